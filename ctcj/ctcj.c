@@ -29,10 +29,14 @@
 #include <pthread.h>
 #include <assert.h>
 #include <string.h>
+#include <errno.h>
+#include <time.h>
 
 #include "ctcp.h"
 #include "ctcg_conf.h"
 #include "ctcg_list.h"
+#include "ctcg_queue.h"
+#include "ctcg_cpu.h"
 #include "ctcj.h"
 #include "ctcl.h"
 #include "ctcs_def.h"
@@ -48,10 +52,6 @@ static ctcj_job_add_table ();
 static ctcj_job_delete_table ();
 static ctcj_init_table_info ();
 static ctcj_destroy_all_job_info ();
-
-static ctcj_job_queue_enq_item ();
-static ctcj_job_queue_deq_item ();
-static ctcj_get_job_queue_left_size ();
 */
 static CTC_REF_TAB_INFO *ctcj_ref_table_find_table (const char *table_name, 
                                                     const char *user_name);
@@ -61,8 +61,6 @@ static void ctcj_job_is_registered_table (CTCJ_JOB_INFO *job,
                                           const char *user_name, 
                                           BOOL *is_registered);
 
-static int ctcj_compare_tid_func (const void *first, 
-                                  const void *second);
 /* inline functions */
 /*
 static inline void ctcj_ref_table_inc_tab_ref_cnt(CTC_REF_TAB_INFO *tab);
@@ -71,10 +69,24 @@ static inline void ctcj_ref_table_inc_tbl_cnt(void);
 static inline void ctcj_ref_table_dec_tbl_cnt(void);
 static inline void ctcj_job_inc_table_cnt (CTCJ_JOB_INFO *job);
 static inline void ctcj_job_dec_table_cnt (CTCJ_JOB_INFO *job);
-static inline int ctcj_get_job_queue_left_size (CTCJ_JOB_INFO *job_info);
 */
+static inline int ctcj_get_job_queue_left_size (CTCJ_JOB_INFO *job_info);
+
+/* capture pool */
+static int ctcj_capture_pool_init (void);
+static void ctcj_capture_pool_final (void);
+static void ctcj_capture_pool_schedule (CTCJ_JOB_INFO *job);
+static void ctcj_capture_pool_wait_idle (CTCJ_JOB_INFO *job);
+static UINT_64 ctcj_capture_pool_wake_lingering (void);
+static void ctcj_capture_notify (void *notify_arg);
+static BOOL ctcj_capture_has_byte_credit (CTCJ_CAPTURE_BATCH *batch);
+static BOOL ctcj_capture_has_credit (CTCJ_JOB_INFO *job);
+static void *ctcj_capture_worker_func (void *args);
+static BOOL ctcj_capture_job_run (CTCJ_JOB_INFO *job);
+static UINT_64 ctcj_get_mono_usec (void);
 
 CTC_JOB_REF_TABLE job_ref_Tbl;
+static CTCJ_CAPTURE_POOL capture_Pool;
 
 /* ctcj */
 extern int ctcj_initialize (void)
@@ -106,6 +118,10 @@ extern int ctcj_initialize (void)
     CTC_TEST_EXCEPTION (ctcj_ref_table_table_unlock (), 
                         err_unlock_failed_label);
 
+    /* capture workers */
+    result = ctcj_capture_pool_init ();
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_capture_pool_init_failed_label);
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_lock_failed_label)
@@ -117,6 +133,10 @@ extern int ctcj_initialize (void)
     {
         result = CTC_ERR_UNLOCK_FAILED;
     }
+    CTC_EXCEPTION (err_capture_pool_init_failed_label)
+    {
+        /* error info set from sub-function */
+    }
     EXCEPTION_END;
 
     return result;
@@ -143,12 +163,8 @@ extern void ctcj_finalize (void)
 
                 if (status == CTCJ_JOB_PROCESSING)
                 {
-                    ctcj_set_job_status (job, CTCJ_JOB_IMMEDIATE_STOPPED);
-
-                    while (status == CTCJ_JOB_PROCESSING)
-                    {
-                        sleep (1);
-                    }
+                    /* returns after a worker closed its cursor */
+                    ctcj_stop_capture_immediately (job);
                 }
                 else
                 {
@@ -199,6 +215,9 @@ extern void ctcj_finalize (void)
         /* empty table list */
     }
 
+    /* phase 3: capture workers, no job is capturing any more */
+    ctcj_capture_pool_final ();
+
     return;
 }
 
@@ -531,17 +550,59 @@ extern int ctcj_init_job_info (CTCJ_JOB_INFO *job_info,
 
     job_info->job_qsize = job_qsize; 
     job_info->long_tran_qsize = long_tran_qsize;
-    job_info->job_queue = (unsigned long *)malloc (sizeof (unsigned long) *
-                                                   job_info->job_qsize);
 
-    CTC_COND_EXCEPTION (job_info->job_queue == NULL, 
+    result = ctcg_spsc_queue_init (&job_info->job_queue, job_info->job_qsize);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                         err_job_queue_alloc_failed_label);
 
+    job_info->update_mode = CTCJ_UPDATE_MODE_ALL_COLUMNS;
+    job_info->send_before_image = CTC_FALSE;
+
+    /* one transaction per frame unless client sets batch attributes */
+    job_info->batch.max_trans = 1;
+    /* frame is sent when full, its size is negotiated per link */
+    job_info->batch.max_bytes = CTCP_PACKET_DATA_ABS_MAX_LEN;
+    job_info->batch.linger_usec = 0;
+    job_info->batch.trans_cnt = 0;
+    job_info->batch.frame_limit = 0;
+    job_info->batch.sent_items = 0;
+    job_info->batch.open_usec = 0;
+    job_info->batch.encoded_bytes = 0;
+    job_info->batch.is_compressed = CTC_FALSE;
+    job_info->batch.is_compact = CTC_FALSE;
+    job_info->batch.frame_flag = 0;
+    job_info->batch.prev_tid = 0;
+    job_info->batch.prev_commit_lsa = 0;
+    job_info->batch.held_trans = NULL;
+    job_info->batch.held_cnt = 0;
+    job_info->batch.held_size = 0;
+    job_info->batch.held_len = 0;
+    job_info->batch.dict_sent = NULL;
+    job_info->batch.dict_sent_size = 0;
+    job_info->batch.sent_bytes = 0;
+    job_info->batch.credit_units = 0;
+    job_info->batch.credit_frames = 0;
+    job_info->batch.credit_bytes = 0;
+    job_info->batch.credit_need = 0;
+    job_info->batch.is_credit_blocked = CTC_FALSE;
+
+    job_info->weight = 1;
+    job_info->deficit = 0;
+
+    /* a slow job must not hold back the others unless it asks to */
+    job_info->queue_full_policy = CTCL_QUEUE_FULL_SPILL;
+
     job_info->status = CTCJ_JOB_NONE;
 
     job_info->last_processed_tid = 0;
+    job_info->cursor = NULL;
     job_info->enqueued_item_num = 0;
     job_info->dequeued_item_num = 0;
+    job_info->linger_due_usec = 0;
+
+    job_info->sched_status = CTCJ_SCHED_IDLE;
+    job_info->capture_session = NULL;
+    CTCG_LIST_INIT_OBJ (&(job_info->run_node), job_info);
     
     CTCG_LIST_INIT_OBJ (&(job_info->node), job_info);
 
@@ -559,11 +620,29 @@ extern int ctcj_init_job_info (CTCJ_JOB_INFO *job_info,
 
 extern void ctcj_destroy_job_info (CTCJ_JOB_INFO *job_info)
 {
+    int i;
+
     assert (job_info->status != CTCJ_JOB_PROCESSING);
 
     if (job_info != NULL)
     {
-        free (job_info->job_queue);
+        ctcg_spsc_queue_final (&job_info->job_queue);
+
+        if (job_info->batch.dict_sent != NULL)
+        {
+            free (job_info->batch.dict_sent);
+        }
+
+        if (job_info->batch.held_trans != NULL)
+        {
+            for (i = 0; i < job_info->batch.held_cnt; i++)
+            {
+                ctcl_encoded_trans_release (job_info->batch.held_trans[i].encoded);
+            }
+
+            free (job_info->batch.held_trans);
+        }
+
         free (job_info);
     }
     else
@@ -574,6 +653,67 @@ extern void ctcj_destroy_job_info (CTCJ_JOB_INFO *job_info)
     return;
 }
 
+
+/*
+ * Description : reallocate job queue to size slots, only before the 
+ *               capture thread started using it
+ *
+ */
+extern int ctcj_job_queue_resize (CTCJ_JOB_INFO *job_info, int size)
+{
+    int result;
+    CTCG_SPSC_QUEUE new_queue;
+
+    assert (job_info != NULL);
+
+    CTC_COND_EXCEPTION (job_info->status == CTCJ_JOB_PROCESSING,
+                        err_invalid_job_status_label);
+
+    if (size != job_info->job_queue.size)
+    {
+        result = ctcg_spsc_queue_init (&new_queue, size);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_job_queue_alloc_failed_label);
+
+        ctcg_spsc_queue_final (&job_info->job_queue);
+
+        job_info->job_queue = new_queue;
+        job_info->job_qsize = size;
+    }
+    else
+    {
+        /* same size, keep current queue */
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_job_status_label)
+    {
+        result = CTC_ERR_INVALID_JOB_STATUS_FAILED;
+    }
+    CTC_EXCEPTION (err_job_queue_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+extern void ctcj_get_job_queue_stat (CTCJ_JOB_INFO *job_info, 
+                                     CTCJ_JOB_QUEUE_STAT *stat)
+{
+    assert (job_info != NULL);
+
+    stat->size = job_info->job_queue.size;
+    stat->used = job_info->job_queue.size - 
+                 ctcj_get_job_queue_left_size (job_info);
+    stat->high_water = ctcg_spsc_queue_get_high_water (&job_info->job_queue);
+    stat->delivered_bytes = __atomic_load_n (&job_info->batch.sent_bytes, 
+                                             __ATOMIC_RELAXED);
+}
+
 /*
 extern CTCG_LIST *ctcj_job_get_table_list (CTCJ_JOB_INFO *job_info)
 {
@@ -813,186 +953,774 @@ static CTC_REF_TAB_INFO *ctcj_ref_table_find_table (const char *table_name,
 }
 
 
-static int ctcj_compare_tid_func (const void *first, 
-                                  const void *second)
+/* capture pool */
+static int ctcj_capture_pool_init (void)
 {
-    if (((CTCL_TRANS_LOG_LIST *)first)->tid > ((CTCL_TRANS_LOG_LIST *)second)->tid)
+    int i;
+    int result;
+    int worker_cnt;
+    pthread_attr_t attr;
+    CTCG_CPU_SET cpu_set;
+
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_CAPTURE_WORKER_COUNT, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&worker_cnt);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_failed_label);
+
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_JOB_MAX_LATENCY, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&capture_Pool.max_latency);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_failed_label);
+
+    result = ctcg_cpu_set_parse (CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_CAPTURE_WORKER_CPU_LIST].value),
+                                 &cpu_set);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_failed_label);
+
+    if (worker_cnt <= 0 && cpu_set.cnt > 0)
+    {
+        /* one worker per listed cpu */
+        worker_cnt = cpu_set.cnt;
+    }
+
+    if (worker_cnt <= 0)
     {
-        return 1;
+        /* sized to cores, workers mostly serialize and send */
+        worker_cnt = (int)sysconf (_SC_NPROCESSORS_ONLN);
+
+        if (worker_cnt <= 0)
+        {
+            worker_cnt = 1;
+        }
+    }
+
+    capture_Pool.worker_cnt = 0;
+    capture_Pool.is_stopped = CTC_FALSE;
+    CTCG_LIST_INIT (&capture_Pool.run_queue);
+    CTCG_LIST_INIT (&capture_Pool.linger_list);
+
+    pthread_mutex_init (&capture_Pool.lock, NULL);
+    pthread_cond_init (&capture_Pool.run_cond, NULL);
+    pthread_cond_init (&capture_Pool.idle_cond, NULL);
+
+    capture_Pool.worker = (pthread_t *)malloc (sizeof (pthread_t) * worker_cnt);
+    CTC_COND_EXCEPTION (capture_Pool.worker == NULL, err_alloc_failed_label);
+
+    for (i = 0; i < worker_cnt; i++)
+    {
+        /* worker starts on its cpu, its buffers are node local */
+        (void)pthread_attr_init (&attr);
+
+        result = ctcg_cpu_bind_attr (&attr, &cpu_set, i);
+
+        if (result == CTC_SUCCESS)
+        {
+            result = pthread_create (&capture_Pool.worker[i], 
+                                     &attr, 
+                                     ctcj_capture_worker_func, 
+                                     NULL);
+        }
+
+        (void)pthread_attr_destroy (&attr);
+
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_create_thread_failed_label); 
+
+        capture_Pool.worker_cnt++;
     }
-    else if (((CTCL_TRANS_LOG_LIST *)first)->tid < ((CTCL_TRANS_LOG_LIST *)second)->tid)
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_get_conf_failed_label)
     {
-        return -1;
+        /* error info set from sub-function */
     }
-    else
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_create_thread_failed_label)
+    {
+        ctcj_capture_pool_final ();
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+static void ctcj_capture_pool_final (void)
+{
+    int i;
+
+    (void)pthread_mutex_lock (&capture_Pool.lock);
+
+    capture_Pool.is_stopped = CTC_TRUE;
+    (void)pthread_cond_broadcast (&capture_Pool.run_cond);
+
+    (void)pthread_mutex_unlock (&capture_Pool.lock);
+
+    for (i = 0; i < capture_Pool.worker_cnt; i++)
+    {
+        (void)pthread_join (capture_Pool.worker[i], NULL);
+    }
+
+    if (capture_Pool.worker != NULL)
+    {
+        free (capture_Pool.worker);
+        capture_Pool.worker = NULL;
+    }
+
+    capture_Pool.worker_cnt = 0;
+
+    pthread_cond_destroy (&capture_Pool.idle_cond);
+    pthread_cond_destroy (&capture_Pool.run_cond);
+    pthread_mutex_destroy (&capture_Pool.lock);
+}
+
+
+/*
+ * Description : make job runnable, a job already queued is not queued 
+ *               twice and a running job is run again by its worker
+ *
+ */
+static void ctcj_capture_pool_schedule (CTCJ_JOB_INFO *job)
+{
+    (void)pthread_mutex_lock (&capture_Pool.lock);
+
+    switch (job->sched_status)
+    {
+        case CTCJ_SCHED_IDLE:
+
+            job->sched_status = CTCJ_SCHED_QUEUED;
+            CTCG_LIST_ADD_LAST (&capture_Pool.run_queue, &job->run_node);
+            (void)pthread_cond_signal (&capture_Pool.run_cond);
+            break;
+
+        case CTCJ_SCHED_LINGERING:
+
+            /* new data or stop, open frame goes on now */
+            CTCG_LIST_REMOVE (&job->run_node);
+            job->sched_status = CTCJ_SCHED_QUEUED;
+            CTCG_LIST_ADD_LAST (&capture_Pool.run_queue, &job->run_node);
+            (void)pthread_cond_signal (&capture_Pool.run_cond);
+            break;
+
+        case CTCJ_SCHED_RUNNING:
+
+            job->sched_status = CTCJ_SCHED_RUNNING_NOTIFIED;
+            break;
+
+        default:
+            /* already queued or notified */
+            break;
+    }
+
+    (void)pthread_mutex_unlock (&capture_Pool.lock);
+}
+
+
+/*
+ * Description : wait until no worker is running job and its cursor 
+ *               is closed, job status must not be processing
+ *
+ */
+static void ctcj_capture_pool_wait_idle (CTCJ_JOB_INFO *job)
+{
+    (void)pthread_mutex_lock (&capture_Pool.lock);
+
+    while (job->sched_status != CTCJ_SCHED_IDLE || job->cursor != NULL)
+    {
+        (void)pthread_cond_wait (&capture_Pool.idle_cond, &capture_Pool.lock);
+    }
+
+    (void)pthread_mutex_unlock (&capture_Pool.lock);
+}
+
+
+/*
+ * Description : lingering jobs whose open frame is due are queued, 
+ *               returns usec until the next is due or 0 when none 
+ *               lingers. pool lock is held by caller.
+ *
+ */
+static UINT_64 ctcj_capture_pool_wake_lingering (void)
+{
+    UINT_64 now;
+    UINT_64 next_usec = 0;
+    CTCG_LIST_NODE *itr;
+    CTCG_LIST_NODE *next;
+    CTCJ_JOB_INFO *job;
+
+    if (CTCG_LIST_IS_EMPTY (&capture_Pool.linger_list) == CTC_TRUE)
     {
         return 0;
     }
+
+    now = ctcj_get_mono_usec ();
+
+    for (itr = CTCG_LIST_GET_FIRST (&capture_Pool.linger_list);
+         itr != &capture_Pool.linger_list;
+         itr = next)
+    {
+        next = CTCG_LIST_GET_NEXT (itr);
+        job = (CTCJ_JOB_INFO *)itr->obj;
+
+        if (job->linger_due_usec <= now)
+        {
+            CTCG_LIST_REMOVE (&job->run_node);
+            job->sched_status = CTCJ_SCHED_QUEUED;
+            CTCG_LIST_ADD_LAST (&capture_Pool.run_queue, &job->run_node);
+        }
+        else if (next_usec == 0 || job->linger_due_usec - now < next_usec)
+        {
+            next_usec = job->linger_due_usec - now;
+        }
+    }
+
+    return next_usec;
 }
 
 
-/* capture */
-extern void *ctcj_capture_thr_func (void *args)
+/*
+ * Description : called by the analyzer when the job queue of an idle 
+ *               job gets a new entry
+ *
+ */
+static void ctcj_capture_notify (void *notify_arg)
 {
-    int i, j;
-    int result;
-    int last_tid;
-    int biggest_tid;
-    int sorted_trans_cnt;
-    int cur_trans_cnt;
-    CTCS_JOB_SESSION *job_session = (CTCS_JOB_SESSION *)args;
-    CTCJ_JOB_INFO *job = NULL;
-    CTCL_TRANS_LOG_LIST *list = NULL;
-    CTCL_TRANS_LOG_LIST **trans_list = NULL;
-    CTCL_TRANS_LOG_LIST ***trans_log_list = NULL;
+    ctcj_capture_pool_schedule ((CTCJ_JOB_INFO *)notify_arg);
+}
 
-    assert (job_session != NULL);
 
-    job = job_session->job;
+static BOOL ctcj_capture_has_byte_credit (CTCJ_CAPTURE_BATCH *batch)
+{
+    SINT_64 credit_bytes;
+
+    credit_bytes = __atomic_load_n (&batch->credit_bytes, __ATOMIC_SEQ_CST);
 
-    trans_list = ctcl_mgr_get_trans_log_list ();
+    /* a frame carries more than its header */
+    return (credit_bytes > CTCP_HDR_LEN && 
+            credit_bytes >= (SINT_64)batch->credit_need) ? CTC_TRUE : CTC_FALSE;
+}
+
+
+/*
+ * Description : CTC_FALSE when a granted unit of credit is too low for 
+ *               the next frame, the grant refilling it schedules job again
+ *
+ */
+static BOOL ctcj_capture_has_credit (CTCJ_JOB_INFO *job)
+{
+    int i;
+    int units;
+    CTCJ_CAPTURE_BATCH *batch = &job->batch;
+
+    units = __atomic_load_n (&batch->credit_units, __ATOMIC_ACQUIRE);
+
+    if (units == 0)
+    {
+        /* consumer never granted, not flow controlled */
+        return CTC_TRUE;
+    }
+
+    /* checked again once blocked, a grant in between did not see it */
+    for (i = 0; i < 2; i++)
+    {
+        if (((units & CTCJ_CREDIT_UNIT_FRAMES) == 0 ||
+             __atomic_load_n (&batch->credit_frames, __ATOMIC_SEQ_CST) > 0) &&
+            ((units & CTCJ_CREDIT_UNIT_BYTES) == 0 ||
+             ctcj_capture_has_byte_credit (batch) == CTC_TRUE))
+        {
+            return CTC_TRUE;
+        }
+
+        __atomic_store_n (&batch->is_credit_blocked, CTC_TRUE, __ATOMIC_SEQ_CST);
+    }
+
+    return CTC_FALSE;
+}
 
-    last_tid = ctcl_mgr_get_last_tid_nolock ();
-    job->last_processed_tid = last_tid;
-    job->start_tid = last_tid + 1;
 
-    while (job->status == CTCJ_JOB_PROCESSING)
+static void *ctcj_capture_worker_func (void *args)
+{
+    BOOL is_runnable;
+    UINT_64 wait_usec;
+    UINT_64 linger_usec;
+    struct timespec abs_time;
+    CTCJ_JOB_INFO *job = NULL;
+
+    while (1)
     {
-        biggest_tid = 0;
-        cur_trans_cnt = ctcl_mgr_get_cur_trans_index ();
+        (void)pthread_mutex_lock (&capture_Pool.lock);
 
-        if (cur_trans_cnt > 0)
+        linger_usec = ctcj_capture_pool_wake_lingering ();
+
+        while (CTCG_LIST_IS_EMPTY (&capture_Pool.run_queue) == CTC_TRUE &&
+               capture_Pool.is_stopped != CTC_TRUE)
         {
-            trans_log_list = (CTCL_TRANS_LOG_LIST ***)malloc (cur_trans_cnt * 
-                                                              sizeof (CTCL_TRANS_LOG_LIST *));
+            wait_usec = (UINT_64)capture_Pool.max_latency * 1000;
 
-            /* get committed transaction log list from ctcl_Mgr */
-            for (i = 0, j = 0; i < cur_trans_cnt; i++)
+            if (linger_usec > 0 && linger_usec < wait_usec)
             {
-                list = trans_list[i];
+                /* woken for the first open frame due */
+                wait_usec = linger_usec;
+            }
 
-                if (list->is_committed == CTC_TRUE)
-                {
-                    if (list->tid > job->last_processed_tid)
-                    {
-                        trans_log_list[j++] = &trans_list[i];
-
-                        if (list->tid > biggest_tid)
-                        {
-                            biggest_tid = list->tid;
-                        }
-                    }
-                    else
-                    {
-                        /* already processed transaction */
-                    }
-                }
-                else
-                {
-                    /* not yet committed transaction */
-                }
+            (void)clock_gettime (CLOCK_REALTIME, &abs_time);
+
+            abs_time.tv_sec += (time_t)(wait_usec / 1000000);
+            abs_time.tv_nsec += (long)(wait_usec % 1000000) * 1000L;
+
+            if (abs_time.tv_nsec >= 1000000000L)
+            {
+                abs_time.tv_sec++;
+                abs_time.tv_nsec -= 1000000000L;
             }
 
-            sorted_trans_cnt = j;
+            (void)pthread_cond_timedwait (&capture_Pool.run_cond, 
+                                          &capture_Pool.lock, 
+                                          &abs_time);
+
+            linger_usec = ctcj_capture_pool_wake_lingering ();
+        }
+
+        if (capture_Pool.is_stopped == CTC_TRUE)
+        {
+            (void)pthread_mutex_unlock (&capture_Pool.lock);
+            break;
+        }
+
+        job = (CTCJ_JOB_INFO *)CTCG_LIST_GET_FIRST (&capture_Pool.run_queue)->obj;
+        CTCG_LIST_REMOVE (&job->run_node);
+        job->sched_status = CTCJ_SCHED_RUNNING;
+
+        (void)pthread_mutex_unlock (&capture_Pool.lock);
+
+        is_runnable = ctcj_capture_job_run (job);
+
+        (void)pthread_mutex_lock (&capture_Pool.lock);
+
+        if (is_runnable == CTC_TRUE || 
+            job->sched_status == CTCJ_SCHED_RUNNING_NOTIFIED)
+        {
+            /* yield to other jobs, run again from the tail */
+            job->sched_status = CTCJ_SCHED_QUEUED;
+            CTCG_LIST_ADD_LAST (&capture_Pool.run_queue, &job->run_node);
+        }
+        else if (job->linger_due_usec != 0)
+        {
+            /* open frame is flushed when due, unless notified before */
+            job->sched_status = CTCJ_SCHED_LINGERING;
+            CTCG_LIST_ADD_LAST (&capture_Pool.linger_list, &job->run_node);
+        }
+        else
+        {
+            job->sched_status = CTCJ_SCHED_IDLE;
+            (void)pthread_cond_broadcast (&capture_Pool.idle_cond);
+        }
+
+        (void)pthread_mutex_unlock (&capture_Pool.lock);
+    }
+
+    return NULL;
+}
+
+
+static UINT_64 ctcj_get_mono_usec (void)
+{
+    struct timespec now;
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return (UINT_64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+
+/*
+ * Description : send job's committed transactions for one turn, returns
+ *               CTC_TRUE if job may have more to send. closes the cursor
+ *               once the job is stopped. 
+ *
+ *               jobs share workers by deficit round robin, each turn adds
+ *               weight quanta to job's deficit and transactions are sent 
+ *               while it is positive. overdraft of the last transaction is 
+ *               paid in the next turn, an idle job loses its deficit.
+ *
+ *               a frame left open by batching waits up to its linger time 
+ *               for more transactions on the linger list of the pool,
+ *               the worker goes on with other jobs meanwhile.
+ *
+ */
+static BOOL ctcj_capture_job_run (CTCJ_JOB_INFO *job)
+{
+    int i;
+    int result;
+    int trans_cnt = 0;
+    int sent_cnt = 0;
+    int appended_cnt;
+    BOOL is_queue_full = CTC_FALSE;
+    BOOL is_credit_out = CTC_FALSE;
+    UINT_64 elapsed_usec;
+    UINT_64 encoded_bytes;
+    CTCS_JOB_SESSION *job_session = (CTCS_JOB_SESSION *)job->capture_session;
+    CTCL_TRANS_LOG_LIST *trans_log_list[CTCL_STREAM_FETCH_MAX];
+
+    job->linger_due_usec = 0;
+
+    if (job->cursor == NULL)
+    {
+        /* send failed before, waits for stop */
+        return CTC_FALSE;
+    }
+
+    if (job->status != CTCJ_JOB_PROCESSING)
+    {
+        /* transactions already in open frame are sent */
+        (void)ctcp_flush_captured_data_result (job_session->link,
+                                               job->job_desc,
+                                               job_session->sgid,
+                                               &job->batch);
+
+        ctcl_stream_close_cursor (job->cursor);
+        job->cursor = NULL;
+
+        return CTC_FALSE;
+    }
+
+    /* entries spilled by the analyzer are written even when nothing can
+     * be sent, a write failure fails the cursor and the next fetch */
+    (void)ctcl_stream_write_spill (job->cursor);
+
+    if (ctcn_link_is_send_queue_full (job_session->link) == CTC_TRUE)
+    {
+        /* network is behind, notified when the send queue drains */
+        return CTC_FALSE;
+    }
+
+    if (ctcj_capture_has_credit (job) != CTC_TRUE)
+    {
+        /* transactions wait in the job queue until consumer grants */
+        is_credit_out = CTC_TRUE;
+    }
+    else
+    {
+        job->deficit += (SINT_64)job->weight * CTCJ_DRR_QUANTUM_BYTES;
+    }
 
-            if (sorted_trans_cnt > 1)
+    while (job->deficit > 0 && 
+           is_queue_full == CTC_FALSE && 
+           is_credit_out == CTC_FALSE)
+    {
+        result = ctcl_stream_fetch (job->cursor, 
+                                    trans_log_list, 
+                                    CTCL_STREAM_FETCH_MAX, 
+                                    &trans_cnt);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_fetch_failed_label);
+
+        if (trans_cnt == 0)
+        {
+            break;
+        }
+
+        for (i = 0; 
+             i < trans_cnt && 
+             job->deficit > 0 && 
+             is_queue_full == CTC_FALSE && 
+             is_credit_out == CTC_FALSE; 
+             i++)
+        {
+            if (job->batch.trans_cnt == 0)
             {
-                /* sort trans_log_list */
-                qsort (trans_log_list[0], 
-                       sorted_trans_cnt, 
-                       sizeof(CTCL_TRANS_LOG_LIST *), 
-                       ctcj_compare_tid_func);
+                job->batch.open_usec = ctcj_get_mono_usec ();
             }
 
-            /* send transaction log list */
+            encoded_bytes = job->batch.encoded_bytes;
+
+            /* small transactions are packed into a frame */
             result = ctcp_send_captured_data_result (job_session->link,
-                                                     job_session->job->job_desc,
+                                                     job->job_desc,
                                                      job_session->sgid,
-                                                     sorted_trans_cnt,
-                                                     (void **)trans_log_list);
+                                                     1,
+                                                     (void **)&trans_log_list[i],
+                                                     job->update_mode,
+                                                     job->send_before_image,
+                                                     &job->batch,
+                                                     &appended_cnt);
 
             CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                                 err_send_capture_result_failed_label);
 
-            /* update tid infos and decrease ref_cnt of ctcl */
-            job->last_processed_tid = biggest_tid;
+            job->deficit -= (SINT_64)(job->batch.encoded_bytes - encoded_bytes);
+
+            if (appended_cnt == 0)
+            {
+                /* stays in the job queue, sent again after a grant */
+                is_credit_out = !ctcj_capture_has_credit (job);
+
+                if (is_credit_out == CTC_FALSE)
+                {
+                    /* granted meanwhile */
+                    i--;
+                    continue;
+                }
+
+                break;
+            }
 
-            /* free trans_log_list */
-            free (trans_log_list);
-            trans_log_list = NULL;
+            is_queue_full = ctcn_link_is_send_queue_full (job_session->link);
+            is_credit_out = !ctcj_capture_has_credit (job);
         }
-        else
+
+        if (i == 0)
         {
-            usleep (100 * 1000);
-            continue;
+            break;
         }
+
+        job->last_processed_tid = trans_log_list[i - 1]->tid;
+
+        /* release sent entries to the stream, open frame has its own copy */
+        ctcl_stream_advance (job->cursor, i);
+        sent_cnt += i;
     }
 
-    pthread_exit ((void *)&result);
+    if (is_credit_out == CTC_TRUE)
+    {
+        /* open frame is within credit, it goes with the next grant or
+         * when its linger time is over */
+        return CTC_FALSE;
+    }
 
-    CTC_EXCEPTION (err_send_capture_result_failed_label)
+    if (is_queue_full == CTC_TRUE)
     {
-        /* error info set from sub-function */
-        if (trans_log_list != NULL)
+        /* open frame is continued once the queue drains */
+        return CTC_FALSE;
+    }
+
+    if (sent_cnt == 0)
+    {
+        /* nothing to send, an idle job gets no credit */
+        job->deficit = 0;
+
+        if (job->batch.trans_cnt > 0)
         {
-            free (trans_log_list);
+            elapsed_usec = ctcj_get_mono_usec () - job->batch.open_usec;
+
+            if (elapsed_usec < (UINT_64)job->batch.linger_usec)
+            {
+                /* parked by worker, run again when due or notified */
+                job->linger_due_usec = job->batch.open_usec + 
+                                       (UINT_64)job->batch.linger_usec;
+
+                return CTC_FALSE;
+            }
         }
+
+        /* linger time is over */
+        result = ctcp_flush_captured_data_result (job_session->link,
+                                                  job->job_desc,
+                                                  job_session->sgid,
+                                                  &job->batch);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_send_capture_result_failed_label);
+
+        /* analyzer notifies when the job queue gets a new entry */
+        return CTC_FALSE;
+    }
+
+    if (job->batch.linger_usec == 0)
+    {
+        result = ctcp_flush_captured_data_result (job_session->link,
+                                                  job->job_desc,
+                                                  job_session->sgid,
+                                                  &job->batch);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_send_capture_result_failed_label);
+    }
+
+    return CTC_TRUE;
+
+    CTC_EXCEPTION (err_fetch_failed_label)
+    {
+        /* error info set from sub-function */
+        ctcl_stream_close_cursor (job->cursor);
+        job->cursor = NULL;
+    }
+    CTC_EXCEPTION (err_send_capture_result_failed_label)
+    {
+        /* error info set from sub-function */
+        ctcl_stream_close_cursor (job->cursor);
+        job->cursor = NULL;
     }
     EXCEPTION_END;
 
-    pthread_exit ((void *)&result);
+    return CTC_FALSE;
 }
 
 
-extern void ctcj_stop_capture_immediately (pthread_t job_thr_id, 
-                                           CTCJ_JOB_INFO *job)
+/* capture */
+extern int ctcj_start_capture (CTCJ_JOB_INFO *job, 
+                               void *job_session,
+                               CTCL_STREAM_POS *start_pos)
 {
+    int result;
+    int last_tid;
+
     assert (job != NULL);
+    assert (job_session != NULL);
+
+    /* previous capture of this job may still be closing its cursor */
+    ctcj_capture_pool_wait_idle (job);
+
+    job->capture_session = job_session;
+    job->deficit = 0;
+
+    /* read transactions committed from start_pos on, in commit order */
+    result = ctcl_stream_open_cursor (&job->cursor, 
+                                      &job->job_queue,
+                                      start_pos,
+                                      job->queue_full_policy,
+                                      ctcj_capture_notify,
+                                      (void *)job);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_open_cursor_failed_label);
+
+    /* a job stopped by a full send queue goes on when it drains */
+    ctcn_link_set_drain_func (((CTCS_JOB_SESSION *)job_session)->link,
+                              ctcj_capture_notify,
+                              (void *)job);
+
+    last_tid = ctcl_mgr_get_last_tid_nolock ();
+    job->last_processed_tid = last_tid;
+    job->start_tid = last_tid + 1;
+
+    (void)ctcj_set_job_status (job, CTCJ_JOB_PROCESSING);
+
+    return CTC_SUCCESS;
 
-    if (job_thr_id > 0)
+    CTC_EXCEPTION (err_open_cursor_failed_label)
     {
-        if (job->status == CTCJ_JOB_PROCESSING)
-        {
-            job->status = CTCJ_JOB_IMMEDIATE_STOPPED;
-        }
-        else
-        {
-            /* already stopped */
-        }
+        job->cursor = NULL;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+extern void ctcj_stop_capture_immediately (CTCJ_JOB_INFO *job)
+{
+    assert (job != NULL);
+
+    if (job->status == CTCJ_JOB_PROCESSING)
+    {
+        job->status = CTCJ_JOB_IMMEDIATE_STOPPED;
+
+        /* a worker closes the cursor, even if nothing to send */
+        ctcj_capture_pool_schedule (job);
+        ctcj_capture_pool_wait_idle (job);
+
+        ctcn_link_set_drain_func (((CTCS_JOB_SESSION *)job->capture_session)->link,
+                                  NULL,
+                                  NULL);
     }
     else
     {
-        /* invalid thread id, critical system error but, ignore */
+        /* already stopped */
     }
 
     return;
 }
 
 
-extern void ctcj_stop_capture (pthread_t job_thr_id, CTCJ_JOB_INFO *job)
+extern void ctcj_stop_capture (CTCJ_JOB_INFO *job)
 {
     assert (job != NULL);
 
-    if (job_thr_id > 0)
+    if (job->status == CTCJ_JOB_PROCESSING)
     {
-        if (job->status == CTCJ_JOB_PROCESSING)
-        {
-            job->status = CTCJ_JOB_STOPPED;
-        }
-        else
-        {
-            /* already stopped */
-        }
+        job->status = CTCJ_JOB_STOPPED;
+
+        /* a worker closes the cursor, even if nothing to send */
+        ctcj_capture_pool_schedule (job);
+        ctcj_capture_pool_wait_idle (job);
+
+        ctcn_link_set_drain_func (((CTCS_JOB_SESSION *)job->capture_session)->link,
+                                  NULL,
+                                  NULL);
     }
     else
     {
-        /* invalid thread id, critical system error but, ignore */
+        /* already stopped */
     }
 
     return;
 }
 
 
+/*
+ * Description : consumer may take amount more of unit. sending stops 
+ *               when any unit ever granted is too low for the next frame,
+ *               a frame is capped at the byte credit left when it is 
+ *               opened. a frame opened before the first grant of a unit 
+ *               is not capped by it.
+ *
+ */
+extern int ctcj_grant_credit (CTCJ_JOB_INFO *job, int unit, SINT_64 amount)
+{
+    int result;
+
+    assert (job != NULL);
+
+    CTC_COND_EXCEPTION (amount <= 0, err_invalid_value_label);
+
+    switch (unit)
+    {
+        case CTCJ_CREDIT_UNIT_FRAMES:
+
+            (void)__atomic_add_fetch (&job->batch.credit_frames, 
+                                      amount, 
+                                      __ATOMIC_SEQ_CST);
+            break;
+
+        case CTCJ_CREDIT_UNIT_BYTES:
+
+            (void)__atomic_add_fetch (&job->batch.credit_bytes, 
+                                      amount, 
+                                      __ATOMIC_SEQ_CST);
+            break;
+
+        default:
+
+            CTC_COND_EXCEPTION (CTC_TRUE, err_invalid_unit_label);
+            break;
+    }
+
+    (void)__atomic_or_fetch (&job->batch.credit_units, unit, __ATOMIC_RELEASE);
+
+    if (__atomic_exchange_n (&job->batch.is_credit_blocked, 
+                             CTC_FALSE, 
+                             __ATOMIC_SEQ_CST) == CTC_TRUE)
+    {
+        /* a job not capturing any more returns at once */
+        ctcj_capture_pool_schedule (job);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_value_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_invalid_unit_label)
+    {
+        result = CTC_ERR_INVALID_ATTR_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
 /* inline functions */
 static inline void ctcj_ref_table_inc_tab_ref_cnt(CTC_REF_TAB_INFO *tab)
 {
@@ -1020,7 +1748,8 @@ static inline void ctcj_job_dec_table_cnt (CTCJ_JOB_INFO *job)
 
 static inline int ctcj_get_job_queue_left_size (CTCJ_JOB_INFO *job_info)
 {
-    return 0;
+    return job_info->job_queue.size - 
+           ctcg_spsc_queue_get_used (&job_info->job_queue);
 }
 
 
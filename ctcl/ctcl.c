@@ -29,7 +29,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/time.h>
+#include <time.h>
 #include <pthread.h>
+#include <arpa/inet.h>
 
 #include "porting.h"
 #include "utility.h"
@@ -54,6 +56,11 @@
 #include "util_func.h"
 
 #include "ctcl.h"
+#include "ctcl_encoder.h"
+#include "ctcl_spill.h"
+#include "ctcg_queue.h"
+#include "ctcg_cpu.h"
+#include "ctcg_trace.h"
 #include "ctc_common.h"
 
 
@@ -85,6 +92,10 @@
 #define CTCL_LOG_IS_IN_ARCHIVE(pageid) \
     ((pageid) < ctcl_Mgr.log_info.act_log.log_hdr->nxarv_pageid)
 
+#define CTCL_TRANS_SLOT(idx) \
+    (&ctcl_Mgr.log_info.trans_log_chunk[(idx) / CTCL_TRANS_LOG_LIST_COUNT] \
+                                       [(idx) % CTCL_TRANS_LOG_LIST_COUNT])
+
 #define SIZEOF_CTCL_CACHE_LOG_BUFFER(io_size) \
     (offsetof(CTCL_CACHE_BUFFER, logpage) + (io_size))
 
@@ -421,7 +432,9 @@ struct ctcl_info
     CTCL_LOG_LSA last_committed_rep_lsa;    
 
 
-    CTCL_TRANS_LOG_LIST **trans_log_list;
+    /* slots of transactions being analyzed, analyzer thread only. 
+     * grows by chunks, a slot never moves while it is in use */
+    CTCL_TRANS_LOG_LIST *trans_log_chunk[CTCL_TRANS_LOG_CHUNK_MAX];
     int trans_cnt;                  /* the number of transactions */
     int cur_trans;                  /* the index of the current transaction */
     time_t log_record_time;         /* time of the last commit log record */
@@ -447,6 +460,105 @@ struct ctcl_info
     unsigned long commit_counter;
 };
 
+/* committed transaction published on the commit stream */
+typedef struct ctcl_stream_entry CTCL_STREAM_ENTRY;
+struct ctcl_stream_entry
+{
+    UINT_64 seq;                        /* commit sequence number */
+    CTCL_LOG_LSA commit_lsa;
+    CTCL_TRANS_LOG_LIST *trans_log_list;  /* detached from analyzer slot */
+    UINT_64 mem_bytes;                  /* charged to each job queue */
+    CTCL_STREAM_ENTRY *next;            /* kept after unlinked */
+    UINT_64 retire_epoch;
+    CTCL_STREAM_ENTRY *retire_next;
+};
+
+struct ctcl_stream_cursor
+{
+    UINT_64 last_enq_seq;               /* seq of last entry delivered */
+    CTCG_SPSC_QUEUE *queue;             /* job queue, analyzer produces */
+    UINT_64 queued_bytes;               /* mem_bytes of entries in queue */
+    int queue_full_policy;              /* CTCL_QUEUE_FULL_POLICY */
+    BOOL is_failed;                     /* spill failed, nothing more is 
+                                           delivered, fetch fails */
+    CTCL_STREAM_NOTIFY_FUNC notify_func;/* called when empty queue gets 
+                                           a new entry */
+    void *notify_arg;
+
+    /* 
+     * spill : a job whose queue is full or holds job_mem_quota bytes 
+     * starts spilling. while is_spilling, the analyzer hands every new 
+     * entry to the job on spill_pending instead of the queue, so the 
+     * queue only holds older entries. the job thread appends pending 
+     * entries to the segment file, reads the file once the queue is 
+     * empty, and clears is_spilling when both are drained. only the job
+     * thread touches the file. the analyzer and the job share pending
+     * entries and is_spilling under the stream lock.
+     */
+    BOOL is_spilling;
+    CTCL_STREAM_ENTRY **spill_pending;  /* not written yet, commit order */
+    int spill_pending_cnt;
+    int spill_pending_size;
+    UINT_64 spill_writing_seq;          /* first entry being written, 
+                                           0 : none */
+    CTCL_SPILL spill;
+    int spill_list_cnt;                 /* decoded, not advanced yet */
+    CTCL_TRANS_LOG_LIST *spill_list[CTCL_STREAM_FETCH_MAX];
+
+    /*
+     * replay : a cursor opened at a past position reads retained entries
+     * straight from the stream without the stream lock, inside an epoch.
+     * the analyzer does not deliver to it meanwhile. it joins delivery 
+     * once it reaches the tail. reclaim keeps replay_prev and every 
+     * entry after it.
+     */
+    BOOL is_replaying;
+    UINT_64 replay_seq;                 /* seq of next entry to fetch */
+    CTCL_STREAM_ENTRY *replay_prev;     /* last advanced entry, or NULL */
+    UINT_64 epoch;                      /* epoch entered, 0 : outside */
+
+    CTCG_LIST_NODE node;
+};
+
+/* 
+ * commit stream : committed transactions in commit order, shared by 
+ * all jobs. appended and reclaimed only by the analyzer thread, entries
+ * are freed once no job queue holds them and they fall out of the 
+ * retention ring, i.e. the latest retention_trans_cnt transactions of 
+ * at most retention_item_cnt items, kept for jobs resuming by commit 
+ * lsa after reconnect. an entry is handed to each job through its 
+ * bounded job queue, when a job queue is full or holds job_mem_quota 
+ * bytes the entry is spilled to the job's segment file. only a job that
+ * asked for CTCL_QUEUE_FULL_BLOCK makes the analyzer wait until it 
+ * dequeues (backpressure on every job).
+ *
+ * epoch : replaying cursors walk the entries without the lock. reclaim 
+ * unlinks entries under the lock, retires them with the current epoch 
+ * and advances it. a retired entry is freed once every cursor reading 
+ * the stream has entered a later epoch.
+ */
+typedef struct ctcl_commit_stream CTCL_COMMIT_STREAM;
+struct ctcl_commit_stream
+{
+    UINT_64 next_seq;
+    CTCL_LOG_LSA horizon_lsa;           /* this and older can not replay */
+    int entry_cnt;
+    long item_cnt;                      /* items of all entries */
+    int retention_trans_cnt;
+    int retention_item_cnt;
+    int is_publisher_blocked;           /* analyzer waits on space_cond */
+    UINT_64 job_mem_quota;              /* queued bytes a job may hold */
+    char spill_path[CTCL_LOG_PATH_MAX];
+    CTCL_STREAM_ENTRY *head;
+    CTCL_STREAM_ENTRY *tail;
+    UINT_64 epoch;
+    CTCL_STREAM_ENTRY *retired_head;    /* unlinked, in epoch order */
+    CTCL_STREAM_ENTRY *retired_tail;
+    CTCG_LIST cursor_list;
+    pthread_mutex_t lock;
+    pthread_cond_t space_cond;          /* signaled when job dequeues */
+};
+
 /* ctc log manager */
 typedef struct ctcl_mgr CTCL_MGR;
 struct ctcl_mgr
@@ -463,7 +575,9 @@ struct ctcl_mgr
 
     CTCL_ARGS thr_args;
     CTCL_INFO log_info;
+    CTCL_COMMIT_STREAM stream;
     pthread_t analyzer_thr;  
+    CTCG_CPU_SET analyzer_cpu_set;
 //    CTCL_THREAD analyzer_thr;   
 //    CTC_JOB_REF_TABLE *job_ref_tbl;   /* job reference table */
 };
@@ -582,7 +696,7 @@ static int ctcl_find_log_pagesize (CTCL_ACT_LOG *act_log,
 static int ctcl_info_pre_alloc (void);
 
 static int ctcl_check_page_exist (CTCL_LOG_PAGEID pageid);
-static int ctcl_init_trans_log_list (BOOL is_need_realloc);
+static int ctcl_grow_trans_log_list (void);
 
 static BOOL ctcl_is_trans_log_list_empty (void);
 
@@ -612,6 +726,7 @@ static void ctcl_unlink_log_item (CTCL_TRANS_LOG_LIST *trans_log_list,
 static void ctcl_free_log_item (CTCL_TRANS_LOG_LIST *trans_log_list, 
                                 CTCL_ITEM *item);
 
+static void ctcl_free_item_columns (CTCL_ITEM *item);
 static void ctcl_free_all_log_items_except_head (CTCL_TRANS_LOG_LIST *trans_log_list);
 
 static void ctcl_free_all_log_items (CTCL_TRANS_LOG_LIST *trans_log_list);
@@ -658,6 +773,25 @@ static int ctcl_get_insert_current (OR_BUF *buf,
                                     CTCL_ITEM *item, 
                                     int offset_size);
 
+static CTCL_COLUMN *ctcl_make_column (SM_ATTRIBUTE *att, DB_VALUE *value);
+
+static int ctcl_set_key_column (CTCL_COLUMN *key_col, 
+                                SM_ATTRIBUTE *att, 
+                                DB_VALUE *value);
+
+static int ctcl_get_update_before (MOBJ classobj, 
+                                   RECDES *old_recdes, 
+                                   CTCL_ITEM *item);
+
+static CTCL_COLUMN *ctcl_find_set_column (CTCG_LIST *col_list, 
+                                          const char *name);
+
+static void ctcl_set_column_old_value (CTCL_ITEM *item, 
+                                       SM_ATTRIBUTE *att, 
+                                       DB_VALUE *value);
+
+static void ctcl_mark_changed_columns (CTCL_ITEM *item);
+
 static int ctcl_get_undoredo_diff (CTCL_LOG_PAGE **pgptr, 
                                    CTCL_LOG_PAGEID *pageid, 
                                    CTCL_PAGE_LENGTH *offset, 
@@ -745,6 +879,31 @@ static inline void ctcl_mgr_inc_last_tid(void);
 static inline void ctcl_mgr_dec_last_tid(void);
 
 static inline void ctcl_trans_log_set_committed (CTCL_TRANS_LOG_LIST *trans_log_list);
+static void ctcl_stream_init (CTCL_CONF_ITEMS *conf_items);
+static void ctcl_stream_final (void);
+static void ctcl_stream_free_entry (CTCL_STREAM_ENTRY *entry);
+static int ctcl_stream_publish (int tid, CTCL_LOG_LSA *commit_lsa);
+static void ctcl_stream_deliver (CTCL_STREAM_ENTRY *entry);
+static BOOL ctcl_stream_has_quota (CTCL_STREAM_CURSOR *cursor, 
+                                   CTCL_STREAM_ENTRY *entry);
+static BOOL ctcl_stream_spill (CTCL_STREAM_CURSOR *cursor, 
+                               CTCL_STREAM_ENTRY *entry);
+static UINT_64 ctcl_stream_get_trans_bytes (CTCL_TRANS_LOG_LIST *trans_log_list);
+static int ctcl_stream_fetch_spill (CTCL_STREAM_CURSOR *cursor,
+                                    int max_cnt);
+static void ctcl_stream_free_trans_log_list (CTCL_TRANS_LOG_LIST *trans_log_list);
+static void ctcl_stream_reclaim (void);
+static int ctcl_stream_set_start_pos (CTCL_STREAM_CURSOR *cursor,
+                                      CTCL_STREAM_POS *start_pos);
+static CTCL_STREAM_ENTRY *ctcl_stream_get_replay_entry (CTCL_STREAM_CURSOR *cursor);
+static void ctcl_stream_fetch_replay (CTCL_STREAM_CURSOR *cursor,
+                                      CTCL_TRANS_LOG_LIST **trans_list,
+                                      int max_cnt,
+                                      int *fetched_cnt);
+static void ctcl_stream_advance_replay (CTCL_STREAM_CURSOR *cursor, int cnt);
+static void ctcl_stream_enter_epoch (CTCL_STREAM_CURSOR *cursor);
+static void ctcl_stream_leave_epoch (CTCL_STREAM_CURSOR *cursor);
+
 static inline int ctcl_get_trans_ref_cnt (CTCL_TRANS_LOG_LIST *trans_log_list);
 static inline void ctcl_inc_trans_ref_cnt (CTCL_TRANS_LOG_LIST *trans_log_list);
 static inline void ctcl_dec_trans_ref_cnt (CTCL_TRANS_LOG_LIST *trans_log_list);
@@ -754,6 +913,7 @@ extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id)
 {
     int result;
     int stage = 0;
+    CTCG_CPU_SET saved_cpu_set;
 
     pthread_mutex_init(&ctcl_Mgr.lock, NULL);
 
@@ -774,12 +934,19 @@ extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id)
     /* init log analyzer thread arguments */
     ctcl_thr_args_init (conf_items, &ctcl_Mgr.thr_args);
 
+    memcpy (&ctcl_Mgr.analyzer_cpu_set, 
+            &conf_items->analyzer_cpu_set, 
+            sizeof (CTCG_CPU_SET));
+
     /* init LZO */
     CTC_COND_EXCEPTION (lzo_init () != LZO_E_OK, err_lzo_init_failed_label);
 
     /* init log info */
     ctcl_info_init (conf_items->log_path, conf_items->max_mem_size);
 
+    /* init commit stream */
+    ctcl_stream_init (conf_items);
+
     /* init cache buffer */
     ctcl_Mgr.log_info.cache_pb = ctcl_init_cache_pb ();
     CTC_COND_EXCEPTION (ctcl_Mgr.log_info.cache_pb == NULL,
@@ -793,17 +960,35 @@ extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id)
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                         err_find_log_pagesize_failed_label);
 
-    /* DEBUG */
-    printf ("act_log.log_hdr.eof_lsa.pageid = %d\n \
-            act_log.log_hdr.append_lsa.pageid = %d\n", 
-            ctcl_Mgr.log_info.act_log.log_hdr->eof_lsa.pageid, 
-            ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid);
+    CTCG_TRACE_INFO (CTCG_TRACE_EV_LOG_HDR,
+                     ctcl_Mgr.log_info.act_log.log_hdr->eof_lsa.pageid,
+                     ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid,
+                     0, 0);
+
+    if (ctcl_Mgr.analyzer_cpu_set.cnt > 0)
+    {
+        /* page cache is first touched on the analyzer cpus, so its pages
+         * come from their node */
+        (void)ctcg_cpu_get_thread (pthread_self (), &saved_cpu_set);
+
+        result = ctcg_cpu_bind_thread (pthread_self (), 
+                                       &ctcl_Mgr.analyzer_cpu_set, 
+                                       CTCG_CPU_ALL);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_bind_cpu_failed_label);
+    }
 
     result = ctcl_init_cache_log_buffer (ctcl_Mgr.log_info.cache_pb, 
                                          ctcl_Mgr.log_info.cache_buffer_size, 
                                          SIZEOF_CTCL_CACHE_LOG_BUFFER(
                                              ctcl_Mgr.log_info.act_log.db_logpagesize));
 
+    if (ctcl_Mgr.analyzer_cpu_set.cnt > 0)
+    {
+        (void)ctcg_cpu_bind_thread (pthread_self (), 
+                                    &saved_cpu_set, 
+                                    CTCG_CPU_ALL);
+    }
+
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                         err_init_cache_log_buffer_failed_label);
 
@@ -817,14 +1002,18 @@ extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id)
     AU_DISABLE_PASSWORDS ();
     db_set_client_type (DB_CLIENT_TYPE_CTC);
 
-    if (db_login ("DBA", NULL) != CTC_SUCCESS)
+    result = db_login ("DBA", NULL);
+
+    if (result != CTC_SUCCESS)
     {
-        printf ("db login failed\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DB_LOGIN_FAILED, result, 0, 0, 0);
     }
 
-    if (db_restart ("cub_ctc", 1, ctcl_Mgr.src_db_name) != CTC_SUCCESS)
+    result = db_restart ("cub_ctc", 1, ctcl_Mgr.src_db_name);
+
+    if (result != CTC_SUCCESS)
     {
-        printf ("db restart failed\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DB_RESTART_FAILED, result, 0, 0, 0);
     }
 
     //db_Connect_status = DB_CONNECTION_STATUS_CONNECTED;
@@ -871,6 +1060,11 @@ extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id)
     {
         /* error info set from sub-function */
     }
+    CTC_EXCEPTION (err_bind_cpu_failed_label)
+    {
+        fprintf (stdout, "\n ERROR: invalid analyzer cpu list \n\t");
+        fflush (stdout);
+    }
     CTC_EXCEPTION (err_init_cache_log_buffer_failed_label)
     {
         fprintf (stdout, "\n ERROR: cache log buffer init failed \n\t");
@@ -968,8 +1162,7 @@ static int ctcl_get_last_ha_applied_info (void)
 
         if (CTCL_LSA_ISNULL (&ctcl_Mgr.log_info.required_lsa))
         {
-            /* DEBUG */
-            printf ("required_lsa cannot be NULL");
+            CTCG_TRACE_ERROR (CTCG_TRACE_EV_REQUIRED_LSA_NULL, 0, 0, 0, 0);
             return CTC_FAILURE;
         }
     }
@@ -1259,7 +1452,8 @@ static void ctcl_info_init (const char *log_path, const int max_mem_size)
     CTCL_LSA_SET_NULL (&ctcl_Mgr.log_info.final_lsa);
     CTCL_LSA_SET_NULL (&ctcl_Mgr.log_info.committed_lsa);
 
-    ctcl_Mgr.log_info.trans_log_list = NULL;
+    memset (ctcl_Mgr.log_info.trans_log_chunk, 0, 
+            sizeof (ctcl_Mgr.log_info.trans_log_chunk));
 
     ctcl_Mgr.log_info.trans_cnt = 0;
     ctcl_Mgr.log_info.cur_trans = 0;
@@ -1319,6 +1513,8 @@ extern void ctcl_finalize(void)
 {
     ctcl_stop_log_analyzer ();
 
+    ctcl_stream_final ();
+
     ctcl_Mgr.status = CTCL_MGR_STATUS_STOPPED;
     ctcl_Mgr.cur_job_cnt = 0;
 }
@@ -1366,8 +1562,9 @@ extern int ctcl_mgr_set_first_tid (void)
     }
     CTC_EXCEPTION (err_ctcl_mgr_not_ready_label)
     {
-        /* DEBUG for thread start timing */
-        printf ("err_ctcl_mgr_not_ready_label\n");
+        /* for thread start timing */
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_MGR_NOT_READY, 
+                          ctcl_Mgr.status, 0, 0, 0);
         result = CTC_ERR_NOT_READY_FAILED;
     }
     CTC_EXCEPTION (err_unlock_failed_label)
@@ -1432,11 +1629,6 @@ extern int ctcl_mgr_get_last_tid_nolock (void)
     return ctcl_Mgr.last_tid;
 }
 
-extern int ctcl_mgr_get_cur_trans_index (void)
-{
-    return ctcl_Mgr.log_info.cur_trans;
-}
-
 extern int ctcl_mgr_get_cur_job_cnt (void)
 {
     return ctcl_Mgr.cur_job_cnt;
@@ -1469,145 +1661,196 @@ extern int ctcl_mgr_inc_cur_job_cnt (void)
 }
 
 
-extern CTCL_TRANS_LOG_LIST **ctcl_mgr_get_trans_log_list (void)
+static void ctcl_stream_init (CTCL_CONF_ITEMS *conf_items)
 {
-    return ctcl_Mgr.log_info.trans_log_list;
+    pthread_mutex_init (&ctcl_Mgr.stream.lock, NULL);
+    pthread_cond_init (&ctcl_Mgr.stream.space_cond, NULL);
+
+    ctcl_Mgr.stream.next_seq = 1;
+    CTCL_LSA_SET_NULL (&ctcl_Mgr.stream.horizon_lsa);
+    ctcl_Mgr.stream.entry_cnt = 0;
+    ctcl_Mgr.stream.item_cnt = 0;
+    ctcl_Mgr.stream.retention_trans_cnt = conf_items->retention_trans_cnt;
+    ctcl_Mgr.stream.retention_item_cnt = conf_items->retention_item_cnt;
+    ctcl_Mgr.stream.is_publisher_blocked = CTC_FALSE;
+    ctcl_Mgr.stream.job_mem_quota = (UINT_64)conf_items->job_mem_quota_kb * 1024;
+
+    memset (ctcl_Mgr.stream.spill_path, 0, CTCL_LOG_PATH_MAX);
+    strncpy (ctcl_Mgr.stream.spill_path, 
+             conf_items->spill_path, 
+             strlen (conf_items->spill_path));
+    ctcl_Mgr.stream.head = NULL;
+    ctcl_Mgr.stream.tail = NULL;
+    ctcl_Mgr.stream.epoch = 1;
+    ctcl_Mgr.stream.retired_head = NULL;
+    ctcl_Mgr.stream.retired_tail = NULL;
+
+    CTCG_LIST_INIT (&ctcl_Mgr.stream.cursor_list);
 }
 
 
-/*
- * Description : modified from la_log_phypageid()
- *               get the physical page id from the logical pageid
- *
- */
-static CTCL_LOG_PHY_PAGEID ctcl_get_log_phypageid (CTCL_LOG_PAGEID lpageid)
+static void ctcl_stream_free_trans_log_list (CTCL_TRANS_LOG_LIST *trans_log_list)
 {
-    CTCL_LOG_PAGEID tmp_pageid;
-    CTCL_LOG_PHY_PAGEID phy_pageid;
+    CTCL_ENCODED_TRANS *encoded;
 
-    if (lpageid == CTCL_LOGPB_HEADER_PAGE_ID)
-    {
-        phy_pageid = 0;
-    }
-    else
+    while (trans_log_list->encoded_list != NULL)
     {
-        tmp_pageid = lpageid - ctcl_Mgr.log_info.act_log.log_hdr->fpageid;
+        encoded = trans_log_list->encoded_list;
+        trans_log_list->encoded_list = encoded->next;
 
-        if (tmp_pageid >= ctcl_Mgr.log_info.act_log.log_hdr->npages)
-        {
-            tmp_pageid %= ctcl_Mgr.log_info.act_log.log_hdr->npages;
-        }
-        else if (tmp_pageid < 0)
-        {
-            tmp_pageid = ctcl_Mgr.log_info.act_log.log_hdr->npages -
-                ((-tmp_pageid) % ctcl_Mgr.log_info.act_log.log_hdr->npages);
-        }
+        ctcl_encoded_trans_release (encoded);
+    }
 
-        tmp_pageid++;
+    ctcl_free_all_log_items (trans_log_list);
+    free (trans_log_list);
+}
 
-        if (tmp_pageid > ctcl_Mgr.log_info.act_log.log_hdr->npages)
-        {
-            tmp_pageid %= ctcl_Mgr.log_info.act_log.log_hdr->npages;
-        }
 
-        assert (tmp_pageid <= CTCL_PAGE_ID_MAX);
-        phy_pageid = (CTCL_LOG_PHY_PAGEID) tmp_pageid;
+static void ctcl_stream_free_entry (CTCL_STREAM_ENTRY *entry)
+{
+    if (entry->trans_log_list != NULL)
+    {
+        ctcl_stream_free_trans_log_list (entry->trans_log_list);
+        entry->trans_log_list = NULL;
     }
 
-    return phy_pageid;
+    free (entry);
 }
 
 
-static int ctcl_read_log_page_from_disk (char *vname, 
-                                         int vdes, 
-                                         void *io_pgptr, 
-                                         LOG_PHY_PAGEID pageid, 
-                                         int pagesize)
+/*
+ * Description : called after the analyzer thread stopped, 
+ *               job threads must have closed their cursors
+ *
+ */
+static void ctcl_stream_final (void)
 {
-    return ctcl_read_log_page_from_disk_retry (vname, 
-                                               vdes, 
-                                               io_pgptr, 
-                                               pageid, 
-                                               pagesize, 
-                                               -1);
+    CTCL_STREAM_ENTRY *entry;
+    CTCL_STREAM_ENTRY *next_entry;
+
+    for (entry = ctcl_Mgr.stream.head; entry != NULL; entry = next_entry)
+    {
+        next_entry = entry->next;
+        ctcl_stream_free_entry (entry);
+    }
+
+    for (entry = ctcl_Mgr.stream.retired_head; entry != NULL; entry = next_entry)
+    {
+        next_entry = entry->retire_next;
+        ctcl_stream_free_entry (entry);
+    }
+
+    ctcl_Mgr.stream.head = NULL;
+    ctcl_Mgr.stream.tail = NULL;
+    ctcl_Mgr.stream.retired_head = NULL;
+    ctcl_Mgr.stream.retired_tail = NULL;
+    ctcl_Mgr.stream.entry_cnt = 0;
+    ctcl_Mgr.stream.item_cnt = 0;
+
+    pthread_cond_destroy (&ctcl_Mgr.stream.space_cond);
+    pthread_mutex_destroy (&ctcl_Mgr.stream.lock);
 }
 
 
 /*
- * Description : read a page from the disk with max retries
- *
- *     vname(in): the volume name of the target file
- *     vdes(in): the volume descriptor of the target file
- *     io_pgptr(out): start pointer to be read
- *     pageid(in): page id to read
- *     pagesize(in): page size to wrea
- *     retries(in): read retry count
+ * Description : detach the committed transaction's items from its 
+ *               analyzer slot and append them to the commit stream.
+ *               the slot is reset so that it can be reused right away.
  *
- * Note:
- *     reads a predefined size of page from the disk
  */
-static int ctcl_read_log_page_from_disk_retry (char *vname, 
-                                               int vdes, 
-                                               void *io_pgptr, 
-                                               LOG_PHY_PAGEID pageid, 
-                                               int pagesize, 
-                                               int retry)
+static int ctcl_stream_publish (int tid, CTCL_LOG_LSA *commit_lsa)
 {
     int result;
-    int nbytes;
-    int remain_bytes = pagesize;
-    off64_t offset = ((off64_t) pagesize) * ((off64_t) pageid);
-    char *current_ptr = (char *)io_pgptr;
+    CTCL_TRANS_LOG_LIST *slot;
+    CTCL_TRANS_LOG_LIST *trans_log_list = NULL;
+    CTCL_STREAM_ENTRY *entry = NULL;
 
-    CTC_COND_EXCEPTION (lseek64 (vdes, offset, SEEK_SET) == -1,
-                        err_lseek_failed_label);
+    slot = ctcl_find_trans_log_list (tid);
 
-    while (remain_bytes > 0 && retry != 0)
+    if (slot == NULL || slot->item_num == 0)
     {
-        retry = (retry > 0) ? retry - 1 : retry;
+        /* nothing captured in this transaction */
+        ctcl_clear_trans_log_list (slot);
+        return CTC_SUCCESS;
+    }
 
-        nbytes = read (vdes, current_ptr, remain_bytes);
+    (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
 
-        if (nbytes == 0)
-        {
-            result = CTC_ERR_BAD_PAGE_FAILED;
-            usleep (100 * 1000);
-            continue;
-        }
-        else if (nbytes < 0)
-        {
-            CTC_COND_EXCEPTION (errno != EINTR, err_read_page_failed_label);
-            continue;
-        }
-        else
-        {
-            remain_bytes -= nbytes;
-            current_ptr += nbytes;
-        }
+    if (CTCG_LIST_IS_EMPTY (&ctcl_Mgr.stream.cursor_list) == CTC_TRUE &&
+        (ctcl_Mgr.stream.retention_trans_cnt == 0 ||
+         ctcl_Mgr.stream.retention_item_cnt == 0))
+    {
+        /* no job is reading the stream, it can not be replayed either */
+        CTCL_LSA_COPY (&ctcl_Mgr.stream.horizon_lsa, commit_lsa);
+
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+        ctcl_clear_trans_log_list (slot);
+        return CTC_SUCCESS;
     }
 
-    CTC_COND_EXCEPTION (remain_bytes > 0, err_bad_page_label);
+    (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
 
-    return CTC_SUCCESS;
+    trans_log_list = (CTCL_TRANS_LOG_LIST *)malloc (sizeof (CTCL_TRANS_LOG_LIST));
+    CTC_COND_EXCEPTION (trans_log_list == NULL, err_alloc_failed_label);
 
-    CTC_EXCEPTION (err_lseek_failed_label)
+    entry = (CTCL_STREAM_ENTRY *)malloc (sizeof (CTCL_STREAM_ENTRY));
+    CTC_COND_EXCEPTION (entry == NULL, err_alloc_failed_label);
+
+    memcpy (trans_log_list, slot, sizeof (CTCL_TRANS_LOG_LIST));
+    trans_log_list->is_committed = CTC_TRUE;
+    CTCL_LSA_COPY (&trans_log_list->commit_lsa, commit_lsa);
+    trans_log_list->long_trans_log_list = NULL;
+    trans_log_list->encoded_list = NULL;
+
+    /* items are owned by the stream entry from now on */
+    slot->head = NULL;
+    slot->tail = NULL;
+    slot->item_num = 0;
+    ctcl_clear_trans_log_list (slot);
+
+    CTCL_LSA_COPY (&entry->commit_lsa, commit_lsa);
+    entry->trans_log_list = trans_log_list;
+    entry->mem_bytes = ctcl_stream_get_trans_bytes (trans_log_list);
+    entry->next = NULL;
+
+    (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+
+    entry->seq = ctcl_Mgr.stream.next_seq++;
+
+    /* replaying cursors read next and head without the lock */
+    if (ctcl_Mgr.stream.tail != NULL)
     {
-        result = CTC_FAILURE;
+        __atomic_store_n (&ctcl_Mgr.stream.tail->next, entry, __ATOMIC_RELEASE);
     }
-    CTC_EXCEPTION (err_read_page_failed_label)
+    else
     {
-        result = CTC_ERR_READ_FROM_DISK_FAILED;
+        __atomic_store_n (&ctcl_Mgr.stream.head, entry, __ATOMIC_SEQ_CST);
     }
-    CTC_EXCEPTION (err_bad_page_label)
+
+    ctcl_Mgr.stream.tail = entry;
+    ctcl_Mgr.stream.entry_cnt++;
+    ctcl_Mgr.stream.item_cnt += trans_log_list->item_num;
+
+    ctcl_stream_deliver (entry);
+
+    (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+    ctcl_stream_reclaim ();
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
     {
-        if (retry <= 0)
-        {
-            result = CTC_ERR_BAD_PAGE_FAILED;
-        }
-        else
+        if (trans_log_list != NULL)
         {
-            result = CTC_FAILURE;
+            free (trans_log_list);
+            trans_log_list = NULL;
         }
+
+        ctcl_clear_trans_log_list (slot);
+
+        result = CTC_ERR_ALLOC_FAILED;
     }
     EXCEPTION_END;
 
@@ -1615,1074 +1858,2378 @@ static int ctcl_read_log_page_from_disk_retry (char *vname,
 }
 
 
-static int ctcl_log_fetch (CTCL_LOG_PAGEID pageid, 
-                           CTCL_CACHE_BUFFER *cache_buffer)
+/*
+ * Description : enqueue entry into every cursor's job queue. 
+ *               called with stream lock held. when the queue of a job
+ *               is full or over its byte quota the entry is handed to 
+ *               the job's spill writer. only for a cursor opened with CTCL_QUEUE_FULL_BLOCK the
+ *               analyzer waits for the job to dequeue, so that job 
+ *               bounds the capture rate. a cursor whose spill fails is
+ *               failed instead of waited for.
+ *
+ */
+static void ctcl_stream_deliver (CTCL_STREAM_ENTRY *entry)
 {
-    int result;
-    LOG_PHY_PAGEID phy_pageid = NULL_PAGEID;
-    int retry = 5;
+    BOOL is_full;
+    BOOL is_enqueued;
+    CTCL_STREAM_CURSOR *cursor;
+    CTCG_LIST_NODE *itr;
 
-    assert (cache_buffer);
+    while (1)
+    {
+        is_full = CTC_FALSE;
 
-    /* get the physical page id */
-    phy_pageid = ctcl_get_log_phypageid (pageid);
+        CTCG_LIST_ITERATE (&ctcl_Mgr.stream.cursor_list, itr)
+        {
+            cursor = (CTCL_STREAM_CURSOR *)itr->obj;
 
-    if (ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid)
-    {
-        /* check it again */
-        result = ctcl_fetch_log_hdr (&ctcl_Mgr.log_info.act_log);
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_fetch_log_header_failed_label);
+            if (cursor->is_replaying == CTC_TRUE ||
+                cursor->is_failed == CTC_TRUE ||
+                cursor->last_enq_seq >= entry->seq)
+            {
+                /* reads the stream by itself, failed, already delivered, 
+                 * or opened after this entry */
+                continue;
+            }
 
-        /* check it again */
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid,
-                            err_log_not_exist_in_archive_label);
-    }
+            is_enqueued = CTC_FALSE;
 
-    while (retry > 0)
-    {
-        retry--;
-        /* read from the active log file */
-        result = ctcl_read_log_page_from_disk (ctcl_Mgr.log_info.act_log.path, 
-                                               ctcl_Mgr.log_info.act_log.log_vdes, 
-                                               &cache_buffer->logpage, 
-                                               phy_pageid, 
-                                               ctcl_Mgr.log_info.act_log.db_logpagesize);
+            if (cursor->is_spilling != CTC_TRUE &&
+                ctcl_stream_has_quota (cursor, entry) == CTC_TRUE)
+            {
+                /* charged before enqueue, the job uncharges on dequeue */
+                (void)__atomic_add_fetch (&cursor->queued_bytes, 
+                                          entry->mem_bytes, 
+                                          __ATOMIC_RELAXED);
 
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_read_log_page_from_disk_failed_label);
+                if (ctcg_spsc_queue_enq (cursor->queue, (void *)entry) == CTC_TRUE)
+                {
+                    is_enqueued = CTC_TRUE;
+                }
+                else
+                {
+                    (void)__atomic_sub_fetch (&cursor->queued_bytes, 
+                                              entry->mem_bytes, 
+                                              __ATOMIC_RELAXED);
+                }
+            }
 
-        cache_buffer->in_archive = CTC_FALSE;
+            if (is_enqueued != CTC_TRUE)
+            {
+                if (cursor->queue_full_policy == CTCL_QUEUE_FULL_BLOCK)
+                {
+                    is_full = CTC_TRUE;
+                }
+                else if (ctcl_stream_spill (cursor, entry) != CTC_TRUE)
+                {
+                    /* the job fails, other jobs go on */
+                    __atomic_store_n (&cursor->is_failed, CTC_TRUE, __ATOMIC_RELEASE);
+                    cursor->notify_func (cursor->notify_arg);
+                }
 
-        if (cache_buffer->logpage.hdr.logical_pageid == pageid)
+                continue;
+            }
+
+            cursor->last_enq_seq = entry->seq;
+
+            if (ctcg_spsc_queue_get_used (cursor->queue) == 1)
+            {
+                /* queue was empty, job may be idle */
+                cursor->notify_func (cursor->notify_arg);
+            }
+        }
+
+        if (is_full != CTC_TRUE)
         {
             break;
         }
 
-        usleep (100 * 1000);
-
-        result = ctcl_fetch_log_hdr (&ctcl_Mgr.log_info.act_log);
+        if (ctcl_Mgr.stream.is_publisher_blocked != CTC_TRUE)
+        {
+            /* announce and retry once, job thread either sees this 
+             * flag or its dequeue is seen by the retry */
+            __atomic_store_n (&ctcl_Mgr.stream.is_publisher_blocked, 
+                              CTC_TRUE, 
+                              __ATOMIC_SEQ_CST);
+            continue;
+        }
 
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_fetch_log_header_failed_label);
+        /* cursor list may change while waiting, so rescan all */
+        (void)pthread_cond_wait (&ctcl_Mgr.stream.space_cond, 
+                                 &ctcl_Mgr.stream.lock);
     }
 
-    /*
-    CTC_COND_EXCEPTION (retry <= 0 || 
-                        ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid,
-                        err_log_not_exist_in_archive_label);
-                        */
-
-    cache_buffer->pageid = pageid;
-    cache_buffer->phy_pageid = phy_pageid;
+    __atomic_store_n (&ctcl_Mgr.stream.is_publisher_blocked, 
+                      CTC_FALSE, 
+                      __ATOMIC_SEQ_CST);
+}
 
-    return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_fetch_log_header_failed_label)
-    {
-        /* error info set from sub-function */
-    }
-    CTC_EXCEPTION (err_log_not_exist_in_archive_label)
-    {
-        /* log not exist in archive */
-        result = CTC_ERR_LOG_NOT_EXIST_FAILED;
-    }
-    CTC_EXCEPTION (err_read_log_page_from_disk_failed_label)
+/*
+ * Description : whether entry fits in the cursor's byte quota, an empty
+ *               queue takes any entry so that a big transaction is 
+ *               not spilled for its size alone
+ *
+ */
+static BOOL ctcl_stream_has_quota (CTCL_STREAM_CURSOR *cursor, 
+                                   CTCL_STREAM_ENTRY *entry)
+{
+    UINT_64 queued_bytes;
+
+    if (ctcg_spsc_queue_get_used (cursor->queue) == 0)
     {
-        /* log not exist in archive */
-        result = CTC_ERR_READ_FROM_DISK_FAILED;
+        return CTC_TRUE;
     }
-    EXCEPTION_END;
 
-    return result;
+    queued_bytes = __atomic_load_n (&cursor->queued_bytes, __ATOMIC_RELAXED);
+
+    return (queued_bytes + entry->mem_bytes <= ctcl_Mgr.stream.job_mem_quota) 
+           ? CTC_TRUE : CTC_FALSE;
 }
 
+
 /*
- * Description : expand cache log buffer
- *   return: CTC_SUCCESS or ER_FAILED
- *   cache_pb : cache page buffer pointer
- *   slb_cnt : the # of cache log buffers per cache page buffer
- *   slb_size : size of CACHE_LOG_BUFFER
+ * Description : hand entry to the job's spill writer instead of its 
+ *               queue, called with stream lock held. the job thread 
+ *               appends it to the segment file in ctcl_stream_write_spill(),
+ *               the analyzer does no file I/O. returns CTC_FALSE if the 
+ *               entry can not be kept.
  *
- * Note:
- *         : Expand the cache log buffer pool with the given number of buffers.
- *         : If a zero or a negative value is given, the function expands
- *           the cache buffer pool with a default porcentage of the currently
- *           size.
  */
-static int ctcl_expand_cache_log_buffer (CTCL_CACHE_PB *cache_pb, 
-                                         int slb_cnt, 
-                                         int slb_size)
+static BOOL ctcl_stream_spill (CTCL_STREAM_CURSOR *cursor, 
+                               CTCL_STREAM_ENTRY *entry)
 {
-    int i; 
-    int result;
-    int size;
-    int bufid;
-    int total_buffers;
-    CTCL_CACHE_BUFFER_AREA *area = NULL;
-    CTCL_CACHE_BUFFER **slb_log_buffer;
-
-    assert (slb_cnt > 0);
-    assert (slb_size > 0);
-
-    size = ((slb_cnt * slb_size) + sizeof (CTCL_CACHE_BUFFER_AREA));
-
-    area = (CTCL_CACHE_BUFFER_AREA *)malloc (size);
-    CTC_COND_EXCEPTION (area == NULL, err_alloc_failed_label);
-
-    memset (area, 0, size);
+    int new_size;
+    CTCL_STREAM_ENTRY **new_pending;
 
-    total_buffers = cache_pb->num_buffers + slb_cnt;
-    slb_log_buffer = realloc (cache_pb->log_buffer,
-                              total_buffers * sizeof (CTCL_CACHE_BUFFER *));
-    CTC_COND_EXCEPTION (slb_log_buffer == NULL, err_alloc_failed_label);
+    if (cursor->spill_pending_cnt == cursor->spill_pending_size)
+    {
+        new_size = (cursor->spill_pending_size == 0) 
+                   ? CTCL_STREAM_FETCH_MAX : cursor->spill_pending_size * 2;
 
-    area->buffer_area =
-        ((CTCL_CACHE_BUFFER *) ((char *) area + sizeof (CTCL_CACHE_BUFFER_AREA)));
-    area->next = cache_pb->buffer_area;
+        new_pending = (CTCL_STREAM_ENTRY **)realloc (cursor->spill_pending,
+                                                     sizeof (CTCL_STREAM_ENTRY *) * new_size);
+        if (new_pending == NULL)
+        {
+            /* entry can not be skipped without breaking commit order */
+            return CTC_FALSE;
+        }
 
-    for (i = 0, bufid = cache_pb->num_buffers; i < slb_cnt; i++, bufid++)
-    {
-        slb_log_buffer[bufid] =
-            (CTCL_CACHE_BUFFER *) ((char *) area->buffer_area + slb_size * i);
+        cursor->spill_pending = new_pending;
+        cursor->spill_pending_size = new_size;
     }
 
-    cache_pb->log_buffer = slb_log_buffer;
-    cache_pb->buffer_area = area;
-    cache_pb->num_buffers = total_buffers;
-
-    return CTC_SUCCESS;
+    cursor->spill_pending[cursor->spill_pending_cnt++] = entry;
+    cursor->last_enq_seq = entry->seq;
 
-    CTC_EXCEPTION (err_alloc_failed_label)
-    {
-        result = CTC_ERR_ALLOC_FAILED;
-    }
-    EXCEPTION_END;
+    __atomic_store_n (&cursor->is_spilling, CTC_TRUE, __ATOMIC_RELEASE);
 
-    if (area)
+    if (cursor->spill_pending_cnt == 1)
     {
-        free (area);
-        area = NULL;
+        /* job may be idle */
+        cursor->notify_func (cursor->notify_arg);
     }
 
-    return result;
+    return CTC_TRUE;
 }
 
 
-static CTCL_CACHE_BUFFER *ctcl_cache_buffer_replace (CTCL_CACHE_PB *cache_pb, 
-                                                     CTCL_LOG_PAGEID pageid, 
-                                                     int io_pagesize, 
-                                                     int buffer_size)
+/*
+ * Description : memory held by a committed transaction, what a job 
+ *               queue is charged for it
+ *
+ */
+static UINT_64 ctcl_stream_get_trans_bytes (CTCL_TRANS_LOG_LIST *trans_log_list)
 {
-    int i;
-    int result;
-    int found = -1;
-    int num_recently_free;
-    static unsigned int last = 0;
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+    UINT_64 bytes = sizeof (CTCL_TRANS_LOG_LIST);
+    CTCL_ITEM *item;
+    CTCL_COLUMN *key_col;
+    CTCL_COLUMN *col;
+    CTCG_LIST *col_list;
+    CTCG_LIST_NODE *itr;
 
-    while (found < 0)
+    for (item = trans_log_list->head; item != NULL; item = item->next)
     {
-        num_recently_free = 0;
+        bytes += sizeof (CTCL_ITEM);
 
-        for (i = 0; i < cache_pb->num_buffers; i++)
+        if (item->table_name != NULL)
         {
-            last = ((last + 1) % cache_pb->num_buffers);
-            cache_buffer = cache_pb->log_buffer[last];
-
-            if (cache_buffer->fix_count == 0)
-            {
-                if (cache_buffer->recently_free == CTC_TRUE)
-                {
-                    cache_buffer->recently_free = CTC_FALSE;
-                    num_recently_free++;
-                }
-                else
-                {
-                    found = last;
-                    break;
-                }
-            }
+            bytes += strlen (item->table_name) + 1;
         }
 
-        if (found >= 0)
+        key_col = NULL;
+        col_list = NULL;
+
+        switch (item->stmt_type)
         {
-            if (cache_buffer->pageid != 0)
-            {
-                (void)mht_rem (cache_pb->hash_table, 
-                               &cache_buffer->pageid, 
-                               NULL, 
-                               NULL);
-            }
+            case CTCL_STMT_TYPE_INSERT:
+                col_list = &(item->insert_log_info.set_col_list);
+                break;
 
-            cache_buffer->fix_count = 0;
+            case CTCL_STMT_TYPE_UPDATE:
+                key_col = &(item->update_log_info.key_col);
+                col_list = &(item->update_log_info.set_col_list);
+                break;
 
-            CTC_TEST_EXCEPTION (ctcl_log_fetch (pageid, cache_buffer), 
-                                err_log_fetch_failed_label);
+            case CTCL_STMT_TYPE_DELETE:
+                key_col = &(item->delete_log_info.key_col);
+                break;
 
-            break;
+            default:
+                break;
         }
 
-        if (num_recently_free > 0)
+        if (key_col != NULL && key_col->val_len > 0)
+        {
+            bytes += key_col->val_len;
+        }
+
+        if (col_list == NULL)
         {
             continue;
         }
 
-        CTC_TEST_EXCEPTION (ctcl_expand_cache_log_buffer (cache_pb, 
-                                                          buffer_size, 
-                                                          SIZEOF_CTCL_CACHE_LOG_BUFFER (io_pagesize)),
-                            err_expand_cache_log_buffer_failed_label);
-    }
+        CTCG_LIST_ITERATE (col_list, itr)
+        {
+            col = (CTCL_COLUMN *)itr->obj;
 
-    return cache_buffer;
+            bytes += sizeof (CTCL_COLUMN);
 
-    CTC_EXCEPTION (err_log_fetch_failed_label)
-    {
-        cache_buffer->pageid = 0;
-    }
-    CTC_EXCEPTION (err_expand_cache_log_buffer_failed_label)
-    {
+            if (col->val_len > 0)
+            {
+                bytes += col->val_len;
+            }
+
+            if (col->old_val_len > 0)
+            {
+                bytes += col->old_val_len;
+            }
+        }
     }
-    EXCEPTION_END;
 
-    return NULL;
+    return bytes;
 }
 
 
-static CTCL_CACHE_BUFFER *ctcl_get_page_buffer (CTCL_LOG_PAGEID pageid)
+/*
+ * Description : free stream entries no job queue, spill writer or 
+ *               replaying cursor holds any more, entries written to the
+ *               segment file are not held by the job.
+ *               the oldest ones go first and only while the stream is 
+ *               bigger than the retention ring. freed entries move the 
+ *               replay horizon. an unlinked entry is retired and freed 
+ *               once no cursor is in the epoch it was retired in.
+ *
+ */
+static void ctcl_stream_reclaim (void)
 {
-    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+    UINT_64 min_seq;
+    UINT_64 replay_seq;
+    UINT_64 min_epoch;
+    UINT_64 cursor_epoch;
+    CTCL_STREAM_ENTRY *entry;
+    CTCL_STREAM_ENTRY *free_head = NULL;
+    CTCL_STREAM_CURSOR *cursor;
+    CTCG_LIST_NODE *itr;
 
-    /* find the target page in the cache buffer */
-    cache_buffer = (CTCL_CACHE_BUFFER *)mht_get (cache_pb->hash_table, 
-                                                 (void *)&pageid);
+    (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
 
-    if (cache_buffer == NULL)
+    min_seq = ctcl_Mgr.stream.next_seq;
+
+    CTCG_LIST_ITERATE (&ctcl_Mgr.stream.cursor_list, itr)
     {
-        cache_buffer = ctcl_cache_buffer_replace (cache_pb, 
-                                                  pageid, 
-                                                  ctcl_Mgr.log_info.act_log.db_logpagesize, 
-                                                  ctcl_Mgr.log_info.cache_buffer_size);
+        cursor = (CTCL_STREAM_CURSOR *)itr->obj;
 
-        if (cache_buffer == NULL
-            || cache_buffer->logpage.hdr.logical_pageid != pageid)
+        if (cursor->is_replaying == CTC_TRUE)
         {
-            return NULL;
+            /* replay_seq is stored after replay_prev by the cursor, 
+             * a stale pair only pins more */
+            replay_seq = __atomic_load_n (&cursor->replay_seq, __ATOMIC_ACQUIRE);
+
+            if (replay_seq < min_seq)
+            {
+                min_seq = replay_seq;
+            }
+
+            entry = __atomic_load_n (&cursor->replay_prev, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            /* job queue is in commit order, oldest one pins the rest */
+            entry = (CTCL_STREAM_ENTRY *)ctcg_spsc_queue_peek_oldest (cursor->queue);
         }
 
-        (void) mht_rem (cache_pb->hash_table, &cache_buffer->pageid,
-                        NULL, NULL);
+        if (entry != NULL && entry->seq < min_seq)
+        {
+            min_seq = entry->seq;
+        }
 
-        if (mht_put (cache_pb->hash_table, &cache_buffer->pageid, cache_buffer)
-            == NULL)
+        /* handed to the spill writer, kept until written */
+        if (cursor->spill_writing_seq != 0 && cursor->spill_writing_seq < min_seq)
         {
-            return NULL;
+            min_seq = cursor->spill_writing_seq;
+        }
+
+        if (cursor->spill_pending_cnt > 0 && cursor->spill_pending[0]->seq < min_seq)
+        {
+            min_seq = cursor->spill_pending[0]->seq;
         }
     }
-    else
+
+    while (ctcl_Mgr.stream.head != NULL && 
+           ctcl_Mgr.stream.head->seq < min_seq &&
+           (ctcl_Mgr.stream.entry_cnt > ctcl_Mgr.stream.retention_trans_cnt ||
+            ctcl_Mgr.stream.item_cnt > ctcl_Mgr.stream.retention_item_cnt))
     {
-        if (cache_buffer->logpage.hdr.logical_pageid != pageid)
+        entry = ctcl_Mgr.stream.head;
+        __atomic_store_n (&ctcl_Mgr.stream.head, entry->next, __ATOMIC_SEQ_CST);
+        ctcl_Mgr.stream.entry_cnt--;
+        ctcl_Mgr.stream.item_cnt -= entry->trans_log_list->item_num;
+
+        CTCL_LSA_COPY (&ctcl_Mgr.stream.horizon_lsa, &entry->commit_lsa);
+
+        /* next is kept, a cursor in an older epoch may still walk it */
+        entry->retire_epoch = ctcl_Mgr.stream.epoch;
+        entry->retire_next = NULL;
+
+        if (ctcl_Mgr.stream.retired_tail != NULL)
         {
-            (void) mht_rem (cache_pb->hash_table, &cache_buffer->pageid,
-                            NULL, NULL);
-            return NULL;
+            ctcl_Mgr.stream.retired_tail->retire_next = entry;
         }
+        else
+        {
+            ctcl_Mgr.stream.retired_head = entry;
+        }
+
+        ctcl_Mgr.stream.retired_tail = entry;
     }
 
-    cache_buffer->fix_count++;
-    return cache_buffer;
-}
+    if (ctcl_Mgr.stream.head == NULL)
+    {
+        ctcl_Mgr.stream.tail = NULL;
+    }
 
+    if (ctcl_Mgr.stream.retired_head != NULL)
+    {
+        /* cursors entering from now on can not reach retired entries */
+        if (ctcl_Mgr.stream.retired_tail->retire_epoch == ctcl_Mgr.stream.epoch)
+        {
+            (void)__atomic_add_fetch (&ctcl_Mgr.stream.epoch, 1, __ATOMIC_SEQ_CST);
+        }
 
-static CTCL_LOG_PAGE *ctcl_get_page (CTCL_LOG_PAGEID pageid)
-{
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+        min_epoch = ctcl_Mgr.stream.epoch;
 
-    assert (pageid != CTCL_PAGE_NULL_ID);
+        CTCG_LIST_ITERATE (&ctcl_Mgr.stream.cursor_list, itr)
+        {
+            cursor = (CTCL_STREAM_CURSOR *)itr->obj;
+            cursor_epoch = __atomic_load_n (&cursor->epoch, __ATOMIC_SEQ_CST);
 
-    if (pageid != CTCL_PAGE_NULL_ID)
-    {
-        while (cache_buffer == NULL)
+            if (cursor_epoch != 0 && cursor_epoch < min_epoch)
+            {
+                min_epoch = cursor_epoch;
+            }
+        }
+
+        free_head = ctcl_Mgr.stream.retired_head;
+        entry = NULL;
+
+        while (ctcl_Mgr.stream.retired_head != NULL &&
+               ctcl_Mgr.stream.retired_head->retire_epoch < min_epoch)
         {
-            /* cache buffer must exist */
-            cache_buffer = ctcl_get_page_buffer (pageid);
+            entry = ctcl_Mgr.stream.retired_head;
+            ctcl_Mgr.stream.retired_head = entry->retire_next;
+        }
+
+        if (entry != NULL)
+        {
+            entry->retire_next = NULL;
+        }
+        else
+        {
+            free_head = NULL;
+        }
+
+        if (ctcl_Mgr.stream.retired_head == NULL)
+        {
+            ctcl_Mgr.stream.retired_tail = NULL;
         }
     }
-    else
+
+    (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+    /* no cursor can reach these entries any more */
+    while (free_head != NULL)
     {
-        return NULL;
-    }
+        entry = free_head;
+        free_head = entry->retire_next;
 
-    return &cache_buffer->logpage;
+        ctcl_stream_free_entry (entry);
+    }
 }
 
+
 /*
- * Description : decrease the fix_count of the target buffer
+ * Description : open a cursor positioned at start_pos, NULL is after the
+ *               last published transaction. entries are delivered into 
+ *               queue which must be empty and consumed by one thread at 
+ *               a time, queue_full_policy tells what to do when it is 
+ *               full. notify_func is called by the analyzer with stream
+ *               lock held, it must not block or call ctcl_stream functions.
  *
  */
-static void ctcl_release_page_buffer (CTCL_LOG_PAGEID pageid)
+extern int ctcl_stream_open_cursor (CTCL_STREAM_CURSOR **cursor,
+                                    CTCG_SPSC_QUEUE *queue,
+                                    CTCL_STREAM_POS *start_pos,
+                                    int queue_full_policy,
+                                    CTCL_STREAM_NOTIFY_FUNC notify_func,
+                                    void *notify_arg)
 {
-    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+    int result;
+    CTCL_STREAM_CURSOR *new_cursor = NULL;
 
-    cache_buffer = (CTCL_CACHE_BUFFER *)mht_get (cache_pb->hash_table, 
-                                                 (void *)&pageid);
-    if (cache_buffer != NULL)
+    new_cursor = (CTCL_STREAM_CURSOR *)malloc (sizeof (CTCL_STREAM_CURSOR));
+    CTC_COND_EXCEPTION (new_cursor == NULL, err_alloc_failed_label);
+
+    new_cursor->queue = queue;
+    new_cursor->queue_full_policy = queue_full_policy;
+    new_cursor->is_failed = CTC_FALSE;
+    new_cursor->notify_func = notify_func;
+    new_cursor->notify_arg = notify_arg;
+
+    new_cursor->queued_bytes = 0;
+    new_cursor->is_spilling = CTC_FALSE;
+    new_cursor->spill_pending = NULL;
+    new_cursor->spill_pending_cnt = 0;
+    new_cursor->spill_pending_size = 0;
+    new_cursor->spill_writing_seq = 0;
+    ctcl_spill_init (&new_cursor->spill);
+    new_cursor->spill_list_cnt = 0;
+
+    new_cursor->is_replaying = CTC_FALSE;
+    new_cursor->replay_seq = 0;
+    new_cursor->replay_prev = NULL;
+    new_cursor->epoch = 0;
+
+    CTCG_LIST_INIT_OBJ (&new_cursor->node, new_cursor);
+
+    (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+
+    new_cursor->last_enq_seq = ctcl_Mgr.stream.next_seq - 1;
+
+    if (start_pos != NULL)
     {
-        if ((--cache_buffer->fix_count) <= 0)
-        {
-            cache_buffer->fix_count = 0;
-        }
+        result = ctcl_stream_set_start_pos (new_cursor, start_pos);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_set_start_pos_failed_label);
+    }
 
-        cache_buffer->recently_free = CTC_TRUE;
+    CTCG_LIST_ADD_LAST (&ctcl_Mgr.stream.cursor_list, &new_cursor->node);
+
+    (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+    *cursor = new_cursor;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_set_start_pos_failed_label)
+    {
+        /* error info set from sub-function */
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+        free (new_cursor);
     }
+    EXCEPTION_END;
+
+    return result;
 }
 
 
 /*
- * Description : release all page buffers
+ * Description : position cursor after start_pos, called with stream 
+ *               lock held. fails if a transaction committed after 
+ *               start_pos is not retained any more, or if start_pos is
+ *               past the last commit published in this server run.
+ *               a lsa older than the analyzer start is never retained,
+ *               the log is not read back for it. positions are commit 
+ *               lsa only, they stay valid across server restarts.
  *
  */
-static void ctcl_release_all_page_buffers (CTCL_LOG_PAGEID except_pageid)
+static int ctcl_stream_set_start_pos (CTCL_STREAM_CURSOR *cursor,
+                                      CTCL_STREAM_POS *start_pos)
 {
-    int i;
-    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+    int result;
+    CTCL_STREAM_ENTRY *entry;
+    CTCL_LOG_LSA *last_lsa;
 
-    /* find unfix or unused buffer */
-    for (i = 0; i < cache_pb->num_buffers; i++)
+    switch (start_pos->type)
     {
-        cache_buffer = cache_pb->log_buffer[i];
+        case CTCL_STREAM_POS_NOW:
+            break;
 
-        if (cache_buffer->pageid == except_pageid)
-        {
-            continue;
-        }
+        case CTCL_STREAM_POS_LSA:
 
-        if (cache_buffer->fix_count > 0)
-        {
-            cache_buffer->fix_count = 0;
-            cache_buffer->recently_free = CTC_TRUE;
-        }
+            /* the stream is not started yet, nothing can be after lsa */
+            CTC_COND_EXCEPTION (CTCL_LSA_ISNULL (&ctcl_Mgr.stream.horizon_lsa),
+                                err_invalid_pos_label);
+
+            CTC_COND_EXCEPTION (CTCL_LSA_GT (&ctcl_Mgr.stream.horizon_lsa, &start_pos->lsa),
+                                err_pos_not_available_label);
+
+            /* commit lsa of the last published transaction, a job can 
+             * not have been handed a later one in this server run */
+            if (ctcl_Mgr.stream.tail != NULL)
+            {
+                last_lsa = &ctcl_Mgr.stream.tail->commit_lsa;
+            }
+            else
+            {
+                last_lsa = &ctcl_Mgr.stream.horizon_lsa;
+            }
+
+            CTC_COND_EXCEPTION (CTCL_LSA_GT (&start_pos->lsa, last_lsa),
+                                err_invalid_pos_label);
+
+            /* entries between horizon and tail are all retained */
+            for (entry = ctcl_Mgr.stream.head; entry != NULL; entry = entry->next)
+            {
+                if (CTCL_LSA_GT (&entry->commit_lsa, &start_pos->lsa))
+                {
+                    cursor->is_replaying = CTC_TRUE;
+                    cursor->replay_seq = entry->seq;
+                    break;
+                }
+            }
+
+            break;
+
+        default:
+            CTC_COND_EXCEPTION (CTC_TRUE, err_invalid_pos_label);
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_pos_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_pos_not_available_label)
+    {
+        result = CTC_ERR_POSITION_NOT_AVAILABLE_FAILED;
     }
+    EXCEPTION_END;
+
+    return result;
 }
 
+
 /*
- * Description : decrease the fix_count and drop the target buffer from cache
+ * Description : a cursor walks stream entries without the stream lock 
+ *               only between enter and leave, reclaim does not free an
+ *               entry unlinked after the cursor entered.
  *
  */
-static void ctcl_decache_page_buffer (CTCL_CACHE_BUFFER * cache_buffer)
+static void ctcl_stream_enter_epoch (CTCL_STREAM_CURSOR *cursor)
 {
-    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+    __atomic_store_n (&cursor->epoch, 
+                      __atomic_load_n (&ctcl_Mgr.stream.epoch, __ATOMIC_SEQ_CST),
+                      __ATOMIC_SEQ_CST);
+}
 
-    if (cache_buffer == NULL)
+
+static void ctcl_stream_leave_epoch (CTCL_STREAM_CURSOR *cursor)
+{
+    __atomic_store_n (&cursor->epoch, 0, __ATOMIC_RELEASE);
+}
+
+
+/*
+ * Description : first entry a replaying cursor has not advanced, NULL
+ *               at the tail. called in an epoch or with stream lock held.
+ *
+ */
+static CTCL_STREAM_ENTRY *ctcl_stream_get_replay_entry (CTCL_STREAM_CURSOR *cursor)
+{
+    CTCL_STREAM_ENTRY *entry;
+
+    if (cursor->replay_prev != NULL)
     {
-        return;
+        /* pinned by reclaim, so is every entry after it */
+        return __atomic_load_n (&cursor->replay_prev->next, __ATOMIC_ACQUIRE);
     }
 
-    if (cache_buffer->pageid != 0)
+    /* not advanced yet, entries from replay_seq on are retained */
+    for (entry = __atomic_load_n (&ctcl_Mgr.stream.head, __ATOMIC_SEQ_CST); 
+         entry != NULL; 
+         entry = __atomic_load_n (&entry->next, __ATOMIC_ACQUIRE))
     {
-        (void)mht_rem (cache_pb->hash_table, &cache_buffer->pageid, NULL, NULL);
+        if (entry->seq >= cursor->replay_seq)
+        {
+            break;
+        }
     }
 
-    cache_buffer->fix_count = 0;
-    cache_buffer->recently_free = CTC_FALSE;
-    cache_buffer->pageid = 0;
+    return entry;
 }
 
 
-static void ctcl_decache_page_buffer_range (CTCL_LOG_PAGEID from, 
-                                            CTCL_LOG_PAGEID to)
+/*
+ * Description : fetch retained entries of a replaying cursor, switches 
+ *               the cursor to delivery when nothing is left to replay
+ *
+ */
+static void ctcl_stream_fetch_replay (CTCL_STREAM_CURSOR *cursor,
+                                      CTCL_TRANS_LOG_LIST **trans_list,
+                                      int max_cnt,
+                                      int *fetched_cnt)
 {
-    int i;
+    int cnt = 0;
+    CTCL_STREAM_ENTRY *entry;
 
-    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
-    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+    ctcl_stream_enter_epoch (cursor);
 
-    for (i = 0; i < cache_pb->num_buffers; i++)
+    entry = ctcl_stream_get_replay_entry (cursor);
+
+    for (; entry != NULL && cnt < max_cnt; 
+         entry = __atomic_load_n (&entry->next, __ATOMIC_ACQUIRE))
     {
-        cache_buffer = cache_pb->log_buffer[i];
+        trans_list[cnt++] = entry->trans_log_list;
+    }
 
-        if ((cache_buffer->pageid == NULL_PAGEID) || 
-            (cache_buffer->pageid == 0)           || 
-            (cache_buffer->pageid < from)         || 
-            (cache_buffer->pageid > to))
+    ctcl_stream_leave_epoch (cursor);
+
+    if (cnt == 0)
+    {
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+
+        /* analyzer may have published after the walk */
+        if (ctcl_stream_get_replay_entry (cursor) == NULL)
         {
-            continue;
+            /* caught up, entries published from now on are delivered */
+            cursor->is_replaying = CTC_FALSE;
+            cursor->last_enq_seq = ctcl_Mgr.stream.next_seq - 1;
+            cursor->replay_prev = NULL;
         }
 
-        (void)mht_rem (cache_pb->hash_table, 
-                       &cache_buffer->pageid, 
-                       NULL, 
-                       NULL);
-
-        cache_buffer->fix_count = 0;
-        cache_buffer->recently_free = CTC_FALSE;
-        cache_buffer->pageid = 0;
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
     }
 
-    return;
+    *fetched_cnt = cnt;
 }
 
 
-static void ctcl_find_lowest_required_lsa (CTCL_LOG_LSA *required_lsa)
+static void ctcl_stream_advance_replay (CTCL_STREAM_CURSOR *cursor, int cnt)
 {
     int i;
-    CTCL_LOG_LSA lowest_lsa;
+    CTCL_STREAM_ENTRY *entry;
+    CTCL_STREAM_ENTRY *prev = NULL;
 
-    CTCL_LSA_SET_NULL (&lowest_lsa);
+    ctcl_stream_enter_epoch (cursor);
 
-    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+    entry = ctcl_stream_get_replay_entry (cursor);
+
+    for (i = 0; i < cnt && entry != NULL; i++)
+    {
+        prev = entry;
+        entry = __atomic_load_n (&entry->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (prev != NULL)
+    {
+        /* reclaim reads replay_seq first, it never sees the new seq 
+         * with the old replay_prev */
+        __atomic_store_n (&cursor->replay_prev, prev, __ATOMIC_RELAXED);
+        __atomic_store_n (&cursor->replay_seq, prev->seq + 1, __ATOMIC_RELEASE);
+    }
+
+    ctcl_stream_leave_epoch (cursor);
+}
+
+
+extern void ctcl_stream_close_cursor (CTCL_STREAM_CURSOR *cursor)
+{
+    int i;
+
+    if (cursor != NULL)
     {
-        if (ctcl_Mgr.log_info.trans_log_list[i]->tid <= 0)
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+
+        CTCG_LIST_REMOVE (&cursor->node);
+
+        /* analyzer may be blocked on this cursor's full queue */
+        (void)pthread_cond_broadcast (&ctcl_Mgr.stream.space_cond);
+
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+        /* drop undelivered items, entries are freed on next publish */
+        ctcg_spsc_queue_deq (cursor->queue, 
+                             ctcg_spsc_queue_get_used (cursor->queue));
+
+        for (i = 0; i < cursor->spill_list_cnt; i++)
         {
-            continue;
+            ctcl_stream_free_trans_log_list (cursor->spill_list[i]);
         }
 
-        if (CTCL_LSA_ISNULL (&lowest_lsa) ||
-            CTCL_LSA_GT (&lowest_lsa, &ctcl_Mgr.log_info.trans_log_list[i]->start_lsa))
+        ctcl_spill_final (&cursor->spill);
+
+        /* pending entries are owned by the stream */
+        if (cursor->spill_pending != NULL)
         {
-            CTCL_LSA_COPY (&lowest_lsa, &ctcl_Mgr.log_info.trans_log_list[i]->start_lsa);
+            free (cursor->spill_pending);
         }
-    }
 
-    if (CTCL_LSA_ISNULL (&lowest_lsa))
-    {
-        CTCL_LSA_COPY (required_lsa, &ctcl_Mgr.log_info.final_lsa);
+        free (cursor);
     }
     else
     {
-        CTCL_LSA_COPY (required_lsa, &lowest_lsa);
+        /* nothing to do */
     }
-
-    return;
 }
 
+
 /*
- * Description : initialize the cache log buffer area of cache page buffer
- *
- *   cache_pb : cache page buffer pointer
- *   slb_cnt : the # of cache log buffers per cache page buffer
- *   slb_size : size of CACHE_LOG_BUFFER
+ * Description : decode spilled transactions into cursor's spill list 
+ *               once the job queue is empty. the segment file is 
+ *               truncated and spilling stops when it and the pending 
+ *               entries are drained.
  *
- * Note:
- *         : allocate the cache page buffer area
- *         : the size of page buffer area is determined after reading the
- *           log header, so we split the "initialize" and "allocate" phase.
  */
-static int ctcl_init_cache_log_buffer (CTCL_CACHE_PB *cache_pb, 
-                                       int slb_cnt, 
-                                       int slb_size)
+static int ctcl_stream_fetch_spill (CTCL_STREAM_CURSOR *cursor,
+                                    int max_cnt)
 {
     int result;
+    BOOL is_drained = CTC_FALSE;
+    CTCL_TRANS_LOG_LIST *trans_log_list;
 
-    result = ctcl_expand_cache_log_buffer (cache_pb, slb_cnt, slb_size);
+    while (cursor->spill_list_cnt < max_cnt)
+    {
+        result = ctcl_spill_read (&cursor->spill, &trans_log_list);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_spill_read_failed_label);
 
-    CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                        err_expand_cache_log_buffer_failed_label);
+        if (trans_log_list == NULL)
+        {
+            break;
+        }
 
-    cache_pb->hash_table = mht_create ("log applier cache log buffer hash table", 
-                                       cache_pb->num_buffers * 8, 
-                                       mht_logpageidhash, 
-                                       mht_compare_logpageids_are_equal);
+        cursor->spill_list[cursor->spill_list_cnt++] = trans_log_list;
+    }
 
-    CTC_COND_EXCEPTION (cache_pb->hash_table == NULL, 
-                        err_hash_table_create_failed_label);
+    if (cursor->spill_list_cnt == 0 && cursor->spill.rec_cnt == 0)
+    {
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+
+        if (cursor->spill_pending_cnt == 0)
+        {
+            /* analyzer delivers to the queue again from the next entry */
+            __atomic_store_n (&cursor->is_spilling, CTC_FALSE, __ATOMIC_RELEASE);
+            is_drained = CTC_TRUE;
+        }
+
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+        if (is_drained == CTC_TRUE)
+        {
+            /* only this thread writes the file */
+            ctcl_spill_truncate (&cursor->spill);
+        }
+    }
 
     return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_expand_cache_log_buffer_failed_label)
+    CTC_EXCEPTION (err_spill_read_failed_label)
     {
         /* error info set from sub-function */
     }
-    CTC_EXCEPTION (err_hash_table_create_failed_label)
-    {
-        result = CTC_ERR_ALLOC_FAILED;
-    }
     EXCEPTION_END;
 
     return result;
 }
 
-    
-static int ctcl_fetch_log_hdr (CTCL_ACT_LOG *act_log)
+
+/*
+ * Description : append entries handed to the cursor's spill writer to
+ *               its segment file, called only by the job thread owning 
+ *               the cursor. the file is written without the stream 
+ *               lock, reclaim keeps the entries by spill_writing_seq 
+ *               until they are written. a write failure fails the cursor.
+ *
+ */
+extern int ctcl_stream_write_spill (CTCL_STREAM_CURSOR *cursor)
 {
-    int result;
+    int i;
+    int cnt;
+    int result = CTC_SUCCESS;
+    CTCL_STREAM_ENTRY **pending;
 
-    CTC_TEST_EXCEPTION (ctcl_read_log_page_from_disk (act_log->path, 
-                                                      act_log->log_vdes, 
-                                                      (void *)act_log->hdr_page, 
-                                                      0, 
-                                                      act_log->db_logpagesize),
-                        err_read_from_disk_failed_label);
+    if (__atomic_load_n (&cursor->is_spilling, __ATOMIC_ACQUIRE) != CTC_TRUE)
+    {
+        return CTC_SUCCESS;
+    }
 
-    act_log->log_hdr = (struct log_header *)(act_log->hdr_page->area);
+    (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
 
-    return CTC_SUCCESS;
+    pending = cursor->spill_pending;
+    cnt = cursor->spill_pending_cnt;
 
-    CTC_EXCEPTION (err_read_from_disk_failed_label)
+    if (cnt > 0)
     {
-        result = CTC_ERR_READ_FROM_DISK_FAILED;
+        cursor->spill_writing_seq = pending[0]->seq;
     }
-    EXCEPTION_END;
-
-    return result;
-}
-
 
-static int ctcl_find_log_pagesize (CTCL_ACT_LOG *act_log, 
-                                   const char *logpath, 
-                                   const char *dbname)
-{
-    int result;
+    cursor->spill_pending = NULL;
+    cursor->spill_pending_cnt = 0;
+    cursor->spill_pending_size = 0;
 
-    /* set active log file full path */
-    sprintf (act_log->path, "%s%s%s%s", 
-             logpath, 
-             CTC_PATH_SEPARATOR (logpath), 
-             dbname, 
-             CTCL_ACTIVE_LOG_FILE_SUFFIX);
+    (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
 
-    /* phase 1 : open active log file on 'read only' */
-    do
+    for (i = 0; i < cnt; i++)
     {
-        act_log->log_vdes = fileio_open (act_log->path, O_RDONLY, 0);
-
-        if (act_log->log_vdes == CTCL_NULL_VOLDES)
+        result = ctcl_spill_write (&cursor->spill, 
+                                   ctcl_Mgr.stream.spill_path, 
+                                   pending[i]->trans_log_list);
+        if (result != CTC_SUCCESS)
         {
-            /* active log file not exist */ 
-            result = CTC_ERR_FILE_NOT_EXIST_FAILED;
-            CTCL_SLEEP (0, 200 * 1000);
-        }
-        else
-        {
-            result = CTC_SUCCESS;
+            /* entry can not be skipped without breaking commit order */
+            __atomic_store_n (&cursor->is_failed, CTC_TRUE, __ATOMIC_RELEASE);
             break;
         }
     }
-    while (ctcl_Mgr.need_stop_analyzer == CTC_FALSE);
 
-    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_file_open_failed_label);
+    if (cnt > 0)
+    {
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+        cursor->spill_writing_seq = 0;
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+    }
 
-    act_log->hdr_page = (CTCL_LOG_PAGE *)malloc (CTCL_DEFAULT_LOG_PAGE_SIZE);
+    if (pending != NULL)
+    {
+        free (pending);
+    }
 
-    CTC_COND_EXCEPTION (act_log->hdr_page == NULL, err_alloc_failed_label);
+    return result;
+}
 
-    /* phase2 : read log header from active log file */
-    do
-    {
-        result = ctcl_read_log_page_from_disk (act_log->path, 
-                                               act_log->log_vdes, 
-                                               (char *)act_log->hdr_page, 
-                                               0, 
-                                               CTCL_DEFAULT_LOG_PAGE_SIZE);
 
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_read_log_page_failed_label);
+/*
+ * Description : get up to max_cnt committed transactions from cursor 
+ *               position in commit order. the cursor is not moved, 
+ *               returned lists stay valid until ctcl_stream_advance().
+ *
+ */
+extern int ctcl_stream_fetch (CTCL_STREAM_CURSOR *cursor,
+                              CTCL_TRANS_LOG_LIST **trans_list,
+                              int max_cnt,
+                              int *fetched_cnt)
+{
+    int cnt;
+    int result;
+    CTCL_STREAM_ENTRY *entry;
 
-        act_log->log_hdr = (struct log_header *)act_log->hdr_page->area;
+    *fetched_cnt = 0;
 
-        /* log header validation */
-        if (strncmp (act_log->log_hdr->magic,
-                     CTCL_CUBRID_MAGIC_LOG_ACTIVE, 
-                     CTCL_CUBRID_MAGIC_MAX_LENGTH) != 0)
+    /* segment file could not take an entry, the rest would be out of 
+     * order */
+    CTC_COND_EXCEPTION (__atomic_load_n (&cursor->is_failed, 
+                                         __ATOMIC_ACQUIRE) == CTC_TRUE,
+                        err_cursor_failed_label);
+
+    if (cursor->is_replaying == CTC_TRUE)
+    {
+        ctcl_stream_fetch_replay (cursor, trans_list, max_cnt, fetched_cnt);
+
+        if (*fetched_cnt > 0)
         {
-            CTCL_SLEEP (0, 10 * 1000);
-            continue;
+            return CTC_SUCCESS;
         }
 
-        /* active log header is corrupted. */
-        CTC_COND_EXCEPTION (act_log->log_hdr->prefix_name[0] != '\0' &&
-                            strncmp (act_log->log_hdr->prefix_name, 
-                                     dbname, 
-                                     strlen (dbname)) != 0, 
-                            err_log_header_corrupted_label);
-            
-        result = CTC_SUCCESS;
-        break;
+        /* joined delivery, job queue is still empty */
     }
-    while (ctcl_Mgr.need_stop_analyzer == CTC_FALSE);
 
-    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_read_file_failed_label);
+    result = ctcl_stream_write_spill (cursor);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_write_spill_failed_label);
 
-    /* phase 3 : set size to act_log of log_info from log header */
-    act_log->db_iopagesize = act_log->log_hdr->db_iopagesize;
-    act_log->db_logpagesize = act_log->log_hdr->db_logpagesize;
+    if (cursor->spill_list_cnt == 0 &&
+        ctcg_spsc_queue_get_used (cursor->queue) == 0 &&
+        __atomic_load_n (&cursor->is_spilling, __ATOMIC_ACQUIRE) == CTC_TRUE)
+    {
+        /* every entry queued before spilling started is consumed */
+        result = ctcl_stream_fetch_spill (cursor, max_cnt);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_fetch_spill_failed_label);
+    }
 
-    /* page size validation */
-    CTC_COND_EXCEPTION (act_log->db_logpagesize < CTCL_IO_MIN_PAGE_SIZE || 
-                        act_log->db_logpagesize > CTCL_IO_MAX_PAGE_SIZE,
-                        err_log_page_corrupted_label);
+    if (cursor->spill_list_cnt > 0)
+    {
+        for (cnt = 0; cnt < cursor->spill_list_cnt && cnt < max_cnt; cnt++)
+        {
+            trans_list[cnt] = cursor->spill_list[cnt];
+        }
 
-    if (act_log->db_logpagesize > CTCL_DEFAULT_LOG_PAGE_SIZE)
+        *fetched_cnt = cnt;
+
+        return CTC_SUCCESS;
+    }
+
+    for (cnt = 0; cnt < max_cnt; cnt++)
     {
-        act_log->hdr_page = (CTCL_LOG_PAGE *)realloc (act_log->hdr_page, 
-                                                      act_log->db_logpagesize);
+        entry = (CTCL_STREAM_ENTRY *)ctcg_spsc_queue_peek (cursor->queue, cnt);
 
-        act_log->log_hdr = (struct log_header *)act_log->hdr_page->area;
+        if (entry == NULL)
+        {
+            break;
+        }
+
+        trans_list[cnt] = entry->trans_log_list;
     }
 
+    *fetched_cnt = cnt;
+
     return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_file_open_failed_label)
-    {
-        /* error code already set */
-    }
-    CTC_EXCEPTION (err_alloc_failed_label)
-    {
-        result = CTC_ERR_ALLOC_FAILED;
-    }
-    CTC_EXCEPTION (err_read_log_page_failed_label)
-    {
-        /* error code already set */
-    }
-    CTC_EXCEPTION (err_read_file_failed_label)
-    {
-        /* error code already set */
-    }
-    CTC_EXCEPTION (err_log_page_corrupted_label)
+    CTC_EXCEPTION (err_cursor_failed_label)
     {
-        result = CTC_ERR_PAGE_CORRUPTED_FAILED;
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
     }
-    CTC_EXCEPTION (err_log_header_corrupted_label)
+    CTC_EXCEPTION (err_write_spill_failed_label)
     {
-        ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
-        result = CTC_ERR_PAGE_CORRUPTED_FAILED;
+        /* error info set from sub-function */
     }
-    CTC_EXCEPTION (err_db_charset_not_matched_label)
+    CTC_EXCEPTION (err_fetch_spill_failed_label)
     {
-        /* ER_LOC_INIT */
-        ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
-        result = CTC_FAILURE;
+        /* error info set from sub-function */
     }
     EXCEPTION_END;
 
     return result;
 }
 
-static int ctcl_info_pre_alloc (void)
-{
-    int result;
-    int stage = 0;
 
-    CTCL_LSA_COPY (&ctcl_Mgr.log_info.final_lsa, 
-                   &ctcl_Mgr.log_info.committed_lsa);
+/*
+ * Description : dequeue cnt fetched transactions, called only by the 
+ *               job thread owning the cursor
+ *
+ */
+extern void ctcl_stream_advance (CTCL_STREAM_CURSOR *cursor, int cnt)
+{
+    int i;
+    UINT_64 bytes = 0;
+    CTCL_STREAM_ENTRY *entry;
 
-    if (ctcl_Mgr.log_info.log_data == NULL)
+    if (cursor->is_replaying == CTC_TRUE)
     {
-        ctcl_Mgr.log_info.log_data = 
-            (char *)malloc (ctcl_Mgr.log_info.act_log.db_iopagesize);
-
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.log_data == NULL,
-                            err_alloc_failed_label);
-        stage = 1;
+        /* retained entries are freed by reclaim */
+        ctcl_stream_advance_replay (cursor, cnt);
+        return;
     }
 
-    if (ctcl_Mgr.log_info.rec_type == NULL)
+    if (cursor->spill_list_cnt > 0)
     {
-        ctcl_Mgr.log_info.rec_type = (char *)malloc (sizeof (INT_16));
+        /* decoded from segment file, owned by the cursor */
+        for (i = 0; i < cnt; i++)
+        {
+            ctcl_stream_free_trans_log_list (cursor->spill_list[i]);
+        }
 
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.rec_type == NULL,
-                            err_alloc_failed_label);
-        stage = 2;
-    }
+        for (i = cnt; i < cursor->spill_list_cnt; i++)
+        {
+            cursor->spill_list[i - cnt] = cursor->spill_list[i];
+        }
 
-    if (ctcl_Mgr.log_info.undo_unzip_ptr == NULL)
+        cursor->spill_list_cnt -= cnt;
+    }
+    else
     {
-        ctcl_Mgr.log_info.undo_unzip_ptr = 
-            log_zip_alloc (ctcl_Mgr.log_info.act_log.db_iopagesize, CTC_FALSE);
+        for (i = 0; i < cnt; i++)
+        {
+            entry = (CTCL_STREAM_ENTRY *)ctcg_spsc_queue_peek (cursor->queue, i);
+            bytes += entry->mem_bytes;
+        }
 
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.undo_unzip_ptr == NULL,
-                            err_alloc_failed_label);
-        stage = 3;
+        ctcg_spsc_queue_deq (cursor->queue, cnt);
+
+        (void)__atomic_sub_fetch (&cursor->queued_bytes, bytes, __ATOMIC_RELAXED);
     }
 
-    if (ctcl_Mgr.log_info.redo_unzip_ptr == NULL)
+    if (__atomic_load_n (&ctcl_Mgr.stream.is_publisher_blocked, 
+                         __ATOMIC_SEQ_CST) == CTC_TRUE)
     {
-        ctcl_Mgr.log_info.redo_unzip_ptr = 
-            log_zip_alloc (ctcl_Mgr.log_info.act_log.db_iopagesize, CTC_FALSE);
-
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.redo_unzip_ptr == NULL,
-                            err_alloc_failed_label);
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+        (void)pthread_cond_broadcast (&ctcl_Mgr.stream.space_cond);
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
     }
+}
 
-    return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_alloc_failed_label)
+/*
+ * Description : find the wire form of the committed transaction made 
+ *               with variant, returned one is held by caller. 
+ *               caller must hold the transaction itself, e.g. fetched 
+ *               and not advanced yet.
+ *
+ */
+extern CTCL_ENCODED_TRANS *ctcl_trans_get_encoded (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                                   int variant)
+{
+    CTCL_ENCODED_TRANS *encoded;
+
+    encoded = __atomic_load_n (&trans_log_list->encoded_list, __ATOMIC_ACQUIRE);
+
+    for (; encoded != NULL; encoded = encoded->next)
     {
-        switch (stage)
+        if (encoded->variant == variant)
         {
-            case 3: log_zip_free (ctcl_Mgr.log_info.undo_unzip_ptr);
-            case 2: free (ctcl_Mgr.log_info.rec_type);
-            case 1: free (ctcl_Mgr.log_info.log_data);
-                break;
+            (void)__atomic_add_fetch (&encoded->ref_cnt, 1, __ATOMIC_RELAXED);
+            return encoded;
         }
-
-        result = CTC_ERR_ALLOC_FAILED;
     }
-    EXCEPTION_END;
 
-    return result;
+    return NULL;
 }
 
+
 /*
- * Description : check where the page exists
- * 
+ * Description : share encoded with the other jobs sending the 
+ *               transaction, caller's reference on encoded is kept.
+ *               when another job added the same variant meanwhile, 
+ *               encoded is released and that one is returned held.
+ *
  */
-static int ctcl_check_page_exist (CTCL_LOG_PAGEID pageid)
+extern CTCL_ENCODED_TRANS *ctcl_trans_add_encoded (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                                   CTCL_ENCODED_TRANS *encoded)
 {
-    int log_exist = CTCL_PAGE_NOT_EXIST;
-    CTCL_CACHE_BUFFER *page_buffer;
+    CTCL_ENCODED_TRANS *head;
+    CTCL_ENCODED_TRANS *found;
 
-    page_buffer = ctcl_get_page_buffer (pageid);
+    /* list holds one reference */
+    encoded->ref_cnt = 2;
 
-    if (page_buffer != NULL)
+    head = __atomic_load_n (&trans_log_list->encoded_list, __ATOMIC_ACQUIRE);
+
+    do
     {
-        if (page_buffer->pageid == pageid && 
-            page_buffer->logpage.hdr.logical_pageid == pageid && 
-            page_buffer->logpage.hdr.offset > NULL_OFFSET)
+        for (found = head; found != NULL; found = found->next)
         {
-            /* valid page */
-            if (page_buffer->in_archive != CTC_TRUE)
-            {
-                log_exist = CTCL_PAGE_EXST_IN_ACTIVE_LOG;
-            }
-            else
+            if (found->variant == encoded->variant)
             {
-                log_exist = CTCL_PAGE_EXST_IN_ARCHIVE_LOG;
-            }
+                (void)__atomic_add_fetch (&found->ref_cnt, 1, __ATOMIC_RELAXED);
+                free (encoded);
 
-            ctcl_release_page_buffer (pageid);
-        }
-        else
-        {
-            /* invalid page */
-            ctcl_decache_page_buffer (page_buffer);
+                return found;
+            }
         }
+
+        encoded->next = head;
     }
+    while (__atomic_compare_exchange_n (&trans_log_list->encoded_list,
+                                        &head,
+                                        encoded,
+                                        CTC_FALSE,
+                                        __ATOMIC_RELEASE,
+                                        __ATOMIC_ACQUIRE) != CTC_TRUE);
 
-    return log_exist;
+    return encoded;
 }
 
+
 /*
- * Description : modified from la_init_repl_lists() 
- *               initialize trans_log_list of log_info
+ * Description : find the compressed batch made with variant of the 
+ *               trans_cnt transactions committed at lsa_list, the first
+ *               of which is first. returned one is held by caller, who
+ *               must hold first.
  *
  */
-static int ctcl_init_trans_log_list (BOOL is_need_realloc)
+extern CTCL_ENCODED_TRANS *ctcl_encoded_get_batch (CTCL_ENCODED_TRANS *first,
+                                                   int variant,
+                                                   int trans_cnt,
+                                                   UINT_64 *lsa_list)
 {
-    int i;
-    int result;
-    int alloced_trans = 0;
-    int cur_trans_cnt = 0;
-
-    if (is_need_realloc == CTC_FALSE)
-    {
-        ctcl_Mgr.log_info.trans_log_list = malloc (sizeof (CTCL_TRANS_LOG_LIST *) * 
-                                                   CTCL_TRANS_LOG_LIST_COUNT);
+    CTCL_ENCODED_TRANS *batch;
 
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.trans_log_list == NULL, 
-                            err_alloc_failed_label);
+    batch = __atomic_load_n (&first->batch_list, __ATOMIC_ACQUIRE);
 
-        ctcl_Mgr.log_info.trans_cnt = CTCL_TRANS_LOG_LIST_COUNT;
-        ctcl_Mgr.log_info.cur_trans = 0;
-    
-    }
-    else
+    for (; batch != NULL; batch = batch->next)
     {
-        ctcl_Mgr.log_info.trans_log_list = realloc (ctcl_Mgr.log_info.trans_log_list, 
-                                                    (sizeof (CTCL_TRANS_LOG_LIST *) * 
-                                                     (CTCL_TRANS_LOG_LIST_COUNT + 
-                                                      ctcl_Mgr.log_info.trans_cnt)));
-
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.trans_log_list == NULL, 
-                            err_alloc_failed_label);
-
-        cur_trans_cnt = ctcl_Mgr.log_info.trans_cnt;
-        ctcl_Mgr.log_info.trans_cnt += CTCL_TRANS_LOG_LIST_COUNT;
+        if (batch->variant == variant &&
+            batch->item_cnt == trans_cnt &&
+            memcmp (batch->batch_lsa, 
+                    lsa_list, 
+                    trans_cnt * sizeof (UINT_64)) == 0)
+        {
+            (void)__atomic_add_fetch (&batch->ref_cnt, 1, __ATOMIC_RELAXED);
+            return batch;
+        }
     }
 
-    for (i = cur_trans_cnt; i < ctcl_Mgr.log_info.trans_cnt; i++)
-    {
-        ctcl_Mgr.log_info.trans_log_list[i] = malloc (sizeof (CTCL_TRANS_LOG_LIST));
+    return NULL;
+}
 
-        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.trans_log_list[i] == NULL, 
-                            err_alloc_failed_label);
 
-        ctcl_Mgr.log_info.trans_log_list[i]->tid = 0;
-        ctcl_Mgr.log_info.trans_log_list[i]->item_num = 0;
-        ctcl_Mgr.log_info.trans_log_list[i]->ref_cnt = 0;
-        ctcl_Mgr.log_info.trans_log_list[i]->long_tx_flag = CTC_FALSE;
-        CTCL_LSA_SET_NULL (&ctcl_Mgr.log_info.trans_log_list[i]->start_lsa);
-        CTCL_LSA_SET_NULL (&ctcl_Mgr.log_info.trans_log_list[i]->last_lsa);
-        ctcl_Mgr.log_info.trans_log_list[i]->head = NULL;
-        ctcl_Mgr.log_info.trans_log_list[i]->tail = NULL;
+/*
+ * Description : share a compressed batch with the other jobs sending the
+ *               same transactions in a frame, see ctcl_trans_add_encoded.
+ *               it lives as long as first.
+ *
+ */
+extern CTCL_ENCODED_TRANS *ctcl_encoded_add_batch (CTCL_ENCODED_TRANS *first,
+                                                   CTCL_ENCODED_TRANS *batch)
+{
+    CTCL_ENCODED_TRANS *head;
+    CTCL_ENCODED_TRANS *found;
 
-        alloced_trans++;
-    }
+    /* list holds one reference */
+    batch->ref_cnt = 2;
 
-    return CTC_SUCCESS;
+    head = __atomic_load_n (&first->batch_list, __ATOMIC_ACQUIRE);
 
-    CTC_EXCEPTION (err_alloc_failed_label)
+    do
     {
-        if (ctcl_Mgr.log_info.trans_log_list)
+        for (found = head; found != NULL; found = found->next)
         {
-            for (i = 0; i < alloced_trans; i++)
+            if (found->variant == batch->variant &&
+                found->item_cnt == batch->item_cnt &&
+                memcmp (found->batch_lsa, 
+                        batch->batch_lsa, 
+                        batch->item_cnt * sizeof (UINT_64)) == 0)
             {
-                free (ctcl_Mgr.log_info.trans_log_list[i]);
-            }
+                (void)__atomic_add_fetch (&found->ref_cnt, 1, __ATOMIC_RELAXED);
+                free (batch);
 
-            free (ctcl_Mgr.log_info.trans_log_list);
+                return found;
+            }
         }
 
-        result = CTC_ERR_ALLOC_FAILED;
+        batch->next = head;
     }
-    EXCEPTION_END;
+    while (__atomic_compare_exchange_n (&first->batch_list,
+                                        &head,
+                                        batch,
+                                        CTC_FALSE,
+                                        __ATOMIC_RELEASE,
+                                        __ATOMIC_ACQUIRE) != CTC_TRUE);
 
-    return result;
+    return batch;
 }
 
 
-static BOOL ctcl_is_trans_log_list_empty (void)
+extern void ctcl_encoded_trans_hold (CTCL_ENCODED_TRANS *encoded)
 {
-    int i;
-
-    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
-    {
-        if (ctcl_Mgr.log_info.trans_log_list[i]->item_num > 0)
-        {
-            return CTC_FALSE;
-        }
-    }
-
-    return CTC_TRUE;
+    (void)__atomic_add_fetch (&encoded->ref_cnt, 1, __ATOMIC_RELAXED);
 }
 
-/*
- * Description : return transaction list pointer for transaction id
- *
- */
-static CTCL_TRANS_LOG_LIST *ctcl_find_trans_log_list (int tid)
+
+extern void ctcl_encoded_trans_release (CTCL_ENCODED_TRANS *encoded)
 {
-    int i;
+    CTCL_ENCODED_TRANS *batch;
 
-    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+    if (__atomic_sub_fetch (&encoded->ref_cnt, 1, __ATOMIC_ACQ_REL) == 0)
     {
-        if (ctcl_Mgr.log_info.trans_log_list[i]->tid == tid)
+        /* no one can look up batches starting here any more */
+        while (encoded->batch_list != NULL)
         {
-            return ctcl_Mgr.log_info.trans_log_list[i];
+            batch = encoded->batch_list;
+            encoded->batch_list = batch->next;
+
+            ctcl_encoded_trans_release (batch);
         }
-    }
 
-    return NULL;
+        free (encoded);
+    }
 }
 
 
+
 /*
- * Description : modified from la_add_apply_list()
+ * Description : modified from la_log_phypageid()
+ *               get the physical page id from the logical pageid
  *
  */
-static CTCL_TRANS_LOG_LIST *ctcl_get_trans_log_list_set_tid (int tid)
+static CTCL_LOG_PHY_PAGEID ctcl_get_log_phypageid (CTCL_LOG_PAGEID lpageid)
 {
-    int i;
-    int free_index = -1;
-    CTCL_TRANS_LOG_LIST *trans_log_list = NULL;
-
-    trans_log_list = ctcl_find_trans_log_list (tid);
+    CTCL_LOG_PAGEID tmp_pageid;
+    CTCL_LOG_PHY_PAGEID phy_pageid;
 
-    if (trans_log_list == NULL)
+    if (lpageid == CTCL_LOGPB_HEADER_PAGE_ID)
     {
-        for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+        phy_pageid = 0;
+    }
+    else
+    {
+        tmp_pageid = lpageid - ctcl_Mgr.log_info.act_log.log_hdr->fpageid;
+
+        if (tmp_pageid >= ctcl_Mgr.log_info.act_log.log_hdr->npages)
         {
-            if (ctcl_Mgr.log_info.trans_log_list[i]->tid == 0)
-            {
-                free_index = i;
-                break;
-            }
+            tmp_pageid %= ctcl_Mgr.log_info.act_log.log_hdr->npages;
         }
-
-        if (free_index < 0)
+        else if (tmp_pageid < 0)
         {
-            if (ctcl_Mgr.log_info.cur_trans == ctcl_Mgr.log_info.trans_cnt)
-            {
-                /* array is full --> realloc */
-                if (ctcl_init_trans_log_list (CTC_TRUE) == CTC_SUCCESS)
-                {
-                    ctcl_Mgr.log_info.trans_log_list[ctcl_Mgr.log_info.cur_trans]->tid = tid;
-                    ctcl_Mgr.log_info.cur_trans++;
+            tmp_pageid = ctcl_Mgr.log_info.act_log.log_hdr->npages -
+                ((-tmp_pageid) % ctcl_Mgr.log_info.act_log.log_hdr->npages);
+        }
 
-                    trans_log_list = ctcl_Mgr.log_info.trans_log_list[ctcl_Mgr.log_info.cur_trans - 1];
-                }
-                else
-                {
-                    /* can not get any empty transaction log list */
-                    trans_log_list = NULL;
-                }
-            }
-            else
-            {
-                ctcl_Mgr.log_info.trans_log_list[ctcl_Mgr.log_info.cur_trans]->tid = tid;
-                ctcl_Mgr.log_info.cur_trans++;
+        tmp_pageid++;
 
-                trans_log_list = ctcl_Mgr.log_info.trans_log_list[ctcl_Mgr.log_info.cur_trans - 1];
-            }
-        }
-        else
+        if (tmp_pageid > ctcl_Mgr.log_info.act_log.log_hdr->npages)
         {
-            ctcl_Mgr.log_info.trans_log_list[free_index]->tid = tid;
-
-            trans_log_list = ctcl_Mgr.log_info.trans_log_list[free_index];
+            tmp_pageid %= ctcl_Mgr.log_info.act_log.log_hdr->npages;
         }
 
+        assert (tmp_pageid <= CTCL_PAGE_ID_MAX);
+        phy_pageid = (CTCL_LOG_PHY_PAGEID) tmp_pageid;
     }
-    else
-    {
-        /* found list */
-    }
-        
-    return trans_log_list;
+
+    return phy_pageid;
+}
+
+
+static int ctcl_read_log_page_from_disk (char *vname, 
+                                         int vdes, 
+                                         void *io_pgptr, 
+                                         LOG_PHY_PAGEID pageid, 
+                                         int pagesize)
+{
+    return ctcl_read_log_page_from_disk_retry (vname, 
+                                               vdes, 
+                                               io_pgptr, 
+                                               pageid, 
+                                               pagesize, 
+                                               -1);
 }
 
 
 /*
- * Description : modified from la_log_copy_fromlog()
- *               copy a portion of the log
- *   
- *   rec_type(out)
- *   area: Area where the portion of the log is copied.
- *               (Set as a side effect)
- *   length: the length to copy (type change PGLENGTH -> int)
- *   log_pageid: log page identifier of the log data to copy
- *               (May be set as a side effect)
- *   log_offset: log offset within the log page of the log data to copy
- *               (May be set as a side effect)
- *   log_pgptr: the buffer containing the log page
- *               (May be set as a side effect)
+ * Description : read a page from the disk with max retries
  *
- * Note:
- *   Copy "length" bytes of the log starting at log_pageid,
- *   log_offset onto the given area.
+ *     vname(in): the volume name of the target file
+ *     vdes(in): the volume descriptor of the target file
+ *     io_pgptr(out): start pointer to be read
+ *     pageid(in): page id to read
+ *     pagesize(in): page size to wrea
+ *     retries(in): read retry count
  *
- *   area is set as a side effect.
- *   log_pageid, log_offset, and log_pgptr are set as a side effect.
+ * Note:
+ *     reads a predefined size of page from the disk
  */
-static void ctcl_log_copy_fromlog (char *rec_type, 
-                                   char *area, 
-                                   int length, 
-                                   CTCL_LOG_PAGEID log_pageid, 
-                                   CTCL_PAGE_LENGTH log_offset, 
-                                   CTCL_LOG_PAGE *log_pg)
+static int ctcl_read_log_page_from_disk_retry (char *vname, 
+                                               int vdes, 
+                                               void *io_pgptr, 
+                                               LOG_PHY_PAGEID pageid, 
+                                               int pagesize, 
+                                               int retry)
 {
     int result;
-    int t_length;			/* target length  */
-    int copy_length;
-    int rec_length = (int)sizeof (CTCL_PAGE_LENGTH);
-    int area_offset = 0;		/* The area offset */
-    CTCL_LOG_PAGE *pg;
+    int nbytes;
+    int remain_bytes = pagesize;
+    off64_t offset = ((off64_t) pagesize) * ((off64_t) pageid);
+    char *current_ptr = (char *)io_pgptr;
 
-    pg = log_pg;
+    CTC_COND_EXCEPTION (lseek64 (vdes, offset, SEEK_SET) == -1,
+                        err_lseek_failed_label);
 
-    while (rec_type != NULL && rec_length > 0)
+    while (remain_bytes > 0 && retry != 0)
     {
-        CTCL_LOG_READ_ADVANCE (result, 0, log_offset, log_pageid, pg);
+        retry = (retry > 0) ? retry - 1 : retry;
 
-        if (pg == NULL)
+        nbytes = read (vdes, current_ptr, remain_bytes);
+
+        if (nbytes == 0)
         {
-            break;
+            result = CTC_ERR_BAD_PAGE_FAILED;
+            usleep (100 * 1000);
+            continue;
         }
-
-        if ((log_offset + rec_length) <= CTCL_LOGAREA_SIZE)
+        else if (nbytes < 0)
         {
-            copy_length = rec_length;
+            CTC_COND_EXCEPTION (errno != EINTR, err_read_page_failed_label);
+            continue;
         }
         else
         {
-            copy_length = CTCL_LOGAREA_SIZE - log_offset;
+            remain_bytes -= nbytes;
+            current_ptr += nbytes;
         }
-
-        memcpy (rec_type + area_offset, 
-                (char *)(pg)->area + log_offset, 
-                copy_length);
-
-        rec_length -= copy_length;
-        area_offset += copy_length;
-        log_offset += copy_length;
-        length = length - sizeof (CTCL_PAGE_LENGTH);
     }
 
-    area_offset = 0;
-    t_length = length;
-
-    /* The log data is not contiguous */
-    while (t_length > 0)
-    {
-        CTCL_LOG_READ_ADVANCE (result, 0, log_offset, log_pageid, pg);
+    CTC_COND_EXCEPTION (remain_bytes > 0, err_bad_page_label);
 
-        if (pg == NULL)
-        {
-            break;
-        }
+    return CTC_SUCCESS;
 
-        if ((log_offset + t_length) <= CTCL_LOGAREA_SIZE)
+    CTC_EXCEPTION (err_lseek_failed_label)
+    {
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_read_page_failed_label)
+    {
+        result = CTC_ERR_READ_FROM_DISK_FAILED;
+    }
+    CTC_EXCEPTION (err_bad_page_label)
+    {
+        if (retry <= 0)
         {
-            copy_length = t_length;
+            result = CTC_ERR_BAD_PAGE_FAILED;
         }
         else
         {
-            copy_length = CTCL_LOGAREA_SIZE - log_offset;
+            result = CTC_FAILURE;
         }
-
-        memcpy (area + area_offset, 
-                (char *)(pg)->area + log_offset, 
-                copy_length);
-
-        t_length -= copy_length;
-        area_offset += copy_length;
-        log_offset += copy_length;
     }
+    EXCEPTION_END;
 
-    return;
+    return result;
 }
 
 
-static CTCL_ITEM *ctcl_new_item (CTCL_LOG_LSA *lsa, CTCL_LOG_LSA *target_lsa)
+static int ctcl_log_fetch (CTCL_LOG_PAGEID pageid, 
+                           CTCL_CACHE_BUFFER *cache_buffer)
 {
-    CTCL_ITEM *item;
+    int result;
+    LOG_PHY_PAGEID phy_pageid = NULL_PAGEID;
+    int retry = 5;
 
-    item = malloc (sizeof (CTCL_ITEM));
+    assert (cache_buffer);
 
-    if (item == NULL)
+    /* get the physical page id */
+    phy_pageid = ctcl_get_log_phypageid (pageid);
+
+    if (ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid)
     {
-        return NULL;
+        /* check it again */
+        result = ctcl_fetch_log_hdr (&ctcl_Mgr.log_info.act_log);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_fetch_log_header_failed_label);
+
+        /* check it again */
+        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid,
+                            err_log_not_exist_in_archive_label);
     }
 
-    item->db_user = NULL;
-    item->table_name = NULL;
-    item->log_type = -1;
-    item->stmt_type = -1;
-    CTCL_LSA_COPY (&item->lsa, lsa);
-    CTCL_LSA_COPY (&item->target_lsa, target_lsa);
+    while (retry > 0)
+    {
+        retry--;
+        /* read from the active log file */
+        result = ctcl_read_log_page_from_disk (ctcl_Mgr.log_info.act_log.path, 
+                                               ctcl_Mgr.log_info.act_log.log_vdes, 
+                                               &cache_buffer->logpage, 
+                                               phy_pageid, 
+                                               ctcl_Mgr.log_info.act_log.db_logpagesize);
 
-    item->next = NULL;
-    item->prev = NULL;
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_read_log_page_from_disk_failed_label);
 
-    return item;
-}
+        cache_buffer->in_archive = CTC_FALSE;
 
+        if (cache_buffer->logpage.hdr.logical_pageid == pageid)
+        {
+            break;
+        }
 
-static void ctcl_add_log_item_list (CTCL_TRANS_LOG_LIST *trans_log_list, 
-                                    CTCL_ITEM *item)
-{
-    assert (trans_log_list != NULL);
-    assert (item != NULL);
+        usleep (100 * 1000);
 
-    item->next = NULL;
-    item->prev = trans_log_list->tail;
+        result = ctcl_fetch_log_hdr (&ctcl_Mgr.log_info.act_log);
 
-    if (trans_log_list->tail)
-    {
-        trans_log_list->tail->next = item;
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_fetch_log_header_failed_label);
+    }
+
+    /*
+    CTC_COND_EXCEPTION (retry <= 0 || 
+                        ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid < pageid,
+                        err_log_not_exist_in_archive_label);
+                        */
+
+    cache_buffer->pageid = pageid;
+    cache_buffer->phy_pageid = phy_pageid;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_fetch_log_header_failed_label)
+    {
+        /* error info set from sub-function */
+    }
+    CTC_EXCEPTION (err_log_not_exist_in_archive_label)
+    {
+        /* log not exist in archive */
+        result = CTC_ERR_LOG_NOT_EXIST_FAILED;
+    }
+    CTC_EXCEPTION (err_read_log_page_from_disk_failed_label)
+    {
+        /* log not exist in archive */
+        result = CTC_ERR_READ_FROM_DISK_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+/*
+ * Description : expand cache log buffer
+ *   return: CTC_SUCCESS or ER_FAILED
+ *   cache_pb : cache page buffer pointer
+ *   slb_cnt : the # of cache log buffers per cache page buffer
+ *   slb_size : size of CACHE_LOG_BUFFER
+ *
+ * Note:
+ *         : Expand the cache log buffer pool with the given number of buffers.
+ *         : If a zero or a negative value is given, the function expands
+ *           the cache buffer pool with a default porcentage of the currently
+ *           size.
+ */
+static int ctcl_expand_cache_log_buffer (CTCL_CACHE_PB *cache_pb, 
+                                         int slb_cnt, 
+                                         int slb_size)
+{
+    int i; 
+    int result;
+    int size;
+    int bufid;
+    int total_buffers;
+    CTCL_CACHE_BUFFER_AREA *area = NULL;
+    CTCL_CACHE_BUFFER **slb_log_buffer;
+
+    assert (slb_cnt > 0);
+    assert (slb_size > 0);
+
+    size = ((slb_cnt * slb_size) + sizeof (CTCL_CACHE_BUFFER_AREA));
+
+    area = (CTCL_CACHE_BUFFER_AREA *)malloc (size);
+    CTC_COND_EXCEPTION (area == NULL, err_alloc_failed_label);
+
+    memset (area, 0, size);
+
+    total_buffers = cache_pb->num_buffers + slb_cnt;
+    slb_log_buffer = realloc (cache_pb->log_buffer,
+                              total_buffers * sizeof (CTCL_CACHE_BUFFER *));
+    CTC_COND_EXCEPTION (slb_log_buffer == NULL, err_alloc_failed_label);
+
+    area->buffer_area =
+        ((CTCL_CACHE_BUFFER *) ((char *) area + sizeof (CTCL_CACHE_BUFFER_AREA)));
+    area->next = cache_pb->buffer_area;
+
+    for (i = 0, bufid = cache_pb->num_buffers; i < slb_cnt; i++, bufid++)
+    {
+        slb_log_buffer[bufid] =
+            (CTCL_CACHE_BUFFER *) ((char *) area->buffer_area + slb_size * i);
+    }
+
+    cache_pb->log_buffer = slb_log_buffer;
+    cache_pb->buffer_area = area;
+    cache_pb->num_buffers = total_buffers;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    if (area)
+    {
+        free (area);
+        area = NULL;
+    }
+
+    return result;
+}
+
+
+static CTCL_CACHE_BUFFER *ctcl_cache_buffer_replace (CTCL_CACHE_PB *cache_pb, 
+                                                     CTCL_LOG_PAGEID pageid, 
+                                                     int io_pagesize, 
+                                                     int buffer_size)
+{
+    int i;
+    int result;
+    int found = -1;
+    int num_recently_free;
+    static unsigned int last = 0;
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    while (found < 0)
+    {
+        num_recently_free = 0;
+
+        for (i = 0; i < cache_pb->num_buffers; i++)
+        {
+            last = ((last + 1) % cache_pb->num_buffers);
+            cache_buffer = cache_pb->log_buffer[last];
+
+            if (cache_buffer->fix_count == 0)
+            {
+                if (cache_buffer->recently_free == CTC_TRUE)
+                {
+                    cache_buffer->recently_free = CTC_FALSE;
+                    num_recently_free++;
+                }
+                else
+                {
+                    found = last;
+                    break;
+                }
+            }
+        }
+
+        if (found >= 0)
+        {
+            if (cache_buffer->pageid != 0)
+            {
+                (void)mht_rem (cache_pb->hash_table, 
+                               &cache_buffer->pageid, 
+                               NULL, 
+                               NULL);
+            }
+
+            cache_buffer->fix_count = 0;
+
+            CTC_TEST_EXCEPTION (ctcl_log_fetch (pageid, cache_buffer), 
+                                err_log_fetch_failed_label);
+
+            break;
+        }
+
+        if (num_recently_free > 0)
+        {
+            continue;
+        }
+
+        CTC_TEST_EXCEPTION (ctcl_expand_cache_log_buffer (cache_pb, 
+                                                          buffer_size, 
+                                                          SIZEOF_CTCL_CACHE_LOG_BUFFER (io_pagesize)),
+                            err_expand_cache_log_buffer_failed_label);
+    }
+
+    return cache_buffer;
+
+    CTC_EXCEPTION (err_log_fetch_failed_label)
+    {
+        cache_buffer->pageid = 0;
+    }
+    CTC_EXCEPTION (err_expand_cache_log_buffer_failed_label)
+    {
+    }
+    EXCEPTION_END;
+
+    return NULL;
+}
+
+
+static CTCL_CACHE_BUFFER *ctcl_get_page_buffer (CTCL_LOG_PAGEID pageid)
+{
+    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    /* find the target page in the cache buffer */
+    cache_buffer = (CTCL_CACHE_BUFFER *)mht_get (cache_pb->hash_table, 
+                                                 (void *)&pageid);
+
+    if (cache_buffer == NULL)
+    {
+        cache_buffer = ctcl_cache_buffer_replace (cache_pb, 
+                                                  pageid, 
+                                                  ctcl_Mgr.log_info.act_log.db_logpagesize, 
+                                                  ctcl_Mgr.log_info.cache_buffer_size);
+
+        if (cache_buffer == NULL
+            || cache_buffer->logpage.hdr.logical_pageid != pageid)
+        {
+            return NULL;
+        }
+
+        (void) mht_rem (cache_pb->hash_table, &cache_buffer->pageid,
+                        NULL, NULL);
+
+        if (mht_put (cache_pb->hash_table, &cache_buffer->pageid, cache_buffer)
+            == NULL)
+        {
+            return NULL;
+        }
+    }
+    else
+    {
+        if (cache_buffer->logpage.hdr.logical_pageid != pageid)
+        {
+            (void) mht_rem (cache_pb->hash_table, &cache_buffer->pageid,
+                            NULL, NULL);
+            return NULL;
+        }
+    }
+
+    cache_buffer->fix_count++;
+    return cache_buffer;
+}
+
+
+static CTCL_LOG_PAGE *ctcl_get_page (CTCL_LOG_PAGEID pageid)
+{
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    assert (pageid != CTCL_PAGE_NULL_ID);
+
+    if (pageid != CTCL_PAGE_NULL_ID)
+    {
+        while (cache_buffer == NULL)
+        {
+            /* cache buffer must exist */
+            cache_buffer = ctcl_get_page_buffer (pageid);
+        }
+    }
+    else
+    {
+        return NULL;
+    }
+
+    return &cache_buffer->logpage;
+}
+
+/*
+ * Description : decrease the fix_count of the target buffer
+ *
+ */
+static void ctcl_release_page_buffer (CTCL_LOG_PAGEID pageid)
+{
+    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    cache_buffer = (CTCL_CACHE_BUFFER *)mht_get (cache_pb->hash_table, 
+                                                 (void *)&pageid);
+    if (cache_buffer != NULL)
+    {
+        if ((--cache_buffer->fix_count) <= 0)
+        {
+            cache_buffer->fix_count = 0;
+        }
+
+        cache_buffer->recently_free = CTC_TRUE;
+    }
+}
+
+
+/*
+ * Description : release all page buffers
+ *
+ */
+static void ctcl_release_all_page_buffers (CTCL_LOG_PAGEID except_pageid)
+{
+    int i;
+    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    /* find unfix or unused buffer */
+    for (i = 0; i < cache_pb->num_buffers; i++)
+    {
+        cache_buffer = cache_pb->log_buffer[i];
+
+        if (cache_buffer->pageid == except_pageid)
+        {
+            continue;
+        }
+
+        if (cache_buffer->fix_count > 0)
+        {
+            cache_buffer->fix_count = 0;
+            cache_buffer->recently_free = CTC_TRUE;
+        }
+    }
+}
+
+/*
+ * Description : decrease the fix_count and drop the target buffer from cache
+ *
+ */
+static void ctcl_decache_page_buffer (CTCL_CACHE_BUFFER * cache_buffer)
+{
+    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+
+    if (cache_buffer == NULL)
+    {
+        return;
+    }
+
+    if (cache_buffer->pageid != 0)
+    {
+        (void)mht_rem (cache_pb->hash_table, &cache_buffer->pageid, NULL, NULL);
+    }
+
+    cache_buffer->fix_count = 0;
+    cache_buffer->recently_free = CTC_FALSE;
+    cache_buffer->pageid = 0;
+}
+
+
+static void ctcl_decache_page_buffer_range (CTCL_LOG_PAGEID from, 
+                                            CTCL_LOG_PAGEID to)
+{
+    int i;
+
+    CTCL_CACHE_PB *cache_pb = ctcl_Mgr.log_info.cache_pb;
+    CTCL_CACHE_BUFFER *cache_buffer = NULL;
+
+    for (i = 0; i < cache_pb->num_buffers; i++)
+    {
+        cache_buffer = cache_pb->log_buffer[i];
+
+        if ((cache_buffer->pageid == NULL_PAGEID) || 
+            (cache_buffer->pageid == 0)           || 
+            (cache_buffer->pageid < from)         || 
+            (cache_buffer->pageid > to))
+        {
+            continue;
+        }
+
+        (void)mht_rem (cache_pb->hash_table, 
+                       &cache_buffer->pageid, 
+                       NULL, 
+                       NULL);
+
+        cache_buffer->fix_count = 0;
+        cache_buffer->recently_free = CTC_FALSE;
+        cache_buffer->pageid = 0;
+    }
+
+    return;
+}
+
+
+static void ctcl_find_lowest_required_lsa (CTCL_LOG_LSA *required_lsa)
+{
+    int i;
+    CTCL_LOG_LSA lowest_lsa;
+
+    CTCL_LSA_SET_NULL (&lowest_lsa);
+
+    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+    {
+        if (CTCL_TRANS_SLOT (i)->tid <= 0)
+        {
+            continue;
+        }
+
+        if (CTCL_LSA_ISNULL (&lowest_lsa) ||
+            CTCL_LSA_GT (&lowest_lsa, &CTCL_TRANS_SLOT (i)->start_lsa))
+        {
+            CTCL_LSA_COPY (&lowest_lsa, &CTCL_TRANS_SLOT (i)->start_lsa);
+        }
+    }
+
+    if (CTCL_LSA_ISNULL (&lowest_lsa))
+    {
+        CTCL_LSA_COPY (required_lsa, &ctcl_Mgr.log_info.final_lsa);
+    }
+    else
+    {
+        CTCL_LSA_COPY (required_lsa, &lowest_lsa);
+    }
+
+    return;
+}
+
+/*
+ * Description : initialize the cache log buffer area of cache page buffer
+ *
+ *   cache_pb : cache page buffer pointer
+ *   slb_cnt : the # of cache log buffers per cache page buffer
+ *   slb_size : size of CACHE_LOG_BUFFER
+ *
+ * Note:
+ *         : allocate the cache page buffer area
+ *         : the size of page buffer area is determined after reading the
+ *           log header, so we split the "initialize" and "allocate" phase.
+ */
+static int ctcl_init_cache_log_buffer (CTCL_CACHE_PB *cache_pb, 
+                                       int slb_cnt, 
+                                       int slb_size)
+{
+    int result;
+
+    result = ctcl_expand_cache_log_buffer (cache_pb, slb_cnt, slb_size);
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                        err_expand_cache_log_buffer_failed_label);
+
+    cache_pb->hash_table = mht_create ("log applier cache log buffer hash table", 
+                                       cache_pb->num_buffers * 8, 
+                                       mht_logpageidhash, 
+                                       mht_compare_logpageids_are_equal);
+
+    CTC_COND_EXCEPTION (cache_pb->hash_table == NULL, 
+                        err_hash_table_create_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_expand_cache_log_buffer_failed_label)
+    {
+        /* error info set from sub-function */
+    }
+    CTC_EXCEPTION (err_hash_table_create_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+    
+static int ctcl_fetch_log_hdr (CTCL_ACT_LOG *act_log)
+{
+    int result;
+
+    CTC_TEST_EXCEPTION (ctcl_read_log_page_from_disk (act_log->path, 
+                                                      act_log->log_vdes, 
+                                                      (void *)act_log->hdr_page, 
+                                                      0, 
+                                                      act_log->db_logpagesize),
+                        err_read_from_disk_failed_label);
+
+    act_log->log_hdr = (struct log_header *)(act_log->hdr_page->area);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_read_from_disk_failed_label)
+    {
+        result = CTC_ERR_READ_FROM_DISK_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+static int ctcl_find_log_pagesize (CTCL_ACT_LOG *act_log, 
+                                   const char *logpath, 
+                                   const char *dbname)
+{
+    int result;
+
+    /* set active log file full path */
+    sprintf (act_log->path, "%s%s%s%s", 
+             logpath, 
+             CTC_PATH_SEPARATOR (logpath), 
+             dbname, 
+             CTCL_ACTIVE_LOG_FILE_SUFFIX);
+
+    /* phase 1 : open active log file on 'read only' */
+    do
+    {
+        act_log->log_vdes = fileio_open (act_log->path, O_RDONLY, 0);
+
+        if (act_log->log_vdes == CTCL_NULL_VOLDES)
+        {
+            /* active log file not exist */ 
+            result = CTC_ERR_FILE_NOT_EXIST_FAILED;
+            CTCL_SLEEP (0, 200 * 1000);
+        }
+        else
+        {
+            result = CTC_SUCCESS;
+            break;
+        }
+    }
+    while (ctcl_Mgr.need_stop_analyzer == CTC_FALSE);
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_file_open_failed_label);
+
+    act_log->hdr_page = (CTCL_LOG_PAGE *)malloc (CTCL_DEFAULT_LOG_PAGE_SIZE);
+
+    CTC_COND_EXCEPTION (act_log->hdr_page == NULL, err_alloc_failed_label);
+
+    /* phase2 : read log header from active log file */
+    do
+    {
+        result = ctcl_read_log_page_from_disk (act_log->path, 
+                                               act_log->log_vdes, 
+                                               (char *)act_log->hdr_page, 
+                                               0, 
+                                               CTCL_DEFAULT_LOG_PAGE_SIZE);
+
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_read_log_page_failed_label);
+
+        act_log->log_hdr = (struct log_header *)act_log->hdr_page->area;
+
+        /* log header validation */
+        if (strncmp (act_log->log_hdr->magic,
+                     CTCL_CUBRID_MAGIC_LOG_ACTIVE, 
+                     CTCL_CUBRID_MAGIC_MAX_LENGTH) != 0)
+        {
+            CTCL_SLEEP (0, 10 * 1000);
+            continue;
+        }
+
+        /* active log header is corrupted. */
+        CTC_COND_EXCEPTION (act_log->log_hdr->prefix_name[0] != '\0' &&
+                            strncmp (act_log->log_hdr->prefix_name, 
+                                     dbname, 
+                                     strlen (dbname)) != 0, 
+                            err_log_header_corrupted_label);
+            
+        result = CTC_SUCCESS;
+        break;
+    }
+    while (ctcl_Mgr.need_stop_analyzer == CTC_FALSE);
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_read_file_failed_label);
+
+    /* phase 3 : set size to act_log of log_info from log header */
+    act_log->db_iopagesize = act_log->log_hdr->db_iopagesize;
+    act_log->db_logpagesize = act_log->log_hdr->db_logpagesize;
+
+    /* page size validation */
+    CTC_COND_EXCEPTION (act_log->db_logpagesize < CTCL_IO_MIN_PAGE_SIZE || 
+                        act_log->db_logpagesize > CTCL_IO_MAX_PAGE_SIZE,
+                        err_log_page_corrupted_label);
+
+    if (act_log->db_logpagesize > CTCL_DEFAULT_LOG_PAGE_SIZE)
+    {
+        act_log->hdr_page = (CTCL_LOG_PAGE *)realloc (act_log->hdr_page, 
+                                                      act_log->db_logpagesize);
+
+        act_log->log_hdr = (struct log_header *)act_log->hdr_page->area;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_file_open_failed_label)
+    {
+        /* error code already set */
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_read_log_page_failed_label)
+    {
+        /* error code already set */
+    }
+    CTC_EXCEPTION (err_read_file_failed_label)
+    {
+        /* error code already set */
+    }
+    CTC_EXCEPTION (err_log_page_corrupted_label)
+    {
+        result = CTC_ERR_PAGE_CORRUPTED_FAILED;
+    }
+    CTC_EXCEPTION (err_log_header_corrupted_label)
+    {
+        ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
+        result = CTC_ERR_PAGE_CORRUPTED_FAILED;
+    }
+    CTC_EXCEPTION (err_db_charset_not_matched_label)
+    {
+        /* ER_LOC_INIT */
+        ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
+        result = CTC_FAILURE;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+static int ctcl_info_pre_alloc (void)
+{
+    int result;
+    int stage = 0;
+
+    CTCL_LSA_COPY (&ctcl_Mgr.log_info.final_lsa, 
+                   &ctcl_Mgr.log_info.committed_lsa);
+
+    if (ctcl_Mgr.log_info.log_data == NULL)
+    {
+        ctcl_Mgr.log_info.log_data = 
+            (char *)malloc (ctcl_Mgr.log_info.act_log.db_iopagesize);
+
+        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.log_data == NULL,
+                            err_alloc_failed_label);
+        stage = 1;
+    }
+
+    if (ctcl_Mgr.log_info.rec_type == NULL)
+    {
+        ctcl_Mgr.log_info.rec_type = (char *)malloc (sizeof (INT_16));
+
+        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.rec_type == NULL,
+                            err_alloc_failed_label);
+        stage = 2;
+    }
+
+    if (ctcl_Mgr.log_info.undo_unzip_ptr == NULL)
+    {
+        ctcl_Mgr.log_info.undo_unzip_ptr = 
+            log_zip_alloc (ctcl_Mgr.log_info.act_log.db_iopagesize, CTC_FALSE);
+
+        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.undo_unzip_ptr == NULL,
+                            err_alloc_failed_label);
+        stage = 3;
+    }
+
+    if (ctcl_Mgr.log_info.redo_unzip_ptr == NULL)
+    {
+        ctcl_Mgr.log_info.redo_unzip_ptr = 
+            log_zip_alloc (ctcl_Mgr.log_info.act_log.db_iopagesize, CTC_FALSE);
+
+        CTC_COND_EXCEPTION (ctcl_Mgr.log_info.redo_unzip_ptr == NULL,
+                            err_alloc_failed_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        switch (stage)
+        {
+            case 3: log_zip_free (ctcl_Mgr.log_info.undo_unzip_ptr);
+            case 2: free (ctcl_Mgr.log_info.rec_type);
+            case 1: free (ctcl_Mgr.log_info.log_data);
+                break;
+        }
+
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+/*
+ * Description : check where the page exists
+ * 
+ */
+static int ctcl_check_page_exist (CTCL_LOG_PAGEID pageid)
+{
+    int log_exist = CTCL_PAGE_NOT_EXIST;
+    CTCL_CACHE_BUFFER *page_buffer;
+
+    page_buffer = ctcl_get_page_buffer (pageid);
+
+    if (page_buffer != NULL)
+    {
+        if (page_buffer->pageid == pageid && 
+            page_buffer->logpage.hdr.logical_pageid == pageid && 
+            page_buffer->logpage.hdr.offset > NULL_OFFSET)
+        {
+            /* valid page */
+            if (page_buffer->in_archive != CTC_TRUE)
+            {
+                log_exist = CTCL_PAGE_EXST_IN_ACTIVE_LOG;
+            }
+            else
+            {
+                log_exist = CTCL_PAGE_EXST_IN_ARCHIVE_LOG;
+            }
+
+            ctcl_release_page_buffer (pageid);
+        }
+        else
+        {
+            /* invalid page */
+            ctcl_decache_page_buffer (page_buffer);
+        }
+    }
+
+    return log_exist;
+}
+
+/*
+ * Description : modified from la_init_repl_lists() 
+ *               add a chunk of CTCL_TRANS_LOG_LIST_COUNT slots, slots 
+ *               already in use are never moved
+ *
+ */
+static int ctcl_grow_trans_log_list (void)
+{
+    int i;
+    int result;
+    int chunk_idx;
+    CTCL_TRANS_LOG_LIST *chunk;
+
+    chunk_idx = ctcl_Mgr.log_info.trans_cnt / CTCL_TRANS_LOG_LIST_COUNT;
+
+    CTC_COND_EXCEPTION (chunk_idx >= CTCL_TRANS_LOG_CHUNK_MAX, 
+                        err_too_many_trans_label);
+
+    chunk = malloc (sizeof (CTCL_TRANS_LOG_LIST) * CTCL_TRANS_LOG_LIST_COUNT);
+    CTC_COND_EXCEPTION (chunk == NULL, err_alloc_failed_label);
+
+    for (i = 0; i < CTCL_TRANS_LOG_LIST_COUNT; i++)
+    {
+        chunk[i].tid = 0;
+        chunk[i].item_num = 0;
+        CTCL_LSA_SET_NULL (&chunk[i].commit_lsa);
+        chunk[i].encoded_list = NULL;
+        chunk[i].ref_cnt = 0;
+        chunk[i].long_tx_flag = CTC_FALSE;
+        CTCL_LSA_SET_NULL (&chunk[i].start_lsa);
+        CTCL_LSA_SET_NULL (&chunk[i].last_lsa);
+        chunk[i].head = NULL;
+        chunk[i].tail = NULL;
+    }
+
+    ctcl_Mgr.log_info.trans_log_chunk[chunk_idx] = chunk;
+    ctcl_Mgr.log_info.trans_cnt += CTCL_TRANS_LOG_LIST_COUNT;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_too_many_trans_label)
+    {
+        result = CTC_ERR_EXCEED_MAX_FAILED;
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+static BOOL ctcl_is_trans_log_list_empty (void)
+{
+    int i;
+
+    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+    {
+        if (CTCL_TRANS_SLOT (i)->item_num > 0)
+        {
+            return CTC_FALSE;
+        }
+    }
+
+    return CTC_TRUE;
+}
+
+/*
+ * Description : return transaction list pointer for transaction id
+ *
+ */
+static CTCL_TRANS_LOG_LIST *ctcl_find_trans_log_list (int tid)
+{
+    int i;
+
+    for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+    {
+        if (CTCL_TRANS_SLOT (i)->tid == tid)
+        {
+            return CTCL_TRANS_SLOT (i);
+        }
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Description : modified from la_add_apply_list()
+ *
+ */
+static CTCL_TRANS_LOG_LIST *ctcl_get_trans_log_list_set_tid (int tid)
+{
+    int i;
+    int free_index = -1;
+    CTCL_TRANS_LOG_LIST *trans_log_list = NULL;
+
+    trans_log_list = ctcl_find_trans_log_list (tid);
+
+    if (trans_log_list == NULL)
+    {
+        for (i = 0; i < ctcl_Mgr.log_info.cur_trans; i++)
+        {
+            if (CTCL_TRANS_SLOT (i)->tid == 0)
+            {
+                free_index = i;
+                break;
+            }
+        }
+
+        if (free_index < 0)
+        {
+            if (ctcl_Mgr.log_info.cur_trans == ctcl_Mgr.log_info.trans_cnt)
+            {
+                /* every slot is in use --> add a chunk */
+                if (ctcl_grow_trans_log_list () == CTC_SUCCESS)
+                {
+                    CTCL_TRANS_SLOT (ctcl_Mgr.log_info.cur_trans)->tid = tid;
+                    ctcl_Mgr.log_info.cur_trans++;
+
+                    trans_log_list = CTCL_TRANS_SLOT (ctcl_Mgr.log_info.cur_trans - 1);
+                }
+                else
+                {
+                    /* can not get any empty transaction log list */
+                    trans_log_list = NULL;
+                }
+            }
+            else
+            {
+                CTCL_TRANS_SLOT (ctcl_Mgr.log_info.cur_trans)->tid = tid;
+                ctcl_Mgr.log_info.cur_trans++;
+
+                trans_log_list = CTCL_TRANS_SLOT (ctcl_Mgr.log_info.cur_trans - 1);
+            }
+        }
+        else
+        {
+            CTCL_TRANS_SLOT (free_index)->tid = tid;
+
+            trans_log_list = CTCL_TRANS_SLOT (free_index);
+        }
+
+    }
+    else
+    {
+        /* found list */
+    }
+        
+    return trans_log_list;
+}
+
+
+/*
+ * Description : modified from la_log_copy_fromlog()
+ *               copy a portion of the log
+ *   
+ *   rec_type(out)
+ *   area: Area where the portion of the log is copied.
+ *               (Set as a side effect)
+ *   length: the length to copy (type change PGLENGTH -> int)
+ *   log_pageid: log page identifier of the log data to copy
+ *               (May be set as a side effect)
+ *   log_offset: log offset within the log page of the log data to copy
+ *               (May be set as a side effect)
+ *   log_pgptr: the buffer containing the log page
+ *               (May be set as a side effect)
+ *
+ * Note:
+ *   Copy "length" bytes of the log starting at log_pageid,
+ *   log_offset onto the given area.
+ *
+ *   area is set as a side effect.
+ *   log_pageid, log_offset, and log_pgptr are set as a side effect.
+ */
+static void ctcl_log_copy_fromlog (char *rec_type, 
+                                   char *area, 
+                                   int length, 
+                                   CTCL_LOG_PAGEID log_pageid, 
+                                   CTCL_PAGE_LENGTH log_offset, 
+                                   CTCL_LOG_PAGE *log_pg)
+{
+    int result;
+    int t_length;			/* target length  */
+    int copy_length;
+    int rec_length = (int)sizeof (CTCL_PAGE_LENGTH);
+    int area_offset = 0;		/* The area offset */
+    CTCL_LOG_PAGE *pg;
+
+    pg = log_pg;
+
+    while (rec_type != NULL && rec_length > 0)
+    {
+        CTCL_LOG_READ_ADVANCE (result, 0, log_offset, log_pageid, pg);
+
+        if (pg == NULL)
+        {
+            break;
+        }
+
+        if ((log_offset + rec_length) <= CTCL_LOGAREA_SIZE)
+        {
+            copy_length = rec_length;
+        }
+        else
+        {
+            copy_length = CTCL_LOGAREA_SIZE - log_offset;
+        }
+
+        memcpy (rec_type + area_offset, 
+                (char *)(pg)->area + log_offset, 
+                copy_length);
+
+        rec_length -= copy_length;
+        area_offset += copy_length;
+        log_offset += copy_length;
+        length = length - sizeof (CTCL_PAGE_LENGTH);
+    }
+
+    area_offset = 0;
+    t_length = length;
+
+    /* The log data is not contiguous */
+    while (t_length > 0)
+    {
+        CTCL_LOG_READ_ADVANCE (result, 0, log_offset, log_pageid, pg);
+
+        if (pg == NULL)
+        {
+            break;
+        }
+
+        if ((log_offset + t_length) <= CTCL_LOGAREA_SIZE)
+        {
+            copy_length = t_length;
+        }
+        else
+        {
+            copy_length = CTCL_LOGAREA_SIZE - log_offset;
+        }
+
+        memcpy (area + area_offset, 
+                (char *)(pg)->area + log_offset, 
+                copy_length);
+
+        t_length -= copy_length;
+        area_offset += copy_length;
+        log_offset += copy_length;
+    }
+
+    return;
+}
+
+
+static CTCL_ITEM *ctcl_new_item (CTCL_LOG_LSA *lsa, CTCL_LOG_LSA *target_lsa)
+{
+    CTCL_ITEM *item;
+
+    item = malloc (sizeof (CTCL_ITEM));
+
+    if (item == NULL)
+    {
+        return NULL;
+    }
+
+    item->db_user = NULL;
+    item->table_name = NULL;
+    item->log_type = -1;
+    item->stmt_type = -1;
+    CTCL_LSA_COPY (&item->lsa, lsa);
+    CTCL_LSA_COPY (&item->target_lsa, target_lsa);
+
+    db_make_null (&item->key);
+
+    ctcl_item_update_log_info_init (item);
+    ctcl_item_insert_log_info_init (item);
+    ctcl_item_delete_log_info_init (item);
+
+    item->next = NULL;
+    item->prev = NULL;
+
+    return item;
+}
+
+
+static void ctcl_add_log_item_list (CTCL_TRANS_LOG_LIST *trans_log_list, 
+                                    CTCL_ITEM *item)
+{
+    assert (trans_log_list != NULL);
+    assert (item != NULL);
+
+    item->next = NULL;
+    item->prev = trans_log_list->tail;
+
+    if (trans_log_list->tail)
+    {
+        trans_log_list->tail->next = item;
     }
     else
     {
@@ -2806,23 +4353,16 @@ static CTCL_ITEM *ctcl_make_item (CTCL_LOG_PAGE *log_pg,
                     break;
 
                 default:
-                    /* DEBUG */
-                    printf ("DATA another stmt type entered: LOG_RCVINDEX number = %d\n",
-                            repl_log->rcvindex);
+                    CTCG_TRACE_DEBUG (CTCG_TRACE_EV_UNKNOWN_DATA_RCVINDEX,
+                                      repl_log->rcvindex, 0, 0, 0);
                     break;
             }
 
-            /* DEBUG */
-            printf ("item->db_user = %s\n \
-                    item->table_name = %s\n \
-                    item->log_type = %d\n \
-                    item->stmt_type = %d\n \
-                    item->key = %ld\n", 
-                    item->db_user, 
-                    item->table_name,
-                    item->log_type,
-                    item->stmt_type,
-                    item->key);
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ITEM_MADE,
+                              log_type,
+                              item->stmt_type,
+                              lsa->pageid,
+                              lsa->offset);
 
             break;
 
@@ -2837,21 +4377,15 @@ static CTCL_ITEM *ctcl_make_item (CTCL_LOG_PAGE *log_pg,
             ptr = or_unpack_string (ptr, &item->db_user);
             */
 
-                    
-            printf ("SCHEMA another stmt type entered: LOG_RCVINDEX number = %d\n", 
-                    repl_log->rcvindex);
 
-            /* DEBUG */
-            printf ("item->db_user = %s\n \
-                    item->table_name = %s\n \
-                    item->log_type = %d\n \
-                    item->stmt_type = %d\n \
-                    item->key = %ld\n", 
-                    item->db_user, 
-                    item->table_name,
-                    item->log_type,
-                    item->stmt_type,
-                    item->key);
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_UNKNOWN_SCHEMA_RCVINDEX,
+                              repl_log->rcvindex, 0, 0, 0);
+
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ITEM_MADE,
+                              log_type,
+                              item->stmt_type,
+                              lsa->pageid,
+                              lsa->offset);
 
             break;
 
@@ -2995,15 +4529,15 @@ static int ctcl_process_insert_log (CTCL_ITEM *item)
     }
     CTC_EXCEPTION (err_invalid_rectype_label)
     {
-        /* DEBUG */
-        printf ("apply_update : rectype.type = %d\n", recdes.type);
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_INVALID_RECTYPE,
+                          item->stmt_type, recdes.type, 0, 0);
         ctcl_release_page_buffer (old_pageid);
         result = CTC_ERR_INVALID_TYPE_FAILED;
     }
     CTC_EXCEPTION (err_invalid_rcvindex_label)
     {
-        /* DEBUG */
-        printf ("apply_update : rcvindex = %d\n", rcvindex);
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_INVALID_RCVINDEX,
+                          item->stmt_type, rcvindex, 0, 0);
         ctcl_release_page_buffer (old_pageid);
         result = CTC_ERR_INVALID_TYPE_FAILED;
     }
@@ -3048,6 +4582,7 @@ static int ctcl_process_delete_log (CTCL_ITEM *item)
 {
     int result;
     int con_name_len;
+    int val_size;
     MOBJ mclass;
     DB_OBJECT *class_obj;
     DB_OTMPL *inst_tp = NULL;
@@ -3079,51 +4614,28 @@ static int ctcl_process_delete_log (CTCL_ITEM *item)
             cons->attributes[0]->header.name,
             con_name_len);
 
+    item->delete_log_info.key_col.name_len = con_name_len;
     item->delete_log_info.key_col.type = value_type;
 
-    switch (value_type)
-    {
-        case DB_TYPE_INTEGER:
-            item->delete_log_info.key_col.val_len = sizeof (int);
-            item->delete_log_info.key_col.val = malloc (sizeof (int));
-            *(int *)(item->delete_log_info.key_col.val) = item->key.data.i;
-            break;
+    val_size = ctcl_encoder_get_size (&item->key);
+    CTC_COND_EXCEPTION (val_size < 0, err_invalid_type_label);
 
-        case DB_TYPE_CHAR:
-        case DB_TYPE_VARCHAR:
-            item->delete_log_info.key_col.val_len = 
-                strlen (item->key.data.ch.medium.buf);
-            item->delete_log_info.key_col.val = 
-                malloc (item->delete_log_info.key_col.val_len);
-            memcpy (item->delete_log_info.key_col.val,
-                    item->key.data.ch.medium.buf,
-                    item->delete_log_info.key_col.val_len);
-            break;
+    item->delete_log_info.key_col.val = malloc (val_size > 0 ? val_size : 1);
+    CTC_COND_EXCEPTION (item->delete_log_info.key_col.val == NULL, 
+                        err_alloc_key_val_failed_label);
 
-        default:
-            break;
-    }
+    item->delete_log_info.key_col.val_len = 
+        ctcl_encoder_write (&item->key, (char *)item->delete_log_info.key_col.val);
 
-    /* >>> DEBUG */
-    if (item->delete_log_info.key_col.val_len != 0)
+    if (item->delete_log_info.key_col.val_len > 0)
     {
-        printf ("key_col.name = %s\n \
-                key_col.type = %d\n \
-                key_col.val_len = %d\n",
-                item->delete_log_info.key_col.name,
-                item->delete_log_info.key_col.type,
-                item->delete_log_info.key_col.val_len);
-
-        if (item->delete_log_info.key_col.type == DB_TYPE_INTEGER)
-        {
-            printf ("key_col.val = %d\n", *(int *)(item->delete_log_info.key_col.val));
-        }
-        else
-        {
-            printf ("key_col.val = %s\n", (char *)(item->delete_log_info.key_col.val));
-        }
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_KEY_COLUMN,
+                          item->stmt_type,
+                          item->delete_log_info.key_col.type,
+                          item->delete_log_info.key_col.val_len,
+                          item->delete_log_info.key_col.type == DB_TYPE_INTEGER ?
+                          (int)ntohl (*(UINT_32 *)(item->delete_log_info.key_col.val)) : 0);
     }
-    /* <<< DEBUG */
 /*
     inst_tp = dbt_edit_object (object);
     CTC_COND_EXCEPTION (inst_tp == NULL, err_invalid_table_label);
@@ -3140,27 +4652,31 @@ static int ctcl_process_delete_log (CTCL_ITEM *item)
     CTC_EXCEPTION (err_fetch_class_failed_label)
     {
         /* error info set from sub-function */
-        /* DEBUG */
-        printf ("err_fetch_class_failed_label\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DELETE_LOG_FAILED,
+                          CTCG_TRACE_DELETE_FAIL_FETCH_CLASS, 0, 0, 0);
     }
     CTC_EXCEPTION (err_find_pk_failed_label)
     {
-        /* DEBUG */
-        printf ("err_find_pk_failed_label\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DELETE_LOG_FAILED,
+                          CTCG_TRACE_DELETE_FAIL_FIND_PK, 0, 0, 0);
         result = CTC_FAILURE;
     }
     CTC_EXCEPTION (err_invalid_type_label)
     {
-        /* DEBUG */
-        printf ("err_invalid_type_label\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DELETE_LOG_FAILED,
+                          CTCG_TRACE_DELETE_FAIL_INVALID_TYPE, 0, 0, 0);
         result = CTC_FAILURE;
     }
     CTC_EXCEPTION (err_invalid_key_value_label)
     {
-        /* DEBUG */
-        printf ("err_invalid_key_value_label\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_DELETE_LOG_FAILED,
+                          CTCG_TRACE_DELETE_FAIL_INVALID_KEY_VALUE, 0, 0, 0);
         result = CTC_FAILURE;
     }
+    CTC_EXCEPTION (err_alloc_key_val_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
     EXCEPTION_END;
 
     return result;
@@ -3180,6 +4696,7 @@ static int ctcl_process_update_log (CTCL_ITEM *item)
     MOBJ mclass;
     CTCL_LOG_PAGE *pgptr;
     RECDES recdes;
+    RECDES old_recdes;
     DB_OTMPL *inst_tp = NULL;
     CTCL_LOG_PAGEID old_pageid = -1;
 
@@ -3189,10 +4706,12 @@ static int ctcl_process_update_log (CTCL_ITEM *item)
 
     CTC_COND_EXCEPTION (pgptr == NULL, err_null_pg_label);
 
-    /* retrieve the target record description */
+    old_recdes.data = NULL;
+
+    /* retrieve the target record description with its undo image */
     result = ctcl_get_recdes (&item->target_lsa, 
                              pgptr, 
-                             NULL, 
+                             &old_recdes, 
                              &recdes, 
                              &rcvindex, 
                              ctcl_Mgr.log_info.log_data, 
@@ -3232,6 +4751,19 @@ static int ctcl_process_update_log (CTCL_ITEM *item)
     result = ctcl_disk_to_obj (mclass, &recdes, inst_tp, item);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_table_label);
 
+    /* before-image is only a plain record for in-place heap update */
+    if (old_recdes.data != NULL && 
+        rcvindex == RVHF_UPDATE &&
+        (old_recdes.type == REC_HOME || old_recdes.type == REC_NEWHOME))
+    {
+        if (ctcl_get_update_before (mclass, &old_recdes, item) == CTC_SUCCESS)
+        {
+            item->update_log_info.has_before_image = CTC_TRUE;
+        }
+    }
+
+    ctcl_mark_changed_columns (item);
+
     /* finish object */
     new_object = dbt_finish_object_and_decache_when_failure (inst_tp);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_table_label);
@@ -3261,6 +4793,12 @@ static int ctcl_process_update_log (CTCL_ITEM *item)
 
     object = new_object = NULL;
 
+    if (old_recdes.data != NULL)
+    {
+        free (old_recdes.data);
+        old_recdes.data = NULL;
+    }
+
     ctcl_release_page_buffer (old_pageid);
 
     return CTC_SUCCESS;
@@ -3271,185 +4809,586 @@ static int ctcl_process_update_log (CTCL_ITEM *item)
     }
     CTC_EXCEPTION (err_get_recdes_failed_label)
     {
+        if (old_recdes.data != NULL)
+        {
+            free (old_recdes.data);
+        }
+
         ctcl_release_page_buffer (old_pageid);
         result = CTC_ERR_BAD_PAGE_FAILED;
     }
     CTC_EXCEPTION (err_invalid_rectype_label)
     {
-        /* DEBUG */
-        printf ("apply_update : rectype.type = %d\n", recdes.type);
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_INVALID_RECTYPE,
+                          item->stmt_type, recdes.type, 0, 0);
+        if (old_recdes.data != NULL)
+        {
+            free (old_recdes.data);
+        }
+
         ctcl_release_page_buffer (old_pageid);
         result = CTC_ERR_INVALID_TYPE_FAILED;
     }
     CTC_EXCEPTION (err_invalid_rcvindex_label)
     {
-        /* DEBUG */
-        printf ("apply_update : rcvindex = %d\n", rcvindex);
-        ctcl_release_page_buffer (old_pageid);
-        result = CTC_ERR_INVALID_TYPE_FAILED;
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_INVALID_RCVINDEX,
+                          item->stmt_type, rcvindex, 0, 0);
+        if (old_recdes.data != NULL)
+        {
+            free (old_recdes.data);
+        }
+
+        ctcl_release_page_buffer (old_pageid);
+        result = CTC_ERR_INVALID_TYPE_FAILED;
+    }
+    CTC_EXCEPTION (err_invalid_table_label)
+    {
+        if (old_recdes.data != NULL)
+        {
+            free (old_recdes.data);
+            old_recdes.data = NULL;
+        }
+
+        if (ovfyn)
+        {
+            if (recdes.data)
+            {
+                free (recdes.data);
+                recdes.data = NULL;
+            }
+        }
+
+        assert (new_object == NULL || new_object == object);
+
+        if (object)
+        {
+            ws_release_user_instance (object);
+            ws_decache (object);
+            object = new_object = NULL;
+        }
+
+        if (inst_tp)
+        {
+            dbt_abort_object (inst_tp);
+        }
+
+        if (new_object == NULL)
+        {
+        //    AU_RESTORE (au_save);
+        }
+
+        if (result == ER_NET_CANT_CONNECT_SERVER || 
+            result == ER_OBJ_NO_CONNECT)
+        {
+            result = ER_NET_CANT_CONNECT_SERVER;
+        }
+
+        ctcl_release_page_buffer (old_pageid);
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+static int ctcl_disk_to_obj (MOBJ classobj, 
+                             RECDES *record, 
+                             DB_OTMPL *def, 
+                             CTCL_ITEM *item)
+{
+    OR_BUF orep, *buf;
+    int repid, status;
+    SM_CLASS *sm_class;
+    unsigned int repid_bits;
+    int bound_bit_flag;
+    int rc = CTC_SUCCESS;
+    int error = CTC_SUCCESS;
+    int offset_size;
+    DB_VALUE *key = &item->key;
+
+    buf = &orep;
+    or_init (buf, record->data, record->length);
+    buf->error_abort = 1;
+
+    status = setjmp (buf->env);
+
+    if (status == 0)
+    {
+        sm_class = (SM_CLASS *)classobj;
+
+        offset_size = OR_GET_OFFSET_SIZE (buf->ptr);
+
+        repid_bits = or_get_int (buf, &rc);
+
+        (void)or_get_int (buf, &rc);
+
+        repid = repid_bits & ~OR_BOUND_BIT_FLAG & ~OR_OFFSET_SIZE_FLAG;
+
+        bound_bit_flag = repid_bits & OR_BOUND_BIT_FLAG;
+
+        if (item->stmt_type == CTCL_STMT_TYPE_UPDATE)
+        {
+            error = ctcl_get_update_current (buf, 
+                                             sm_class, 
+                                             bound_bit_flag, 
+                                             def, 
+                                             item, 
+                                             offset_size);
+        }
+        else if (item->stmt_type == CTCL_STMT_TYPE_INSERT)
+        {
+            error = ctcl_get_insert_current (buf, 
+                                             sm_class, 
+                                             bound_bit_flag, 
+                                             def, 
+                                             item, 
+                                             offset_size);
+        }
+        else
+        {
+            /* DELETE come in?? */
+        }
+    }
+    else
+    {
+        error = ER_GENERIC_ERROR;
+    }
+
+    return error;
+}
+
+
+static void ctcl_item_delete_log_info_init (CTCL_ITEM *item)
+{
+    memset (item->delete_log_info.key_col.name, 0, CTCL_NAME_MAX);
+    item->delete_log_info.key_col.val = NULL;
+    item->delete_log_info.key_col.val_len = 0;
+}
+
+
+static void ctcl_item_insert_log_info_init (CTCL_ITEM *item)
+{
+    item->insert_log_info.set_col_cnt = 0;
+    CTCG_LIST_INIT (&(item->insert_log_info.set_col_list));
+}
+
+
+static void ctcl_item_update_log_info_init (CTCL_ITEM *item)
+{
+    memset (item->update_log_info.key_col.name, 0, CTCL_NAME_MAX);
+    item->update_log_info.key_col.val = NULL;
+    item->update_log_info.key_col.val_len = 0;
+    item->update_log_info.set_col_cnt = 0;
+    item->update_log_info.changed_col_cnt = 0;
+    item->update_log_info.has_before_image = CTC_FALSE;
+
+    CTCG_LIST_INIT (&(item->update_log_info.set_col_list));
+}
+
+
+/*
+ * ctcl_make_column () - make a set column from the disk value
+ *
+ *  the encoded value is stored in the same allocation as the column,
+ *  NULL and not supported value have NULL val and a negative val_len
+ *  from the encoder.
+ */
+static CTCL_COLUMN *ctcl_make_column (SM_ATTRIBUTE *att, DB_VALUE *value)
+{
+    int val_size;
+    CTCL_COLUMN *col;
+
+    val_size = ctcl_encoder_get_size (value);
+
+    col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN) + 
+                                 (val_size > 0 ? val_size : 0));
+
+    if (col == NULL)
+    {
+        return NULL;
+    }
+
+    memset (col->name, 0, CTCL_NAME_MAX);
+
+    CTCG_LIST_INIT_OBJ (&col->node, col);
+
+    /* 1. column name */
+    col->name_len = strlen (att->header.name);
+    memcpy (col->name, att->header.name, col->name_len);
+
+    /* 2. column type */
+    col->type = att->domain->type->id;
+
+    /* 3. column value */
+    if (val_size >= 0)
+    {
+        col->val = (void *)(col + 1);
+        col->val_len = ctcl_encoder_write (value, (char *)col->val);
+    }
+    else
+    {
+        col->val = NULL;
+        col->val_len = val_size;
+    }
+
+    /* 4. changed flag, fixed by before-image later */
+    col->is_changed = CTC_TRUE;
+    col->old_val_len = CTCL_COLUMN_NOT_LOGGED;
+    col->old_val = NULL;
+
+    return col;
+}
+
+
+static int ctcl_set_key_column (CTCL_COLUMN *key_col, 
+                                SM_ATTRIBUTE *att, 
+                                DB_VALUE *value)
+{
+    int val_size;
+
+    /* 1. column name */
+    key_col->name_len = strlen (att->header.name);
+    memcpy (key_col->name, att->header.name, key_col->name_len);
+
+    /* 2. column type */
+    key_col->type = att->domain->type->id;
+
+    /* 3. column value */
+    val_size = ctcl_encoder_get_size (value);
+
+    key_col->val = NULL;
+    key_col->val_len = val_size;
+
+    if (val_size >= 0)
+    {
+        key_col->val = malloc (val_size > 0 ? val_size : 1);
+
+        if (key_col->val == NULL)
+        {
+            return ER_OUT_OF_VIRTUAL_MEMORY;
+        }
+
+        key_col->val_len = ctcl_encoder_write (value, (char *)key_col->val);
+    }
+
+    return CTC_SUCCESS;
+}
+
+
+static int ctcl_get_update_current (OR_BUF *buf, 
+                                    SM_CLASS *sm_class, 
+                                    int bound_bit_flag, 
+                                    DB_OTMPL *def, 
+                                    CTCL_ITEM *item, 
+                                    int offset_size)
+{
+    int error = CTC_SUCCESS;
+    int rc = CTC_SUCCESS;
+    int *vars = NULL;
+    int i, j, offset, offset2, pad;
+    int key_att_id = 0;
+    char *bits, *start, *v_start;
+    SM_ATTRIBUTE *att;
+    DB_VALUE value;
+    CTCL_COLUMN *set_col = NULL;
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_DEBUG
+    CTCL_COLUMN *test_col = NULL;
+    CTCG_LIST_NODE *itr;
+#endif
+
+    if (sm_class->variable_count)
+    {
+        vars = (int *)malloc (DB_SIZEOF (int) * sm_class->variable_count);
+
+        if (vars == NULL)
+        {
+            return ER_OUT_OF_VIRTUAL_MEMORY;
+        }
+
+        offset = or_get_offset_internal (buf, &rc, offset_size);
+
+        for (i = 0; i < sm_class->variable_count; i++)
+        {
+            offset2 = or_get_offset_internal (buf, &rc, offset_size);
+            vars[i] = offset2 - offset;
+            offset = offset2;
+        }
+
+        buf->ptr = PTR_ALIGN (buf->ptr, sizeof(int));
+    }
+
+    bits = NULL;
+
+    if (bound_bit_flag)
+    {
+        bits = (char *)buf->ptr + sm_class->fixed_size;
     }
-    CTC_EXCEPTION (err_invalid_table_label)
+
+    att = sm_class->attributes;
+    start = buf->ptr;
+
+    /* initialize update_log_info */
+    ctcl_item_update_log_info_init (item);
+
+    /* find key attribute */
+    for (i = 0; 
+         i < sm_class->att_count; 
+         i++, att = (SM_ATTRIBUTE *)att->header.next)
     {
-        if (ovfyn)
+        if (att->constraints != NULL)
         {
-            if (recdes.data)
+            if (att->constraints->type == SM_CONSTRAINT_PRIMARY_KEY)
             {
-                free (recdes.data);
-                recdes.data = NULL;
+                key_att_id = att->id;
             }
         }
+        else
+        {
+            /* key not exist, critical problem, but ignore */
+        }
+    }
 
-        assert (new_object == NULL || new_object == object);
+    att = sm_class->attributes;
 
-        if (object)
+    /* process the fixed length column */
+    for (i = 0; 
+         i < sm_class->fixed_count; 
+         i++, att = (SM_ATTRIBUTE *)att->header.next)
+    {
+        if (bits != NULL && !OR_GET_BOUND_BIT (bits, i))
         {
-            ws_release_user_instance (object);
-            ws_decache (object);
-            object = new_object = NULL;
+            /* its a NULL value, still a set column so that an update 
+             * to NULL is reported */
+            db_make_null (&value);
+            or_advance (buf, tp_domain_disk_size (att->domain));
         }
-
-        if (inst_tp)
+        else
         {
-            dbt_abort_object (inst_tp);
+            /* read the disk value into the db_value */
+            (*(att->type->data_readval))(buf, &value, att->domain, 
+                                         -1, true, NULL, 0);
         }
 
-        if (new_object == NULL)
+        /* key column info setting */
+        if (att->id == key_att_id)
         {
-        //    AU_RESTORE (au_save);
+            error = ctcl_set_key_column (&(item->update_log_info.key_col),
+                                         att,
+                                         &value);
         }
+        /* set column info setting */
+        else
+        {
+            set_col = ctcl_make_column (att, &value);
 
-        if (result == ER_NET_CANT_CONNECT_SERVER || 
-            result == ER_OBJ_NO_CONNECT)
+            if (set_col != NULL)
+            {
+                CTCG_LIST_ADD_LAST (&(item->update_log_info.set_col_list), 
+                                    &set_col->node);
+
+                item->update_log_info.set_col_cnt++;
+            }
+            else
+            {
+                error = ER_OUT_OF_VIRTUAL_MEMORY;
+            }
+        }
+
+        if (error != CTC_SUCCESS)
         {
-            result = ER_NET_CANT_CONNECT_SERVER;
+            pr_clear_value (&value);
+
+            if (vars != NULL)
+            {
+                free (vars);
+                vars = NULL;
+            }
+
+            return error;
         }
 
-        ctcl_release_page_buffer (old_pageid);
-    }
-    EXCEPTION_END;
+        /* skip cache object attribute for foreign key */
+        if (att->is_fk_cache_attr)
+        {
+            continue;
+        }
 
-    return result;
-}
+        /* update the column */
+        error = dbt_put_internal (def, att->header.name, &value);
+        pr_clear_value (&value);
 
+        if (error != CTC_SUCCESS)
+        {
+            if (vars != NULL)
+            {
+                free (vars);
+                vars = NULL;
+            }
 
-static int ctcl_disk_to_obj (MOBJ classobj, 
-                             RECDES *record, 
-                             DB_OTMPL *def, 
-                             CTCL_ITEM *item)
-{
-    OR_BUF orep, *buf;
-    int repid, status;
-    SM_CLASS *sm_class;
-    unsigned int repid_bits;
-    int bound_bit_flag;
-    int rc = CTC_SUCCESS;
-    int error = CTC_SUCCESS;
-    int offset_size;
-    DB_VALUE *key = &item->key;
+            return error;
+        }
+    }
 
-    buf = &orep;
-    or_init (buf, record->data, record->length);
-    buf->error_abort = 1;
+    /* round up to a to the end of the fixed block */
+    pad = (int) (buf->ptr - start);
 
-    status = setjmp (buf->env);
+    if (pad < sm_class->fixed_size)
+    {
+        or_advance (buf, sm_class->fixed_size - pad);
+    }
 
-    if (status == 0)
+    /* skip over the bound bits */
+    if (bound_bit_flag)
     {
-        sm_class = (SM_CLASS *)classobj;
+        or_advance (buf, OR_BOUND_BIT_BYTES (sm_class->fixed_count));
+    }
 
-        offset_size = OR_GET_OFFSET_SIZE (buf->ptr);
+    /* process variable length column */
+    v_start = buf->ptr;
 
-        repid_bits = or_get_int (buf, &rc);
+    for (i = sm_class->fixed_count, j = 0;
+         i < sm_class->att_count && j < sm_class->variable_count;
+         i++, j++, att = (SM_ATTRIBUTE *)att->header.next)
+    {
+        (*(att->type->data_readval))(buf, &value, att->domain, 
+                                     vars[j], true, NULL, 0);
+        v_start += vars[j];
+        buf->ptr = v_start;
 
-        (void)or_get_int (buf, &rc);
+        set_col = ctcl_make_column (att, &value);
 
-        repid = repid_bits & ~OR_BOUND_BIT_FLAG & ~OR_OFFSET_SIZE_FLAG;
+        if (set_col == NULL)
+        {
+            pr_clear_value (&value);
 
-        bound_bit_flag = repid_bits & OR_BOUND_BIT_FLAG;
+            if (vars != NULL)
+            {
+                free (vars);
+                vars = NULL;
+            }
 
-        if (item->stmt_type == CTCL_STMT_TYPE_UPDATE)
-        {
-            error = ctcl_get_update_current (buf, 
-                                             sm_class, 
-                                             bound_bit_flag, 
-                                             def, 
-                                             item, 
-                                             offset_size);
-        }
-        else if (item->stmt_type == CTCL_STMT_TYPE_INSERT)
-        {
-            error = ctcl_get_insert_current (buf, 
-                                             sm_class, 
-                                             bound_bit_flag, 
-                                             def, 
-                                             item, 
-                                             offset_size);
+            return ER_OUT_OF_VIRTUAL_MEMORY;
         }
-        else
+
+        CTCG_LIST_ADD_LAST (&(item->update_log_info.set_col_list), 
+                            &set_col->node);
+
+        item->update_log_info.set_col_cnt++;
+
+        /* update the column */
+        error = dbt_put_internal (def, att->header.name, &value);
+        pr_clear_value (&value);
+
+        if (error != CTC_SUCCESS)
         {
-            /* DELETE come in?? */
+            if (vars != NULL)
+            {
+                free (vars);
+                vars = NULL;
+            }
+
+            return error;
         }
     }
-    else
+
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_DEBUG
+    if (item->update_log_info.key_col.val_len > 0)
     {
-        error = ER_GENERIC_ERROR;
+        CTCG_TRACE_DEBUG (CTCG_TRACE_EV_KEY_COLUMN,
+                          item->stmt_type,
+                          item->update_log_info.key_col.type,
+                          item->update_log_info.key_col.val_len,
+                          item->update_log_info.key_col.type == DB_TYPE_INTEGER ?
+                          (int)ntohl (*(UINT_32 *)(item->update_log_info.key_col.val)) : 0);
     }
 
-    return error;
-}
-
-
-static void ctcl_item_delete_log_info_init (CTCL_ITEM *item)
-{
-    memset (item->delete_log_info.key_col.name, 0, CTCL_NAME_MAX);
-}
-
-
-static void ctcl_item_insert_log_info_init (CTCL_ITEM *item)
-{
-    item->insert_log_info.set_col_cnt = 0;
-    CTCG_LIST_INIT (&(item->insert_log_info.set_col_list));
-}
+    CTCG_LIST_ITERATE (&(item->update_log_info.set_col_list), itr)
+    {
+        test_col = (CTCL_COLUMN *)itr->obj;
 
+        if (test_col != NULL)
+        {
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_SET_COLUMN,
+                              item->stmt_type,
+                              test_col->type,
+                              test_col->val_len,
+                              test_col->type == DB_TYPE_INTEGER &&
+                              test_col->val_len > 0 ?
+                              (int)ntohl (*(UINT_32 *)(test_col->val)) : 0);
+        }
+    }
+#endif
 
-static void ctcl_item_update_log_info_init (CTCL_ITEM *item)
-{
-    memset (item->update_log_info.key_col.name, 0, CTCL_NAME_MAX);
-    item->update_log_info.set_col_cnt = 0;
+    if (vars != NULL)
+    {
+        free (vars);
+        vars = NULL;
+    }
 
-    CTCG_LIST_INIT (&(item->update_log_info.set_col_list));
+    return error;
 }
 
 
-static int ctcl_get_update_current (OR_BUF *buf, 
-                                    SM_CLASS *sm_class, 
-                                    int bound_bit_flag, 
-                                    DB_OTMPL *def, 
-                                    CTCL_ITEM *item, 
-                                    int offset_size)
+/*
+ * ctcl_get_update_before () - attach before-image values to set columns
+ *
+ *  the undo image of RVHF_UPDATE is the whole old record, so it is read
+ *  with the same disk representation as the redo image and each value is
+ *  hung on the set column made by ctcl_get_update_current ().
+ */
+static int ctcl_get_update_before (MOBJ classobj, 
+                                   RECDES *old_recdes, 
+                                   CTCL_ITEM *item)
 {
-    int error = CTC_SUCCESS;
+    OR_BUF orep, *buf;
     int rc = CTC_SUCCESS;
-    int *vars = NULL;
+    int status;
+    int offset_size;
+    int bound_bit_flag;
     int i, j, offset, offset2, pad;
-    int col_name_len;
-    int key_att_id = 0;
+    int *vars = NULL;
+    unsigned int repid_bits;
     char *bits, *start, *v_start;
+    SM_CLASS *sm_class = (SM_CLASS *)classobj;
     SM_ATTRIBUTE *att;
     DB_VALUE value;
-    CTCL_COLUMN *set_col = NULL;
-    CTCL_COLUMN *test_col = NULL;
-    CTCG_LIST_NODE *itr;
 
-    if (sm_class->variable_count)
-    {
-        vars = (int *)malloc (DB_SIZEOF (int) * sm_class->variable_count);
+    if (sm_class->variable_count)
+    {
+        vars = (int *)malloc (DB_SIZEOF (int) * sm_class->variable_count);
+
+        if (vars == NULL)
+        {
+            return ER_OUT_OF_VIRTUAL_MEMORY;
+        }
+    }
+
+    buf = &orep;
+    or_init (buf, old_recdes->data, old_recdes->length);
+    buf->error_abort = 1;
+
+    status = setjmp (buf->env);
 
-        if (vars == NULL)
+    if (status != 0)
+    {
+        if (vars != NULL)
         {
-            return ER_OUT_OF_VIRTUAL_MEMORY;
+            free (vars);
         }
 
+        return ER_GENERIC_ERROR;
+    }
+
+    offset_size = OR_GET_OFFSET_SIZE (buf->ptr);
+
+    repid_bits = or_get_int (buf, &rc);
+
+    (void)or_get_int (buf, &rc);
+
+    bound_bit_flag = repid_bits & OR_BOUND_BIT_FLAG;
+
+    if (sm_class->variable_count)
+    {
         offset = or_get_offset_internal (buf, &rc, offset_size);
 
         for (i = 0; i < sm_class->variable_count; i++)
@@ -3472,147 +5411,27 @@ static int ctcl_get_update_current (OR_BUF *buf,
     att = sm_class->attributes;
     start = buf->ptr;
 
-    /* initialize update_log_info */
-    ctcl_item_update_log_info_init (item);
-
-    /* find key attribute */
-    for (i = 0; 
-         i < sm_class->att_count; 
-         i++, att = (SM_ATTRIBUTE *)att->header.next)
-    {
-        if (att->constraints != NULL)
-        {
-            if (att->constraints->type == SM_CONSTRAINT_PRIMARY_KEY)
-            {
-                key_att_id = att->id;
-            }
-        }
-        else
-        {
-            /* key not exist, critical problem, but ignore */
-        }
-    }
-
-    att = sm_class->attributes;
-
-    /* process the fixed length column */
+    /* fixed length column */
     for (i = 0; 
          i < sm_class->fixed_count; 
          i++, att = (SM_ATTRIBUTE *)att->header.next)
     {
         if (bits != NULL && !OR_GET_BOUND_BIT (bits, i))
         {
-            /* its a NULL value, skip it */
+            /* NULL before-image */
             db_make_null (&value);
             or_advance (buf, tp_domain_disk_size (att->domain));
         }
         else
         {
-            /* read the disk value into the db_value */
             (*(att->type->data_readval))(buf, &value, att->domain, 
-                                         -1, true, NULL, 0);
-
-            /* key column info setting */
-            if (att->id == key_att_id)
-            {
-                /* 1. column name */
-                col_name_len = strlen (att->header.name);
-                memcpy (item->update_log_info.key_col.name,
-                        att->header.name,
-                        col_name_len);
-
-                /* 2. column type */
-                item->update_log_info.key_col.type = att->domain->type->id;
-
-                /* 3. column value */
-                switch (att->type->id)
-                {
-                    case DB_TYPE_INTEGER:
-                        item->update_log_info.key_col.val_len = sizeof(int);
-                        item->update_log_info.key_col.val = malloc (sizeof(int));
-                        *(int *)(item->update_log_info.key_col.val) = value.data.i;
-                        break;
-
-                    case DB_TYPE_CHAR:
-                    case DB_TYPE_VARCHAR:
-                        item->update_log_info.key_col.val_len = 
-                            strlen (value.data.ch.medium.buf);
-                        item->update_log_info.key_col.val =
-                            malloc (item->update_log_info.key_col.val_len);
-                        memcpy (item->update_log_info.key_col.val,
-                                value.data.ch.medium.buf,
-                                item->update_log_info.key_col.val_len);
-                        break;
-
-                    default:
-                        break;
-                }
-            }
-            /* set column info setting */
-            else
-            {
-                set_col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN));
-                memset (set_col->name, 0, CTCL_NAME_MAX);
-
-                CTCG_LIST_INIT_OBJ (&set_col->node, set_col);
-
-                /* 1. column name */
-                col_name_len = strlen (att->header.name);
-                memcpy (set_col->name, att->header.name, col_name_len);
-
-                /* 2. column type */
-                set_col->type = att->domain->type->id;
-
-                /* 3. column value */
-                switch (set_col->type)
-                {
-                    case DB_TYPE_INTEGER:
-                        set_col->val_len = sizeof(int);
-                        set_col->val = malloc (set_col->val_len);
-                        *(int *)(set_col->val) = value.data.i;
-                        break;
-
-                    case DB_TYPE_CHAR:
-                    case DB_TYPE_VARCHAR:
-                        set_col->val_len = strlen (value.data.ch.medium.buf);
-                        set_col->val = malloc (set_col->val_len);
-                        memcpy (set_col->val, 
-                                value.data.ch.medium.buf, 
-                                set_col->val_len);
-                        break;
-
-                    default:
-                        break;
-                }
-
-                CTCG_LIST_ADD_LAST (&(item->update_log_info.set_col_list), 
-                                    &set_col->node);
-            }
-        }
-
-        /* skip cache object attribute for foreign key */
-        if (att->is_fk_cache_attr)
-        {
-            continue;
+                                         -1, false, NULL, 0);
         }
 
-        /* update the column */
-        error = dbt_put_internal (def, att->header.name, &value);
+        ctcl_set_column_old_value (item, att, &value);
         pr_clear_value (&value);
-
-        if (error != CTC_SUCCESS)
-        {
-            if (vars != NULL)
-            {
-                free (vars);
-                vars = NULL;
-            }
-
-            return error;
-        }
     }
 
-    /* round up to a to the end of the fixed block */
     pad = (int) (buf->ptr - start);
 
     if (pad < sm_class->fixed_size)
@@ -3620,13 +5439,12 @@ static int ctcl_get_update_current (OR_BUF *buf,
         or_advance (buf, sm_class->fixed_size - pad);
     }
 
-    /* skip over the bound bits */
     if (bound_bit_flag)
     {
         or_advance (buf, OR_BOUND_BIT_BYTES (sm_class->fixed_count));
     }
 
-    /* process variable length column */
+    /* variable length column */
     v_start = buf->ptr;
 
     for (i = sm_class->fixed_count, j = 0;
@@ -3634,115 +5452,120 @@ static int ctcl_get_update_current (OR_BUF *buf,
          i++, j++, att = (SM_ATTRIBUTE *)att->header.next)
     {
         (*(att->type->data_readval))(buf, &value, att->domain, 
-                                     vars[j], true, NULL, 0);
+                                     vars[j], false, NULL, 0);
         v_start += vars[j];
         buf->ptr = v_start;
 
-        set_col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN));
-        memset (set_col->name, 0, CTCL_NAME_MAX);
+        ctcl_set_column_old_value (item, att, &value);
+        pr_clear_value (&value);
+    }
 
-        CTCG_LIST_INIT_OBJ (&set_col->node, set_col);
+    if (vars != NULL)
+    {
+        free (vars);
+        vars = NULL;
+    }
 
-        /* 1. column name */
-        col_name_len = strlen (att->header.name);
-        memcpy (set_col->name, att->header.name, col_name_len);
+    return CTC_SUCCESS;
+}
 
-        /* 2. column type */
-        set_col->type = att->domain->type->id;
 
-        /* 3. column value */
-        switch (set_col->type)
-        {
-            case DB_TYPE_INTEGER:
-                set_col->val_len = sizeof(int);
-                set_col->val = malloc (set_col->val_len);
-                *(int *)(set_col->val) = value.data.i;
-                break;
+static CTCL_COLUMN *ctcl_find_set_column (CTCG_LIST *col_list, 
+                                          const char *name)
+{
+    CTCL_COLUMN *col;
+    CTCG_LIST_NODE *itr;
 
-            case DB_TYPE_CHAR:
-            case DB_TYPE_VARCHAR:
-                set_col->val_len = strlen (value.data.ch.medium.buf);
-                set_col->val = malloc (set_col->val_len);
-                memcpy (set_col->val, 
-                        value.data.ch.medium.buf, 
-                        set_col->val_len);
-                break;
+    CTCG_LIST_ITERATE (col_list, itr)
+    {
+        col = (CTCL_COLUMN *)itr->obj;
 
-            default:
-                break;
+        if (col != NULL && strcmp (col->name, name) == 0)
+        {
+            return col;
         }
+    }
 
-        CTCG_LIST_ADD_LAST (&(item->update_log_info.set_col_list), 
-                            &set_col->node);
+    return NULL;
+}
 
-        /* update the column */
-        error = dbt_put_internal (def, att->header.name, &value);
-        pr_clear_value (&value);
 
-        if (error != CTC_SUCCESS)
-        {
-            if (vars != NULL)
-            {
-                free (vars);
-                vars = NULL;
-            }
+static void ctcl_set_column_old_value (CTCL_ITEM *item, 
+                                       SM_ATTRIBUTE *att, 
+                                       DB_VALUE *value)
+{
+    int val_size;
+    CTCL_COLUMN *set_col;
 
-            return error;
-        }
+    /* key column has no set column */
+    set_col = ctcl_find_set_column (&(item->update_log_info.set_col_list),
+                                    att->header.name);
+
+    if (set_col == NULL)
+    {
+        return;
     }
 
-    /* >>> DEBUG */
-    if (item->update_log_info.key_col.val_len != 0)
+    val_size = ctcl_encoder_get_size (value);
+
+    if (val_size < 0)
     {
-        printf ("key_col.name = %s\n \
-                key_col.type = %d\n \
-                key_col.val_len = %d\n",
-                item->update_log_info.key_col.name,
-                item->update_log_info.key_col.type,
-                item->update_log_info.key_col.val_len);
+        set_col->old_val_len = val_size;
+        return;
+    }
 
-        if (item->update_log_info.key_col.type == DB_TYPE_INTEGER)
-        {
-            printf ("key_col.val = %d\n", *(int *)(item->update_log_info.key_col.val));
-        }
-        else
-        {
-            printf ("key_col.val = %s\n", (char *)(item->update_log_info.key_col.val));
-        }
+    set_col->old_val = malloc (val_size > 0 ? val_size : 1);
+
+    if (set_col->old_val != NULL)
+    {
+        set_col->old_val_len = ctcl_encoder_write (value, 
+                                                   (char *)set_col->old_val);
     }
+}
 
-    CTCG_LIST_ITERATE (&(item->update_log_info.set_col_list), itr)
+
+/*
+ * ctcl_mark_changed_columns () - compare set columns with before-image
+ *
+ *  without a before-image every set column is regarded as changed.
+ *  a NULL value has CTCL_ENCODER_NULL length, so value to NULL and 
+ *  NULL to value are both changed.
+ */
+static void ctcl_mark_changed_columns (CTCL_ITEM *item)
+{
+    CTCL_UPDATE_LOG_INFO *info = &item->update_log_info;
+    CTCL_COLUMN *set_col;
+    CTCG_LIST_NODE *itr;
+
+    info->changed_col_cnt = 0;
+
+    CTCG_LIST_ITERATE (&(info->set_col_list), itr)
     {
-        test_col = (CTCL_COLUMN *)itr->obj;
+        set_col = (CTCL_COLUMN *)itr->obj;
 
-        if (test_col != NULL)
+        if (info->has_before_image != CTC_TRUE)
         {
-            printf ("col_name = %s\n \
-                    col_type = %d\n \
-                    col_val_len = %d\n", 
-                    test_col->name,
-                    test_col->type,
-                    test_col->val_len);
+            set_col->is_changed = CTC_TRUE;
         }
-
-        if (test_col->type == DB_TYPE_INTEGER)
+        else if (set_col->val_len != set_col->old_val_len)
         {
-            printf ("col_val = %d\n", *(int *)(test_col->val));
+            set_col->is_changed = CTC_TRUE;
+        }
+        else if (set_col->val_len > 0 &&
+                 memcmp (set_col->val, set_col->old_val, set_col->val_len) != 0)
+        {
+            set_col->is_changed = CTC_TRUE;
         }
         else
         {
-            printf ("col_val = %s\n", (char *)(test_col->val));
+            set_col->is_changed = CTC_FALSE;
         }
-    }
-    /* <<< DEBUG */
 
-    if (vars != NULL)
-    {
-        free (vars);
-        vars = NULL;
+        if (set_col->is_changed == CTC_TRUE)
+        {
+            info->changed_col_cnt++;
+        }
     }
-
-    return error;
 }
 
 
@@ -3757,13 +5580,14 @@ static int ctcl_get_insert_current (OR_BUF *buf,
     int rc = CTC_SUCCESS;
     int *vars = NULL;
     int i, j, offset, offset2, pad;
-    int col_name_len;
     char *bits, *start, *v_start;
     SM_ATTRIBUTE *att;
     DB_VALUE value;
     CTCL_COLUMN *set_col = NULL;
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_DEBUG
     CTCL_COLUMN *test_col = NULL;
     CTCG_LIST_NODE *itr;
+#endif
 
     if (sm_class->variable_count)
     {
@@ -3812,42 +5636,24 @@ static int ctcl_get_insert_current (OR_BUF *buf,
         }
         else
         {
-            /* read the disk value into the db_value */
+            /* read the disk value into the db_value without copy,
+             * encoder takes the bytes straight from the record */
             (*(att->type->data_readval))(buf, &value, att->domain, 
-                                         -1, true, NULL, 0);
-
-            set_col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN));
-            memset (set_col->name, 0, CTCL_NAME_MAX);
-
-            CTCG_LIST_INIT_OBJ (&set_col->node, set_col);
-
-            /* 1. column name */
-            col_name_len = strlen (att->header.name);
-            memcpy (set_col->name, att->header.name, col_name_len);
+                                         -1, false, NULL, 0);
 
-            /* 2. column type */
-            set_col->type = att->domain->type->id;
+            set_col = ctcl_make_column (att, &value);
 
-            /* 3. column value */
-            switch (set_col->type)
+            if (set_col == NULL)
             {
-                case DB_TYPE_INTEGER:
-                    set_col->val_len = sizeof(int);
-                    set_col->val = malloc (set_col->val_len);
-                    *(int *)(set_col->val) = value.data.i;
-                    break;
+                pr_clear_value (&value);
 
-                case DB_TYPE_CHAR:
-                case DB_TYPE_VARCHAR:
-                    set_col->val_len = strlen (value.data.ch.medium.buf);
-                    set_col->val = malloc (set_col->val_len);
-                    memcpy (set_col->val, 
-                            value.data.ch.medium.buf, 
-                            set_col->val_len);
-                    break;
+                if (vars != NULL)
+                {
+                    free (vars);
+                    vars = NULL;
+                }
 
-                default:
-                    break;
+                return ER_OUT_OF_VIRTUAL_MEMORY;
             }
 
             CTCG_LIST_ADD_LAST (&(item->insert_log_info.set_col_list), 
@@ -3899,47 +5705,28 @@ static int ctcl_get_insert_current (OR_BUF *buf,
          i++, j++, att = (SM_ATTRIBUTE *)att->header.next)
     {
         (*(att->type->data_readval))(buf, &value, att->domain, 
-                                     vars[j], true, NULL, 0);
+                                     vars[j], false, NULL, 0);
         v_start += vars[j];
         buf->ptr = v_start;
 
-        set_col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN));
-        memset (set_col->name, 0, CTCL_NAME_MAX);
+        set_col = ctcl_make_column (att, &value);
 
-        CTCG_LIST_INIT_OBJ (&set_col->node, set_col);
-
-        /* 1. column name */
-        col_name_len = strlen (att->header.name);
-        memcpy (set_col->name, att->header.name, col_name_len);
-
-        /* 2. column type */
-        set_col->type = att->domain->type->id;
-
-        /* 3. column value */
-        switch (set_col->type)
+        if (set_col == NULL)
         {
-            case DB_TYPE_INTEGER:
-                set_col->val_len = sizeof(int);
-                set_col->val = malloc (set_col->val_len);
-                *(int *)(set_col->val) = value.data.i;
-                break;
+            pr_clear_value (&value);
 
-            case DB_TYPE_CHAR:
-            case DB_TYPE_VARCHAR:
-                set_col->val_len = strlen (value.data.ch.medium.buf);
-                set_col->val = malloc (set_col->val_len);
-                memcpy (set_col->val, 
-                        value.data.ch.medium.buf, 
-                        set_col->val_len);
-                break;
+            if (vars != NULL)
+            {
+                free (vars);
+                vars = NULL;
+            }
 
-            default:
-                break;
+            return ER_OUT_OF_VIRTUAL_MEMORY;
         }
 
         CTCG_LIST_ADD_LAST (&(item->insert_log_info.set_col_list), 
                             &set_col->node);
-    
+
         item->insert_log_info.set_col_cnt++;
 
         /* update the column */
@@ -3958,31 +5745,23 @@ static int ctcl_get_insert_current (OR_BUF *buf,
         }
     }
 
-    /* >>> DEBUG */
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_DEBUG
     CTCG_LIST_ITERATE (&(item->insert_log_info.set_col_list), itr)
     {
         test_col = (CTCL_COLUMN *)itr->obj;
 
         if (test_col != NULL)
         {
-            printf ("col_name = %s\n \
-                    col_type = %d\n \
-                    col_val_len = %d\n", 
-                    test_col->name,
-                    test_col->type,
-                    test_col->val_len);
-        }
-
-        if (test_col->type == DB_TYPE_INTEGER)
-        {
-            printf ("col_val = %d\n", *(int *)(test_col->val));
-        }
-        else
-        {
-            printf ("col_val = %s\n", (char *)(test_col->val));
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_SET_COLUMN,
+                              item->stmt_type,
+                              test_col->type,
+                              test_col->val_len,
+                              test_col->type == DB_TYPE_INTEGER &&
+                              test_col->val_len > 0 ?
+                              (int)ntohl (*(UINT_32 *)(test_col->val)) : 0);
         }
     }
-    /* <<< DEBUG */
+#endif
 
     if (vars != NULL)
     {
@@ -4042,12 +5821,15 @@ static void ctcl_free_log_item (CTCL_TRANS_LOG_LIST *trans_log_list,
 
     ctcl_unlink_log_item (trans_log_list, item);
 
+    ctcl_free_item_columns (item);
+
     if (item->table_name != NULL)
     {
         free (item->table_name);
-        pr_clear_value (&item->key);
     }
 
+    pr_clear_value (&item->key);
+
     if (item->db_user != NULL)
     {
         free (item->db_user);
@@ -4060,6 +5842,65 @@ static void ctcl_free_log_item (CTCL_TRANS_LOG_LIST *trans_log_list,
 }
 
 
+/*
+ * ctcl_free_item_columns () - free key and set columns of an item
+ *
+ *  set columns are a single allocation made by ctcl_make_column (),
+ *  key column value and before-images are separate allocations.
+ */
+static void ctcl_free_item_columns (CTCL_ITEM *item)
+{
+    CTCG_LIST *col_list = NULL;
+    CTCL_COLUMN *col;
+
+    switch (item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+            col_list = &(item->insert_log_info.set_col_list);
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+            col_list = &(item->update_log_info.set_col_list);
+
+            if (item->update_log_info.key_col.val != NULL)
+            {
+                free (item->update_log_info.key_col.val);
+                item->update_log_info.key_col.val = NULL;
+            }
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+            if (item->delete_log_info.key_col.val != NULL)
+            {
+                free (item->delete_log_info.key_col.val);
+                item->delete_log_info.key_col.val = NULL;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (col_list == NULL)
+    {
+        return;
+    }
+
+    while (CTCG_LIST_IS_EMPTY (col_list) != CTC_TRUE)
+    {
+        col = (CTCL_COLUMN *)CTCG_LIST_GET_FIRST (col_list)->obj;
+        CTCG_LIST_REMOVE (&col->node);
+
+        if (col->old_val != NULL)
+        {
+            free (col->old_val);
+        }
+
+        free (col);
+    }
+}
+
+
 static void ctcl_free_all_log_items_except_head (CTCL_TRANS_LOG_LIST *trans_log_list)
 {
     CTCL_ITEM *item, *next_item;
@@ -4115,7 +5956,9 @@ static void ctcl_clear_trans_log_list (CTCL_TRANS_LOG_LIST *trans_log_list)
 
         CTCL_LSA_SET_NULL (&trans_log_list->start_lsa);
         CTCL_LSA_SET_NULL (&trans_log_list->last_lsa);
+        trans_log_list->is_committed = CTC_FALSE;
         trans_log_list->tid = 0;
+        CTCL_LSA_SET_NULL (&trans_log_list->commit_lsa);
     }
     else
     {
@@ -5734,7 +7577,6 @@ static int ctcl_log_record_process (CTCL_LOG_RECORD_HEADER *lrec,
 
             apply = ctcl_get_trans_log_list_set_tid (lrec->trid);
             apply->is_committed = CTC_TRUE;
-            apply->ref_cnt = ctcl_mgr_get_cur_job_cnt ();
             /* add the repl_list to the commit_list  */
             result = ctcl_add_unlock_commit_log (lrec->trid, final);
             CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
@@ -5749,7 +7591,6 @@ static int ctcl_log_record_process (CTCL_LOG_RECORD_HEADER *lrec,
 
             apply = ctcl_get_trans_log_list_set_tid (lrec->trid);
             apply->is_committed = CTC_TRUE;
-            apply->ref_cnt = ctcl_mgr_get_cur_job_cnt ();
             /* apply the replication log to the slave */
             if (CTCL_LSA_GT (final, &ctcl_Mgr.log_info.committed_lsa))
             {
@@ -5797,6 +7638,10 @@ static int ctcl_log_record_process (CTCL_LOG_RECORD_HEADER *lrec,
                                                          * there is the replication log
                                                          * applying to the slave
                                                          */
+
+                result = ctcl_stream_publish (lrec->trid, final);
+                CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                                    err_stream_publish_failed_label);
             }
             else
             {
@@ -5865,6 +7710,10 @@ static int ctcl_log_record_process (CTCL_LOG_RECORD_HEADER *lrec,
     {
         ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
     }
+    CTC_EXCEPTION (err_stream_publish_failed_label)
+    {
+        ctcl_Mgr.need_stop_analyzer = CTC_TRUE;
+    }
     CTC_EXCEPTION (err_final_log_page_corrupted_label)
     {
         if (ctcl_check_page_exist (final->pageid) == CTCL_PAGE_EXST_IN_ARCHIVE_LOG)
@@ -5941,21 +7790,15 @@ static void ctcl_shutdown (void)
         ctcl_Mgr.log_info.cache_pb = NULL;
     }
 
-    if (ctcl_Mgr.log_info.trans_log_list)
+    for (i = 0; i < ctcl_Mgr.log_info.trans_cnt / CTCL_TRANS_LOG_LIST_COUNT; i++)
     {
-        for (i = 0; i < ctcl_Mgr.log_info.trans_cnt; i++)
-        {
-            if (ctcl_Mgr.log_info.trans_log_list[i] != NULL)
-            {
-                free (ctcl_Mgr.log_info.trans_log_list[i]);
-                ctcl_Mgr.log_info.trans_log_list[i] = NULL;
-            }
-        }
-
-        free (ctcl_Mgr.log_info.trans_log_list);
-        ctcl_Mgr.log_info.trans_log_list = NULL;
+        free (ctcl_Mgr.log_info.trans_log_chunk[i]);
+        ctcl_Mgr.log_info.trans_log_chunk[i] = NULL;
     }
 
+    ctcl_Mgr.log_info.trans_cnt = 0;
+    ctcl_Mgr.log_info.cur_trans = 0;
+
     if (ctcl_Mgr.log_info.act_log.hdr_page)
     {
         free (ctcl_Mgr.log_info.act_log.hdr_page);
@@ -5969,11 +7812,23 @@ static int ctcl_start_log_analyzer (CTCL_ARGS *ctcl_args)
     int result;
     int thr_ret = 0;
     pthread_t la_thr;
+    pthread_attr_t attr;
 
-    result = pthread_create (&la_thr, 
-                             NULL, 
-                             ctcl_log_analyzer_thr_func, 
-                             (void *)ctcl_args);
+    (void)pthread_attr_init (&attr);
+
+    result = ctcg_cpu_bind_attr (&attr, 
+                                 &ctcl_Mgr.analyzer_cpu_set, 
+                                 CTCG_CPU_ALL);
+
+    if (result == CTC_SUCCESS)
+    {
+        result = pthread_create (&la_thr, 
+                                 &attr, 
+                                 ctcl_log_analyzer_thr_func, 
+                                 (void *)ctcl_args);
+    }
+
+    (void)pthread_attr_destroy (&attr);
 
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_create_thread_failed_label); 
 
@@ -5984,8 +7839,8 @@ static int ctcl_start_log_analyzer (CTCL_ARGS *ctcl_args)
 
     CTC_EXCEPTION (err_create_thread_failed_label)
     {
-        /* DEBUG */            
-        printf ("result of pthread_create : %d\n", result);
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_ANALYZER_THR_CREATE_FAILED,
+                          result, 0, 0, 0);
 
         result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
     }
@@ -6037,7 +7892,6 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
     struct log_header final_log_hdr;
     CTCL_CACHE_BUFFER *log_buf = NULL;
     CTCL_LOG_PAGE *pg_ptr;
-    CTCL_TRANS_LOG_LIST *trans = NULL;
     
     CTCL_LOG_RECORD_HEADER *lrec = NULL;
     
@@ -6065,11 +7919,17 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
         CTCL_LSA_COPY (&ctcl_Mgr.log_info.committed_lsa, 
                        &ctcl_Mgr.log_info.final_lsa);
 
-        /* DEBUG */
-        printf ("ctcl_Mgr.log_info.final_lsa.pageid = %d\n \
-                act_log.log_hdr.append_lsa.pageid = %d\n", 
-                ctcl_Mgr.log_info.final_lsa.pageid, 
-                ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid);
+        /* transactions committed before this point can not be replayed,
+         * retained ones neither as commits in between are never read. 
+         * a client resuming from an earlier server run ends up here */
+        (void)pthread_mutex_lock (&ctcl_Mgr.stream.lock);
+        CTCL_LSA_COPY (&ctcl_Mgr.stream.horizon_lsa, &ctcl_Mgr.log_info.final_lsa);
+        (void)pthread_mutex_unlock (&ctcl_Mgr.stream.lock);
+
+        CTCG_TRACE_INFO (CTCG_TRACE_EV_ANALYZER_FINAL_LSA,
+                         ctcl_Mgr.log_info.final_lsa.pageid,
+                         ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid,
+                         0, 0);
 
         /* start loop for apply */
         while (!CTCL_LSA_ISNULL (&ctcl_Mgr.log_info.final_lsa))
@@ -6098,18 +7958,11 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
                 continue;
             }
 
-            /* DEBUG */
-            if (ctcl_Mgr.log_info.final_lsa.pageid 
-                != ctcl_Mgr.log_info.act_log.log_hdr->eof_lsa.pageid)
-            {
-                printf ("IN_LOOP \n \
-                        ctcl_Mgr.log_info.final_lsa.pageid = %d\n \
-                        act_log.log_hdr.eof_lsa.pageid = %d\n \
-                        act_log.log_hdr.append_lsa.pageid = %d\n", 
-                        ctcl_Mgr.log_info.final_lsa.pageid, 
-                        ctcl_Mgr.log_info.act_log.log_hdr->eof_lsa.pageid,
-                        ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid);
-            }
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_IN_LOOP,
+                              ctcl_Mgr.log_info.final_lsa.pageid,
+                              ctcl_Mgr.log_info.act_log.log_hdr->eof_lsa.pageid,
+                              ctcl_Mgr.log_info.act_log.log_hdr->append_lsa.pageid,
+                              0);
 
             memset (&final_log_hdr, 0, sizeof (struct log_header));
             memcpy (&final_log_hdr, 
@@ -6158,8 +8011,9 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
             {
                 if (log_buf->logpage.hdr.offset < 0)
                 {
-                    /* DEBUG */
-                    printf ("Did you come in here really??\n");
+                    CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_NEGATIVE_PAGE_OFFSET,
+                                      ctcl_Mgr.log_info.final_lsa.pageid,
+                                      0, 0, 0);
 
                     ctcl_decache_page_buffer (log_buf);
 
@@ -6188,7 +8042,6 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
                 else
                 {
                     /* valid page */
-                    /* DEBUG*/
                     valid_pg_read_cnt++;
                 }
             }
@@ -6207,7 +8060,11 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
 
             /* DEBUG */
             ctcl_Mgr.first_tid = ctcl_Mgr.last_tid + 1;
-            printf("valid page read count = %d\n", valid_pg_read_cnt);
+
+            CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_PAGE_READ,
+                              valid_pg_read_cnt,
+                              log_buf->pageid,
+                              0, 0);
 
             while (ctcl_Mgr.log_info.final_lsa.pageid == log_buf->pageid && 
                    ctcl_Mgr.need_stop_analyzer == CTC_FALSE)
@@ -6229,8 +8086,10 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
                 else if (CTCL_LSA_GT (&ctcl_Mgr.log_info.final_lsa, 
                                       (CTCL_LOG_LSA *)&final_log_hdr.append_lsa))
                 {
-                    /* DEBUG */
-                    printf ("HERE1\n");
+                    CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_PASS_APPEND_LSA,
+                                      ctcl_Mgr.log_info.final_lsa.pageid,
+                                      ctcl_Mgr.log_info.final_lsa.offset,
+                                      0, 0);
 
                     ctcl_decache_page_buffer (log_buf);
                     break;
@@ -6251,8 +8110,7 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
 
                 if (ctcl_Mgr.cur_job_cnt > 0)
                 {
-                    trans = ctcl_get_trans_log_list_set_tid (lrec->trid);
-                    trans->ref_cnt = ctcl_Mgr.cur_job_cnt;
+                    (void)ctcl_get_trans_log_list_set_tid (lrec->trid);
                 }
                 else
                 {
@@ -6294,9 +8152,11 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
                 }
                 */
 
-                /* DEBUG */
-                printf ("record type = %d\n record tid = %d\n", 
-                        lrec->type, lrec->trid);
+                CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_RECORD,
+                                  lrec->type,
+                                  lrec->trid,
+                                  ctcl_Mgr.log_info.final_lsa.pageid,
+                                  ctcl_Mgr.log_info.final_lsa.offset);
 
                 /* process the log record */
                 result = ctcl_log_record_process (lrec, 
@@ -6327,7 +8187,11 @@ static void *ctcl_log_analyzer_thr_func (void *ctcl_args)
                              (CTCL_LOG_LSA *)&final_log_hdr.append_lsa) || 
                 ctcl_Mgr.log_info.is_end_of_record == CTC_TRUE)
             {
-                printf ("HERE2\n");
+                CTCG_TRACE_DEBUG (CTCG_TRACE_EV_ANALYZER_END_OF_PAGE,
+                                  ctcl_Mgr.log_info.final_lsa.pageid,
+                                  ctcl_Mgr.log_info.final_lsa.offset,
+                                  0, 0);
+
                 /* it should be refetched and release */
                 ctcl_decache_page_buffer (log_buf);
             }
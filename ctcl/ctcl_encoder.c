@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcl_encoder.c : ctc column value encoder implementation
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "db.h"
+
+#include "ctcl_encoder.h"
+#include "ctc_common.h"
+
+
+static void ctcl_encoder_put_two (char *dst, unsigned short src);
+static void ctcl_encoder_put_four (char *dst, UINT_32 src);
+static void ctcl_encoder_put_eight (char *dst, UINT_64 src);
+
+static int ctcl_encoder_short_size (DB_VALUE *value);
+static int ctcl_encoder_short_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_int_size (DB_VALUE *value);
+static int ctcl_encoder_int_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_bigint_size (DB_VALUE *value);
+static int ctcl_encoder_bigint_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_float_size (DB_VALUE *value);
+static int ctcl_encoder_float_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_double_size (DB_VALUE *value);
+static int ctcl_encoder_double_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_monetary_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_numeric_size (DB_VALUE *value);
+static int ctcl_encoder_numeric_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_date_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_time_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_timestamp_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_datetime_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_string_size (DB_VALUE *value);
+static int ctcl_encoder_string_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_bit_size (DB_VALUE *value);
+static int ctcl_encoder_bit_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_enum_size (DB_VALUE *value);
+static int ctcl_encoder_enum_write (DB_VALUE *value, char *dst);
+static int ctcl_encoder_set_size (DB_VALUE *value);
+static int ctcl_encoder_set_write (DB_VALUE *value, char *dst);
+
+
+/* encoder table indexed by DB_TYPE, NULL entry means not supported */
+static CTCL_VALUE_ENCODER value_encoder_Tbl[DB_TYPE_LAST + 1] =
+{
+    [DB_TYPE_SHORT]     = { ctcl_encoder_short_size,    ctcl_encoder_short_write },
+    [DB_TYPE_INTEGER]   = { ctcl_encoder_int_size,      ctcl_encoder_int_write },
+    [DB_TYPE_BIGINT]    = { ctcl_encoder_bigint_size,   ctcl_encoder_bigint_write },
+    [DB_TYPE_FLOAT]     = { ctcl_encoder_float_size,    ctcl_encoder_float_write },
+    [DB_TYPE_DOUBLE]    = { ctcl_encoder_double_size,   ctcl_encoder_double_write },
+    [DB_TYPE_MONETARY]  = { ctcl_encoder_double_size,   ctcl_encoder_monetary_write },
+    [DB_TYPE_NUMERIC]   = { ctcl_encoder_numeric_size,  ctcl_encoder_numeric_write },
+    [DB_TYPE_DATE]      = { ctcl_encoder_int_size,      ctcl_encoder_date_write },
+    [DB_TYPE_TIME]      = { ctcl_encoder_int_size,      ctcl_encoder_time_write },
+    [DB_TYPE_TIMESTAMP] = { ctcl_encoder_int_size,      ctcl_encoder_timestamp_write },
+    [DB_TYPE_DATETIME]  = { ctcl_encoder_bigint_size,   ctcl_encoder_datetime_write },
+    [DB_TYPE_CHAR]      = { ctcl_encoder_string_size,   ctcl_encoder_string_write },
+    [DB_TYPE_VARCHAR]   = { ctcl_encoder_string_size,   ctcl_encoder_string_write },
+    [DB_TYPE_NCHAR]     = { ctcl_encoder_string_size,   ctcl_encoder_string_write },
+    [DB_TYPE_VARNCHAR]  = { ctcl_encoder_string_size,   ctcl_encoder_string_write },
+    [DB_TYPE_BIT]       = { ctcl_encoder_bit_size,      ctcl_encoder_bit_write },
+    [DB_TYPE_VARBIT]    = { ctcl_encoder_bit_size,      ctcl_encoder_bit_write },
+    [DB_TYPE_ENUMERATION] = { ctcl_encoder_enum_size,   ctcl_encoder_enum_write },
+    [DB_TYPE_SET]       = { ctcl_encoder_set_size,      ctcl_encoder_set_write },
+    [DB_TYPE_MULTISET]  = { ctcl_encoder_set_size,      ctcl_encoder_set_write },
+    [DB_TYPE_SEQUENCE]  = { ctcl_encoder_set_size,      ctcl_encoder_set_write }
+};
+
+
+extern BOOL ctcl_encoder_is_supported (int type)
+{
+    if (type < 0 || type > DB_TYPE_LAST)
+    {
+        return CTC_FALSE;
+    }
+
+    return value_encoder_Tbl[type].write != NULL ? CTC_TRUE : CTC_FALSE;
+}
+
+
+/*
+ * ctcl_encoder_get_size () - encoded length of the value
+ *
+ *  returns CTCL_ENCODER_NULL for NULL value and CTCL_ENCODER_NOT_SUPPORTED
+ *  for unknown type.
+ */
+extern int ctcl_encoder_get_size (DB_VALUE *value)
+{
+    int type = DB_VALUE_TYPE (value);
+
+    if (DB_IS_NULL (value))
+    {
+        return CTCL_ENCODER_NULL;
+    }
+
+    if (ctcl_encoder_is_supported (type) != CTC_TRUE)
+    {
+        return CTCL_ENCODER_NOT_SUPPORTED;
+    }
+
+    return value_encoder_Tbl[type].get_size (value);
+}
+
+
+/*
+ * ctcl_encoder_write () - encode the value into dst
+ *
+ *  dst must have ctcl_encoder_get_size () bytes, returns written length,
+ *  or the same negative length as ctcl_encoder_get_size ().
+ */
+extern int ctcl_encoder_write (DB_VALUE *value, char *dst)
+{
+    int type = DB_VALUE_TYPE (value);
+
+    if (DB_IS_NULL (value))
+    {
+        return CTCL_ENCODER_NULL;
+    }
+
+    if (ctcl_encoder_is_supported (type) != CTC_TRUE)
+    {
+        return CTCL_ENCODER_NOT_SUPPORTED;
+    }
+
+    return value_encoder_Tbl[type].write (value, dst);
+}
+
+
+static void ctcl_encoder_put_two (char *dst, unsigned short src)
+{
+    dst[0] = (char)(src >> 8);
+    dst[1] = (char)(src);
+}
+
+
+static void ctcl_encoder_put_four (char *dst, UINT_32 src)
+{
+    dst[0] = (char)(src >> 24);
+    dst[1] = (char)(src >> 16);
+    dst[2] = (char)(src >> 8);
+    dst[3] = (char)(src);
+}
+
+
+static void ctcl_encoder_put_eight (char *dst, UINT_64 src)
+{
+    ctcl_encoder_put_four (dst, (UINT_32)(src >> 32));
+    ctcl_encoder_put_four (dst + 4, (UINT_32)(src));
+}
+
+
+static int ctcl_encoder_short_size (DB_VALUE *value)
+{
+    return 2;
+}
+
+
+static int ctcl_encoder_short_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_two (dst, (unsigned short)db_get_short (value));
+
+    return 2;
+}
+
+
+static int ctcl_encoder_int_size (DB_VALUE *value)
+{
+    return 4;
+}
+
+
+static int ctcl_encoder_int_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_four (dst, (UINT_32)db_get_int (value));
+
+    return 4;
+}
+
+
+static int ctcl_encoder_bigint_size (DB_VALUE *value)
+{
+    return 8;
+}
+
+
+static int ctcl_encoder_bigint_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_eight (dst, (UINT_64)db_get_bigint (value));
+
+    return 8;
+}
+
+
+static int ctcl_encoder_float_size (DB_VALUE *value)
+{
+    return 4;
+}
+
+
+static int ctcl_encoder_float_write (DB_VALUE *value, char *dst)
+{
+    float f = db_get_float (value);
+    UINT_32 bits;
+
+    memcpy (&bits, &f, sizeof (bits));
+    ctcl_encoder_put_four (dst, bits);
+
+    return 4;
+}
+
+
+static int ctcl_encoder_double_size (DB_VALUE *value)
+{
+    return 8;
+}
+
+
+static int ctcl_encoder_double_write (DB_VALUE *value, char *dst)
+{
+    double d = db_get_double (value);
+    UINT_64 bits;
+
+    memcpy (&bits, &d, sizeof (bits));
+    ctcl_encoder_put_eight (dst, bits);
+
+    return 8;
+}
+
+
+static int ctcl_encoder_monetary_write (DB_VALUE *value, char *dst)
+{
+    DB_MONETARY *money = db_get_monetary (value);
+    UINT_64 bits;
+
+    memcpy (&bits, &money->amount, sizeof (bits));
+    ctcl_encoder_put_eight (dst, bits);
+
+    return 8;
+}
+
+
+static int ctcl_encoder_numeric_size (DB_VALUE *value)
+{
+    return 2 + DB_NUMERIC_BUF_SIZE;
+}
+
+
+static int ctcl_encoder_numeric_write (DB_VALUE *value, char *dst)
+{
+    dst[0] = (char)db_value_precision (value);
+    dst[1] = (char)db_value_scale (value);
+
+    /* numeric buffer is already most significant byte first */
+    memcpy (dst + 2, db_get_numeric (value), DB_NUMERIC_BUF_SIZE);
+
+    return 2 + DB_NUMERIC_BUF_SIZE;
+}
+
+
+static int ctcl_encoder_date_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_four (dst, (UINT_32)*db_get_date (value));
+
+    return 4;
+}
+
+
+static int ctcl_encoder_time_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_four (dst, (UINT_32)*db_get_time (value));
+
+    return 4;
+}
+
+
+static int ctcl_encoder_timestamp_write (DB_VALUE *value, char *dst)
+{
+    ctcl_encoder_put_four (dst, (UINT_32)*db_get_timestamp (value));
+
+    return 4;
+}
+
+
+static int ctcl_encoder_datetime_write (DB_VALUE *value, char *dst)
+{
+    DB_DATETIME *dt = db_get_datetime (value);
+
+    ctcl_encoder_put_four (dst, (UINT_32)dt->date);
+    ctcl_encoder_put_four (dst + 4, (UINT_32)dt->time);
+
+    return 8;
+}
+
+
+static int ctcl_encoder_string_size (DB_VALUE *value)
+{
+    return db_get_string_size (value);
+}
+
+
+static int ctcl_encoder_string_write (DB_VALUE *value, char *dst)
+{
+    int size = db_get_string_size (value);
+
+    memcpy (dst, db_get_string (value), size);
+
+    return size;
+}
+
+
+static int ctcl_encoder_bit_size (DB_VALUE *value)
+{
+    int bit_len = 0;
+
+    (void)db_get_bit (value, &bit_len);
+
+    return 4 + (bit_len + 7) / 8;
+}
+
+
+static int ctcl_encoder_bit_write (DB_VALUE *value, char *dst)
+{
+    int bit_len = 0;
+    const char *bits;
+
+    bits = db_get_bit (value, &bit_len);
+
+    ctcl_encoder_put_four (dst, (UINT_32)bit_len);
+    memcpy (dst + 4, bits, (bit_len + 7) / 8);
+
+    return 4 + (bit_len + 7) / 8;
+}
+
+
+static int ctcl_encoder_enum_size (DB_VALUE *value)
+{
+    return 2 + db_get_enum_string_size (value);
+}
+
+
+static int ctcl_encoder_enum_write (DB_VALUE *value, char *dst)
+{
+    int size = db_get_enum_string_size (value);
+
+    ctcl_encoder_put_two (dst, db_get_enum_short (value));
+
+    if (size > 0)
+    {
+        memcpy (dst + 2, db_get_enum_string (value), size);
+    }
+
+    return 2 + size;
+}
+
+
+static int ctcl_encoder_set_size (DB_VALUE *value)
+{
+    int i;
+    int cnt;
+    int elem_size;
+    int size = 4;
+    DB_SET *set = db_get_set (value);
+    DB_VALUE elem;
+
+    cnt = db_set_size (set);
+
+    for (i = 0; i < cnt; i++)
+    {
+        size += 8;
+
+        if (db_set_get (set, i, &elem) != NO_ERROR)
+        {
+            continue;
+        }
+
+        elem_size = ctcl_encoder_get_size (&elem);
+
+        if (elem_size > 0)
+        {
+            size += elem_size;
+        }
+
+        db_value_clear (&elem);
+    }
+
+    return size;
+}
+
+
+static int ctcl_encoder_set_write (DB_VALUE *value, char *dst)
+{
+    int i;
+    int cnt;
+    int elem_type;
+    int elem_size;
+    int pos = 4;
+    DB_SET *set = db_get_set (value);
+    DB_VALUE elem;
+
+    cnt = db_set_size (set);
+    ctcl_encoder_put_four (dst, (UINT_32)cnt);
+
+    for (i = 0; i < cnt; i++)
+    {
+        elem_type = DB_TYPE_NULL;
+        elem_size = CTCL_ENCODER_NULL;
+
+        if (db_set_get (set, i, &elem) == NO_ERROR)
+        {
+            elem_type = DB_VALUE_TYPE (&elem);
+            elem_size = ctcl_encoder_write (&elem, dst + pos + 8);
+
+            db_value_clear (&elem);
+        }
+
+        /* NULL and unsupported element go with negative length */
+        ctcl_encoder_put_four (dst + pos, (UINT_32)elem_type);
+        ctcl_encoder_put_four (dst + pos + 4, (UINT_32)elem_size);
+
+        pos += 8 + (elem_size > 0 ? elem_size : 0);
+    }
+
+    return pos;
+}
@@ -0,0 +1,714 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcl_spill.c : ctc job spill segment implementation
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "db.h"
+
+#include "ctcl_spill.h"
+#include "ctcl.h"
+#include "ctc_common.h"
+
+
+static int ctcl_spill_open (CTCL_SPILL *spill, const char *dir);
+
+static int ctcl_spill_column_size (CTCL_COLUMN *col);
+static int ctcl_spill_item_size (CTCL_ITEM *item);
+
+static char *ctcl_spill_put_int (char *dst, int val);
+static char *ctcl_spill_put_bytes (char *dst, const void *src, int len);
+static char *ctcl_spill_put_column (char *dst, CTCL_COLUMN *col);
+static char *ctcl_spill_put_item (char *dst, CTCL_ITEM *item);
+
+static char *ctcl_spill_get_int (char *src, int *val);
+static char *ctcl_spill_get_bytes (char *src, void **dst, int len);
+static char *ctcl_spill_get_column (char *src, 
+                                    CTCL_COLUMN **col, 
+                                    CTCL_COLUMN *key_col);
+static char *ctcl_spill_get_item (char *src, CTCL_ITEM **item);
+
+static void ctcl_spill_free_item (CTCL_ITEM *item);
+static void ctcl_spill_free_column_list (CTCG_LIST *col_list);
+
+
+static UINT_32 ctcl_spill_File_seq = 0;
+
+
+extern void ctcl_spill_init (CTCL_SPILL *spill)
+{
+    spill->fd = -1;
+    spill->write_pos = 0;
+    spill->read_pos = 0;
+    spill->rec_cnt = 0;
+}
+
+
+extern void ctcl_spill_final (CTCL_SPILL *spill)
+{
+    if (spill->fd >= 0)
+    {
+        (void)close (spill->fd);
+        spill->fd = -1;
+    }
+
+    spill->write_pos = 0;
+    spill->read_pos = 0;
+    spill->rec_cnt = 0;
+}
+
+
+/*
+ * Description : create the segment file and unlink it, the open 
+ *               descriptor keeps it alive until ctcl_spill_final()
+ *
+ */
+static int ctcl_spill_open (CTCL_SPILL *spill, const char *dir)
+{
+    int result;
+    char path[CTCL_LOG_PATH_MAX];
+
+    snprintf (path, sizeof (path), "%s%s%s_%d_%u", 
+              dir, 
+              CTC_PATH_SEPARATOR (dir), 
+              CTCL_SPILL_FILE_PREFIX,
+              (int)getpid (),
+              __sync_fetch_and_add (&ctcl_spill_File_seq, 1));
+
+    spill->fd = open (path, O_RDWR | O_CREAT | O_EXCL, 0600);
+    CTC_COND_EXCEPTION (spill->fd < 0, err_open_failed_label);
+
+    (void)unlink (path);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_open_failed_label)
+    {
+        result = CTC_ERR_FILE_NOT_EXIST_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : append one committed transaction, called by producer
+ *
+ */
+extern int ctcl_spill_write (CTCL_SPILL *spill, 
+                             const char *dir, 
+                             CTCL_TRANS_LOG_LIST *trans_log_list)
+{
+    int result;
+    int rec_len;
+    char *buf = NULL;
+    char *ptr;
+    CTCL_ITEM *item;
+
+    if (spill->fd < 0)
+    {
+        result = ctcl_spill_open (spill, dir);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_open_failed_label);
+    }
+
+    /* record length, tid, item count, commit lsa */
+    rec_len = 3 * sizeof (int) + sizeof (CTCL_LOG_LSA);
+
+    for (item = trans_log_list->head; item != NULL; item = item->next)
+    {
+        rec_len += ctcl_spill_item_size (item);
+    }
+
+    buf = (char *)malloc (rec_len);
+    CTC_COND_EXCEPTION (buf == NULL, err_alloc_failed_label);
+
+    ptr = ctcl_spill_put_int (buf, rec_len);
+    ptr = ctcl_spill_put_int (ptr, trans_log_list->tid);
+    ptr = ctcl_spill_put_int (ptr, trans_log_list->item_num);
+
+    memcpy (ptr, &trans_log_list->commit_lsa, sizeof (CTCL_LOG_LSA));
+    ptr += sizeof (CTCL_LOG_LSA);
+
+    for (item = trans_log_list->head; item != NULL; item = item->next)
+    {
+        ptr = ctcl_spill_put_item (ptr, item);
+    }
+
+    CTC_COND_EXCEPTION (pwrite (spill->fd, buf, rec_len, spill->write_pos) 
+                        != rec_len,
+                        err_write_failed_label);
+
+    spill->write_pos += rec_len;
+    __sync_fetch_and_add (&spill->rec_cnt, 1);
+
+    free (buf);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_open_failed_label)
+    {
+        /* error info set from sub-function */
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_write_failed_label)
+    {
+        free (buf);
+        result = CTC_FAILURE;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : decode the oldest unread transaction into a new list, 
+ *               called by consumer. *trans_log_list is NULL if there is
+ *               no record to read.
+ *
+ */
+extern int ctcl_spill_read (CTCL_SPILL *spill, 
+                            CTCL_TRANS_LOG_LIST **trans_log_list)
+{
+    int i;
+    int result;
+    int rec_len;
+    int item_cnt;
+    char *buf = NULL;
+    char *ptr;
+    CTCL_ITEM *item;
+    CTCL_TRANS_LOG_LIST *list = NULL;
+
+    *trans_log_list = NULL;
+
+    if (__sync_fetch_and_add (&spill->rec_cnt, 0) == 0)
+    {
+        return CTC_SUCCESS;
+    }
+
+    CTC_COND_EXCEPTION (pread (spill->fd, &rec_len, sizeof (int), spill->read_pos) 
+                        != sizeof (int),
+                        err_read_failed_label);
+
+    buf = (char *)malloc (rec_len);
+    CTC_COND_EXCEPTION (buf == NULL, err_alloc_failed_label);
+
+    CTC_COND_EXCEPTION (pread (spill->fd, buf, rec_len, spill->read_pos) 
+                        != rec_len,
+                        err_read_failed_label);
+
+    list = (CTCL_TRANS_LOG_LIST *)malloc (sizeof (CTCL_TRANS_LOG_LIST));
+    CTC_COND_EXCEPTION (list == NULL, err_alloc_failed_label);
+
+    memset (list, 0, sizeof (CTCL_TRANS_LOG_LIST));
+    list->is_committed = CTC_TRUE;
+
+    ptr = buf + sizeof (int);
+    ptr = ctcl_spill_get_int (ptr, &list->tid);
+    ptr = ctcl_spill_get_int (ptr, &item_cnt);
+
+    memcpy (&list->commit_lsa, ptr, sizeof (CTCL_LOG_LSA));
+    ptr += sizeof (CTCL_LOG_LSA);
+
+    for (i = 0; i < item_cnt; i++)
+    {
+        ptr = ctcl_spill_get_item (ptr, &item);
+        CTC_COND_EXCEPTION (item == NULL, err_alloc_failed_label);
+
+        item->prev = list->tail;
+
+        if (list->tail != NULL)
+        {
+            list->tail->next = item;
+        }
+        else
+        {
+            list->head = item;
+        }
+
+        list->tail = item;
+        list->item_num++;
+    }
+
+    spill->read_pos += rec_len;
+    __sync_fetch_and_sub (&spill->rec_cnt, 1);
+
+    free (buf);
+
+    *trans_log_list = list;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_read_failed_label)
+    {
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    if (list != NULL)
+    {
+        for (item = list->head; item != NULL; item = list->head)
+        {
+            list->head = item->next;
+            ctcl_spill_free_item (item);
+        }
+
+        free (list);
+    }
+
+    if (buf != NULL)
+    {
+        free (buf);
+    }
+
+    return result;
+}
+
+
+/*
+ * Description : drop file contents once every record has been read, 
+ *               caller must block the producer
+ *
+ */
+extern void ctcl_spill_truncate (CTCL_SPILL *spill)
+{
+    if (spill->fd >= 0)
+    {
+        (void)ftruncate (spill->fd, 0);
+    }
+
+    spill->write_pos = 0;
+    spill->read_pos = 0;
+    spill->rec_cnt = 0;
+}
+
+
+static int ctcl_spill_column_size (CTCL_COLUMN *col)
+{
+    /* name length, type, value length, is changed, before-image length */
+    return 5 * sizeof (int) + 
+           col->name_len + 
+           (col->val != NULL ? col->val_len : 0) + 
+           (col->old_val != NULL ? col->old_val_len : 0);
+}
+
+
+static int ctcl_spill_item_size (CTCL_ITEM *item)
+{
+    int size;
+    CTCG_LIST_NODE *itr;
+
+    /* stmt type, table name length, table name */
+    size = 2 * sizeof (int) + strlen (item->table_name);
+
+    switch (item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+
+            size += sizeof (int);
+
+            CTCG_LIST_ITERATE (&(item->insert_log_info.set_col_list), itr)
+            {
+                size += ctcl_spill_column_size ((CTCL_COLUMN *)itr->obj);
+            }
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+
+            size += ctcl_spill_column_size (&item->update_log_info.key_col);
+            size += 3 * sizeof (int);
+
+            CTCG_LIST_ITERATE (&(item->update_log_info.set_col_list), itr)
+            {
+                size += ctcl_spill_column_size ((CTCL_COLUMN *)itr->obj);
+            }
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+
+            size += ctcl_spill_column_size (&item->delete_log_info.key_col);
+            break;
+
+        default:
+            break;
+    }
+
+    return size;
+}
+
+
+static char *ctcl_spill_put_int (char *dst, int val)
+{
+    memcpy (dst, &val, sizeof (int));
+
+    return dst + sizeof (int);
+}
+
+
+static char *ctcl_spill_put_bytes (char *dst, const void *src, int len)
+{
+    if (src == NULL)
+    {
+        /* keep the negative length of a column value without value */
+        return ctcl_spill_put_int (dst, len < 0 ? len : CTCL_SPILL_NULL_LEN);
+    }
+
+    dst = ctcl_spill_put_int (dst, len);
+    memcpy (dst, src, len);
+
+    return dst + len;
+}
+
+
+static char *ctcl_spill_put_column (char *dst, CTCL_COLUMN *col)
+{
+    dst = ctcl_spill_put_bytes (dst, col->name, col->name_len);
+    dst = ctcl_spill_put_int (dst, col->type);
+    dst = ctcl_spill_put_bytes (dst, col->val, col->val_len);
+    dst = ctcl_spill_put_int (dst, (int)col->is_changed);
+    dst = ctcl_spill_put_bytes (dst, col->old_val, col->old_val_len);
+
+    return dst;
+}
+
+
+static char *ctcl_spill_put_item (char *dst, CTCL_ITEM *item)
+{
+    CTCG_LIST_NODE *itr;
+
+    dst = ctcl_spill_put_int (dst, item->stmt_type);
+    dst = ctcl_spill_put_bytes (dst, item->table_name, strlen (item->table_name));
+
+    switch (item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+
+            dst = ctcl_spill_put_int (dst, item->insert_log_info.set_col_cnt);
+
+            CTCG_LIST_ITERATE (&(item->insert_log_info.set_col_list), itr)
+            {
+                dst = ctcl_spill_put_column (dst, (CTCL_COLUMN *)itr->obj);
+            }
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+
+            dst = ctcl_spill_put_column (dst, &item->update_log_info.key_col);
+            dst = ctcl_spill_put_int (dst, item->update_log_info.set_col_cnt);
+            dst = ctcl_spill_put_int (dst, item->update_log_info.changed_col_cnt);
+            dst = ctcl_spill_put_int (dst, (int)item->update_log_info.has_before_image);
+
+            CTCG_LIST_ITERATE (&(item->update_log_info.set_col_list), itr)
+            {
+                dst = ctcl_spill_put_column (dst, (CTCL_COLUMN *)itr->obj);
+            }
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+
+            dst = ctcl_spill_put_column (dst, &item->delete_log_info.key_col);
+            break;
+
+        default:
+            break;
+    }
+
+    return dst;
+}
+
+
+static char *ctcl_spill_get_int (char *src, int *val)
+{
+    memcpy (val, src, sizeof (int));
+
+    return src + sizeof (int);
+}
+
+
+/*
+ * Description : *dst points into src, caller copies it if needed
+ *
+ */
+static char *ctcl_spill_get_bytes (char *src, void **dst, int len)
+{
+    if (len < 0)
+    {
+        *dst = NULL;
+        return src;
+    }
+
+    *dst = (void *)src;
+
+    return src + len;
+}
+
+
+/*
+ * Description : decode a set column into a new allocation laid out as
+ *               ctcl_make_column() does, or a key column into key_col
+ *
+ */
+static char *ctcl_spill_get_column (char *src, 
+                                    CTCL_COLUMN **col, 
+                                    CTCL_COLUMN *key_col)
+{
+    int name_len;
+    int type;
+    int val_len;
+    int is_changed;
+    int old_val_len;
+    void *name;
+    void *val;
+    void *old_val;
+    CTCL_COLUMN *new_col;
+
+    src = ctcl_spill_get_int (src, &name_len);
+    src = ctcl_spill_get_bytes (src, &name, name_len);
+    src = ctcl_spill_get_int (src, &type);
+    src = ctcl_spill_get_int (src, &val_len);
+    src = ctcl_spill_get_bytes (src, &val, val_len);
+    src = ctcl_spill_get_int (src, &is_changed);
+    src = ctcl_spill_get_int (src, &old_val_len);
+    src = ctcl_spill_get_bytes (src, &old_val, old_val_len);
+
+    if (key_col != NULL)
+    {
+        new_col = key_col;
+        new_col->val = NULL;
+    }
+    else
+    {
+        new_col = (CTCL_COLUMN *)malloc (sizeof (CTCL_COLUMN) + 
+                                         (val != NULL ? val_len : 0));
+        if (new_col == NULL)
+        {
+            *col = NULL;
+            return src;
+        }
+
+        CTCG_LIST_INIT_OBJ (&new_col->node, new_col);
+        new_col->val = (val != NULL) ? (void *)(new_col + 1) : NULL;
+    }
+
+    memset (new_col->name, 0, CTCL_NAME_MAX);
+    memcpy (new_col->name, name, name_len);
+    new_col->name_len = name_len;
+    new_col->type = type;
+    new_col->val_len = val_len;
+    new_col->is_changed = (BOOL)is_changed;
+    new_col->old_val = NULL;
+    new_col->old_val_len = (old_val != NULL) ? CTCL_COLUMN_NOT_LOGGED : old_val_len;
+
+    if (key_col != NULL && val != NULL)
+    {
+        /* key column value is a separate allocation */
+        new_col->val = malloc (val_len > 0 ? val_len : 1);
+    }
+
+    if (new_col->val != NULL)
+    {
+        memcpy (new_col->val, val, new_col->val_len);
+    }
+
+    if (old_val != NULL)
+    {
+        new_col->old_val = malloc (old_val_len > 0 ? old_val_len : 1);
+
+        if (new_col->old_val != NULL)
+        {
+            memcpy (new_col->old_val, old_val, old_val_len);
+            new_col->old_val_len = old_val_len;
+        }
+    }
+
+    if (col != NULL)
+    {
+        *col = new_col;
+    }
+
+    return src;
+}
+
+
+static char *ctcl_spill_get_item (char *src, CTCL_ITEM **item)
+{
+    int i;
+    int col_cnt;
+    int len;
+    int val;
+    void *table_name;
+    CTCL_ITEM *new_item;
+    CTCL_COLUMN *col;
+    CTCG_LIST *col_list = NULL;
+
+    new_item = (CTCL_ITEM *)malloc (sizeof (CTCL_ITEM));
+
+    if (new_item == NULL)
+    {
+        *item = NULL;
+        return src;
+    }
+
+    memset (new_item, 0, sizeof (CTCL_ITEM));
+    db_make_null (&new_item->key);
+
+    CTCG_LIST_INIT (&(new_item->insert_log_info.set_col_list));
+    CTCG_LIST_INIT (&(new_item->update_log_info.set_col_list));
+
+    src = ctcl_spill_get_int (src, &new_item->stmt_type);
+    src = ctcl_spill_get_int (src, &len);
+    src = ctcl_spill_get_bytes (src, &table_name, len);
+
+    new_item->table_name = (char *)malloc (len + 1);
+
+    if (new_item->table_name == NULL)
+    {
+        ctcl_spill_free_item (new_item);
+        *item = NULL;
+        return src;
+    }
+
+    memcpy (new_item->table_name, table_name, len);
+    new_item->table_name[len] = '\0';
+
+    switch (new_item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+
+            src = ctcl_spill_get_int (src, &col_cnt);
+            col_list = &(new_item->insert_log_info.set_col_list);
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+
+            src = ctcl_spill_get_column (src, NULL, 
+                                         &new_item->update_log_info.key_col);
+            src = ctcl_spill_get_int (src, &col_cnt);
+            src = ctcl_spill_get_int (src, &new_item->update_log_info.changed_col_cnt);
+            src = ctcl_spill_get_int (src, &val);
+            new_item->update_log_info.has_before_image = (BOOL)val;
+            col_list = &(new_item->update_log_info.set_col_list);
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+
+            src = ctcl_spill_get_column (src, NULL, 
+                                         &new_item->delete_log_info.key_col);
+            col_cnt = 0;
+            break;
+
+        default:
+            col_cnt = 0;
+            break;
+    }
+
+    for (i = 0; i < col_cnt; i++)
+    {
+        src = ctcl_spill_get_column (src, &col, NULL);
+
+        if (col == NULL)
+        {
+            ctcl_spill_free_item (new_item);
+            *item = NULL;
+            return src;
+        }
+
+        CTCG_LIST_ADD_LAST (col_list, &col->node);
+
+        if (new_item->stmt_type == CTCL_STMT_TYPE_INSERT)
+        {
+            new_item->insert_log_info.set_col_cnt++;
+        }
+        else
+        {
+            new_item->update_log_info.set_col_cnt++;
+        }
+    }
+
+    *item = new_item;
+
+    return src;
+}
+
+
+static void ctcl_spill_free_column_list (CTCG_LIST *col_list)
+{
+    CTCL_COLUMN *col;
+
+    while (CTCG_LIST_IS_EMPTY (col_list) != CTC_TRUE)
+    {
+        col = (CTCL_COLUMN *)CTCG_LIST_GET_FIRST (col_list)->obj;
+        CTCG_LIST_REMOVE (&col->node);
+
+        if (col->old_val != NULL)
+        {
+            free (col->old_val);
+        }
+
+        free (col);
+    }
+}
+
+
+/*
+ * Description : free an item that failed to decode, decoded items are
+ *               freed with the rest of the list by ctcl
+ *
+ */
+static void ctcl_spill_free_item (CTCL_ITEM *item)
+{
+    ctcl_spill_free_column_list (&(item->insert_log_info.set_col_list));
+    ctcl_spill_free_column_list (&(item->update_log_info.set_col_list));
+
+    if (item->update_log_info.key_col.val != NULL)
+    {
+        free (item->update_log_info.key_col.val);
+    }
+
+    if (item->delete_log_info.key_col.val != NULL)
+    {
+        free (item->delete_log_info.key_col.val);
+    }
+
+    if (item->table_name != NULL)
+    {
+        free (item->table_name);
+    }
+
+    free (item);
+}
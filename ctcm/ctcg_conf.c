@@ -144,6 +144,95 @@ static int conf_item_ctc_long_tran_queue_size_upper = 100000;
 static int conf_item_ctc_long_tran_queue_size_lower = 2000;
 static unsigned int conf_item_ctc_long_tran_queue_size_flag = 0;
 
+/* msec, longest time an idle capture thread blocks without a wakeup */
+int CONF_ITEM_CTC_JOB_MAX_LATENCY = 100;
+static int conf_item_ctc_job_max_latency_default = 100;
+static int conf_item_ctc_job_max_latency_upper = 10000;
+static int conf_item_ctc_job_max_latency_lower = 1;
+static unsigned int conf_item_ctc_job_max_latency_flag = 0;
+
+/* capture threads shared by all jobs, 0 : online cpu count */
+int CONF_ITEM_CTC_CAPTURE_WORKER_COUNT = 0;
+static int conf_item_ctc_capture_worker_count_default = 0;
+static int conf_item_ctc_capture_worker_count_upper = 256;
+static int conf_item_ctc_capture_worker_count_lower = 0;
+static unsigned int conf_item_ctc_capture_worker_count_flag = 0;
+
+/* latest committed transactions kept in memory for reconnecting jobs,
+ * the ring is bounded by both, 0 : no retention */
+int CONF_ITEM_CTC_RETENTION_TRANS_COUNT = 1024;
+static int conf_item_ctc_retention_trans_count_default = 1024;
+static int conf_item_ctc_retention_trans_count_upper = 1000000;
+static int conf_item_ctc_retention_trans_count_lower = 0;
+static unsigned int conf_item_ctc_retention_trans_count_flag = 0;
+
+int CONF_ITEM_CTC_RETENTION_ITEM_COUNT = 65536;
+static int conf_item_ctc_retention_item_count_default = 65536;
+static int conf_item_ctc_retention_item_count_upper = 10000000;
+static int conf_item_ctc_retention_item_count_lower = 0;
+static unsigned int conf_item_ctc_retention_item_count_flag = 0;
+
+/* cpu lists such as "0-3,8", empty : thread is not pinned. the page 
+ * cache is allocated on the analyzer cpus, control session threads 
+ * inherit the listener cpus, capture worker n gets the nth listed cpu */
+const char *CONF_ITEM_CTC_ANALYZER_CPU_LIST = ""; 
+static char *conf_item_ctc_analyzer_cpu_list_default = NULL; 
+static unsigned int conf_item_ctc_analyzer_cpu_list_flag = 0;
+
+const char *CONF_ITEM_CTC_CAPTURE_WORKER_CPU_LIST = ""; 
+static char *conf_item_ctc_capture_worker_cpu_list_default = NULL; 
+static unsigned int conf_item_ctc_capture_worker_cpu_list_flag = 0;
+
+const char *CONF_ITEM_CTC_LISTENER_CPU_LIST = ""; 
+static char *conf_item_ctc_listener_cpu_list_default = NULL; 
+static unsigned int conf_item_ctc_listener_cpu_list_flag = 0;
+
+/* largest frame a client may negotiate at control session creation */
+int CONF_ITEM_CTC_MAX_FRAME_SIZE = 4 * 1024 * 1024;
+static int conf_item_ctc_max_frame_size_default = 4 * 1024 * 1024;
+static int conf_item_ctc_max_frame_size_upper = 16 * 1024 * 1024;
+static int conf_item_ctc_max_frame_size_lower = 4 * 1024;
+static unsigned int conf_item_ctc_max_frame_size_flag = 0;
+
+/* 1 : large captured data frames are sent with MSG_ZEROCOPY */
+int CONF_ITEM_CTC_SEND_ZEROCOPY = 0;
+static int conf_item_ctc_send_zerocopy_default = 0;
+static int conf_item_ctc_send_zerocopy_upper = 1;
+static int conf_item_ctc_send_zerocopy_lower = 0;
+static unsigned int conf_item_ctc_send_zerocopy_flag = 0;
+
+/* threads serving all control sessions, sync upper with CTCN_REACTOR_THREAD_MAX */
+int CONF_ITEM_CTC_REACTOR_THREAD_COUNT = 2;
+static int conf_item_ctc_reactor_thread_count_default = 2;
+static int conf_item_ctc_reactor_thread_count_upper = 16;
+static int conf_item_ctc_reactor_thread_count_lower = 1;
+static unsigned int conf_item_ctc_reactor_thread_count_flag = 0;
+
+/* bytes queued per job link before its job stops serializing */
+int CONF_ITEM_CTC_SEND_QUEUE_SIZE = 16 * 1024 * 1024;
+static int conf_item_ctc_send_queue_size_default = 16 * 1024 * 1024;
+static int conf_item_ctc_send_queue_size_upper = 1024 * 1024 * 1024;
+static int conf_item_ctc_send_queue_size_lower = 1024 * 1024;
+static unsigned int conf_item_ctc_send_queue_size_flag = 0;
+
+/* local consumers connect here too, not listened unless set */
+const char *CONF_ITEM_CTC_UNIX_SOCKET_PATH = ""; 
+static char *conf_item_ctc_unix_socket_path_default = NULL; 
+static unsigned int conf_item_ctc_unix_socket_path_flag = 0;
+
+/* octal file mode of the unix domain socket */
+const char *CONF_ITEM_CTC_UNIX_SOCKET_MODE = ""; 
+static char *conf_item_ctc_unix_socket_mode_default = "0660"; 
+static unsigned int conf_item_ctc_unix_socket_mode_flag = 0;
+
+/* KB of captured transactions a job queue may hold, the rest is 
+ * spilled to the job's segment file */
+int CONF_ITEM_CTC_JOB_QUEUE_MEM_QUOTA = 65536;
+static int conf_item_ctc_job_queue_mem_quota_default = 65536;
+static int conf_item_ctc_job_queue_mem_quota_upper = 4194304;
+static int conf_item_ctc_job_queue_mem_quota_lower = 1024;
+static unsigned int conf_item_ctc_job_queue_mem_quota_flag = 0;
+
 
 CTCG_CONF_ITEM conf_item_Def[] = {
     {CONF_NAME_CTC_TRAN_LOG_FILE_PATH,
@@ -211,6 +300,160 @@ CTCG_CONF_ITEM conf_item_Def[] = {
         (void *) &conf_item_ctc_long_tran_queue_size_lower,
         (char *) NULL,
         (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_JOB_MAX_LATENCY,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_job_max_latency_flag,
+        (void *) &conf_item_ctc_job_max_latency_default,
+        (void *) &CONF_ITEM_CTC_JOB_MAX_LATENCY,
+        (void *) &conf_item_ctc_job_max_latency_upper, 
+        (void *) &conf_item_ctc_job_max_latency_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_CAPTURE_WORKER_COUNT,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_capture_worker_count_flag,
+        (void *) &conf_item_ctc_capture_worker_count_default,
+        (void *) &CONF_ITEM_CTC_CAPTURE_WORKER_COUNT,
+        (void *) &conf_item_ctc_capture_worker_count_upper, 
+        (void *) &conf_item_ctc_capture_worker_count_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_RETENTION_TRANS_COUNT,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_retention_trans_count_flag,
+        (void *) &conf_item_ctc_retention_trans_count_default,
+        (void *) &CONF_ITEM_CTC_RETENTION_TRANS_COUNT,
+        (void *) &conf_item_ctc_retention_trans_count_upper, 
+        (void *) &conf_item_ctc_retention_trans_count_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_RETENTION_ITEM_COUNT,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_retention_item_count_flag,
+        (void *) &conf_item_ctc_retention_item_count_default,
+        (void *) &CONF_ITEM_CTC_RETENTION_ITEM_COUNT,
+        (void *) &conf_item_ctc_retention_item_count_upper, 
+        (void *) &conf_item_ctc_retention_item_count_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_ANALYZER_CPU_LIST,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_STRING,
+        (void *) &conf_item_ctc_analyzer_cpu_list_flag,
+        (void *) &conf_item_ctc_analyzer_cpu_list_default,
+        (void *) &CONF_ITEM_CTC_ANALYZER_CPU_LIST,
+        (void *) NULL, 
+        (void *) NULL,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_CAPTURE_WORKER_CPU_LIST,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_STRING,
+        (void *) &conf_item_ctc_capture_worker_cpu_list_flag,
+        (void *) &conf_item_ctc_capture_worker_cpu_list_default,
+        (void *) &CONF_ITEM_CTC_CAPTURE_WORKER_CPU_LIST,
+        (void *) NULL, 
+        (void *) NULL,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_LISTENER_CPU_LIST,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_STRING,
+        (void *) &conf_item_ctc_listener_cpu_list_flag,
+        (void *) &conf_item_ctc_listener_cpu_list_default,
+        (void *) &CONF_ITEM_CTC_LISTENER_CPU_LIST,
+        (void *) NULL, 
+        (void *) NULL,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_MAX_FRAME_SIZE,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_max_frame_size_flag,
+        (void *) &conf_item_ctc_max_frame_size_default,
+        (void *) &CONF_ITEM_CTC_MAX_FRAME_SIZE,
+        (void *) &conf_item_ctc_max_frame_size_upper, 
+        (void *) &conf_item_ctc_max_frame_size_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_SEND_ZEROCOPY,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_send_zerocopy_flag,
+        (void *) &conf_item_ctc_send_zerocopy_default,
+        (void *) &CONF_ITEM_CTC_SEND_ZEROCOPY,
+        (void *) &conf_item_ctc_send_zerocopy_upper, 
+        (void *) &conf_item_ctc_send_zerocopy_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_REACTOR_THREAD_COUNT,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_reactor_thread_count_flag,
+        (void *) &conf_item_ctc_reactor_thread_count_default,
+        (void *) &CONF_ITEM_CTC_REACTOR_THREAD_COUNT,
+        (void *) &conf_item_ctc_reactor_thread_count_upper, 
+        (void *) &conf_item_ctc_reactor_thread_count_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_SEND_QUEUE_SIZE,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_send_queue_size_flag,
+        (void *) &conf_item_ctc_send_queue_size_default,
+        (void *) &CONF_ITEM_CTC_SEND_QUEUE_SIZE,
+        (void *) &conf_item_ctc_send_queue_size_upper, 
+        (void *) &conf_item_ctc_send_queue_size_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_UNIX_SOCKET_PATH,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_STRING,
+        (void *) &conf_item_ctc_unix_socket_path_flag,
+        (void *) &conf_item_ctc_unix_socket_path_default,
+        (void *) &CONF_ITEM_CTC_UNIX_SOCKET_PATH,
+        (void *) NULL, 
+        (void *) NULL,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_UNIX_SOCKET_MODE,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_STRING,
+        (void *) &conf_item_ctc_unix_socket_mode_flag,
+        (void *) &conf_item_ctc_unix_socket_mode_default,
+        (void *) &CONF_ITEM_CTC_UNIX_SOCKET_MODE,
+        (void *) NULL, 
+        (void *) NULL,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL},
+    {CONF_NAME_CTC_JOB_QUEUE_MEM_QUOTA,
+        CTCG_CONF_FOR_SERVER,
+        CTCG_CONF_INTEGER,
+        (void *) &conf_item_ctc_job_queue_mem_quota_flag,
+        (void *) &conf_item_ctc_job_queue_mem_quota_default,
+        (void *) &CONF_ITEM_CTC_JOB_QUEUE_MEM_QUOTA,
+        (void *) &conf_item_ctc_job_queue_mem_quota_upper, 
+        (void *) &conf_item_ctc_job_queue_mem_quota_lower,
+        (char *) NULL,
+        (CTCG_CONF_DUP_FUNC) NULL,
         (CTCG_CONF_DUP_FUNC) NULL}
 };
 
@@ -1434,6 +1677,11 @@ extern int ctcg_conf_get_item_value (CTCG_CONF_ID id,
     {
         case CTCG_CONF_ID_CTC_TRAN_LOG_FILE_PATH:
         case CTCG_CONF_ID_CTC_LONG_TRAN_FILE_PATH:
+        case CTCG_CONF_ID_CTC_ANALYZER_CPU_LIST:
+        case CTCG_CONF_ID_CTC_CAPTURE_WORKER_CPU_LIST:
+        case CTCG_CONF_ID_CTC_LISTENER_CPU_LIST:
+        case CTCG_CONF_ID_CTC_UNIX_SOCKET_PATH:
+        case CTCG_CONF_ID_CTC_UNIX_SOCKET_MODE:
 
             CTC_COND_EXCEPTION (value_type != CTCG_CONF_ITEM_VAL_SET_STR && 
                                 value_type != CTCG_CONF_ITEM_VAL_STR,
@@ -1470,6 +1718,15 @@ extern int ctcg_conf_get_item_value (CTCG_CONF_ID id,
         case CTCG_CONF_ID_CTC_SESSION_GROUP_MAX:
         case CTCG_CONF_ID_CTC_JOB_QUEUE_SIZE:
         case CTCG_CONF_ID_CTC_LONG_TRAN_QUEUE_SIZE:
+        case CTCG_CONF_ID_CTC_JOB_MAX_LATENCY:
+        case CTCG_CONF_ID_CTC_CAPTURE_WORKER_COUNT:
+        case CTCG_CONF_ID_CTC_RETENTION_TRANS_COUNT:
+        case CTCG_CONF_ID_CTC_RETENTION_ITEM_COUNT:
+        case CTCG_CONF_ID_CTC_MAX_FRAME_SIZE:
+        case CTCG_CONF_ID_CTC_SEND_ZEROCOPY:
+        case CTCG_CONF_ID_CTC_REACTOR_THREAD_COUNT:
+        case CTCG_CONF_ID_CTC_SEND_QUEUE_SIZE:
+        case CTCG_CONF_ID_CTC_JOB_QUEUE_MEM_QUOTA:
 
             CTC_COND_EXCEPTION (value_type == CTCG_CONF_ITEM_VAL_SET_STR || 
                                 value_type == CTCG_CONF_ITEM_VAL_STR,
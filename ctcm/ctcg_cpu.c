@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_cpu.c : ctc general(cpu affinity) implementation
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "ctcg_cpu.h"
+#include "ctc_common.h"
+#include "ctc_types.h"
+
+
+static int ctcg_cpu_read_id (const char **str, int *id);
+static void ctcg_cpu_make_sched_set (CTCG_CPU_SET *cpu_set,
+                                     int nth,
+                                     cpu_set_t *sched_set);
+
+
+/*
+ * Description : cpu_list is a comma separated list of cpu ids and
+ *               ranges, NULL or empty gives an empty set
+ *
+ */
+extern int ctcg_cpu_set_parse (const char *cpu_list, CTCG_CPU_SET *cpu_set)
+{
+    int result;
+    int first;
+    int last;
+    const char *p = cpu_list;
+
+    cpu_set->cnt = 0;
+
+    if (p == NULL)
+    {
+        return CTC_SUCCESS;
+    }
+
+    while (isspace ((unsigned char)*p))
+    {
+        p++;
+    }
+
+    while (*p != '\0')
+    {
+        CTC_TEST_EXCEPTION (ctcg_cpu_read_id (&p, &first),
+                            err_invalid_list_label);
+
+        last = first;
+
+        if (*p == '-')
+        {
+            p++;
+
+            CTC_TEST_EXCEPTION (ctcg_cpu_read_id (&p, &last),
+                                err_invalid_list_label);
+            CTC_COND_EXCEPTION (last < first, err_invalid_list_label);
+        }
+
+        for (; first <= last; first++)
+        {
+            CTC_COND_EXCEPTION (cpu_set->cnt >= CTCG_CPU_MAX,
+                                err_invalid_list_label);
+
+            cpu_set->cpu[cpu_set->cnt++] = (short)first;
+        }
+
+        while (isspace ((unsigned char)*p))
+        {
+            p++;
+        }
+
+        if (*p == ',')
+        {
+            p++;
+
+            while (isspace ((unsigned char)*p))
+            {
+                p++;
+            }
+
+            CTC_COND_EXCEPTION (*p == '\0', err_invalid_list_label);
+        }
+        else
+        {
+            CTC_COND_EXCEPTION (*p != '\0', err_invalid_list_label);
+        }
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_list_label)
+    {
+        cpu_set->cnt = 0;
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+static int ctcg_cpu_read_id (const char **str, int *id)
+{
+    long val;
+    char *end;
+
+    if (!isdigit ((unsigned char)**str))
+    {
+        return CTC_FAILURE;
+    }
+
+    val = strtol (*str, &end, 10);
+
+    if (val < 0 || val >= CTCG_CPU_MAX)
+    {
+        return CTC_FAILURE;
+    }
+
+    *id = (int)val;
+    *str = end;
+
+    return CTC_SUCCESS;
+}
+
+
+static void ctcg_cpu_make_sched_set (CTCG_CPU_SET *cpu_set,
+                                     int nth,
+                                     cpu_set_t *sched_set)
+{
+    int i;
+
+    CPU_ZERO (sched_set);
+
+    if (nth == CTCG_CPU_ALL)
+    {
+        for (i = 0; i < cpu_set->cnt; i++)
+        {
+            CPU_SET (cpu_set->cpu[i], sched_set);
+        }
+    }
+    else
+    {
+        CPU_SET (cpu_set->cpu[nth % cpu_set->cnt], sched_set);
+    }
+}
+
+
+/*
+ * Description : threads created with attr start on the cpus, so
+ *               everything they allocate is local. no-op on an empty set.
+ *
+ */
+extern int ctcg_cpu_bind_attr (pthread_attr_t *attr,
+                               CTCG_CPU_SET *cpu_set,
+                               int nth)
+{
+    cpu_set_t sched_set;
+
+    if (cpu_set->cnt == 0)
+    {
+        return CTC_SUCCESS;
+    }
+
+    ctcg_cpu_make_sched_set (cpu_set, nth, &sched_set);
+
+    if (pthread_attr_setaffinity_np (attr, sizeof (cpu_set_t), &sched_set) != 0)
+    {
+        return CTC_ERR_INVALID_VALUE_FAILED;
+    }
+
+    return CTC_SUCCESS;
+}
+
+
+extern int ctcg_cpu_bind_thread (pthread_t thr,
+                                 CTCG_CPU_SET *cpu_set,
+                                 int nth)
+{
+    cpu_set_t sched_set;
+
+    if (cpu_set->cnt == 0)
+    {
+        return CTC_SUCCESS;
+    }
+
+    ctcg_cpu_make_sched_set (cpu_set, nth, &sched_set);
+
+    /* fails when none of the cpus is online */
+    if (pthread_setaffinity_np (thr, sizeof (cpu_set_t), &sched_set) != 0)
+    {
+        return CTC_ERR_INVALID_VALUE_FAILED;
+    }
+
+    return CTC_SUCCESS;
+}
+
+
+/*
+ * Description : current cpus of thr, to be restored by
+ *               ctcg_cpu_bind_thread (thr, cpu_set, CTCG_CPU_ALL)
+ *
+ */
+extern int ctcg_cpu_get_thread (pthread_t thr, CTCG_CPU_SET *cpu_set)
+{
+    int i;
+    cpu_set_t sched_set;
+
+    cpu_set->cnt = 0;
+
+    if (pthread_getaffinity_np (thr, sizeof (cpu_set_t), &sched_set) != 0)
+    {
+        return CTC_FAILURE;
+    }
+
+    for (i = 0; i < CTCG_CPU_MAX && i < CPU_SETSIZE; i++)
+    {
+        if (CPU_ISSET (i, &sched_set))
+        {
+            cpu_set->cpu[cpu_set->cnt++] = (short)i;
+        }
+    }
+
+    return CTC_SUCCESS;
+}
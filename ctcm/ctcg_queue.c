@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_queue.c : ctc general(bounded spsc queue) implementation
+ *
+ */
+
+#include <stdlib.h>
+
+#include "ctcg_queue.h"
+#include "ctc_common.h"
+#include "ctc_types.h"
+
+
+extern int ctcg_spsc_queue_init (CTCG_SPSC_QUEUE *queue, int size)
+{
+    int result;
+
+    queue->head = 0;
+    queue->tail = 0;
+    queue->high_water = 0;
+    queue->size = size;
+
+    queue->slot = (void **)malloc (sizeof (void *) * size);
+    CTC_COND_EXCEPTION (queue->slot == NULL, err_alloc_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        queue->size = 0;
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+extern void ctcg_spsc_queue_final (CTCG_SPSC_QUEUE *queue)
+{
+    if (queue->slot != NULL)
+    {
+        free (queue->slot);
+        queue->slot = NULL;
+    }
+
+    queue->size = 0;
+}
+
+
+/*
+ * Description : returns CTC_FALSE when the queue is full
+ *
+ */
+extern BOOL ctcg_spsc_queue_enq (CTCG_SPSC_QUEUE *queue, void *item)
+{
+    int used;
+    UINT_64 head = queue->head;
+
+    used = (int)(head - __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE));
+
+    if (used >= queue->size)
+    {
+        return CTC_FALSE;
+    }
+
+    queue->slot[head % queue->size] = item;
+
+    if (used + 1 > queue->high_water)
+    {
+        __atomic_store_n (&queue->high_water, used + 1, __ATOMIC_RELAXED);
+    }
+
+    /* make slot visible before the new head */
+    __atomic_store_n (&queue->head, head + 1, __ATOMIC_SEQ_CST);
+
+    return CTC_TRUE;
+}
+
+
+/*
+ * Description : returns idx-th item from the oldest one without 
+ *               dequeuing it, NULL if there are not enough items
+ *
+ */
+extern void *ctcg_spsc_queue_peek (CTCG_SPSC_QUEUE *queue, int idx)
+{
+    UINT_64 pos = queue->tail + idx;
+
+    if (pos >= __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE))
+    {
+        return NULL;
+    }
+
+    return queue->slot[pos % queue->size];
+}
+
+
+/*
+ * Description : called by producer, the returned item may be dequeued 
+ *               concurrently but its slot is not reused until the 
+ *               producer enqueues again
+ *
+ */
+extern void *ctcg_spsc_queue_peek_oldest (CTCG_SPSC_QUEUE *queue)
+{
+    UINT_64 tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
+
+    if (tail >= queue->head)
+    {
+        return NULL;
+    }
+
+    return queue->slot[tail % queue->size];
+}
+
+
+extern void ctcg_spsc_queue_deq (CTCG_SPSC_QUEUE *queue, int cnt)
+{
+    /* release slots to producer */
+    __atomic_store_n (&queue->tail, queue->tail + cnt, __ATOMIC_SEQ_CST);
+}
+
+
+extern int ctcg_spsc_queue_get_used (CTCG_SPSC_QUEUE *queue)
+{
+    UINT_64 tail = __atomic_load_n (&queue->tail, __ATOMIC_ACQUIRE);
+    UINT_64 head = __atomic_load_n (&queue->head, __ATOMIC_ACQUIRE);
+
+    return (head > tail) ? (int)(head - tail) : 0;
+}
+
+
+extern int ctcg_spsc_queue_get_high_water (CTCG_SPSC_QUEUE *queue)
+{
+    return __atomic_load_n (&queue->high_water, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_trace.c : ctc general(binary trace ring) implementation
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "ctcg_trace.h"
+#include "ctc_common.h"
+#include "ctc_types.h"
+
+
+static CTCG_TRACE_RING *ctcg_trace_get_ring (void);
+static int ctcg_trace_write_ring (FILE *fp,
+                                  CTCG_TRACE_RING *ring,
+                                  UINT_32 ring_no);
+
+
+/* rings registered by each tracing thread, never freed until exit */
+static CTCG_TRACE_RING *ctcg_trace_Rings[CTCG_TRACE_MAX_RING];
+static UINT_32 ctcg_trace_Ring_cnt = 0;
+
+static __thread CTCG_TRACE_RING *ctcg_trace_My_ring = NULL;
+static __thread BOOL ctcg_trace_Is_disabled = CTC_FALSE;
+
+static const char *ctcg_trace_Level_str[] =
+{
+    "OFF", "ERROR", "INFO", "DEBUG"
+};
+
+/* decoder format per event, every argument is printed as signed long */
+static const char *ctcg_trace_Event_fmt[CTCG_TRACE_EV_LAST] =
+{
+    /* CTCG_TRACE_EV_NONE */
+    "none",
+    /* CTCG_TRACE_EV_SERVER_START */
+    "server start: pid = %ld",
+    /* CTCG_TRACE_EV_CONF_ITEM_INT */
+    "configuration item no[%ld]: value = %ld",
+    /* CTCG_TRACE_EV_CONF_ITEM_STR */
+    "configuration item no[%ld]: value length = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_THR_STARTED */
+    "log analyzer thread started: thread id = %ld",
+    /* CTCG_TRACE_EV_MAKE_LISTEN_LINK_FAILED */
+    "make listen link failed: result = %ld",
+    /* CTCG_TRACE_EV_LISTEN_FAILED */
+    "listen failed: port = %ld",
+    /* CTCG_TRACE_EV_PROTOCOL_VERSION */
+    "ctc protocol version %ld.%ld.%ld.%ld",
+    /* CTCG_TRACE_EV_LOG_HDR */
+    "log header: eof_lsa.pageid = %ld, append_lsa.pageid = %ld",
+    /* CTCG_TRACE_EV_DB_LOGIN_FAILED */
+    "db login failed: error = %ld",
+    /* CTCG_TRACE_EV_DB_RESTART_FAILED */
+    "db restart failed: error = %ld",
+    /* CTCG_TRACE_EV_REQUIRED_LSA_NULL */
+    "required_lsa cannot be NULL",
+    /* CTCG_TRACE_EV_MGR_NOT_READY */
+    "log manager not ready: status = %ld",
+    /* CTCG_TRACE_EV_UNKNOWN_DATA_RCVINDEX */
+    "DATA another stmt type entered: rcvindex = %ld",
+    /* CTCG_TRACE_EV_UNKNOWN_SCHEMA_RCVINDEX */
+    "SCHEMA another stmt type entered: rcvindex = %ld",
+    /* CTCG_TRACE_EV_ITEM_MADE */
+    "item: log_type = %ld, stmt_type = %ld, lsa = (%ld|%ld)",
+    /* CTCG_TRACE_EV_INVALID_RECTYPE */
+    "invalid record type: stmt_type = %ld, rectype = %ld",
+    /* CTCG_TRACE_EV_INVALID_RCVINDEX */
+    "invalid rcvindex: stmt_type = %ld, rcvindex = %ld",
+    /* CTCG_TRACE_EV_KEY_COLUMN */
+    "key column: stmt_type = %ld, type = %ld, val_len = %ld, int val = %ld",
+    /* CTCG_TRACE_EV_SET_COLUMN */
+    "set column: stmt_type = %ld, type = %ld, val_len = %ld, int val = %ld",
+    /* CTCG_TRACE_EV_DELETE_LOG_FAILED */
+    "process delete log failed: reason = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_THR_CREATE_FAILED */
+    "log analyzer pthread_create failed: result = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_FINAL_LSA */
+    "analyzer start: final_lsa.pageid = %ld, append_lsa.pageid = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_IN_LOOP */
+    "analyzer loop: final_lsa.pageid = %ld, eof_lsa.pageid = %ld, "
+    "append_lsa.pageid = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_NEGATIVE_PAGE_OFFSET */
+    "page with negative offset: pageid = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_PAGE_READ */
+    "valid page read: count = %ld, pageid = %ld",
+    /* CTCG_TRACE_EV_ANALYZER_PASS_APPEND_LSA */
+    "final_lsa passed append_lsa: final_lsa = (%ld|%ld)",
+    /* CTCG_TRACE_EV_ANALYZER_RECORD */
+    "record: type = %ld, tid = %ld, lsa = (%ld|%ld)",
+    /* CTCG_TRACE_EV_ANALYZER_END_OF_PAGE */
+    "end of readable log: final_lsa = (%ld|%ld)"
+};
+
+
+/*
+ * Description: get (or register at first call) ring of calling thread
+ *
+ *  only the owner thread writes its ring, so registration is the only
+ *  shared step and it is done with one atomic increment.
+ */
+static CTCG_TRACE_RING *ctcg_trace_get_ring (void)
+{
+    UINT_32 ring_no;
+    CTCG_TRACE_RING *ring = NULL;
+
+    if (ctcg_trace_My_ring != NULL || ctcg_trace_Is_disabled == CTC_TRUE)
+    {
+        return ctcg_trace_My_ring;
+    }
+
+    ring = (CTCG_TRACE_RING *)malloc (sizeof (CTCG_TRACE_RING));
+    CTC_COND_EXCEPTION (ring == NULL, err_alloc_failed_label);
+
+    ring_no = __sync_fetch_and_add (&ctcg_trace_Ring_cnt, 1);
+    CTC_COND_EXCEPTION (ring_no >= CTCG_TRACE_MAX_RING,
+                        err_too_many_ring_label);
+
+    memset (ring, 0, sizeof (CTCG_TRACE_RING));
+    ring->thread_id = (UINT_64)pthread_self ();
+
+    __atomic_store_n (&ctcg_trace_Rings[ring_no], ring, __ATOMIC_RELEASE);
+
+    ctcg_trace_My_ring = ring;
+
+    return ring;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        ctcg_trace_Is_disabled = CTC_TRUE;
+    }
+    CTC_EXCEPTION (err_too_many_ring_label)
+    {
+        free (ring);
+        ctcg_trace_Is_disabled = CTC_TRUE;
+    }
+    EXCEPTION_END;
+
+    return NULL;
+}
+
+
+extern void ctcg_trace_write (unsigned short level,
+                              unsigned short event,
+                              SINT_64 a0,
+                              SINT_64 a1,
+                              SINT_64 a2,
+                              SINT_64 a3)
+{
+    UINT_64 head;
+    struct timespec ts;
+    CTCG_TRACE_REC *rec;
+    CTCG_TRACE_RING *ring = ctcg_trace_get_ring ();
+
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    head = ring->head;
+    rec = &ring->rec[head & CTCG_TRACE_RING_MASK];
+
+    rec->ts = (UINT_64)ts.tv_sec * 1000000000UL + (UINT_64)ts.tv_nsec;
+    rec->event = event;
+    rec->level = level;
+    rec->arg[0] = a0;
+    rec->arg[1] = a1;
+    rec->arg[2] = a2;
+    rec->arg[3] = a3;
+
+    /* publish record to dumper */
+    __atomic_store_n (&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+
+static int ctcg_trace_write_ring (FILE *fp,
+                                  CTCG_TRACE_RING *ring,
+                                  UINT_32 ring_no)
+{
+    UINT_64 i;
+    UINT_64 start;
+    CTCG_TRACE_DUMP_RING_HDR ring_hdr;
+
+    ring_hdr.thread_id = ring->thread_id;
+    ring_hdr.head = __atomic_load_n (&ring->head, __ATOMIC_ACQUIRE);
+    ring_hdr.ring_no = ring_no;
+
+    if (ring_hdr.head > CTCG_TRACE_RING_SIZE)
+    {
+        start = ring_hdr.head - CTCG_TRACE_RING_SIZE;
+    }
+    else
+    {
+        start = 0;
+    }
+
+    ring_hdr.rec_cnt = (UINT_32)(ring_hdr.head - start);
+
+    CTC_COND_EXCEPTION (fwrite (&ring_hdr, sizeof (ring_hdr), 1, fp) != 1,
+                        err_write_failed_label);
+
+    /* a thread still tracing may overwrite the oldest slots while
+     * dumping, those records are simply decoded as they are */
+    for (i = start; i < ring_hdr.head; i++)
+    {
+        CTC_COND_EXCEPTION (fwrite (&ring->rec[i & CTCG_TRACE_RING_MASK],
+                                    sizeof (CTCG_TRACE_REC), 1, fp) != 1,
+                            err_write_failed_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_failed_label)
+    {
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description: write every registered ring into the dump file
+ *
+ *  nothing is written when no thread has traced (e.g. CTCG_TRACE_LEVEL
+ *  is off in this build).
+ */
+extern int ctcg_trace_dump (const char *path)
+{
+    UINT_32 i;
+    UINT_32 ring_cnt;
+    FILE *fp = NULL;
+    CTCG_TRACE_RING *ring;
+    CTCG_TRACE_DUMP_HDR hdr;
+
+    ring_cnt = __atomic_load_n (&ctcg_trace_Ring_cnt, __ATOMIC_ACQUIRE);
+
+    if (ring_cnt == 0)
+    {
+        return CTC_SUCCESS;
+    }
+
+    if (ring_cnt > CTCG_TRACE_MAX_RING)
+    {
+        ring_cnt = CTCG_TRACE_MAX_RING;
+    }
+
+    fp = fopen (path, "wb");
+    CTC_COND_EXCEPTION (fp == NULL, err_open_failed_label);
+
+    hdr.magic = CTCG_TRACE_DUMP_MAGIC;
+    hdr.version = CTCG_TRACE_DUMP_VERSION;
+    hdr.ring_cnt = 0;
+    hdr.rec_size = sizeof (CTCG_TRACE_REC);
+
+    for (i = 0; i < ring_cnt; i++)
+    {
+        if (__atomic_load_n (&ctcg_trace_Rings[i], __ATOMIC_ACQUIRE) != NULL)
+        {
+            hdr.ring_cnt++;
+        }
+    }
+
+    CTC_COND_EXCEPTION (fwrite (&hdr, sizeof (hdr), 1, fp) != 1,
+                        err_write_failed_label);
+
+    for (i = 0; i < ring_cnt; i++)
+    {
+        ring = __atomic_load_n (&ctcg_trace_Rings[i], __ATOMIC_ACQUIRE);
+
+        if (ring != NULL)
+        {
+            CTC_TEST_EXCEPTION (ctcg_trace_write_ring (fp, ring, i),
+                                err_write_failed_label);
+        }
+    }
+
+    fclose (fp);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_open_failed_label)
+    {
+    }
+    CTC_EXCEPTION (err_write_failed_label)
+    {
+        fclose (fp);
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description: decode dump file into text, one line per record
+ *
+ *  records are printed ring by ring, each ring in written order.
+ *  line format: <ring_no> <thread_id> <sec.nsec> <level> <message>
+ */
+extern int ctcg_trace_decode (const char *path, FILE *out)
+{
+    UINT_32 i;
+    UINT_32 j;
+    FILE *fp = NULL;
+    CTCG_TRACE_DUMP_HDR hdr;
+    CTCG_TRACE_DUMP_RING_HDR ring_hdr;
+    CTCG_TRACE_REC rec;
+
+    fp = fopen (path, "rb");
+    CTC_COND_EXCEPTION (fp == NULL, err_open_failed_label);
+
+    CTC_COND_EXCEPTION (fread (&hdr, sizeof (hdr), 1, fp) != 1,
+                        err_read_failed_label);
+
+    CTC_COND_EXCEPTION (hdr.magic != CTCG_TRACE_DUMP_MAGIC ||
+                        hdr.version != CTCG_TRACE_DUMP_VERSION ||
+                        hdr.rec_size != sizeof (CTCG_TRACE_REC),
+                        err_invalid_dump_label);
+
+    for (i = 0; i < hdr.ring_cnt; i++)
+    {
+        CTC_COND_EXCEPTION (fread (&ring_hdr, sizeof (ring_hdr), 1, fp) != 1,
+                            err_read_failed_label);
+
+        fprintf (out, "# ring %u: thread %lu, %lu records written, %u kept\n",
+                 ring_hdr.ring_no,
+                 ring_hdr.thread_id,
+                 ring_hdr.head,
+                 ring_hdr.rec_cnt);
+
+        for (j = 0; j < ring_hdr.rec_cnt; j++)
+        {
+            CTC_COND_EXCEPTION (fread (&rec, sizeof (rec), 1, fp) != 1,
+                                err_read_failed_label);
+
+            fprintf (out, "%u %lu %lu.%09lu %s ",
+                     ring_hdr.ring_no,
+                     ring_hdr.thread_id,
+                     rec.ts / 1000000000UL,
+                     rec.ts % 1000000000UL,
+                     rec.level <= CTCG_TRACE_LEVEL_DEBUG ?
+                     ctcg_trace_Level_str[rec.level] : "?");
+
+            if (rec.event < CTCG_TRACE_EV_LAST)
+            {
+                fprintf (out,
+                         ctcg_trace_Event_fmt[rec.event],
+                         rec.arg[0], rec.arg[1], rec.arg[2], rec.arg[3]);
+            }
+            else
+            {
+                fprintf (out, "unknown event %u: %ld %ld %ld %ld",
+                         rec.event,
+                         rec.arg[0], rec.arg[1], rec.arg[2], rec.arg[3]);
+            }
+
+            fputc ('\n', out);
+        }
+    }
+
+    fclose (fp);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_open_failed_label)
+    {
+    }
+    CTC_EXCEPTION (err_read_failed_label)
+    {
+        fclose (fp);
+    }
+    CTC_EXCEPTION (err_invalid_dump_label)
+    {
+        fclose (fp);
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
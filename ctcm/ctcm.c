@@ -29,11 +29,15 @@
 #include <string.h>
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
 
 #include "ctcp.h"
 #include "ctcg_conf.h"
 #include "ctcg_list.h"
+#include "ctcg_cpu.h"
+#include "ctcg_trace.h"
 #include "ctcn_link.h"
+#include "ctcn_reactor.h"
 #include "ctcs.h"
 #include "ctcm.h"
 #include "ctcj.h"
@@ -42,6 +46,29 @@
 #include "ctc_types.h"
 
 
+#define CTC_HANDSHAKE_TIMEOUT_MSEC      (3000)  /* accept to first frame */
+#define CTC_LISTEN_SWEEP_MSEC           (100)
+
+
+/* accepted link waiting for its first frame on reactor */
+typedef struct ctc_handshake CTC_HANDSHAKE;
+struct ctc_handshake
+{
+    CTCN_LINK *link;
+    UINT_64 accept_msec;
+    BOOL is_expired;                    /* link is shut down */
+    CTCG_LIST_NODE node;
+};
+
+typedef struct ctc_handshake_list CTC_HANDSHAKE_LIST;
+struct ctc_handshake_list
+{
+    pthread_mutex_t lock;
+    int cnt;
+    CTCG_LIST list;
+};
+
+
 static CTC_SIG_HANDLER_FUNC ctc_register_sig_handler (int signal,
                                                       CTC_SIG_HANDLER_FUNC func);
 
@@ -54,12 +81,24 @@ static int ctc_start_listen (unsigned short ctc_port);
 
 static int ctc_make_link (CTCN_LINK **link);
 static int ctc_listen (CTCN_LINK *link, unsigned short ctc_port);
-static int ctc_accept_and_read_protocol (CTCN_LINK *link, void *header);
+static int ctc_listen_unix (CTCN_LINK **link);
+static void ctc_close_listen_unix (CTCN_LINK *link);
+static void ctc_close_link (CTCN_LINK *link);
+
+static void ctc_on_accept (CTCN_LINK *link, void *arg);
+static int ctc_on_handshake_frame (CTCN_LINK *link, void *arg);
+static void ctc_on_handshake_close (CTCN_LINK *link, void *arg);
+static BOOL ctc_handshake_take (CTC_HANDSHAKE *handshake);
+static void ctc_sweep_handshakes (void);
+static UINT_64 ctc_get_mono_msec (void);
 
 static void ctc_stop_listen (void);
 static void ctc_finalize (void);
+static void ctc_dump_trace (void);
+
 
 
+static CTC_HANDSHAKE_LIST ctc_Handshakes = { PTHREAD_MUTEX_INITIALIZER };
 
 BOOL is_stop_listen;
 CTC_SERV_STATUS server_Status;
@@ -112,8 +151,10 @@ int main (int argc, char **argv)
     int result;
     int stage = 0;
     int thr_ret;
+    int reactor_thread_cnt;
     unsigned short ctc_port;
     char *log_path;
+    char *spill_path;
     char *env_root;
     char ctc_root_name[] = "CUBRID";
     char log_file_path[CTCG_PATH_MAX];
@@ -121,11 +162,12 @@ int main (int argc, char **argv)
     pthread_t la_thr_id;
 
     CTCL_CONF_ITEMS ctcl_conf_items;
+    CTCG_CPU_SET listener_cpu_set;
 
     is_stop_listen = CTC_FALSE;
     server_Status = CTC_SERV_STATUS_NOT_READY;
 
-    printf ("\n[ctc main function]\n database name : %s\n", argv[1]);
+    CTCG_TRACE_INFO (CTCG_TRACE_EV_SERVER_START, getpid (), 0, 0, 0);
 
     memset (ctc_source_db_name, 0, CTC_NAME_LEN);
     strncpy (ctc_source_db_name, argv[1], strlen (argv[1]));
@@ -191,14 +233,54 @@ int main (int argc, char **argv)
 
     strncpy (ctcl_conf_items.log_path, log_file_path, strlen(log_file_path));
 
-    /* TEST */
-    printf("ctcl_conf_items.log_path = %s\n", ctcl_conf_items.log_path);
+    CTCG_TRACE_INFO (CTCG_TRACE_EV_CONF_ITEM_STR,
+                     CTCG_CONF_ID_CTC_TRAN_LOG_FILE_PATH,
+                     strlen (ctcl_conf_items.log_path), 
+                     0, 0);
+
+    /* spilled transactions of slow jobs go to long tran file path */
+    spill_path = CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_LONG_TRAN_FILE_PATH].value);
+
+    if (spill_path == NULL || spill_path[0] != '/')
+    {
+        spill_path = P_tmpdir;
+    }
+
+    strncpy (ctcl_conf_items.spill_path, 
+             spill_path, 
+             sizeof (ctcl_conf_items.spill_path) - 1);
+
+    /* retention ring for jobs resuming after reconnect */
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_RETENTION_TRANS_COUNT, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&ctcl_conf_items.retention_trans_cnt);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_item_label);
+
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_RETENTION_ITEM_COUNT, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&ctcl_conf_items.retention_item_cnt);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_item_label);
+
+    /* beyond this a job queue spills to the segment file */
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_JOB_QUEUE_MEM_QUOTA, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&ctcl_conf_items.job_mem_quota_kb);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_item_label);
+
+    /* thread placement */
+    result = ctcg_cpu_set_parse (CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_ANALYZER_CPU_LIST].value),
+                                 &ctcl_conf_items.analyzer_cpu_set);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_cpu_list_label);
+
+    result = ctcg_cpu_set_parse (CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_LISTENER_CPU_LIST].value),
+                                 &listener_cpu_set);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_cpu_list_label);
 
     /* log analyzer start */
     CTC_TEST_EXCEPTION (ctcl_initialize (&ctcl_conf_items, &la_thr_id), 
                         err_ctcl_init_failed_label);
 
-    printf ("log_analyzer_thr_id = %d\n", la_thr_id);
+    CTCG_TRACE_INFO (CTCG_TRACE_EV_ANALYZER_THR_STARTED, la_thr_id, 0, 0, 0);
 
     server_Status = CTC_SERV_STATUS_RUNNING;
     stage = 3;
@@ -222,11 +304,28 @@ int main (int argc, char **argv)
         exit (EXIT_FAILURE);
     }
 
+    /* reactor threads serving control sessions inherit the listener cpus */
+    result = ctcg_cpu_bind_thread (pthread_self (), 
+                                   &listener_cpu_set, 
+                                   CTCG_CPU_ALL);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_cpu_list_label);
+
+    result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_REACTOR_THREAD_COUNT, 
+                                       CTCG_CONF_ITEM_VAL_SET_INT, 
+                                       (void *)&reactor_thread_cnt);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_conf_item_label);
+
+    CTC_TEST_EXCEPTION (ctcn_reactor_initialize (reactor_thread_cnt), 
+                        err_reactor_init_failed_label);
+    stage = 4;
+
     /* listener start */
     CTC_TEST_EXCEPTION (ctc_start_listen (ctc_port), err_listen_failed_label);
 
     pthread_join (la_thr_id, (void **)&thr_ret);
 
+    ctc_dump_trace ();
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_load_conf_failed_label)
@@ -258,7 +357,17 @@ int main (int argc, char **argv)
     }
     CTC_EXCEPTION (err_get_conf_item_label)
     {
-        fprintf (stdout, "\n ERROR(for DEBUG): failed to get log file path.\n");
+        fprintf (stdout, "\n ERROR(for DEBUG): failed to get configuration item.\n");
+        fflush (stdout);
+    }
+    CTC_EXCEPTION (err_invalid_cpu_list_label)
+    {
+        fprintf (stdout, "\n ERROR: invalid cpu list in configuration.\n");
+        fflush (stdout);
+    }
+    CTC_EXCEPTION (err_reactor_init_failed_label)
+    {
+        fprintf (stdout, "\n ERROR(for DEBUG): reactor initialize failed.\n");
         fflush (stdout);
     }
     CTC_EXCEPTION (err_listen_failed_label)
@@ -270,6 +379,8 @@ int main (int argc, char **argv)
 
     switch (stage)
     {
+        case 4:
+            ctcn_reactor_finalize ();
         case 3:
             (void)ctcl_finalize ();
         case 2:
@@ -279,6 +390,8 @@ int main (int argc, char **argv)
             break;
     }
 
+    ctc_dump_trace ();
+
     return CTC_FAILURE;
 }
 
@@ -325,25 +438,29 @@ static int ctc_load_conf (void)
 {
     CTC_TEST_EXCEPTION (ctcg_load_conf (), err_load_conf_label);
 
-    /* >>> for test */
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_INFO
     int i;
+    char *str_val;
+
     for (i = 0; i < CTCG_CONF_ID_LAST; i++)
     {
         if (conf_item_Def[i].datatype == CTCG_CONF_INTEGER)
         {
-            printf ("CONFIGURATION ITEM NO[%d]:\n\t NAME: %s\n\t VALUE: %d\n", 
-                    i, conf_item_Def[i].name, CONF_GET_INT(conf_item_Def[i].value));
+            CTCG_TRACE_INFO (CTCG_TRACE_EV_CONF_ITEM_INT, 
+                             i, CONF_GET_INT (conf_item_Def[i].value), 0, 0);
         }
         else if (conf_item_Def[i].datatype == CTCG_CONF_STRING)
         {
-            printf ("CONFIGURATION ITEM NO[%d]:\n\t NAME: %s\n\t VALUE: %s\n", 
-                    i, conf_item_Def[i].name, CONF_GET_STRING(conf_item_Def[i].value));
+            str_val = CONF_GET_STRING (conf_item_Def[i].value);
+
+            CTCG_TRACE_INFO (CTCG_TRACE_EV_CONF_ITEM_STR, 
+                             i, str_val != NULL ? strlen (str_val) : 0, 0, 0);
         }
         else
         {
         }
     }
-    /* <<< for test */
+#endif
 
     return CTC_SUCCESS;
 
@@ -358,23 +475,21 @@ static int ctc_load_conf (void)
  * Description: main listener thread
  *
  *  1. setup listen socket 
- *  2. listen connection request from CTC API library
- *  3. LOOP: accept and read protocol
- *  4-1. if protocol is 'CTC_CREATE_CTRL_SESSION', create control session thread
- *  4-2. if protocol is 'CTC_CREATE_JOB_SESSION', copy new sd into session grp.
+ *  2. listen connection request from CTC API library, on ctc_port and
+ *     on ctc_unix_socket_path if set
+ *  3. hand listen links to reactor, connections are accepted and their
+ *     first protocol handled there, see ctc_on_handshake_frame
+ *  4. LOOP: close handshakes not done in CTC_HANDSHAKE_TIMEOUT_MSEC
  *
  */
 static int ctc_start_listen (unsigned short ctc_port)
 {
     int result;
-    int result_code;
-    int sgid = CTCP_SGID_NULL;
-    int total_session_cnt = 0;
-    unsigned short job_desc;
-    CTCS_SESSION_GROUP *sg = NULL;
-    CTCS_CTRL_SESSION *ctrl_session;
     CTCN_LINK *link = NULL;
-    CTCP_HEADER header;
+    CTCN_LINK *unix_link = NULL;
+
+    CTCG_LIST_INIT (&ctc_Handshakes.list);
+    ctc_Handshakes.cnt = 0;
 
     /* 1. setup listen socket */
     CTC_TEST_EXCEPTION (ctc_make_link (&link), err_make_link_failed_label);
@@ -382,107 +497,82 @@ static int ctc_start_listen (unsigned short ctc_port)
     /* 2. listen connection request */
     CTC_TEST_EXCEPTION (ctc_listen (link, ctc_port), err_ctc_listen_label);
 
-    /* 3. accept and read protocol */
+    CTC_TEST_EXCEPTION (ctc_listen_unix (&unix_link), 
+                        err_ctc_listen_unix_label);
+
+    /* 3. accept on reactor */
+    CTC_TEST_EXCEPTION (ctcn_reactor_add_listener (link, ctc_on_accept, NULL),
+                        err_add_listener_failed_label);
+
+    if (unix_link != NULL)
+    {
+        CTC_TEST_EXCEPTION (ctcn_reactor_add_listener (unix_link, 
+                                                       ctc_on_accept, 
+                                                       NULL),
+                            err_add_listener_failed_label);
+    }
+
+    /* 4. expire handshakes, accept again after running out of files */
     while (!is_stop_listen)
     {
-        /* accept --> read packet --> packet validation */
-        result = ctc_accept_and_read_protocol (link, (void *)&header);
+        (void)usleep (CTC_LISTEN_SWEEP_MSEC * 1000);
 
-        if (result == CTC_SUCCESS)
-        {
-            switch (header.op_id)
-            {
-                case CTCP_CREATE_CONTROL_SESSION:
-
-                    (void)ctcp_do_create_ctrl_session (link, 
-                                                       &header, 
-                                                       &sgid, 
-                                                       &result_code);
-
-                    ctcp_send_create_ctrl_session_result (link, 
-                                                          result_code, 
-                                                          sgid);
-
-                    if (result_code == CTCP_RC_SUCCESS)
-                    {
-                        CTC_TEST_EXCEPTION (ctcs_mgr_inc_session_count (),
-                                            err_inc_session_cnt_failed_label);
-                    }
-
-                    sg = ctcs_find_session_group_by_id (sgid);
-
-                    if (sg != NULL)
-                    {
-                        ctrl_session = ctcs_sg_get_ctrl_session (sg);
-                        pthread_join (ctrl_session->thread, NULL);
-                    }
-                    else
-                    {
-                        /* ERROR: critical but ignore */
-                    }
-
-                    break;
-
-                case CTCP_CREATE_JOB_SESSION:
-
-                    sgid = ctcp_header_get_sgid (&header);
-
-                    (void)ctcp_do_create_job_session (link, 
-                                                      sgid, 
-                                                      &header, 
-                                                      &job_desc,
-                                                      &result_code);
-
-                    ctcp_send_create_job_session_result (link, 
-                                                         result_code, 
-                                                         job_desc, 
-                                                         sgid);
-
-                    if (result_code == CTCP_RC_SUCCESS)
-                    {
-                        CTC_TEST_EXCEPTION (ctcs_mgr_inc_session_count (),
-                                            err_inc_session_cnt_failed_label);
-                    }
-
-                    break;
-
-                default:
-                    break;
-            }
-        }
-        else
-        {
-            continue;
-        }
+        ctc_sweep_handshakes ();
 
-        CTC_TEST_EXCEPTION (ctcs_mgr_get_session_count (&total_session_cnt),
-                            err_get_session_cnt_failed_label);
+        ctcn_reactor_resume_listener (link);
 
-        if (total_session_cnt >= CTCN_MAX_LISTEN)
+        if (unix_link != NULL)
         {
-            /* WARNING: session count meets max listen allowed */
-            break;
+            ctcn_reactor_resume_listener (unix_link);
         }
     }
 
+    ctcn_reactor_remove_link (link);
+    ctc_close_link (link);
+
+    if (unix_link != NULL)
+    {
+        ctcn_reactor_remove_link (unix_link);
+    }
+
+    ctc_close_listen_unix (unix_link);
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_make_link_failed_label)
     {
-        printf ("err_make_link_failed_label\n");
         result = CTC_ERR_ALLOC_FAILED;
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_MAKE_LISTEN_LINK_FAILED, 
+                          result, 0, 0, 0);
     }
     CTC_EXCEPTION (err_ctc_listen_label)
     {
-        printf ("err_ctc_listen_label\n");
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_LISTEN_FAILED, ctc_port, 0, 0, 0);
+        result = CTC_FAILURE;
+
+        ctc_close_link (link);
     }
-    CTC_EXCEPTION (err_inc_session_cnt_failed_label)
+    CTC_EXCEPTION (err_ctc_listen_unix_label)
     {
-        /* lock fail */
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_LISTEN_FAILED, 0, 0, 0, 0);
+        result = CTC_FAILURE;
+
+        ctc_close_link (link);
     }
-    CTC_EXCEPTION (err_get_session_cnt_failed_label)
+    CTC_EXCEPTION (err_add_listener_failed_label)
     {
-        /* lock fail */
+        CTCG_TRACE_ERROR (CTCG_TRACE_EV_LISTEN_FAILED, ctc_port, 0, 0, 0);
+        result = CTC_FAILURE;
+
+        ctcn_reactor_remove_link (link);
+        ctc_close_link (link);
+
+        if (unix_link != NULL)
+        {
+            ctcn_reactor_remove_link (unix_link);
+        }
+
+        ctc_close_listen_unix (unix_link);
     }
     EXCEPTION_END;
 
@@ -526,89 +616,377 @@ static int ctc_listen (CTCN_LINK *link, unsigned short ctc_port)
 }
 
 
-static int ctc_accept_and_read_protocol (CTCN_LINK *listen_link,
-                                         void *header)
+/*
+ * Description : link is NULL unless ctc_unix_socket_path is set, a 
+ *               consumer on this host connecting there is served like 
+ *               one on ctc_port
+ *
+ */
+static int ctc_listen_unix (CTCN_LINK **link)
 {
-    BOOL is_timeout = CTC_FALSE;
-    int addr_len;
-    int result = CTC_SUCCESS;
-    ctc_sock_addr_t addr;
-    CTCN_LINK *new_link = NULL;
+    int result;
+    long mode;
+    char *path;
+    char *mode_str;
+    char *end = NULL;
 
-    /* make new link */
-    CTC_TEST_EXCEPTION (ctcn_link_create (&new_link), err_link_create_label);
+    *link = NULL;
 
-    while (1)
+    path = CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_UNIX_SOCKET_PATH].value);
+
+    if (path == NULL || path[0] == '\0')
     {
-        result = ctcn_link_poll_socket (listen_link, 1000, &is_timeout);
+        return CTC_SUCCESS;
+    }
 
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_link_poll_socket_failed_label);
+    mode_str = CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_UNIX_SOCKET_MODE].value);
+    CTC_COND_EXCEPTION (mode_str == NULL, err_invalid_mode_label);
 
-        if (is_timeout == CTC_TRUE)
-        {
-            usleep (1000 * 1000);
-            continue;
-        }
-        else
-        {
-            /* accept new clnt socket */
-            CTC_TEST_EXCEPTION (ctcn_sock_accept (&new_link->sock, 
-                                                  &listen_link->sock, 
-                                                  &addr, 
-                                                  &addr_len),
-                                err_sock_accept_label);
+    mode = strtol (mode_str, &end, 8);
+    CTC_COND_EXCEPTION (end == mode_str || *end != '\0' || 
+                        mode < 0 || mode > 0777,
+                        err_invalid_mode_label);
+
+    CTC_TEST_EXCEPTION (ctc_make_link (link), err_make_link_failed_label);
+
+    result = ctcn_link_listen_unix (*link, path, (int)mode);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_link_listen_label);
+
+    return CTC_SUCCESS;
 
-            //ctcn_sock_accept (&new_link->sock, &listen_link->sock, NULL, NULL);
+    CTC_EXCEPTION (err_invalid_mode_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_make_link_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_link_listen_label)
+    {
+        ctcn_link_destroy (*link);
+        *link = NULL;
+    }
+    EXCEPTION_END;
 
-            /* recv packet */
-            CTC_TEST_EXCEPTION (ctcn_link_recv (new_link, 100, &is_timeout),
-                                err_link_recv_socket_label);
+    return result;
+}
 
-            CTC_COND_EXCEPTION (is_timeout == CTC_TRUE, err_sock_recv_timeout_label);
 
-            /* read protocol header */
-            CTC_TEST_EXCEPTION (ctcp_analyze_protocol_header (new_link, 
-                                                              CTCP_UNKNOWN_OPERATION, 
-                                                              (CTCP_HEADER *)header),
-                                err_analyze_protocol_header);
+/* socket file goes with the listener */
+static void ctc_close_listen_unix (CTCN_LINK *link)
+{
+    char *path;
 
-            break;
-        }
+    if (link == NULL)
+    {
+        return;
     }
 
-    return CTC_SUCCESS;
+    path = CONF_GET_STRING (conf_item_Def[CTCG_CONF_ID_CTC_UNIX_SOCKET_PATH].value);
+
+    ctc_close_link (link);
+    (void)unlink (path);
+}
+
+
+static void ctc_close_link (CTCN_LINK *link)
+{
+    (void)ctcn_sock_close (&(link->sock));
+    ctcn_link_destroy (link);
+}
 
-    CTC_EXCEPTION (err_link_create_label)
+
+/*
+ * Description : a connection accepted by reactor waits there for its 
+ *               first protocol, refused once sessions and handshakes
+ *               reach CTCN_MAX_LISTEN
+ *
+ */
+static void ctc_on_accept (CTCN_LINK *link, void *arg)
+{
+    int total_session_cnt = 0;
+    int send_queue_size = 0;
+    CTC_HANDSHAKE *handshake = NULL;
+
+    CTC_TEST_EXCEPTION (ctcs_mgr_get_session_count (&total_session_cnt),
+                        err_get_session_cnt_failed_label);
+
+    handshake = (CTC_HANDSHAKE *)malloc (sizeof (CTC_HANDSHAKE));
+    CTC_COND_EXCEPTION (handshake == NULL, err_alloc_failed_label);
+
+    handshake->link = link;
+    handshake->accept_msec = ctc_get_mono_msec ();
+    handshake->is_expired = CTC_FALSE;
+
+    CTCG_LIST_INIT_OBJ (&(handshake->node), handshake);
+
+    (void)pthread_mutex_lock (&ctc_Handshakes.lock);
+
+    if (total_session_cnt + ctc_Handshakes.cnt >= CTCN_MAX_LISTEN)
     {
-        result = CTC_ERR_ALLOC_FAILED;
+        (void)pthread_mutex_unlock (&ctc_Handshakes.lock);
+
+        /* WARNING: session count meets max listen allowed */
+        CTC_COND_EXCEPTION (CTC_TRUE, err_exceed_max_listen_label);
     }
-    CTC_EXCEPTION (err_link_poll_socket_failed_label)
+
+    /* listed first, the frame may come as soon as it is watched */
+    CTCG_LIST_ADD_LAST (&ctc_Handshakes.list, &(handshake->node));
+    ctc_Handshakes.cnt++;
+
+    (void)pthread_mutex_unlock (&ctc_Handshakes.lock);
+
+    /* results are queued and written by the reactor as the socket takes
+     * them, a frame function never waits for a slow peer */
+    (void)ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_SEND_QUEUE_SIZE,
+                                    CTCG_CONF_ITEM_VAL_SET_INT,
+                                    (void *)&send_queue_size);
+
+    (void)ctcn_link_set_send_queue (link, (unsigned long)send_queue_size);
+
+    CTC_TEST_EXCEPTION (ctcn_reactor_add_link (link, 
+                                               ctc_on_handshake_frame, 
+                                               ctc_on_handshake_close, 
+                                               (void *)handshake),
+                        err_reactor_add_link_failed_label);
+
+    return;
+
+    CTC_EXCEPTION (err_get_session_cnt_failed_label)
     {
-        result = CTC_ERR_ALLOC_FAILED;
+        /* lock fail */
+        ctc_close_link (link);
     }
-    CTC_EXCEPTION (err_sock_accept_label)
+    CTC_EXCEPTION (err_alloc_failed_label)
     {
-        result = CTC_FAILURE;
+        ctc_close_link (link);
     }
-    CTC_EXCEPTION (err_link_recv_socket_label)
+    CTC_EXCEPTION (err_exceed_max_listen_label)
     {
-        result = CTC_FAILURE;
+        free (handshake);
+        ctc_close_link (link);
+    }
+    CTC_EXCEPTION (err_reactor_add_link_failed_label)
+    {
+        (void)ctc_handshake_take (handshake);
+        ctc_close_link (link);
+    }
+    EXCEPTION_END;
+
+    return;
+}
+
+
+/*
+ * Description : first frame of an accepted link, which becomes a 
+ *               control session or a job session. runs on a reactor 
+ *               thread, other connections are accepted meanwhile.
+ *
+ */
+static int ctc_on_handshake_frame (CTCN_LINK *link, void *arg)
+{
+    int result;
+    int result_code;
+    int sgid = CTCP_SGID_NULL;
+    int max_frame_size;
+    int features;
+    BOOL is_taken;
+    unsigned short job_desc;
+    CTCS_SESSION_GROUP *sg = NULL;
+    CTCP_HEADER header;
+
+    is_taken = ctc_handshake_take ((CTC_HANDSHAKE *)arg);
+
+    /* handshake is freed, a close from now on goes without it */
+    (void)ctcn_reactor_add_link (link, 
+                                 ctc_on_handshake_frame, 
+                                 ctc_on_handshake_close, 
+                                 NULL);
+
+    /* shut down by ctc_sweep_handshakes, or a second frame */
+    CTC_COND_EXCEPTION (is_taken != CTC_TRUE, err_handshake_expired_label);
+
+    /* read protocol header */
+    CTC_TEST_EXCEPTION (ctcp_analyze_protocol_header (link, 
+                                                      CTCP_UNKNOWN_OPERATION, 
+                                                      &header),
+                        err_analyze_protocol_header);
+
+    switch (header.op_id)
+    {
+        case CTCP_CREATE_CONTROL_SESSION:
+
+            (void)ctcp_do_create_ctrl_session (link, 
+                                               &header, 
+                                               &sgid, 
+                                               &max_frame_size,
+                                               &features,
+                                               &result_code);
+
+            ctcp_send_create_ctrl_session_result (link, 
+                                                  result_code, 
+                                                  sgid,
+                                                  max_frame_size,
+                                                  features);
+
+            CTC_COND_EXCEPTION (result_code != CTCP_RC_SUCCESS,
+                                err_create_session_failed_label);
+
+            /* session is created, it is served even if not counted */
+            (void)ctcs_mgr_inc_session_count ();
+
+            /* link is handed over in place, see ctcn_reactor_add_link */
+            sg = ctcs_find_session_group_by_id (sgid);
+
+            if (sg == NULL || 
+                ctcs_sg_start_ctrl_session (sg, link) != CTC_SUCCESS)
+            {
+                /* ERROR: critical but ignore */
+            }
+
+            if (sg != NULL)
+            {
+                ctcs_sg_put (sg);
+            }
+
+            break;
+
+        case CTCP_CREATE_JOB_SESSION:
+
+            sgid = ctcp_header_get_sgid (&header);
+
+            /* made send only by reactor */
+            (void)ctcp_do_create_job_session (link, 
+                                              sgid, 
+                                              &header, 
+                                              &job_desc,
+                                              &result_code);
+
+            ctcp_send_create_job_session_result (link, 
+                                                 result_code, 
+                                                 job_desc, 
+                                                 sgid);
+
+            CTC_COND_EXCEPTION (result_code != CTCP_RC_SUCCESS,
+                                err_create_session_failed_label);
+
+            (void)ctcs_mgr_inc_session_count ();
+
+            break;
+
+        default:
+
+            CTC_COND_EXCEPTION (CTC_TRUE, err_invalid_op_label);
+            break;
     }
-    CTC_EXCEPTION (err_sock_recv_timeout_label)
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_handshake_expired_label)
     {
-        result = CTC_ERR_TIMEOUT_FAILED;
+        result = CTCN_REACTOR_CLOSE;
     }
     CTC_EXCEPTION (err_analyze_protocol_header)
     {
         result = CTC_ERR_INVALID_VALUE_FAILED;
     }
+    CTC_EXCEPTION (err_create_session_failed_label)
+    {
+        result = CTCN_REACTOR_CLOSE;
+    }
+    CTC_EXCEPTION (err_invalid_op_label)
+    {
+        result = CTCN_REACTOR_CLOSE;
+    }
     EXCEPTION_END;
 
     return result;
 }
 
 
+/* closed before its first frame was handled, or refused by it */
+static void ctc_on_handshake_close (CTCN_LINK *link, void *arg)
+{
+    (void)ctc_handshake_take ((CTC_HANDSHAKE *)arg);
+
+    ctc_close_link (link);
+}
+
+
+/*
+ * Description : handshake is unlisted and freed, CTC_FALSE when it is
+ *               NULL or expired
+ *
+ */
+static BOOL ctc_handshake_take (CTC_HANDSHAKE *handshake)
+{
+    BOOL is_expired;
+
+    if (handshake == NULL)
+    {
+        return CTC_FALSE;
+    }
+
+    (void)pthread_mutex_lock (&ctc_Handshakes.lock);
+
+    CTCG_LIST_REMOVE (&(handshake->node));
+    ctc_Handshakes.cnt--;
+
+    is_expired = handshake->is_expired;
+
+    (void)pthread_mutex_unlock (&ctc_Handshakes.lock);
+
+    free (handshake);
+
+    return is_expired == CTC_TRUE ? CTC_FALSE : CTC_TRUE;
+}
+
+
+/*
+ * Description : links accepted CTC_HANDSHAKE_TIMEOUT_MSEC ago and still
+ *               without a first frame are shut down, the reactor finds
+ *               end of file and closes them
+ *
+ */
+static void ctc_sweep_handshakes (void)
+{
+    UINT_64 now;
+    CTCG_LIST_NODE *itr;
+    CTC_HANDSHAKE *handshake;
+
+    now = ctc_get_mono_msec ();
+
+    (void)pthread_mutex_lock (&ctc_Handshakes.lock);
+
+    CTCG_LIST_ITERATE (&ctc_Handshakes.list, itr)
+    {
+        handshake = (CTC_HANDSHAKE *)itr->obj;
+
+        if (handshake->is_expired != CTC_TRUE &&
+            now - handshake->accept_msec >= CTC_HANDSHAKE_TIMEOUT_MSEC)
+        {
+            handshake->is_expired = CTC_TRUE;
+
+            (void)ctcn_sock_shutdown (&(handshake->link->sock), 
+                                      CTCN_SHUTDW_RW);
+        }
+    }
+
+    (void)pthread_mutex_unlock (&ctc_Handshakes.lock);
+}
+
+
+static UINT_64 ctc_get_mono_msec (void)
+{
+    struct timespec now;
+
+    (void)clock_gettime (CLOCK_MONOTONIC, &now);
+
+    return (UINT_64)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+
 static int ctc_conf_get_ctc_port (unsigned short *port)
 {
     int result;
@@ -636,14 +1014,38 @@ static int ctc_conf_get_ctc_port (unsigned short *port)
 
 static void ctc_finalize (void)
 {
+    /* control sessions stop before their session groups go */
+    ctcn_reactor_finalize ();
     (void)ctcj_finalize ();
     (void)ctcs_finalize ();
 //    (void)ctcl_finalize ();
 
+    ctc_dump_trace ();
+
     return;
 }
 
 
+/*
+ * Description: write trace rings into $CUBRID/log/ctc_trace.bin
+ *  decode it by testtools/ctc_trace_decoder
+ */
+static void ctc_dump_trace (void)
+{
+    char *env_root;
+    char dump_path[CTCG_PATH_MAX];
+
+    env_root = getenv ("CUBRID");
+
+    snprintf (dump_path, sizeof (dump_path), 
+              "%s/log/%s", 
+              env_root != NULL ? env_root : ".", 
+              CTCG_TRACE_DUMP_FILE_NAME);
+
+    (void)ctcg_trace_dump (dump_path);
+}
+
+
 static void ctc_stop_listen (void)
 {
     is_stop_listen = CTC_TRUE;
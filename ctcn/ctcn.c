@@ -31,15 +31,34 @@
 #include <assert.h>
 #include <sys/time.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
-#include <sys/epoll.h>
+#include <sys/un.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <netdb.h>
 #include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+
+#if defined (SO_ZEROCOPY) && defined (MSG_ZEROCOPY)
+#include <linux/errqueue.h>
+#define CTCN_HAVE_ZEROCOPY
+#define CTCN_MSG_ZEROCOPY               MSG_ZEROCOPY
+#else
+#define CTCN_MSG_ZEROCOPY               (0)
+#endif
+
+#define CTCN_IOV_MAX                    (1024)      /* UIO_MAXIOV */
+#define CTCN_ZEROCOPY_WAIT_MSEC         (1000)
+#define CTCN_SEND_WAIT_MSEC             (60 * 1000) /* peer not reading */
+#define CTCN_HDR_DATA_LEN_OFFSET        (12)        /* sync with CTCP_HEADER */
+#define CTCN_POLL_LINK_MAX              (8)
 
 #include "ctcp.h"
 #include "ctc_common.h"
 #include "ctcn_link.h"
+#include "ctcn_reactor.h"
 #include "ctc_types.h"
 
 
@@ -96,9 +115,69 @@ static int ctcn_sock_send (CTC_SOCK *sock,
                            int *recv_size, 
                            int flag);
 
+static char *ctcn_buf_alloc (unsigned int size, unsigned int *alloc_size);
+static void ctcn_buf_free (char *buf, unsigned int size);
+static int ctcn_link_reserve_rbuf (CTCN_LINK *link, unsigned int size);
+static int ctcn_link_reserve_wbuf (CTCN_LINK *link, unsigned int len);
+
+static int ctcn_sock_sendv (CTC_SOCK *sock,
+                            struct iovec *iov,
+                            int iov_cnt,
+                            int flag,
+                            int *zc_call_cnt);
+static int ctcn_link_build_iov (CTCN_LINK *link, int *iov_cnt);
+static void ctcn_link_release_holds (CTCN_LINK_HOLD *hold, int hold_cnt);
+static CTCN_LINK_ZC_FRAME *ctcn_link_zc_frame_alloc (CTCN_LINK *link);
+static void ctcn_link_zc_frame_park (CTCN_LINK *link, 
+                                     CTCN_LINK_ZC_FRAME *frame,
+                                     int zc_call_cnt);
+static void ctcn_link_reap_zerocopy (CTCN_LINK *link, int timeout_msec);
+
+static int ctcn_link_send_queued (CTCN_LINK *link, int *fds, int fd_cnt);
+static void ctcn_link_out_frame_close_fds (CTCN_LINK_OUT_FRAME *frame);
+static int ctcn_link_out_frame_make (CTCN_LINK *link, 
+                                     CTCN_LINK_OUT_FRAME **out_frame);
+static int ctcn_link_out_frame_write (CTCN_LINK *link, 
+                                      CTCN_LINK_OUT_FRAME *frame);
+static int ctcn_link_build_out_iov (CTCN_LINK *link, 
+                                    CTCN_LINK_OUT_FRAME *frame,
+                                    int *iov_cnt);
+static void ctcn_link_out_frame_done (CTCN_LINK *link, 
+                                      CTCN_LINK_OUT_FRAME *frame);
+static int ctcn_link_flush_nolock (CTCN_LINK *link);
+static void ctcn_link_drop_out_frames (CTCN_LINK *link);
+
+static int ctcn_link_send_ring (CTCN_LINK *link);
+static BOOL ctcn_link_is_ring_full (CTCN_LINK *link);
+static int ctcn_link_flush_ring (CTCN_LINK *link);
+static BOOL ctcn_link_is_ring_drained (CTCN_LINK *link);
+
+static int ctcn_link_get_frame_len (CTCN_LINK *link, unsigned int *frame_len);
+static int ctcn_sock_probe_unix (ctc_sock_addr_un_t *addr_un);
+
 static void ctcn_assign_number_two (unsigned char *src, unsigned char *dest);
 static void ctcn_assign_number_four (unsigned char *src, unsigned char *dest);
+static void ctcn_assign_number_eight (unsigned char *src, unsigned char *dest);
+
+
+/* 
+ * link buffer pool : released buffers are kept by size class, class n
+ * holds CTCN_LINK_BUF_SIZE << n bytes buffers.
+ */
+#define CTCN_BUF_POOL_CLASS_CNT         (13)        /* up to 16MB */
+#define CTCN_BUF_POOL_CLASS_KEEP        (8)
+#define CTCN_BUF_POOL_BYTES_MAX         (64 * 1024 * 1024)
 
+typedef struct ctcn_buf_pool CTCN_BUF_POOL;
+struct ctcn_buf_pool
+{
+    pthread_mutex_t lock;
+    unsigned long kept_bytes;
+    int free_cnt[CTCN_BUF_POOL_CLASS_CNT];
+    char *free_buf[CTCN_BUF_POOL_CLASS_CNT][CTCN_BUF_POOL_CLASS_KEEP];
+};
+
+static CTCN_BUF_POOL ctcn_Buf_pool = { PTHREAD_MUTEX_INITIALIZER };
 
 
 static int ctcn_create_new_sock (CTC_SOCK **sock)
@@ -133,7 +212,12 @@ extern int ctcn_sock_open (CTC_SOCK *sock, int family, int type, int prcl)
 
 extern int ctcn_sock_close (CTC_SOCK *sock)
 {
-    CTC_TEST_EXCEPTION (close (sock->handle), err_sock_close_label);
+    int handle = sock->handle;
+
+    /* the descriptor is gone even when close fails */
+    sock->handle = CTCN_SOCK_INVALID_HANDLE;
+
+    CTC_TEST_EXCEPTION (close (handle), err_sock_close_label);
 
     return CTC_SUCCESS;
 
@@ -159,21 +243,21 @@ extern int ctcn_sock_shutdown (CTC_SOCK *sock, int how)
 
 extern int ctcn_sock_set_block_mode (CTC_SOCK *sock, BOOL block_mode)
 {
-    int result;
+    int flags;
 
-    result = fcntl (sock->handle, 0, 0);
-    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_fcntl_label);
+    flags = fcntl (sock->handle, F_GETFL, 0);
+    CTC_COND_EXCEPTION (flags == -1, err_fcntl_label);
 
     if (block_mode == CTC_TRUE)
     {
-        result &= ~CTCN_NONBLOCK;
+        flags &= ~O_NONBLOCK;
     }
     else
     {
-        result |= CTCN_NONBLOCK;
+        flags |= O_NONBLOCK;
     }
 
-    CTC_TEST_EXCEPTION (fcntl (sock->handle, 1, result), err_fcntl_label);
+    CTC_TEST_EXCEPTION (fcntl (sock->handle, F_SETFL, flags), err_fcntl_label);
 
     sock->block_mode = block_mode;
 
@@ -378,83 +462,35 @@ extern int ctcn_sock_get_peer_name (CTC_SOCK *sock,
 }
 
 
+/*
+ * Description : waits for POLLIN or POLLOUT on one socket, in msec.
+ *               sessions are watched by the reactor, this is for the
+ *               listen socket and for a send waiting on a full socket
+ *
+ */
 extern int ctcn_sock_poll (CTC_SOCK *sock, int event, int timeout)
 {
-    /*
-    struct pollfd poll;
-    int ret;
-    int result;
-
-    poll.fd = sock->handle;
-    poll.events = event;
-    poll.revents = 0;
-
-    ret = poll(&poll, 1, timeout);
-    */
-    int time_out;
-    int handle;
     int ret;
-    int result;
-    struct epoll_event epl_change;
-    struct epoll_event epl_event;
-
-    handle = epoll_create (1);
-    CTC_COND_EXCEPTION (handle == -1, err_epoll_create_failed_label);
-
-    if (timeout == CTCN_RECV_TIMEOUT_MAX)
-    {
-        time_out = -1;
-    }
-    else
-    {
-        time_out = timeout; /* msec */
-    }
-
-    memset (&epl_event, 0, sizeof (struct epoll_event));
-    epl_event.events = event;
+    struct pollfd poll_fd;
 
-    ret = epoll_ctl (handle, EPOLL_CTL_ADD, sock->handle, &epl_event);
-    CTC_COND_EXCEPTION (ret == -1, err_epoll_add_failed_label);
+    poll_fd.fd = sock->handle;
+    poll_fd.events = event;
+    poll_fd.revents = 0;
 
-    ret = epoll_wait (handle, &epl_change, 1, time_out);
+    ret = poll (&poll_fd, 1, timeout == CTCN_RECV_TIMEOUT_MAX ? -1 : timeout);
 
     if (ret == -1)
     {
-        result = errno;
+        return errno == EINTR ? CTCN_RESULT_EINTR : CTC_FAILURE;
     }
     else if (ret == 0)
     {
-        result = CTCN_RESULT_ETIMEDOUT;
+        return CTCN_RESULT_ETIMEDOUT;
     }
     else
     {
-        result = CTC_SUCCESS;
-    }
-
-    ret = epoll_ctl (handle, EPOLL_CTL_DEL, sock->handle, &epl_event);
-    CTC_COND_EXCEPTION (ret == -1, err_epoll_del_failed_label);
-
-    (void)close (handle);
-
-    return CTC_SUCCESS;
-
-    CTC_EXCEPTION (err_epoll_create_failed_label)
-    {
-        result = errno;
-    }
-    CTC_EXCEPTION (err_epoll_add_failed_label)
-    {
-        result = errno;
-        (void)close (handle);
-    }
-    CTC_EXCEPTION (err_epoll_del_failed_label)
-    {
-        result = errno;
-        (void)close (handle);
+        return CTC_SUCCESS;
     }
-    EXCEPTION_END;
-
-    return result;
 }
 
 
@@ -512,21 +548,39 @@ static int ctcn_sock_send (CTC_SOCK *sock,
                            int *send_size, 
                            int flag)
 {
-    int send_result;
+    int send_result = 0;
+    int sent;
     int result;
 
-    if (buf_size == 0)
-    {
-        send_result = 0;
-    }
-    else
+    CTC_COND_EXCEPTION (buf_size < 0 || buf_size > CTCN_LINK_FRAME_SIZE_MAX, 
+                        err_invalid_buf_size_label);
+
+    /* a large frame may be taken by the kernel in parts */
+    while (send_result < buf_size)
     {
-        CTC_COND_EXCEPTION (buf_size > CTCN_LINK_BUF_SIZE, 
-                            err_invalid_buf_size_label);
-            
-        send_result = send (sock->handle, buf, buf_size, flag);
+        sent = send (sock->handle, 
+                     (char *)buf + send_result, 
+                     buf_size - send_result, 
+                     flag);
+
+        if (sent == -1 && errno == EINTR)
+        {
+            continue;
+        }
 
-        CTC_COND_EXCEPTION (send_result == -1, err_sock_send_label);
+        /* non-blocking socket of a reactor link */
+        if (sent == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            CTC_TEST_EXCEPTION (ctcn_sock_poll (sock, 
+                                                POLLOUT, 
+                                                CTCN_SEND_WAIT_MSEC),
+                                err_sock_send_label);
+            continue;
+        }
+
+        CTC_COND_EXCEPTION (sent == -1, err_sock_send_label);
+
+        send_result += sent;
     }
 
     if (send_size != NULL)
@@ -565,12 +619,24 @@ extern int ctcn_link_create (CTCN_LINK **link)
 
     memset (link_ptr, 0, sizeof (*link_ptr));
 
+    is_link_allocated = CTC_TRUE;
+
+    link_ptr->sock.handle = CTCN_SOCK_INVALID_HANDLE;
     link_ptr->is_sock_opened = CTC_FALSE;
     link_ptr->next_seq_no = 0;
+    link_ptr->max_frame_size = CTCN_LINK_BUF_SIZE;
     link_ptr->rbuf_pos = 0;
     link_ptr->read_data_size = 0;
     link_ptr->wbuf_pos = 0;
 
+    (void)pthread_mutex_init (&link_ptr->out_lock, NULL);
+
+    link_ptr->rbuf = ctcn_buf_alloc (CTCN_LINK_BUF_SIZE, &link_ptr->rbuf_size);
+    CTC_COND_EXCEPTION (link_ptr->rbuf == NULL, err_alloc_link_failed_label);
+
+    link_ptr->wbuf = ctcn_buf_alloc (CTCN_LINK_BUF_SIZE, &link_ptr->wbuf_size);
+    CTC_COND_EXCEPTION (link_ptr->wbuf == NULL, err_alloc_link_failed_label);
+
     *link = link_ptr;
 
     return CTC_SUCCESS;
@@ -584,7 +650,7 @@ extern int ctcn_link_create (CTCN_LINK **link)
 
     if (is_link_allocated)
     {
-        free (link_ptr);
+        ctcn_link_destroy (link_ptr);
     }
 
     return CTC_FAILURE;
@@ -593,8 +659,54 @@ extern int ctcn_link_create (CTCN_LINK **link)
 
 extern void ctcn_link_destroy (CTCN_LINK *link)
 {
+    CTCN_LINK_ZC_FRAME *frame;
+
     if (link != NULL)
     {
+        ctcn_ring_destroy (link->ring);
+
+        ctcn_link_drop_out_frames (link);
+
+        ctcn_link_reap_zerocopy (link, CTCN_ZEROCOPY_WAIT_MSEC);
+
+        /* never completed, pages the kernel still sends from are pinned
+         * by it, with the socket closed the memory is ours again */
+        if (link->sock.handle != CTCN_SOCK_INVALID_HANDLE)
+        {
+            (void)ctcn_sock_close (&(link->sock));
+        }
+
+        while ((frame = link->zc_pending_head) != NULL)
+        {
+            link->zc_pending_head = frame->next;
+
+            ctcn_link_release_holds (frame->hold, frame->hold_cnt);
+            free (frame->hold);
+            ctcn_buf_free (frame->wbuf, frame->wbuf_size);
+            free (frame);
+        }
+
+        link->zc_pending_tail = NULL;
+        link->zc_pending_cnt = 0;
+
+        ctcn_link_release_holds (link->hold, link->hold_cnt);
+
+        free (link->hold);
+        free (link->ref);
+        free (link->iov);
+
+        if (link->rbuf != NULL)
+        {
+            ctcn_buf_free (link->rbuf, link->rbuf_size);
+        }
+
+        if (link->wbuf != NULL)
+        {
+            ctcn_buf_free (link->wbuf, link->wbuf_size);
+        }
+
+        (void)pthread_mutex_destroy (&link->out_lock);
+
         free (link);
     }
 
@@ -602,6 +714,202 @@ extern void ctcn_link_destroy (CTCN_LINK *link)
 }
 
 
+/*
+ * Description : frames of link may be up to max_frame_size from now on,
+ *               buffers grow when such a frame comes or is written
+ *
+ */
+extern int ctcn_link_set_max_frame_size (CTCN_LINK *link, 
+                                         unsigned int max_frame_size)
+{
+    int opt;
+
+    CTC_COND_EXCEPTION (max_frame_size < CTCN_LINK_BUF_SIZE ||
+                        max_frame_size > CTCN_LINK_FRAME_SIZE_MAX,
+                        err_invalid_frame_size_label);
+
+    link->max_frame_size = max_frame_size;
+
+    if (link->sock.handle != CTCN_SOCK_INVALID_HANDLE)
+    {
+        /* a whole frame fits in the socket buffer, capped by the kernel */
+        opt = (int)max_frame_size * 2;
+
+        (void)ctcn_sock_set_opt (&(link->sock), 
+                                 SOL_SOCKET, 
+                                 SO_SNDBUF, 
+                                 (void *)&opt, 
+                                 sizeof (opt));
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_frame_size_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : smallest pooled size class holding size, NULL if size 
+ *               exceeds the largest one or malloc fails
+ *
+ */
+static char *ctcn_buf_alloc (unsigned int size, unsigned int *alloc_size)
+{
+    int i;
+    unsigned int class_size = CTCN_LINK_BUF_SIZE;
+    char *buf = NULL;
+
+    for (i = 0; i < CTCN_BUF_POOL_CLASS_CNT && class_size < size; i++)
+    {
+        class_size <<= 1;
+    }
+
+    if (i == CTCN_BUF_POOL_CLASS_CNT)
+    {
+        return NULL;
+    }
+
+    (void)pthread_mutex_lock (&ctcn_Buf_pool.lock);
+
+    if (ctcn_Buf_pool.free_cnt[i] > 0)
+    {
+        buf = ctcn_Buf_pool.free_buf[i][--ctcn_Buf_pool.free_cnt[i]];
+        ctcn_Buf_pool.kept_bytes -= class_size;
+    }
+
+    (void)pthread_mutex_unlock (&ctcn_Buf_pool.lock);
+
+    if (buf == NULL)
+    {
+        buf = (char *)malloc (class_size);
+    }
+
+    *alloc_size = class_size;
+
+    return buf;
+}
+
+
+static void ctcn_buf_free (char *buf, unsigned int size)
+{
+    int i;
+    unsigned int class_size = CTCN_LINK_BUF_SIZE;
+
+    for (i = 0; i < CTCN_BUF_POOL_CLASS_CNT && class_size < size; i++)
+    {
+        class_size <<= 1;
+    }
+
+    assert (class_size == size);
+
+    (void)pthread_mutex_lock (&ctcn_Buf_pool.lock);
+
+    if (ctcn_Buf_pool.free_cnt[i] < CTCN_BUF_POOL_CLASS_KEEP &&
+        ctcn_Buf_pool.kept_bytes + size <= CTCN_BUF_POOL_BYTES_MAX)
+    {
+        ctcn_Buf_pool.free_buf[i][ctcn_Buf_pool.free_cnt[i]++] = buf;
+        ctcn_Buf_pool.kept_bytes += size;
+        buf = NULL;
+    }
+
+    (void)pthread_mutex_unlock (&ctcn_Buf_pool.lock);
+
+    if (buf != NULL)
+    {
+        free (buf);
+    }
+}
+
+
+/*
+ * Description : make read buffer hold size bytes, data already read
+ *               is kept
+ *
+ */
+static int ctcn_link_reserve_rbuf (CTCN_LINK *link, unsigned int size)
+{
+    unsigned int new_size;
+    char *new_buf;
+
+    if (size <= link->rbuf_size)
+    {
+        return CTC_SUCCESS;
+    }
+
+    CTC_COND_EXCEPTION (size > link->max_frame_size, err_frame_too_large_label);
+
+    new_buf = ctcn_buf_alloc (size, &new_size);
+    CTC_COND_EXCEPTION (new_buf == NULL, err_alloc_failed_label);
+
+    memcpy (new_buf, link->rbuf, link->rbuf_size);
+    ctcn_buf_free (link->rbuf, link->rbuf_size);
+
+    link->rbuf = new_buf;
+    link->rbuf_size = new_size;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_frame_too_large_label)
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : make room for len more bytes in write buffer, fails 
+ *               when the frame would exceed max_frame_size
+ *
+ */
+static int ctcn_link_reserve_wbuf (CTCN_LINK *link, unsigned int len)
+{
+    unsigned int size = link->wbuf_pos + len;
+    unsigned int new_size;
+    char *new_buf;
+
+    /* referenced bytes are part of the frame too */
+    CTC_COND_EXCEPTION (size + link->wbuf_ref_len > link->max_frame_size, 
+                        err_frame_too_large_label);
+
+    if (size <= link->wbuf_size)
+    {
+        return CTC_SUCCESS;
+    }
+
+    /* doubled at least, a frame being built grows a few times only */
+    if (size < link->wbuf_size * 2)
+    {
+        size = link->wbuf_size * 2;
+    }
+
+    if (size > link->max_frame_size)
+    {
+        size = link->max_frame_size;
+    }
+
+    new_buf = ctcn_buf_alloc (size, &new_size);
+    CTC_COND_EXCEPTION (new_buf == NULL, err_alloc_failed_label);
+
+    memcpy (new_buf, link->wbuf, link->wbuf_size);
+    ctcn_buf_free (link->wbuf, link->wbuf_size);
+
+    link->wbuf = new_buf;
+    link->wbuf_size = new_size;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_frame_too_large_label)
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
 extern int ctcn_link_set_sock_opt (CTCN_LINK *link)
 {
     int opt;
@@ -642,7 +950,7 @@ extern int ctcn_link_set_sock_opt (CTCN_LINK *link)
                         err_set_sock_opt_nodelay_label);
 
     /* SO_SNDBUF */
-    opt = CTCN_LINK_BUF_SIZE * 2;
+    opt = (int)link->max_frame_size * 2;
     CTC_TEST_EXCEPTION (ctcn_sock_set_opt (&(link->sock), 
                                            0, 
                                            SO_SNDBUF, 
@@ -730,223 +1038,1895 @@ extern int ctcn_link_listen (CTCN_LINK *link,
 }
 
 /*
-extern int ctcn_link_disconnect (CTC_LINK *link, BOOL is_reuse)
+ * Description : CTC_SUCCESS when nothing listens on the socket file at
+ *               addr_un any more, it is left by a run that is gone. a
+ *               server still running there is never taken over.
+ *
+ */
+static int ctcn_sock_probe_unix (ctc_sock_addr_un_t *addr_un)
 {
-    (void)ctcn_sock_shutdown (&(link->sock), CTCN_SHUTDW_RW);
+    int fd;
+    int error = 0;
 
-    if (is_reuse == CTC_TRUE)
+    /* a full backlog is not waited for, it is a live server */
+    fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    CTC_COND_EXCEPTION (fd < 0, err_sock_open_label);
+
+    if (connect (fd, (struct sockaddr *)addr_un, sizeof (*addr_un)) != 0)
     {
+        error = errno;
     }
-    else
+
+    (void)close (fd);
+
+    CTC_COND_EXCEPTION (error != ECONNREFUSED, err_path_in_use_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_sock_open_label)
     {
-        ctcn_sock_close (&(link->sock));
-        link->is_sock_opened = CTC_FALSE;
+        /* ERROR: */
     }
+    CTC_EXCEPTION (err_path_in_use_label)
+    {
+        /* ERROR: connected, or cannot tell */
+    }
+    EXCEPTION_END;
 
-    return CTC_SUCCESS;
+    return CTC_FAILURE;
 }
-*/
 
-extern int ctcn_link_recv (CTCN_LINK *link,
-                           unsigned long timeout,
-                           BOOL *is_timeout)
+
+/*
+ * Description : listen on a unix domain socket for consumers on this host.
+ *               links accepted from it are served like tcp ones, minus
+ *               the tcp options.
+ *
+ */
+extern int ctcn_link_listen_unix (CTCN_LINK *link, 
+                                  const char *path, 
+                                  int mode)
 {
-    BOOL read_header_flag = CTC_FALSE;
-    BOOL timeout_flag = CTC_FALSE;
     int result;
-    int recv_size = 0;
-    int offset = 0; 
-    int remained_data_len = 0; 
-    int length_of_data = 0; 
-    unsigned long i = 0;
+    ctc_sock_addr_un_t addr_un;
+    struct stat st;
 
-    remained_data_len = CTCP_HDR_LEN;
-
-    for (i = 0; i < timeout; i++)
-    {    
-        timeout_flag = CTC_FALSE;
+    CTC_COND_EXCEPTION (path == NULL || path[0] == '\0' ||
+                        strlen (path) >= sizeof (addr_un.sun_path),
+                        err_invalid_path_label);
 
-        CTC_TEST_EXCEPTION (ctcn_link_poll_socket (link, 
-                                                   CTCN_ONE_SEC, 
-                                                   &timeout_flag),
-                            err_sock_poll_label);
+    memset ((void *)&addr_un, 0, sizeof (addr_un));
+    addr_un.sun_family = AF_UNIX;
+    strncpy (addr_un.sun_path, path, sizeof (addr_un.sun_path) - 1);
 
-        if ( timeout_flag == CTC_TRUE )
-        {
-            continue;
-        }
-        else
-        {
-            /* nothing to do */ 
-        }
+    /* socket file of a previous run, never anything else */
+    if (lstat (path, &st) == 0)
+    {
+        CTC_COND_EXCEPTION (!S_ISSOCK (st.st_mode), err_invalid_path_label);
+        CTC_TEST_EXCEPTION (ctcn_sock_probe_unix (&addr_un),
+                            err_path_in_use_label);
+        CTC_TEST_EXCEPTION (unlink (path), err_invalid_path_label);
+    }
 
-        CTC_TEST_EXCEPTION (ctcn_link_recv_socket (link, 
-                                                   link->rbuf + offset, 
-                                                   remained_data_len, 
-                                                   &recv_size), 
-                            err_link_recv_socket_label);
+    CTC_TEST_EXCEPTION (ctcn_sock_open (&link->sock, AF_UNIX, SOCK_STREAM, 0),
+                        err_sock_open_label);
 
-        offset += recv_size;
+    CTC_TEST_EXCEPTION (ctcn_sock_bind (&link->sock,
+                                        (ctc_sock_addr_t *)&addr_un,
+                                        sizeof (addr_un),
+                                        CTC_FALSE),
+                        err_sock_bind_label);
 
-        assert (remained_data_len >= recv_size);
+    /* who may connect is up to the file mode */
+    CTC_TEST_EXCEPTION (chmod (path, (mode_t)mode), err_chmod_label);
 
-        remained_data_len -= recv_size;
+    CTC_TEST_EXCEPTION (ctcn_sock_listen (&link->sock, CTCN_MAX_LISTEN),
+                        err_sock_listen_label);
 
-        if (remained_data_len == 0)
-        {
-            if (read_header_flag == CTC_FALSE)
-            {
-                length_of_data = ctcp_header_get_data_len ((CTCP_HEADER *)link->rbuf);
+    return CTC_SUCCESS;
 
-                remained_data_len = length_of_data;
-                read_header_flag = CTC_TRUE;
-            }
-            else
-            {
+    CTC_EXCEPTION (err_invalid_path_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_path_in_use_label)
+    {
+        /* another server listens there, startup fails */
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_sock_open_label)
+    {
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_sock_bind_label)
+    {
+        (void)ctcn_sock_close (&(link->sock));
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_chmod_label)
+    {
+        (void)ctcn_sock_close (&(link->sock));
+        (void)unlink (path);
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_sock_listen_label)
+    {
+        (void)ctcn_sock_close (&(link->sock));
+        (void)unlink (path);
+        result = CTC_FAILURE;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+extern int ctcn_link_disconnect (CTC_LINK *link, BOOL is_reuse)
+{
+    (void)ctcn_sock_shutdown (&(link->sock), CTCN_SHUTDW_RW);
+
+    if (is_reuse == CTC_TRUE)
+    {
+    }
+    else
+    {
+        ctcn_sock_close (&(link->sock));
+        link->is_sock_opened = CTC_FALSE;
+    }
+
+    return CTC_SUCCESS;
+}
+*/
+
+/*
+ * Description : blocking receive of one frame, timeout in seconds
+ *
+ */
+extern int ctcn_link_recv (CTCN_LINK *link,
+                           unsigned long timeout,
+                           BOOL *is_timeout)
+{
+    BOOL read_header_flag = CTC_FALSE;
+    BOOL timeout_flag = CTC_FALSE;
+    int result;
+    int recv_size = 0;
+    unsigned int offset = 0; 
+    unsigned int remained_data_len = 0; 
+    unsigned int frame_len = 0;
+    unsigned long elapsed_msec;
+    unsigned int wait_msec = CTCN_RECV_TIMEOUT_MAX;
+    struct timeval start_time;
+    struct timeval now;
+
+    remained_data_len = CTCP_HDR_LEN;
+
+    (void)gettimeofday (&start_time, NULL);
+
+    while (remained_data_len > 0)
+    {    
+        if (timeout != CTCN_RECV_TIMEOUT_MAX)
+        {
+            (void)gettimeofday (&now, NULL);
+
+            elapsed_msec = (now.tv_sec - start_time.tv_sec) * CTCN_ONE_SEC +
+                           (now.tv_usec - start_time.tv_usec) / 1000;
+
+            if (elapsed_msec >= timeout * CTCN_ONE_SEC)
+            {
+                timeout_flag = CTC_TRUE;
+                break;
+            }
+
+            wait_msec = timeout * CTCN_ONE_SEC - elapsed_msec;
+        }
+
+        /* one wait for the rest of timeout, not one per second */
+        CTC_TEST_EXCEPTION (ctcn_link_poll_socket (link, 
+                                                   wait_msec, 
+                                                   &timeout_flag),
+                            err_sock_poll_label);
+
+        if (timeout_flag == CTC_TRUE)
+        {
+            timeout_flag = CTC_FALSE;
+            continue;
+        }
+        else
+        {
+            /* nothing to do */ 
+        }
+
+        CTC_TEST_EXCEPTION (ctcn_link_recv_socket (link, 
+                                                   link->rbuf + offset, 
+                                                   remained_data_len, 
+                                                   &recv_size), 
+                            err_link_recv_socket_label);
+
+        offset += recv_size;
+
+        assert (remained_data_len >= (unsigned int)recv_size);
+
+        remained_data_len -= recv_size;
+
+        if (remained_data_len == 0 && read_header_flag == CTC_FALSE)
+        {
+            /* frame larger than negotiated is a protocol error */
+            CTC_TEST_EXCEPTION (ctcn_link_get_frame_len (link, &frame_len),
+                                err_frame_too_large_label);
+
+            remained_data_len = frame_len - CTCP_HDR_LEN;
+            read_header_flag = CTC_TRUE;
+        }
+        else
+        {
+            /* do nothing */
+        }
+    }
+
+    link->rbuf_pos = CTCP_HDR_LEN;
+    link->read_data_size = offset;
+
+    /* nothing follows the frame, it is dropped by next ctcn_link_recv_frame */
+    link->recv_len = offset;
+    link->recv_frame_len = offset;
+
+    *is_timeout = timeout_flag;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_sock_poll_label)
+    {
+        result = CTC_ERR_LINK_RECV_FAILED;
+    }
+    CTC_EXCEPTION (err_link_recv_socket_label)
+    {
+        result = CTC_ERR_LINK_RECV_FAILED;
+    }
+    CTC_EXCEPTION (err_frame_too_large_label)
+    {
+        result = CTC_ERR_LINK_RECV_FAILED;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : reads what the non-blocking socket has, is_received is
+ *               set when a whole frame is in rbuf for ctcn_link_read_*. 
+ *               bytes past the frame are kept, so call again until
+ *               is_received is not set. CTCN_RESULT_EOF on peer close.
+ *
+ */
+extern int ctcn_link_recv_frame (CTCN_LINK *link, BOOL *is_received)
+{
+    int recv_size;
+    int result;
+    unsigned int frame_len;
+
+    *is_received = CTC_FALSE;
+
+    /* drop the frame handed out last time */
+    if (link->recv_frame_len > 0)
+    {
+        memmove (link->rbuf, 
+                 link->rbuf + link->recv_frame_len, 
+                 link->recv_len - link->recv_frame_len);
+
+        link->recv_len -= link->recv_frame_len;
+        link->recv_frame_len = 0;
+    }
+
+    while (1)
+    {
+        if (link->recv_len >= CTCP_HDR_LEN)
+        {
+            CTC_TEST_EXCEPTION (ctcn_link_get_frame_len (link, &frame_len),
+                                err_frame_too_large_label);
+
+            if (link->recv_len >= frame_len)
+            {
+                link->rbuf_pos = CTCP_HDR_LEN;
+                link->read_data_size = frame_len;
+                link->recv_frame_len = frame_len;
+
+                *is_received = CTC_TRUE;
+                break;
+            }
+        }
+
+        /* as much as fits, a burst of frames takes one recv */
+        result = ctcn_sock_recv (&(link->sock), 
+                                 link->rbuf + link->recv_len, 
+                                 link->rbuf_size - link->recv_len, 
+                                 &recv_size, 
+                                 0);
+
+        if (result == CTC_FAILURE && errno == EINTR)
+        {
+            continue;
+        }
+
+        if (result == CTC_FAILURE && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_sock_recv_label);
+
+        link->recv_len += recv_size;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_frame_too_large_label)
+    {
+        result = CTC_ERR_LINK_RECV_FAILED;
+    }
+    CTC_EXCEPTION (err_sock_recv_label)
+    {
+        /* CTCN_RESULT_EOF as is */
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : length of the frame whose header is at rbuf, rbuf is
+ *               made to hold it
+ *
+ */
+static int ctcn_link_get_frame_len (CTCN_LINK *link, unsigned int *frame_len)
+{
+    int data_len;
+
+    /* wire order, as ctcn_link_read_four_byte_number does */
+    ctcn_assign_number_four ((unsigned char *)link->rbuf + CTCN_HDR_DATA_LEN_OFFSET,
+                             (unsigned char *)&data_len);
+
+    CTC_COND_EXCEPTION (data_len < 0 || 
+                        data_len > CTCN_LINK_FRAME_SIZE_MAX - CTCP_HDR_LEN,
+                        err_frame_too_large_label);
+
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_rbuf (link, CTCP_HDR_LEN + data_len),
+                        err_frame_too_large_label);
+
+    *frame_len = CTCP_HDR_LEN + data_len;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_frame_too_large_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern int ctcn_link_poll_socket (CTCN_LINK *link, 
+                                  unsigned int timeout_msec, 
+                                  BOOL *is_timeout)
+{
+    int result = CTC_SUCCESS;
+
+    *is_timeout = CTC_FALSE;
+
+    result = ctcn_sock_poll (&(link->sock), POLLIN, timeout_msec);
+
+    switch (result)
+    {
+        case CTC_SUCCESS:
+            break;
+
+        case CTCN_RESULT_ETIMEDOUT:
+        case CTCN_RESULT_EINTR:
+
+            *is_timeout = CTC_TRUE;
+            break;
+
+        default:
+
+            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_poll_label);
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION(err_sock_poll_label)
+    {
+        /* select socket error */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern int ctcn_link_poll_sockets (CTCN_LINK **link,
+                                   int link_cnt,
+                                   unsigned int timeout_msec, 
+                                   int *ready_idx,
+                                   BOOL *is_timeout)
+{
+    int i;
+    int ret;
+    struct pollfd poll_fd[CTCN_POLL_LINK_MAX];
+
+    assert (link_cnt > 0 && link_cnt <= CTCN_POLL_LINK_MAX);
+
+    *is_timeout = CTC_FALSE;
+    *ready_idx = -1;
+
+    for (i = 0; i < link_cnt; i++)
+    {
+        poll_fd[i].fd = link[i]->sock.handle;
+        poll_fd[i].events = POLLIN;
+        poll_fd[i].revents = 0;
+    }
+
+    ret = poll (poll_fd, 
+                link_cnt, 
+                timeout_msec == CTCN_RECV_TIMEOUT_MAX ? -1 : (int)timeout_msec);
+
+    if (ret == -1)
+    {
+        CTC_COND_EXCEPTION (errno != EINTR, err_sock_poll_label);
+
+        *is_timeout = CTC_TRUE;
+
+        return CTC_SUCCESS;
+    }
+
+    for (i = 0; i < link_cnt; i++)
+    {
+        if (poll_fd[i].revents != 0)
+        {
+            *ready_idx = i;
+
+            return CTC_SUCCESS;
+        }
+    }
+
+    *is_timeout = CTC_TRUE;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_sock_poll_label)
+    {
+        /* poll socket error */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern int ctcn_link_recv_socket (CTCN_LINK *link, 
+                                  void *buf, 
+                                  int buf_size, 
+                                  int *recv_size) 
+{
+    int result = CTC_SUCCESS;
+
+    result = ctcn_sock_recv (&(link->sock), buf, buf_size, recv_size, 0);
+
+    switch (result)
+    {
+        case CTC_SUCCESS:
+            break;
+
+        case CTCN_RESULT_EINTR:
+            break;
+
+        default:
+            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_recv_label);
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION(err_sock_recv_label)
+    {
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern BOOL ctcn_sock_get_block_mode (CTC_SOCK *sock)
+{
+    return sock->block_mode;
+}
+
+
+extern int ctcn_link_send (CTCN_LINK *link)
+{
+    int send_len = 0;
+    int iov_cnt;
+    int flag = 0;
+    int zc_call_cnt = 0;
+    int result = CTC_SUCCESS;
+    CTCN_LINK_ZC_FRAME *zc_frame = NULL;
+
+    if (link->ring != NULL)
+    {
+        /* referenced bytes are copied, holds are released below */
+        CTC_TEST_EXCEPTION (ctcn_link_send_ring (link), err_sock_send_label);
+    }
+    else if (link->is_send_queued == CTC_TRUE)
+    {
+        /* buffers and holds go with the queued frame */
+        CTC_TEST_EXCEPTION (ctcn_link_send_queued (link, NULL, 0), 
+                            err_sock_send_label);
+    }
+    else if (link->ref_cnt == 0)
+    {
+        CTC_TEST_EXCEPTION (ctcn_sock_send (&(link->sock), 
+                                            link->wbuf, 
+                                            link->wbuf_pos, 
+                                            &send_len, 
+                                            0),
+                            err_sock_send_label);
+    }
+    else
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_build_iov (link, &iov_cnt),
+                            err_sock_send_label);
+
+        if (link->is_zerocopy == CTC_TRUE &&
+            link->wbuf_ref_len >= CTCN_LINK_ZEROCOPY_MIN_LEN)
+        {
+            /* copied as usual when it cannot be kept */
+            zc_frame = ctcn_link_zc_frame_alloc (link);
+
+            if (zc_frame != NULL)
+            {
+                flag = CTCN_MSG_ZEROCOPY;
+            }
+        }
+
+        result = ctcn_sock_sendv (&(link->sock), 
+                                  link->iov, 
+                                  iov_cnt, 
+                                  flag, 
+                                  &zc_call_cnt);
+
+        if (zc_frame != NULL)
+        {
+            /* even a failed frame may be partly pinned */
+            ctcn_link_zc_frame_park (link, zc_frame, zc_call_cnt);
+        }
+
+        CTC_TEST_EXCEPTION (result, err_sock_send_label);
+    }
+
+    ctcn_link_release_holds (link->hold, link->hold_cnt);
+    link->hold_cnt = 0;
+    link->ref_cnt = 0;
+    link->wbuf_ref_len = 0;
+
+    link->next_seq_no++;
+
+    if (link->next_seq_no == 0xffffffff)
+    {
+        link->next_seq_no = 0;
+    }
+
+    link->wbuf_pos = 0;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_sock_send_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : frame in wbuf goes with fds attached to its first byte,
+ *               the peer takes them by the read that gets that byte
+ *
+ */
+extern int ctcn_link_send_fds (CTCN_LINK *link, int *fds, int fd_cnt)
+{
+    ssize_t sent;
+    struct msghdr msg;
+    struct iovec iov;
+    struct cmsghdr *cmsg;
+    union
+    {
+        char buf[CMSG_SPACE (sizeof (int) * CTCN_LINK_SEND_FD_MAX)];
+        struct cmsghdr align;
+    } ctrl;
+
+    CTC_COND_EXCEPTION (fd_cnt <= 0 || fd_cnt > CTCN_LINK_SEND_FD_MAX,
+                        err_invalid_fd_cnt_label);
+    CTC_COND_EXCEPTION (link->ref_cnt != 0 || link->wbuf_pos == 0,
+                        err_invalid_frame_label);
+
+    if (link->is_send_queued == CTC_TRUE)
+    {
+        /* written by the reactor as the socket takes it */
+        CTC_TEST_EXCEPTION (ctcn_link_send_queued (link, fds, fd_cnt),
+                            err_sock_send_label);
+    }
+    else
+    {
+        memset (&ctrl, 0, sizeof (ctrl));
+
+        iov.iov_base = link->wbuf;
+        iov.iov_len = link->wbuf_pos;
+
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = ctrl.buf;
+        msg.msg_controllen = CMSG_SPACE (sizeof (int) * fd_cnt);
+
+        cmsg = CMSG_FIRSTHDR (&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN (sizeof (int) * fd_cnt);
+        memcpy (CMSG_DATA (cmsg), fds, sizeof (int) * fd_cnt);
+
+        while (iov.iov_len > 0)
+        {
+            sent = sendmsg (link->sock.handle, &msg, 0);
+
+            if (sent == -1)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                {
+                    CTC_TEST_EXCEPTION (ctcn_sock_poll (&(link->sock), 
+                                                        POLLOUT, 
+                                                        CTCN_SEND_WAIT_MSEC),
+                                        err_sock_send_label);
+                    continue;
+                }
+
+                CTC_COND_EXCEPTION (CTC_TRUE, err_sock_send_label);
+            }
+
+            /* fds went with the first part */
+            msg.msg_control = NULL;
+            msg.msg_controllen = 0;
+
+            iov.iov_base = (char *)iov.iov_base + sent;
+            iov.iov_len -= sent;
+        }
+    }
+
+    link->next_seq_no++;
+
+    if (link->next_seq_no == 0xffffffff)
+    {
+        link->next_seq_no = 0;
+    }
+
+    link->wbuf_pos = 0;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_fd_cnt_label)
+    CTC_EXCEPTION (err_invalid_frame_label)
+    CTC_EXCEPTION (err_sock_send_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern BOOL ctcn_link_is_unix (CTCN_LINK *link)
+{
+    struct sockaddr_storage addr;
+    int addr_len = sizeof (addr);
+
+    if (ctcn_sock_get_name (&(link->sock), 
+                            (ctc_sock_addr_t *)&addr, 
+                            &addr_len) != CTC_SUCCESS)
+    {
+        return CTC_FALSE;
+    }
+
+    return addr.ss_family == AF_UNIX ? CTC_TRUE : CTC_FALSE;
+}
+
+
+/*
+ * Description : frames sent on link are queued from now on and written
+ *               without blocking, link must be watched by the reactor.
+ *               0 goes back to blocking sends and drops what is queued.
+ *
+ */
+extern int ctcn_link_set_send_queue (CTCN_LINK *link, 
+                                     unsigned long max_bytes)
+{
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    if (max_bytes == 0)
+    {
+        ctcn_link_drop_out_frames (link);
+
+        link->is_send_queued = CTC_FALSE;
+    }
+    else
+    {
+        link->is_send_queued = CTC_TRUE;
+        link->out_bytes_max = max_bytes;
+        link->out_error = CTC_SUCCESS;
+    }
+
+    link->is_out_blocked = CTC_FALSE;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return CTC_SUCCESS;
+}
+
+
+/*
+ * Description : drain_func (drain_arg) is called on the reactor thread
+ *               once a queue found full has drained to half, or broke
+ *
+ */
+extern void ctcn_link_set_drain_func (CTCN_LINK *link,
+                                      CTCN_LINK_DRAIN_FUNC drain_func,
+                                      void *drain_arg)
+{
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    link->drain_func = drain_func;
+    link->drain_arg = drain_arg;
+    link->is_out_blocked = CTC_FALSE;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+}
+
+
+/*
+ * Description : writer should stop making frames when CTC_TRUE, it is 
+ *               told by the drain function when to go on. a broken 
+ *               link is not full, the next send fails.
+ *
+ */
+extern BOOL ctcn_link_is_send_queue_full (CTCN_LINK *link)
+{
+    BOOL is_full = CTC_FALSE;
+
+    if (link->ring != NULL)
+    {
+        return ctcn_link_is_ring_full (link);
+    }
+
+    if (link->is_send_queued != CTC_TRUE)
+    {
+        return CTC_FALSE;
+    }
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    if (link->out_error == CTC_SUCCESS && 
+        link->out_bytes >= link->out_bytes_max)
+    {
+        link->is_out_blocked = CTC_TRUE;
+        is_full = CTC_TRUE;
+    }
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return is_full;
+}
+
+
+/*
+ * Description : writes queued frames as far as the socket takes them,
+ *               called by the reactor when link is writable
+ *
+ */
+extern int ctcn_link_flush (CTCN_LINK *link)
+{
+    int result = CTC_SUCCESS;
+    CTCN_LINK_DRAIN_FUNC drain_func = NULL;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    if (link->ring != NULL)
+    {
+        result = ctcn_link_flush_ring (link);
+
+        (void)pthread_mutex_unlock (&link->out_lock);
+
+        return result;
+    }
+
+    if (link->out_error == CTC_SUCCESS)
+    {
+        ctcn_link_reap_zerocopy (link, 0);
+
+        result = ctcn_link_flush_nolock (link);
+
+        if (result == CTC_SUCCESS && link->out_head != NULL)
+        {
+            result = ctcn_reactor_want_write (link);
+        }
+
+        if (result != CTC_SUCCESS)
+        {
+            link->out_error = result;
+        }
+    }
+    else
+    {
+        result = link->out_error;
+    }
+
+    if (link->out_head == NULL || link->out_error != CTC_SUCCESS)
+    {
+        /* no more writes, a link with frames stops reporting writable */
+        ctcn_reactor_done_write (link);
+    }
+
+    if (link->is_out_blocked == CTC_TRUE &&
+        (link->out_error != CTC_SUCCESS || 
+         link->out_bytes <= link->out_bytes_max / 2))
+    {
+        link->is_out_blocked = CTC_FALSE;
+        drain_func = link->drain_func;
+    }
+
+    /* under out_lock, so it is not called once cleared */
+    if (drain_func != NULL)
+    {
+        drain_func (link->drain_arg);
+    }
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return result;
+}
+
+
+/*
+ * Description : frames sent on link go to a new ring of data_size from
+ *               now on, the ring is owned by link. nothing may be left
+ *               in the send queue.
+ *
+ */
+extern int ctcn_link_attach_ring (CTCN_LINK *link, 
+                                  unsigned int data_size,
+                                  CTCN_RING **ring)
+{
+    int result;
+    CTCN_RING *new_ring = NULL;
+
+    CTC_COND_EXCEPTION (link->ring != NULL, err_already_attached_label);
+
+    result = ctcn_ring_create (data_size, &new_ring);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_ring_create_label);
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    CTC_COND_EXCEPTION (link->out_head != NULL, err_frames_queued_label);
+
+    /* without the reactor, a full ring only blocks the writer */
+    if (link->reactor_entry != NULL)
+    {
+        (void)ctcn_reactor_watch_room (link, new_ring->room_fd);
+    }
+
+    link->ring = new_ring;
+    link->is_out_blocked = CTC_FALSE;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    *ring = new_ring;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_already_attached_label)
+    {
+        result = CTC_ERR_INVALID_JOB_STATUS_FAILED;
+    }
+    CTC_EXCEPTION (err_ring_create_label)
+    {
+        /* error info set from sub-function */
+    }
+    CTC_EXCEPTION (err_frames_queued_label)
+    {
+        result = CTC_ERR_INVALID_JOB_STATUS_FAILED;
+
+        (void)pthread_mutex_unlock (&link->out_lock);
+
+        ctcn_ring_destroy (new_ring);
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : frames go to the socket again, the consumer finds the
+ *               ring closed. not while a writer sends.
+ *
+ */
+extern void ctcn_link_detach_ring (CTCN_LINK *link)
+{
+    CTCN_RING *ring;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    ring = link->ring;
+    link->ring = NULL;
+
+    if (ring != NULL && link->reactor_entry != NULL)
+    {
+        (void)ctcn_reactor_watch_room (link, -1);
+    }
+
+    link->is_out_blocked = CTC_FALSE;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    ctcn_ring_destroy (ring);
+}
+
+
+/*
+ * Description : frame is copied into the ring, waiting for the consumer
+ *               to make room when it does not fit
+ *
+ */
+static int ctcn_link_send_ring (CTCN_LINK *link)
+{
+    int result;
+    int iov_cnt;
+    BOOL is_out_blocked;
+    unsigned int frame_len = CTCN_LINK_FRAME_LEN (link);
+
+    CTC_COND_EXCEPTION (link->out_error != CTC_SUCCESS, err_link_broken_label);
+
+    CTC_TEST_EXCEPTION (ctcn_link_build_iov (link, &iov_cnt),
+                        err_link_broken_label);
+
+    while ((result = ctcn_ring_write (link->ring, 
+                                      link->iov, 
+                                      iov_cnt, 
+                                      frame_len)) == CTCN_RESULT_EAGAIN)
+    {
+        result = ctcn_ring_wait_room (link->ring, 
+                                      frame_len, 
+                                      CTCN_SEND_WAIT_MSEC);
+
+        (void)pthread_mutex_lock (&link->out_lock);
+
+        is_out_blocked = link->is_out_blocked;
+
+        if (result != CTC_SUCCESS)
+        {
+            link->out_error = result;
+        }
+
+        (void)pthread_mutex_unlock (&link->out_lock);
+
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_link_broken_label);
+
+        if (is_out_blocked == CTC_TRUE)
+        {
+            /* the reactor waits for the same room */
+            ctcn_ring_post_room_event (link->ring);
+        }
+    }
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_link_broken_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_link_broken_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : a ring lacking room for the largest frame is full, the
+ *               reactor is told to watch for room unless it is there 
+ *               by now
+ *
+ */
+static BOOL ctcn_link_is_ring_full (CTCN_LINK *link)
+{
+    BOOL is_full = CTC_FALSE;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    if (link->out_error == CTC_SUCCESS &&
+        ctcn_ring_has_room (link->ring, link->max_frame_size) != CTC_TRUE)
+    {
+        ctcn_ring_want_room (link->ring);
+
+        if (ctcn_ring_has_room (link->ring, link->max_frame_size) != CTC_TRUE &&
+            ctcn_reactor_want_room (link) == CTC_SUCCESS)
+        {
+            link->is_out_blocked = CTC_TRUE;
+            is_full = CTC_TRUE;
+        }
+    }
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return is_full;
+}
+
+
+/*
+ * Description : room made by the consumer, the writer goes on once
+ *               half of the ring is free. out_lock is held.
+ *
+ */
+static int ctcn_link_flush_ring (CTCN_LINK *link)
+{
+    BOOL is_drained = CTC_FALSE;
+
+    ctcn_ring_clear_room_event (link->ring);
+
+    if (link->is_out_blocked != CTC_TRUE)
+    {
+        return link->out_error;
+    }
+
+    if (link->out_error != CTC_SUCCESS || 
+        ctcn_link_is_ring_drained (link) == CTC_TRUE)
+    {
+        is_drained = CTC_TRUE;
+    }
+    else
+    {
+        ctcn_ring_want_room (link->ring);
+
+        if (ctcn_link_is_ring_drained (link) == CTC_TRUE ||
+            ctcn_reactor_want_room (link) != CTC_SUCCESS)
+        {
+            is_drained = CTC_TRUE;
+        }
+    }
+
+    if (is_drained == CTC_TRUE)
+    {
+        link->is_out_blocked = CTC_FALSE;
+
+        if (link->drain_func != NULL)
+        {
+            link->drain_func (link->drain_arg);
+        }
+    }
+
+    return link->out_error;
+}
+
+
+static BOOL ctcn_link_is_ring_drained (CTCN_LINK *link)
+{
+    if (ctcn_ring_get_free (link->ring) >= link->ring->data_size / 2 &&
+        ctcn_ring_has_room (link->ring, link->max_frame_size) == CTC_TRUE)
+    {
+        return CTC_TRUE;
+    }
+
+    return CTC_FALSE;
+}
+
+
+/*
+ * Description : frame being written goes to the send queue, link takes
+ *               a spare buffer. the queue is written right away when it 
+ *               was empty, otherwise the reactor is already waiting for 
+ *               room. fds are duplicated, the caller keeps its own.
+ *
+ */
+static int ctcn_link_send_queued (CTCN_LINK *link, int *fds, int fd_cnt)
+{
+    int i;
+    int dup_cnt = 0;
+    int result;
+    int fd[CTCN_LINK_SEND_FD_MAX];
+    CTCN_LINK_OUT_FRAME *frame = NULL;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    CTC_COND_EXCEPTION (link->out_error != CTC_SUCCESS, err_link_broken_label);
+
+    for (dup_cnt = 0; dup_cnt < fd_cnt; dup_cnt++)
+    {
+        fd[dup_cnt] = dup (fds[dup_cnt]);
+        CTC_COND_EXCEPTION (fd[dup_cnt] == -1, err_dup_failed_label);
+    }
+
+    CTC_TEST_EXCEPTION (ctcn_link_out_frame_make (link, &frame),
+                        err_alloc_failed_label);
+
+    for (i = 0; i < fd_cnt; i++)
+    {
+        frame->fd[i] = fd[i];
+    }
+
+    frame->fd_cnt = fd_cnt;
+
+    if (link->out_tail == NULL)
+    {
+        link->out_head = frame;
+    }
+    else
+    {
+        link->out_tail->next = frame;
+    }
+
+    link->out_tail = frame;
+    link->out_frame_cnt++;
+    link->out_bytes += frame->len;
+
+    if (link->out_head == frame)
+    {
+        ctcn_link_reap_zerocopy (link, 0);
+
+        result = ctcn_link_flush_nolock (link);
+
+        if (result == CTC_SUCCESS && link->out_head != NULL)
+        {
+            result = ctcn_reactor_want_write (link);
+        }
+
+        if (result != CTC_SUCCESS)
+        {
+            link->out_error = result;
+        }
+    }
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_link_broken_label)
+    CTC_EXCEPTION (err_dup_failed_label)
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        for (i = 0; i < dup_cnt; i++)
+        {
+            (void)close (fd[i]);
+        }
+    }
+    EXCEPTION_END;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return CTC_FAILURE;
+}
+
+
+static void ctcn_link_out_frame_close_fds (CTCN_LINK_OUT_FRAME *frame)
+{
+    int i;
+
+    for (i = 0; i < frame->fd_cnt; i++)
+    {
+        (void)close (frame->fd[i]);
+    }
+
+    frame->fd_cnt = 0;
+}
+
+
+/*
+ * Description : takes wbuf, refs and holds of link into a new frame
+ *
+ */
+static int ctcn_link_out_frame_make (CTCN_LINK *link, 
+                                     CTCN_LINK_OUT_FRAME **out_frame)
+{
+    char *spare_wbuf;
+    unsigned int spare_wbuf_size;
+    CTCN_LINK_OUT_FRAME *frame;
+
+    frame = (CTCN_LINK_OUT_FRAME *)malloc (sizeof (CTCN_LINK_OUT_FRAME) +
+                                           sizeof (CTCN_LINK_REF) * link->ref_cnt);
+    CTC_COND_EXCEPTION (frame == NULL, err_alloc_failed_label);
+
+    spare_wbuf = ctcn_buf_alloc (link->wbuf_size, &spare_wbuf_size);
+    CTC_COND_EXCEPTION (spare_wbuf == NULL, err_alloc_failed_label);
+
+    frame->len = CTCN_LINK_FRAME_LEN (link);
+    frame->sent = 0;
+    frame->wbuf_pos = link->wbuf_pos;
+    frame->wbuf_size = link->wbuf_size;
+    frame->wbuf = link->wbuf;
+    frame->ref_cnt = link->ref_cnt;
+    frame->ref = (CTCN_LINK_REF *)(frame + 1);
+    frame->hold_cnt = link->hold_cnt;
+    frame->hold = link->hold;
+    frame->zc_call_cnt = 0;
+    frame->zc_frame = NULL;
+    frame->fd_cnt = 0;
+    frame->next = NULL;
+
+    if (link->ref_cnt > 0)
+    {
+        memcpy (frame->ref, link->ref, sizeof (CTCN_LINK_REF) * link->ref_cnt);
+    }
+
+    link->wbuf = spare_wbuf;
+    link->wbuf_size = spare_wbuf_size;
+    link->hold = NULL;
+    link->hold_cnt = 0;
+    link->hold_max = 0;
+
+    *out_frame = frame;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        free (frame);
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : writes the unsent part of frame until the socket is 
+ *               full, frame->sent tells how far it got. fds of frame go
+ *               with the first call that takes any byte.
+ *
+ */
+static int ctcn_link_out_frame_write (CTCN_LINK *link, 
+                                      CTCN_LINK_OUT_FRAME *frame)
+{
+    int iov_cnt;
+    int flag = 0;
+    ssize_t sent;
+    struct msghdr msg;
+    struct iovec *iov;
+    struct cmsghdr *cmsg;
+    union
+    {
+        char buf[CMSG_SPACE (sizeof (int) * CTCN_LINK_SEND_FD_MAX)];
+        struct cmsghdr align;
+    } ctrl;
+
+    CTC_TEST_EXCEPTION (ctcn_link_build_out_iov (link, frame, &iov_cnt),
+                        err_alloc_failed_label);
+
+    if (frame->fd_cnt > 0)
+    {
+        /* a small frame, copied */
+    }
+    else if (link->is_zerocopy == CTC_TRUE &&
+        frame->len - frame->wbuf_pos >= CTCN_LINK_ZEROCOPY_MIN_LEN &&
+        link->zc_pending_cnt < CTCN_LINK_ZEROCOPY_PENDING_MAX)
+    {
+        if (frame->zc_frame == NULL)
+        {
+            /* without it the frame could not be kept, it is copied */
+            frame->zc_frame = (CTCN_LINK_ZC_FRAME *)malloc (sizeof (CTCN_LINK_ZC_FRAME));
+        }
+
+        if (frame->zc_frame != NULL)
+        {
+            flag = CTCN_MSG_ZEROCOPY;
+        }
+    }
+
+    iov = link->iov;
+
+    while (iov_cnt > 0)
+    {
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_cnt < CTCN_IOV_MAX ? iov_cnt : CTCN_IOV_MAX;
+
+        if (frame->fd_cnt > 0)
+        {
+            memset (&ctrl, 0, sizeof (ctrl));
+
+            msg.msg_control = ctrl.buf;
+            msg.msg_controllen = CMSG_SPACE (sizeof (int) * frame->fd_cnt);
+
+            cmsg = CMSG_FIRSTHDR (&msg);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN (sizeof (int) * frame->fd_cnt);
+            memcpy (CMSG_DATA (cmsg), frame->fd, sizeof (int) * frame->fd_cnt);
+        }
+
+        sent = sendmsg (link->sock.handle, &msg, flag | MSG_DONTWAIT);
+
+        if (sent == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            if (errno == ENOBUFS && flag != 0)
+            {
+                flag = 0;
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                /* the rest goes on EPOLLOUT */
                 break;
             }
+
+            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_send_label);
+        }
+
+        if (flag != 0)
+        {
+            frame->zc_call_cnt++;
+            link->zc_next_id++;
+        }
+
+        /* the peer has its own copies now */
+        ctcn_link_out_frame_close_fds (frame);
+
+        frame->sent += sent;
+
+        while (iov_cnt > 0 && (size_t)sent >= iov->iov_len)
+        {
+            sent -= iov->iov_len;
+            iov++;
+            iov_cnt--;
+        }
+
+        if (sent > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    CTC_EXCEPTION (err_sock_send_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : vectors of frame in frame order, starting after the 
+ *               bytes already sent
+ *
+ */
+static int ctcn_link_build_out_iov (CTCN_LINK *link, 
+                                    CTCN_LINK_OUT_FRAME *frame,
+                                    int *iov_cnt)
+{
+    int i;
+    int cnt = 0;
+    int iov_max;
+    unsigned int wbuf_from = 0;
+    unsigned int skip = frame->sent;
+    unsigned int len;
+    struct iovec *new_iov;
+
+    iov_max = frame->ref_cnt * 2 + 1;
+
+    if (iov_max > link->iov_max)
+    {
+        new_iov = (struct iovec *)realloc (link->iov, 
+                                           sizeof (struct iovec) * iov_max);
+        CTC_COND_EXCEPTION (new_iov == NULL, err_alloc_failed_label);
+
+        link->iov = new_iov;
+        link->iov_max = iov_max;
+    }
+
+    for (i = 0; i <= frame->ref_cnt; i++)
+    {
+        /* wbuf piece before ref i, or the tail of wbuf */
+        len = (i < frame->ref_cnt ? frame->ref[i].pos : frame->wbuf_pos) - wbuf_from;
+
+        if (skip >= len)
+        {
+            skip -= len;
         }
         else
         {
-            /* do nothing */
+            link->iov[cnt].iov_base = frame->wbuf + wbuf_from + skip;
+            link->iov[cnt].iov_len = len - skip;
+            cnt++;
+            skip = 0;
+        }
+
+        if (i == frame->ref_cnt)
+        {
+            break;
+        }
+
+        wbuf_from = frame->ref[i].pos;
+
+        if (skip >= frame->ref[i].len)
+        {
+            skip -= frame->ref[i].len;
+        }
+        else
+        {
+            link->iov[cnt].iov_base = (void *)(frame->ref[i].ptr + skip);
+            link->iov[cnt].iov_len = frame->ref[i].len - skip;
+            cnt++;
+            skip = 0;
         }
     }
 
-    if (i == timeout)
+    *iov_cnt = cnt;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : frame is all sent, kept on its zero copy record when 
+ *               the kernel may still read from it. the record is taken
+ *               before the first zero copy call, keeping never fails.
+ *
+ */
+static void ctcn_link_out_frame_done (CTCN_LINK *link, 
+                                      CTCN_LINK_OUT_FRAME *frame)
+{
+    CTCN_LINK_ZC_FRAME *zc_frame = frame->zc_frame;
+
+    if (frame->zc_call_cnt > 0)
     {
-        timeout_flag = CTC_TRUE;
+        /* the last call on the socket was the last one of frame */
+        zc_frame->last_id = link->zc_next_id - 1;
+        zc_frame->wbuf = frame->wbuf;
+        zc_frame->wbuf_size = frame->wbuf_size;
+        zc_frame->hold = frame->hold;
+        zc_frame->hold_cnt = frame->hold_cnt;
+        zc_frame->next = NULL;
+
+        if (link->zc_pending_tail == NULL)
+        {
+            link->zc_pending_head = zc_frame;
+        }
+        else
+        {
+            link->zc_pending_tail->next = zc_frame;
+        }
+
+        link->zc_pending_tail = zc_frame;
+        link->zc_pending_cnt++;
     }
     else
     {
-        /* nothing to do */ 
+        ctcn_link_release_holds (frame->hold, frame->hold_cnt);
+        free (frame->hold);
+        ctcn_buf_free (frame->wbuf, frame->wbuf_size);
+        free (zc_frame);
     }
 
-    link->rbuf_pos = CTCP_HDR_LEN;
-    link->read_data_size = offset;
+    free (frame);
+}
+
+
+static int ctcn_link_flush_nolock (CTCN_LINK *link)
+{
+    unsigned int sent;
+    CTCN_LINK_OUT_FRAME *frame;
+
+    while ((frame = link->out_head) != NULL)
+    {
+        sent = frame->sent;
+
+        CTC_TEST_EXCEPTION (ctcn_link_out_frame_write (link, frame),
+                            err_frame_write_label);
+
+        link->out_bytes -= frame->sent - sent;
+
+        if (frame->sent < frame->len)
+        {
+            break;
+        }
+
+        link->out_head = frame->next;
+
+        if (link->out_head == NULL)
+        {
+            link->out_tail = NULL;
+        }
+
+        link->out_frame_cnt--;
+
+        ctcn_link_out_frame_done (link, frame);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_frame_write_label)
+    {
+        link->out_bytes -= frame->sent - sent;
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
 
-    *is_timeout = timeout_flag;
+
+/*
+ * Description : frames never sent are released, one partly sent with 
+ *               zero copy waits for completion as a sent one does since
+ *               the kernel may read it
+ *
+ */
+static void ctcn_link_drop_out_frames (CTCN_LINK *link)
+{
+    CTCN_LINK_OUT_FRAME *frame;
+
+    while ((frame = link->out_head) != NULL)
+    {
+        link->out_head = frame->next;
+
+        if (frame->zc_call_cnt > 0)
+        {
+            /* only the head is partly sent, the last call was its own */
+            ctcn_link_out_frame_done (link, frame);
+            continue;
+        }
+
+        ctcn_link_out_frame_close_fds (frame);
+        ctcn_link_release_holds (frame->hold, frame->hold_cnt);
+        free (frame->hold);
+        ctcn_buf_free (frame->wbuf, frame->wbuf_size);
+        free (frame->zc_frame);
+        free (frame);
+    }
+
+    link->out_tail = NULL;
+    link->out_frame_cnt = 0;
+    link->out_bytes = 0;
+}
+
+static int ctcn_sock_sendv (CTC_SOCK *sock,
+                            struct iovec *iov,
+                            int iov_cnt,
+                            int flag,
+                            int *zc_call_cnt)
+{
+    ssize_t sent;
+    struct msghdr msg;
+
+    *zc_call_cnt = 0;
+
+    while (iov_cnt > 0)
+    {
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iov_cnt < CTCN_IOV_MAX ? iov_cnt : CTCN_IOV_MAX;
+
+        sent = sendmsg (sock->handle, &msg, flag);
+
+        if (sent == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            /* out of optmem for notifications, copy the rest */
+            if (errno == ENOBUFS && flag != 0)
+            {
+                flag = 0;
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                CTC_TEST_EXCEPTION (ctcn_sock_poll (sock, 
+                                                    POLLOUT, 
+                                                    CTCN_SEND_WAIT_MSEC),
+                                    err_sock_send_label);
+                continue;
+            }
+
+            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_send_label);
+        }
+
+        if (flag != 0)
+        {
+            /* each one is notified by its own id */
+            (*zc_call_cnt)++;
+        }
+
+        /* the rest may start in the middle of a vector */
+        while (iov_cnt > 0 && (size_t)sent >= iov->iov_len)
+        {
+            sent -= iov->iov_len;
+            iov++;
+            iov_cnt--;
+        }
+
+        if (sent > 0)
+        {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
 
     return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_sock_poll_label)
-    {
-        /* ERROR: epoll retry? */
+    CTC_EXCEPTION (err_sock_send_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : vectors of wbuf pieces and refs in frame order
+ *
+ */
+static int ctcn_link_build_iov (CTCN_LINK *link, int *iov_cnt)
+{
+    int i;
+    int cnt = 0;
+    int iov_max;
+    unsigned int wbuf_from = 0;
+    struct iovec *new_iov;
+
+    iov_max = link->ref_cnt * 2 + 1;
+
+    if (iov_max > link->iov_max)
+    {
+        new_iov = (struct iovec *)realloc (link->iov, 
+                                           sizeof (struct iovec) * iov_max);
+        CTC_COND_EXCEPTION (new_iov == NULL, err_alloc_failed_label);
+
+        link->iov = new_iov;
+        link->iov_max = iov_max;
+    }
+
+    for (i = 0; i < link->ref_cnt; i++)
+    {
+        if (link->ref[i].pos > wbuf_from)
+        {
+            link->iov[cnt].iov_base = link->wbuf + wbuf_from;
+            link->iov[cnt].iov_len = link->ref[i].pos - wbuf_from;
+            cnt++;
+
+            wbuf_from = link->ref[i].pos;
+        }
+
+        link->iov[cnt].iov_base = (void *)link->ref[i].ptr;
+        link->iov[cnt].iov_len = link->ref[i].len;
+        cnt++;
     }
-    CTC_EXCEPTION (err_link_recv_socket_label)
+
+    if (link->wbuf_pos > wbuf_from)
     {
-        result = CTC_ERR_LINK_RECV_FAILED;
+        link->iov[cnt].iov_base = link->wbuf + wbuf_from;
+        link->iov[cnt].iov_len = link->wbuf_pos - wbuf_from;
+        cnt++;
     }
+
+    *iov_cnt = cnt;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
     EXCEPTION_END;
 
-    return result;
+    return CTC_FAILURE;
 }
 
 
-extern int ctcn_link_poll_socket (CTCN_LINK *link, 
-                                  unsigned int timeout_msec, 
-                                  BOOL *is_timeout)
+static void ctcn_link_release_holds (CTCN_LINK_HOLD *hold, int hold_cnt)
 {
-    int result = CTC_SUCCESS;
+    int i;
 
-    *is_timeout = CTC_FALSE;
+    for (i = 0; i < hold_cnt; i++)
+    {
+        hold[i].release (hold[i].owner);
+    }
+}
 
-    result = ctcn_sock_poll (&(link->sock), EPOLLIN, timeout_msec);
 
-    switch (result)
-    {
-        case CTC_SUCCESS:
-            break;
+/*
+ * Description : NULL when zero copy is not worth keeping the frame for,
+ *               the frame is sent by copy then
+ *
+ */
+static CTCN_LINK_ZC_FRAME *ctcn_link_zc_frame_alloc (CTCN_LINK *link)
+{
+    CTCN_LINK_ZC_FRAME *frame;
 
-        case CTCN_RESULT_ETIMEDOUT:
-        case CTCN_RESULT_EINTR:
+    /* completions of earlier frames, waits when too many are pending */
+    ctcn_link_reap_zerocopy (link, 0);
 
-            *is_timeout = CTC_TRUE;
-            break;
+    if (link->zc_pending_cnt >= CTCN_LINK_ZEROCOPY_PENDING_MAX)
+    {
+        ctcn_link_reap_zerocopy (link, CTCN_ZEROCOPY_WAIT_MSEC);
 
-        default:
+        if (link->zc_pending_cnt >= CTCN_LINK_ZEROCOPY_PENDING_MAX)
+        {
+            return NULL;
+        }
+    }
 
-            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_poll_label);
-            break;
+    frame = (CTCN_LINK_ZC_FRAME *)malloc (sizeof (CTCN_LINK_ZC_FRAME));
+
+    if (frame == NULL)
+    {
+        return NULL;
     }
 
-    return CTC_SUCCESS;
+    /* replaces wbuf, which stays with the frame */
+    frame->wbuf = ctcn_buf_alloc (link->wbuf_size, &frame->wbuf_size);
 
-    CTC_EXCEPTION(err_sock_poll_label)
+    if (frame->wbuf == NULL)
     {
-        /* select socket error */
+        free (frame);
+        return NULL;
     }
-    EXCEPTION_END;
 
-    return CTC_FAILURE;
+    return frame;
 }
 
 
-extern int ctcn_link_recv_socket (CTCN_LINK *link, 
-                                  void *buf, 
-                                  int buf_size, 
-                                  int *recv_size) 
+/*
+ * Description : frame keeps wbuf and holds of link until its last id is
+ *               completed, link continues with the spare buffer
+ *
+ */
+static void ctcn_link_zc_frame_park (CTCN_LINK *link, 
+                                     CTCN_LINK_ZC_FRAME *frame,
+                                     int zc_call_cnt)
 {
-    int result = CTC_SUCCESS;
-
-    result = ctcn_sock_recv (&(link->sock), buf, buf_size, recv_size, 0);
+    char *spare_wbuf = frame->wbuf;
+    unsigned int spare_wbuf_size = frame->wbuf_size;
 
-    switch (result)
+    if (zc_call_cnt == 0)
     {
-        case CTC_SUCCESS:
-            break;
+        /* everything was copied */
+        ctcn_buf_free (frame->wbuf, frame->wbuf_size);
+        free (frame);
+        return;
+    }
 
-        case CTCN_RESULT_EINTR:
-            break;
+    link->zc_next_id += zc_call_cnt;
 
-        default:
-            CTC_COND_EXCEPTION (CTC_TRUE, err_sock_recv_label);
-            break;
-    }
+    frame->last_id = link->zc_next_id - 1;
+    frame->wbuf = link->wbuf;
+    frame->wbuf_size = link->wbuf_size;
+    frame->hold = link->hold;
+    frame->hold_cnt = link->hold_cnt;
+    frame->next = NULL;
 
-    return CTC_SUCCESS;
+    memcpy (spare_wbuf, link->wbuf, link->wbuf_pos);
 
-    CTC_EXCEPTION(err_sock_recv_label)
+    link->wbuf = spare_wbuf;
+    link->wbuf_size = spare_wbuf_size;
+    link->hold = NULL;
+    link->hold_cnt = 0;
+    link->hold_max = 0;
+
+    if (link->zc_pending_tail == NULL)
     {
+        link->zc_pending_head = frame;
+    }
+    else
+    {
+        link->zc_pending_tail->next = frame;
     }
-    EXCEPTION_END;
 
-    return CTC_FAILURE;
+    link->zc_pending_tail = frame;
+    link->zc_pending_cnt++;
 }
 
 
-extern BOOL ctcn_sock_get_block_mode (CTC_SOCK *sock)
+/*
+ * Description : release frames the kernel is done with, waits up to 
+ *               timeout_msec for a notification while any is pending
+ *
+ */
+static void ctcn_link_reap_zerocopy (CTCN_LINK *link, int timeout_msec)
 {
-    return sock->block_mode;
-}
+#ifdef CTCN_HAVE_ZEROCOPY
+    BOOL is_polled = CTC_FALSE;
+    char control[128];
+    struct msghdr msg;
+    struct cmsghdr *cm;
+    struct sock_extended_err *serr;
+    struct pollfd pfd;
+    CTCN_LINK_ZC_FRAME *frame;
+
+    /* a queued frame is parked after its calls, ids may be ahead of it */
+    while (link->zc_pending_head != NULL || link->zc_done_id != link->zc_next_id)
+    {
+        memset (&msg, 0, sizeof (msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof (control);
 
+        if (recvmsg (link->sock.handle, &msg, MSG_ERRQUEUE) == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
 
-extern int ctcn_link_send (CTCN_LINK *link)
-{
-    int send_len = 0;
-    int result = CTC_SUCCESS;
+            if (errno != EAGAIN || timeout_msec == 0 || is_polled == CTC_TRUE)
+            {
+                break;
+            }
 
-    CTC_TEST_EXCEPTION (ctcn_sock_send (&(link->sock), 
-                                        link->wbuf, 
-                                        link->wbuf_pos, 
-                                        &send_len, 
-                                        0),
-                        err_sock_send_label);
+            /* error queue is readable when POLLERR is set */
+            pfd.fd = link->sock.handle;
+            pfd.events = 0;
+            pfd.revents = 0;
 
-    link->next_seq_no++;
+            if (poll (&pfd, 1, timeout_msec) <= 0)
+            {
+                break;
+            }
 
-    if (link->next_seq_no == 0xffffffff)
-    {
-        link->next_seq_no = 0;
-    }
+            is_polled = CTC_TRUE;
+            continue;
+        }
 
-    link->wbuf_pos = 0;
+        is_polled = CTC_FALSE;
 
-    return CTC_SUCCESS;
+        for (cm = CMSG_FIRSTHDR (&msg); cm != NULL; cm = CMSG_NXTHDR (&msg, cm))
+        {
+            serr = (struct sock_extended_err *)CMSG_DATA (cm);
 
-    CTC_EXCEPTION (err_sock_send_label)
-    EXCEPTION_END;
+            if (serr->ee_errno == 0 && 
+                serr->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+            {
+                /* ids ee_info .. ee_data are done, tcp completes in order */
+                link->zc_done_id = serr->ee_data + 1;
+            }
+        }
 
-    return CTC_FAILURE;
+        while ((frame = link->zc_pending_head) != NULL &&
+               (int)(frame->last_id - link->zc_done_id) < 0)
+        {
+            link->zc_pending_head = frame->next;
+
+            if (link->zc_pending_head == NULL)
+            {
+                link->zc_pending_tail = NULL;
+            }
+
+            link->zc_pending_cnt--;
+
+            ctcn_link_release_holds (frame->hold, frame->hold_cnt);
+            free (frame->hold);
+            ctcn_buf_free (frame->wbuf, frame->wbuf_size);
+            free (frame);
+        }
+    }
+#endif
 }
 
 
@@ -995,8 +2975,10 @@ extern int ctcn_link_read_two_byte_number (CTCN_LINK *link, void *dest)
     CTC_COND_EXCEPTION (link->rbuf_pos + 2 > link->read_data_size,
                         err_no_space_in_read_buf);
 
-    *(unsigned char *)dest = link->rbuf[link->rbuf_pos];
-    link->rbuf_pos++;
+    ctcn_assign_number_two ((unsigned char *)link->rbuf + link->rbuf_pos, 
+                            (unsigned char *)dest);
+
+    link->rbuf_pos += 2;
 
     return CTC_SUCCESS;
 
@@ -1032,9 +3014,31 @@ extern int ctcn_link_read_four_byte_number (CTCN_LINK *link, void *dest)
 }
 
 
+extern int ctcn_link_read_eight_byte_number (CTCN_LINK *link, void *dest)
+{
+    CTC_COND_EXCEPTION (link->rbuf_pos + 8 > link->read_data_size,
+                        err_no_space_in_read_buf);
+
+    ctcn_assign_number_eight ((unsigned char *)link->rbuf + link->rbuf_pos, 
+                              (unsigned char *)dest);
+
+    link->rbuf_pos += 8;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_no_space_in_read_buf)
+    {
+        /* ERR_NOT_ENOUGH_DATA_IN_RBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
 extern int ctcn_link_write (CTCN_LINK *link, void *src, unsigned int len)
 {
-    CTC_COND_EXCEPTION (link->wbuf_pos + len > CTCN_LINK_BUF_SIZE,
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, len),
                         err_write_buf_overflow_label);
 
     memcpy (link->wbuf + link->wbuf_pos, src, len);
@@ -1054,7 +3058,7 @@ extern int ctcn_link_write (CTCN_LINK *link, void *src, unsigned int len)
 
 extern int ctcn_link_write_one_byte_number (CTCN_LINK *link, void *src)
 {
-    CTC_COND_EXCEPTION (link->wbuf_pos + 1 > CTCN_LINK_BUF_SIZE,
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, 1),
                         err_write_buf_overflow_label);
 
     link->wbuf[link->wbuf_pos] = *(unsigned char *)src;
@@ -1074,7 +3078,7 @@ extern int ctcn_link_write_one_byte_number (CTCN_LINK *link, void *src)
 
 extern int ctcn_link_write_two_byte_number (CTCN_LINK *link, void *src)
 {
-    CTC_COND_EXCEPTION (link->wbuf_pos + 2 > CTCN_LINK_BUF_SIZE,
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, 2),
                         err_write_buf_overflow_label);
 
     ctcn_assign_number_two ((unsigned char *)src, 
@@ -1096,7 +3100,7 @@ extern int ctcn_link_write_two_byte_number (CTCN_LINK *link, void *src)
 
 extern int ctcn_link_write_four_byte_number (CTCN_LINK *link, void *src)
 {
-    CTC_COND_EXCEPTION (link->wbuf_pos + 4 > CTCN_LINK_BUF_SIZE,
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, 4),
                         err_write_buf_overflow_label);
 
     ctcn_assign_number_four ((unsigned char *)src, 
@@ -1116,9 +3120,31 @@ extern int ctcn_link_write_four_byte_number (CTCN_LINK *link, void *src)
 }
 
 
+extern int ctcn_link_write_eight_byte_number (CTCN_LINK *link, void *src)
+{
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, 8),
+                        err_write_buf_overflow_label);
+
+    ctcn_assign_number_eight ((unsigned char *)src, 
+                              (unsigned char *)(link->wbuf + link->wbuf_pos));
+
+    link->wbuf_pos += 8;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
 extern int ctcn_link_forward_wbuf_pos (CTCN_LINK *link, int size)
 {
-    CTC_COND_EXCEPTION (link->wbuf_pos + size > CTCN_LINK_BUF_SIZE,
+    CTC_TEST_EXCEPTION (ctcn_link_reserve_wbuf (link, size),
                         err_write_buf_overflow_label);
 
     link->wbuf_pos += size;
@@ -1160,6 +3186,161 @@ extern void ctcn_link_move_wbuf_pos (CTCN_LINK *link, int pos)
 }
 
 
+/*
+ * Description : drop the frame from pos on, refs written after it 
+ *               included. owners are released when the whole frame is 
+ *               dropped, otherwise with the frame.
+ *
+ */
+extern void ctcn_link_truncate_wbuf (CTCN_LINK *link, int pos)
+{
+    while (link->ref_cnt > 0 &&
+           (pos == 0 || link->ref[link->ref_cnt - 1].pos > (unsigned int)pos))
+    {
+        link->ref_cnt--;
+        link->wbuf_ref_len -= link->ref[link->ref_cnt].len;
+    }
+
+    if (pos == 0)
+    {
+        ctcn_link_release_holds (link->hold, link->hold_cnt);
+        link->hold_cnt = 0;
+    }
+
+    link->wbuf_pos = pos;
+}
+
+
+/*
+ * Description : frame continues with len bytes at src, they are sent 
+ *               from there and must not change until the frame is sent,
+ *               see ctcn_link_hold
+ *
+ */
+extern int ctcn_link_write_ref (CTCN_LINK *link, 
+                                const void *src, 
+                                unsigned int len)
+{
+    int new_max;
+    CTCN_LINK_REF *last = NULL;
+    CTCN_LINK_REF *new_ref;
+
+    CTC_COND_EXCEPTION (CTCN_LINK_FRAME_LEN (link) + len > link->max_frame_size,
+                        err_write_buf_overflow_label);
+
+    if (link->ref_cnt > 0)
+    {
+        last = &link->ref[link->ref_cnt - 1];
+    }
+
+    if (last != NULL && 
+        last->pos == link->wbuf_pos && 
+        last->ptr + last->len == (const char *)src)
+    {
+        /* continues the previous one */
+        last->len += len;
+    }
+    else
+    {
+        if (link->ref_cnt == link->ref_max)
+        {
+            new_max = link->ref_max == 0 ? 16 : link->ref_max * 2;
+
+            new_ref = (CTCN_LINK_REF *)realloc (link->ref, 
+                                                sizeof (CTCN_LINK_REF) * new_max);
+            CTC_COND_EXCEPTION (new_ref == NULL, err_alloc_failed_label);
+
+            link->ref = new_ref;
+            link->ref_max = new_max;
+        }
+
+        link->ref[link->ref_cnt].pos = link->wbuf_pos;
+        link->ref[link->ref_cnt].len = len;
+        link->ref[link->ref_cnt].ptr = (const char *)src;
+        link->ref_cnt++;
+    }
+
+    link->wbuf_ref_len += len;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : release (owner) is called once the frame being written
+ *               is sent and the kernel is done with it, or dropped
+ *
+ */
+extern int ctcn_link_hold (CTCN_LINK *link, 
+                           void *owner, 
+                           CTCN_LINK_RELEASE_FUNC release)
+{
+    int new_max;
+    CTCN_LINK_HOLD *new_hold;
+
+    if (link->hold_cnt == link->hold_max)
+    {
+        new_max = link->hold_max == 0 ? 16 : link->hold_max * 2;
+
+        new_hold = (CTCN_LINK_HOLD *)realloc (link->hold, 
+                                              sizeof (CTCN_LINK_HOLD) * new_max);
+        CTC_COND_EXCEPTION (new_hold == NULL, err_alloc_failed_label);
+
+        link->hold = new_hold;
+        link->hold_max = new_max;
+    }
+
+    link->hold[link->hold_cnt].owner = owner;
+    link->hold[link->hold_cnt].release = release;
+    link->hold_cnt++;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : large frames of link are sent with MSG_ZEROCOPY, fails
+ *               when kernel or socket does not support it
+ *
+ */
+extern int ctcn_link_set_zerocopy (CTCN_LINK *link)
+{
+#ifdef CTCN_HAVE_ZEROCOPY
+    int opt = 1;
+
+    CTC_TEST_EXCEPTION (ctcn_sock_set_opt (&(link->sock), 
+                                           SOL_SOCKET, 
+                                           SO_ZEROCOPY, 
+                                           (void *)&opt, 
+                                           sizeof (opt)),
+                        err_set_sock_opt_label);
+
+    link->is_zerocopy = CTC_TRUE;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_set_sock_opt_label)
+    EXCEPTION_END;
+#endif
+
+    return CTC_FAILURE;
+}
+
+
 static void ctcn_assign_number_two (unsigned char *src, unsigned char *dest)
 {
 #ifdef ENDIAN_IS_BIG_ENDIAN
@@ -1192,3 +3373,29 @@ static void ctcn_assign_number_four (unsigned char *src, unsigned char *dest)
 }
 
 
+static void ctcn_assign_number_eight (unsigned char *src, unsigned char *dest)
+{
+#ifdef ENDIAN_IS_BIG_ENDIAN
+    dest[0] = src[0];
+    dest[1] = src[1];
+    dest[2] = src[2];
+    dest[3] = src[3];
+    dest[4] = src[4];
+    dest[5] = src[5];
+    dest[6] = src[6];
+    dest[7] = src[7];
+
+#else
+    dest[7] = src[0];
+    dest[6] = src[1];
+    dest[5] = src[2];
+    dest[4] = src[3];
+    dest[3] = src[4];
+    dest[2] = src[5];
+    dest[1] = src[6];
+    dest[0] = src[7];
+
+#endif
+}
+
+
@@ -0,0 +1,1214 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcn_reactor.c : ctc network reactor implementation
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "ctc_common.h"
+#include "ctcg_list.h"
+#include "ctcn_link.h"
+#include "ctcn_reactor.h"
+#include "ctc_types.h"
+
+
+typedef struct ctcn_reactor_thread CTCN_REACTOR_THREAD;
+
+/* 
+ * registration of a link. a removed entry is moved to the dead list and
+ * freed by its thread after the events at hand, they may still point 
+ * to it.
+ */
+typedef struct ctcn_reactor_entry CTCN_REACTOR_ENTRY;
+struct ctcn_reactor_entry
+{
+    CTCN_LINK *link;
+    CTCN_REACTOR_FRAME_FUNC frame_func; /* NULL : send only */
+    CTCN_REACTOR_ACCEPT_FUNC accept_func;   /* of a listener */
+    CTCN_REACTOR_CLOSE_FUNC close_func;
+    void *arg;
+    int room_fd;                        /* of a shared memory ring, or -1 */
+    CTCN_REACTOR_THREAD *thread;
+    pthread_mutex_t serve_lock;         /* held while link is served */
+    BOOL is_removed;
+    BOOL is_paused;                     /* listener, until resumed */
+    BOOL is_out_watched;                /* EPOLLOUT along with EPOLLIN */
+    BOOL is_held;                       /* frame with a worker, not served */
+    CTCN_REACTOR_FRAME_FUNC defer_func; /* run on a worker for the frame */
+    int defer_result;                   /* of defer_func, as frame_func's */
+    CTCG_LIST_NODE node;
+    CTCG_LIST_NODE defer_node;          /* defer_list, then ready_list */
+};
+
+struct ctcn_reactor_thread
+{
+    int epoll_fd;
+    int wakeup_fd;                      /* eventfd, written on finalize */
+    BOOL is_started;
+    pthread_t thr;
+    pthread_mutex_t entry_list_lock;
+    CTCG_LIST entry_list;
+    CTCG_LIST dead_list;
+    CTCG_LIST ready_list;               /* deferred frames done by workers */
+};
+
+typedef struct ctcn_reactor CTCN_REACTOR;
+struct ctcn_reactor
+{
+    int thread_cnt;
+    unsigned int next_thread;           /* links are spread round robin */
+    volatile BOOL is_stop;
+    CTCN_REACTOR_THREAD thread[CTCN_REACTOR_THREAD_MAX];
+    int worker_cnt;
+    pthread_t worker[CTCN_REACTOR_THREAD_MAX];
+    pthread_mutex_t defer_lock;
+    pthread_cond_t defer_cond;
+    CTCG_LIST defer_list;               /* deferred frames to be run */
+};
+
+
+static int ctcn_reactor_add_entry (CTCN_LINK *link,
+                                   CTCN_REACTOR_FRAME_FUNC frame_func,
+                                   CTCN_REACTOR_ACCEPT_FUNC accept_func,
+                                   CTCN_REACTOR_CLOSE_FUNC close_func,
+                                   void *arg);
+static int ctcn_reactor_switch_entry (CTCN_REACTOR_ENTRY *entry,
+                                      CTCN_REACTOR_FRAME_FUNC frame_func,
+                                      CTCN_REACTOR_CLOSE_FUNC close_func,
+                                      void *arg);
+static int ctcn_reactor_thread_init (CTCN_REACTOR_THREAD *thread);
+static void ctcn_reactor_thread_final (CTCN_REACTOR_THREAD *thread);
+static void *ctcn_reactor_thr_func (void *args);
+static int ctcn_reactor_serve_entry (CTCN_REACTOR_ENTRY *entry);
+static void ctcn_reactor_serve_listener (CTCN_REACTOR_ENTRY *entry);
+static void ctcn_reactor_pause_listener (CTCN_REACTOR_ENTRY *entry);
+static void ctcn_reactor_hold_entry (CTCN_REACTOR_ENTRY *entry);
+static int ctcn_reactor_unhold_entry (CTCN_REACTOR_ENTRY *entry);
+static void ctcn_reactor_serve_ready_entries (CTCN_REACTOR_THREAD *thread);
+static void *ctcn_reactor_worker_func (void *args);
+static BOOL ctcn_reactor_detach_entry (CTCN_REACTOR_ENTRY *entry);
+static void ctcn_reactor_free_dead_entries (CTCN_REACTOR_THREAD *thread);
+
+
+static CTCN_REACTOR ctcn_Reactor;
+
+
+extern int ctcn_reactor_initialize (int thread_cnt)
+{
+    int i;
+    int result;
+
+    CTC_COND_EXCEPTION (thread_cnt <= 0 || thread_cnt > CTCN_REACTOR_THREAD_MAX,
+                        err_invalid_thread_cnt_label);
+
+    memset (&ctcn_Reactor, 0, sizeof (ctcn_Reactor));
+
+    ctcn_Reactor.is_stop = CTC_FALSE;
+
+    CTCG_LIST_INIT (&(ctcn_Reactor.defer_list));
+    (void)pthread_mutex_init (&ctcn_Reactor.defer_lock, NULL);
+    (void)pthread_cond_init (&ctcn_Reactor.defer_cond, NULL);
+
+    for (i = 0; i < thread_cnt; i++)
+    {
+        ctcn_Reactor.thread_cnt++;
+
+        CTC_TEST_EXCEPTION (ctcn_reactor_thread_init (&ctcn_Reactor.thread[i]),
+                            err_thread_init_failed_label);
+    }
+
+    /* as many workers as threads, for frames that may wait */
+    for (i = 0; i < thread_cnt; i++)
+    {
+        CTC_TEST_EXCEPTION (pthread_create (&ctcn_Reactor.worker[i],
+                                            NULL,
+                                            ctcn_reactor_worker_func,
+                                            NULL),
+                            err_thread_init_failed_label);
+
+        ctcn_Reactor.worker_cnt++;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_thread_cnt_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_thread_init_failed_label)
+    {
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+
+        ctcn_reactor_finalize ();
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : stops workers after the frames they run, then reactor
+ *               threads. links still registered, deferred frames left
+ *               or not, are closed through their close functions
+ *
+ */
+extern void ctcn_reactor_finalize (void)
+{
+    int i;
+    UINT_64 wakeup = 1;
+
+    (void)pthread_mutex_lock (&ctcn_Reactor.defer_lock);
+    ctcn_Reactor.is_stop = CTC_TRUE;
+    (void)pthread_cond_broadcast (&ctcn_Reactor.defer_cond);
+    (void)pthread_mutex_unlock (&ctcn_Reactor.defer_lock);
+
+    for (i = 0; i < ctcn_Reactor.worker_cnt; i++)
+    {
+        (void)pthread_join (ctcn_Reactor.worker[i], NULL);
+    }
+
+    ctcn_Reactor.worker_cnt = 0;
+
+    for (i = 0; i < ctcn_Reactor.thread_cnt; i++)
+    {
+        if (ctcn_Reactor.thread[i].is_started == CTC_TRUE)
+        {
+            (void)write (ctcn_Reactor.thread[i].wakeup_fd,
+                         &wakeup,
+                         sizeof (wakeup));
+        }
+    }
+
+    for (i = 0; i < ctcn_Reactor.thread_cnt; i++)
+    {
+        ctcn_reactor_thread_final (&ctcn_Reactor.thread[i]);
+    }
+
+    ctcn_Reactor.thread_cnt = 0;
+
+    (void)pthread_cond_destroy (&ctcn_Reactor.defer_cond);
+    (void)pthread_mutex_destroy (&ctcn_Reactor.defer_lock);
+}
+
+
+/*
+ * Description : link is served by a reactor thread from now on, frames
+ *               arriving on it go to frame_func. without frame_func
+ *               only its send queue is written. a link watched already
+ *               is handed over in place, see ctcn_reactor.h.
+ *
+ */
+extern int ctcn_reactor_add_link (CTCN_LINK *link,
+                                  CTCN_REACTOR_FRAME_FUNC frame_func,
+                                  CTCN_REACTOR_CLOSE_FUNC close_func,
+                                  void *arg)
+{
+    CTCN_REACTOR_ENTRY *entry;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+    entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    if (entry != NULL)
+    {
+        /* from the frame function of link, its thread serves it */
+        return ctcn_reactor_switch_entry (entry, frame_func, close_func, arg);
+    }
+
+    return ctcn_reactor_add_entry (link, frame_func, NULL, close_func, arg);
+}
+
+
+/*
+ * Description : connections on listening link are accepted by a reactor
+ *               thread and handed to accept_func, the listener is left
+ *               to its owner. removed by ctcn_reactor_remove_link.
+ *
+ */
+extern int ctcn_reactor_add_listener (CTCN_LINK *link,
+                                      CTCN_REACTOR_ACCEPT_FUNC accept_func,
+                                      void *arg)
+{
+    return ctcn_reactor_add_entry (link, NULL, accept_func, NULL, arg);
+}
+
+
+/*
+ * Description : a listener paused by its reactor thread is watched 
+ *               again, nothing is done for one not paused. called by 
+ *               the owner of the listener, not concurrently with 
+ *               ctcn_reactor_remove_link of it.
+ *
+ */
+extern void ctcn_reactor_resume_listener (CTCN_LINK *link)
+{
+    struct epoll_event event;
+    CTCN_REACTOR_ENTRY *entry;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+    entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    if (entry == NULL || entry->accept_func == NULL ||
+        __atomic_exchange_n (&entry->is_paused, 
+                             CTC_FALSE, 
+                             __ATOMIC_ACQ_REL) != CTC_TRUE)
+    {
+        return;
+    }
+
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN;
+    event.data.ptr = entry;
+
+    if (epoll_ctl (entry->thread->epoll_fd,
+                   EPOLL_CTL_MOD,
+                   link->sock.handle,
+                   &event) == -1)
+    {
+        /* tried again on next call */
+        __atomic_store_n (&entry->is_paused, CTC_TRUE, __ATOMIC_RELEASE);
+    }
+}
+
+
+/*
+ * Description : called by the frame function of link, which returns 
+ *               what this returns. the frame is handled by defer_func
+ *               on a worker, where it may wait, and its result is taken
+ *               as the frame function's. link is not served meanwhile.
+ *
+ */
+extern int ctcn_reactor_defer_frame (CTCN_LINK *link,
+                                     CTCN_REACTOR_FRAME_FUNC defer_func)
+{
+    CTCN_REACTOR_ENTRY *entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+
+    CTC_COND_EXCEPTION (entry == NULL || ctcn_Reactor.worker_cnt == 0,
+                        err_not_deferrable_label);
+
+    entry->defer_func = defer_func;
+
+    return CTCN_REACTOR_DEFER;
+
+    CTC_EXCEPTION (err_not_deferrable_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+static int ctcn_reactor_add_entry (CTCN_LINK *link,
+                                   CTCN_REACTOR_FRAME_FUNC frame_func,
+                                   CTCN_REACTOR_ACCEPT_FUNC accept_func,
+                                   CTCN_REACTOR_CLOSE_FUNC close_func,
+                                   void *arg)
+{
+    int result;
+    struct epoll_event event;
+    CTCN_REACTOR_THREAD *thread;
+    CTCN_REACTOR_ENTRY *entry = NULL;
+
+    CTC_COND_EXCEPTION (ctcn_Reactor.thread_cnt == 0,
+                        err_not_initialized_label);
+
+    entry = (CTCN_REACTOR_ENTRY *)malloc (sizeof (CTCN_REACTOR_ENTRY));
+    CTC_COND_EXCEPTION (entry == NULL, err_alloc_failed_label);
+
+    entry->link = link;
+    entry->frame_func = frame_func;
+    entry->accept_func = accept_func;
+    entry->close_func = close_func;
+    entry->arg = arg;
+    entry->room_fd = -1;
+    entry->is_removed = CTC_FALSE;
+    entry->is_paused = CTC_FALSE;
+    entry->is_out_watched = CTC_FALSE;
+    entry->is_held = CTC_FALSE;
+    entry->defer_func = NULL;
+    entry->defer_result = CTC_SUCCESS;
+
+    CTCG_LIST_INIT_OBJ (&(entry->node), entry);
+    CTCG_LIST_INIT_OBJ (&(entry->defer_node), entry);
+
+    CTC_TEST_EXCEPTION (ctcn_sock_set_block_mode (&(link->sock), CTC_FALSE),
+                        err_set_block_mode_label);
+
+    thread = &ctcn_Reactor.thread[__sync_fetch_and_add (&ctcn_Reactor.next_thread, 1) %
+                                  ctcn_Reactor.thread_cnt];
+
+    entry->thread = thread;
+    (void)pthread_mutex_init (&entry->serve_lock, NULL);
+
+    (void)pthread_mutex_lock (&link->out_lock);
+    link->reactor_entry = entry;
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    /* listed first, the thread may close it as soon as it is watched */
+    (void)pthread_mutex_lock (&thread->entry_list_lock);
+    CTCG_LIST_ADD_LAST (&(thread->entry_list), &(entry->node));
+    (void)pthread_mutex_unlock (&thread->entry_list_lock);
+
+    /* a send only link is armed by ctcn_reactor_want_write */
+    memset (&event, 0, sizeof (event));
+    event.events = (frame_func != NULL || accept_func != NULL) ? 
+                   EPOLLIN : EPOLLONESHOT;
+    event.data.ptr = entry;
+
+    CTC_COND_EXCEPTION (epoll_ctl (thread->epoll_fd,
+                                   EPOLL_CTL_ADD,
+                                   link->sock.handle,
+                                   &event) == -1,
+                        err_epoll_add_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_initialized_label)
+    {
+        result = CTC_ERR_INIT_FAILED;
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_set_block_mode_label)
+    {
+        result = CTC_FAILURE;
+        free (entry);
+    }
+    CTC_EXCEPTION (err_epoll_add_failed_label)
+    {
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+
+        (void)pthread_mutex_lock (&thread->entry_list_lock);
+        CTCG_LIST_REMOVE (&(entry->node));
+        (void)pthread_mutex_unlock (&thread->entry_list_lock);
+
+        (void)pthread_mutex_lock (&link->out_lock);
+        link->reactor_entry = NULL;
+        (void)pthread_mutex_unlock (&link->out_lock);
+
+        (void)ctcn_sock_set_block_mode (&(link->sock), CTC_TRUE);
+        (void)pthread_mutex_destroy (&entry->serve_lock);
+        free (entry);
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : functions of entry are replaced on its own thread, so
+ *               frames left in rbuf go to the new frame_func. a send 
+ *               only link or a listener is not switched. frames queued
+ *               are written either way.
+ *
+ */
+static int ctcn_reactor_switch_entry (CTCN_REACTOR_ENTRY *entry,
+                                      CTCN_REACTOR_FRAME_FUNC frame_func,
+                                      CTCN_REACTOR_CLOSE_FUNC close_func,
+                                      void *arg)
+{
+    int result;
+    struct epoll_event event;
+    CTCN_LINK *link = entry->link;
+
+    CTC_COND_EXCEPTION (entry->frame_func == NULL, err_not_switchable_label);
+
+    /* frame_func is read under out_lock by ctcn_reactor_watch_room and
+     * ctcn_reactor_want_write */
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    if (frame_func == NULL)
+    {
+        /* armed by ctcn_reactor_want_write from now on */
+        memset (&event, 0, sizeof (event));
+        event.events = link->out_head != NULL ? 
+                       EPOLLOUT | EPOLLONESHOT : EPOLLONESHOT;
+        event.data.ptr = entry;
+
+        CTC_COND_EXCEPTION (epoll_ctl (entry->thread->epoll_fd,
+                                       EPOLL_CTL_MOD,
+                                       link->sock.handle,
+                                       &event) == -1,
+                            err_epoll_mod_failed_label);
+
+        entry->is_out_watched = CTC_FALSE;
+    }
+
+    entry->frame_func = frame_func;
+    entry->close_func = close_func;
+    entry->arg = arg;
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_switchable_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_epoll_mod_failed_label)
+    {
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+
+        (void)pthread_mutex_unlock (&link->out_lock);
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : link is no longer watched, its close function is not
+ *               called. not to be called from callbacks of the link,
+ *               nor while a frame of it is deferred.
+ *
+ */
+extern void ctcn_reactor_remove_link (CTCN_LINK *link)
+{
+    CTCN_REACTOR_ENTRY *entry;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+    entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    if (entry == NULL)
+    {
+        return;
+    }
+
+    /* waits for the link being served */
+    (void)pthread_mutex_lock (&entry->serve_lock);
+    (void)ctcn_reactor_detach_entry (entry);
+    (void)pthread_mutex_unlock (&entry->serve_lock);
+}
+
+
+/*
+ * Description : send only link is reported once when writable, a link
+ *               with a frame function is reported while writable, along
+ *               with frames, until ctcn_reactor_done_write. a held link
+ *               is reported once, as a send only one.
+ *
+ */
+extern int ctcn_reactor_want_write (CTCN_LINK *link)
+{
+    struct epoll_event event;
+    CTCN_REACTOR_ENTRY *entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+
+    CTC_COND_EXCEPTION (entry == NULL, err_not_watched_label);
+
+    if (entry->frame_func != NULL && entry->is_held != CTC_TRUE)
+    {
+        if (entry->is_out_watched == CTC_TRUE)
+        {
+            return CTC_SUCCESS;
+        }
+
+        memset (&event, 0, sizeof (event));
+        event.events = EPOLLIN | EPOLLOUT;
+        event.data.ptr = entry;
+
+        CTC_COND_EXCEPTION (epoll_ctl (entry->thread->epoll_fd,
+                                       EPOLL_CTL_MOD,
+                                       link->sock.handle,
+                                       &event) == -1,
+                            err_epoll_mod_failed_label);
+
+        entry->is_out_watched = CTC_TRUE;
+
+        return CTC_SUCCESS;
+    }
+
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLOUT | EPOLLONESHOT;
+    event.data.ptr = entry;
+
+    CTC_COND_EXCEPTION (epoll_ctl (entry->thread->epoll_fd,
+                                   EPOLL_CTL_MOD,
+                                   link->sock.handle,
+                                   &event) == -1,
+                        err_epoll_mod_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_watched_label)
+    CTC_EXCEPTION (err_epoll_mod_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : send queue is empty or broken, a link with a frame 
+ *               function goes back to frames only
+ *
+ */
+extern void ctcn_reactor_done_write (CTCN_LINK *link)
+{
+    struct epoll_event event;
+    CTCN_REACTOR_ENTRY *entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+
+    if (entry == NULL || entry->is_out_watched != CTC_TRUE)
+    {
+        return;
+    }
+
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN;
+    event.data.ptr = entry;
+
+    if (epoll_ctl (entry->thread->epoll_fd,
+                   EPOLL_CTL_MOD,
+                   link->sock.handle,
+                   &event) == 0)
+    {
+        entry->is_out_watched = CTC_FALSE;
+    }
+}
+
+
+/*
+ * Description : room_fd of the ring of a send only link is watched
+ *               with its socket, reported the same way as writable.
+ *               -1 stops watching it.
+ *
+ */
+extern int ctcn_reactor_watch_room (CTCN_LINK *link, int room_fd)
+{
+    struct epoll_event event;
+    CTCN_REACTOR_ENTRY *entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+
+    CTC_COND_EXCEPTION (entry == NULL || entry->frame_func != NULL, 
+                        err_not_watched_label);
+
+    if (entry->room_fd != -1)
+    {
+        (void)epoll_ctl (entry->thread->epoll_fd,
+                         EPOLL_CTL_DEL,
+                         entry->room_fd,
+                         NULL);
+
+        entry->room_fd = -1;
+    }
+
+    if (room_fd != -1)
+    {
+        /* armed by ctcn_reactor_want_room */
+        memset (&event, 0, sizeof (event));
+        event.events = EPOLLONESHOT;
+        event.data.ptr = entry;
+
+        CTC_COND_EXCEPTION (epoll_ctl (entry->thread->epoll_fd,
+                                       EPOLL_CTL_ADD,
+                                       room_fd,
+                                       &event) == -1,
+                            err_epoll_add_failed_label);
+
+        entry->room_fd = room_fd;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_watched_label)
+    CTC_EXCEPTION (err_epoll_add_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : link is reported once when the consumer of its ring
+ *               makes room
+ *
+ */
+extern int ctcn_reactor_want_room (CTCN_LINK *link)
+{
+    struct epoll_event event;
+    CTCN_REACTOR_ENTRY *entry = (CTCN_REACTOR_ENTRY *)link->reactor_entry;
+
+    CTC_COND_EXCEPTION (entry == NULL || entry->room_fd == -1, 
+                        err_not_watched_label);
+
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.ptr = entry;
+
+    CTC_COND_EXCEPTION (epoll_ctl (entry->thread->epoll_fd,
+                                   EPOLL_CTL_MOD,
+                                   entry->room_fd,
+                                   &event) == -1,
+                        err_epoll_mod_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_watched_label)
+    CTC_EXCEPTION (err_epoll_mod_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+static int ctcn_reactor_thread_init (CTCN_REACTOR_THREAD *thread)
+{
+    struct epoll_event event;
+
+    thread->epoll_fd = -1;
+    thread->wakeup_fd = -1;
+    thread->is_started = CTC_FALSE;
+
+    CTCG_LIST_INIT (&(thread->entry_list));
+    CTCG_LIST_INIT (&(thread->dead_list));
+    CTCG_LIST_INIT (&(thread->ready_list));
+    (void)pthread_mutex_init (&thread->entry_list_lock, NULL);
+
+    thread->epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
+    CTC_COND_EXCEPTION (thread->epoll_fd == -1, err_epoll_create_failed_label);
+
+    thread->wakeup_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    CTC_COND_EXCEPTION (thread->wakeup_fd == -1, err_eventfd_failed_label);
+
+    /* NULL data tells the wakeup from links */
+    memset (&event, 0, sizeof (event));
+    event.events = EPOLLIN;
+    event.data.ptr = NULL;
+
+    CTC_COND_EXCEPTION (epoll_ctl (thread->epoll_fd,
+                                   EPOLL_CTL_ADD,
+                                   thread->wakeup_fd,
+                                   &event) == -1,
+                        err_epoll_add_failed_label);
+
+    /* created on the caller's cpus, see ctc_listener_cpu_list */
+    CTC_TEST_EXCEPTION (pthread_create (&thread->thr,
+                                        NULL,
+                                        ctcn_reactor_thr_func,
+                                        (void *)thread),
+                        err_create_thread_failed_label);
+
+    thread->is_started = CTC_TRUE;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_epoll_create_failed_label)
+    CTC_EXCEPTION (err_eventfd_failed_label)
+    CTC_EXCEPTION (err_epoll_add_failed_label)
+    CTC_EXCEPTION (err_create_thread_failed_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+static void ctcn_reactor_thread_final (CTCN_REACTOR_THREAD *thread)
+{
+    CTCN_REACTOR_ENTRY *entry;
+
+    if (thread->is_started == CTC_TRUE)
+    {
+        (void)pthread_join (thread->thr, NULL);
+        thread->is_started = CTC_FALSE;
+    }
+
+    while (CTCG_LIST_IS_EMPTY (&(thread->entry_list)) != CTC_TRUE)
+    {
+        entry = (CTCN_REACTOR_ENTRY *)CTCG_LIST_GET_FIRST (&(thread->entry_list))->obj;
+
+        (void)ctcn_reactor_detach_entry (entry);
+
+        if (entry->close_func != NULL)
+        {
+            entry->close_func (entry->link, entry->arg);
+        }
+    }
+
+    ctcn_reactor_free_dead_entries (thread);
+
+    if (thread->wakeup_fd != -1)
+    {
+        (void)close (thread->wakeup_fd);
+        thread->wakeup_fd = -1;
+    }
+
+    if (thread->epoll_fd != -1)
+    {
+        (void)close (thread->epoll_fd);
+        thread->epoll_fd = -1;
+    }
+
+    (void)pthread_mutex_destroy (&thread->entry_list_lock);
+}
+
+
+static void *ctcn_reactor_thr_func (void *args)
+{
+    int i;
+    int event_cnt;
+    BOOL is_closed;
+    CTCN_REACTOR_ENTRY *entry;
+    CTCN_REACTOR_THREAD *thread = (CTCN_REACTOR_THREAD *)args;
+    struct epoll_event events[CTCN_REACTOR_EVENT_MAX];
+
+    while (ctcn_Reactor.is_stop != CTC_TRUE)
+    {
+        event_cnt = epoll_wait (thread->epoll_fd,
+                                events,
+                                CTCN_REACTOR_EVENT_MAX,
+                                -1);
+
+        if (event_cnt == -1)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            /* ERROR: epoll instance is gone */
+            break;
+        }
+
+        for (i = 0; i < event_cnt; i++)
+        {
+            entry = (CTCN_REACTOR_ENTRY *)events[i].data.ptr;
+
+            if (entry == NULL)
+            {
+                /* wakeup, is_stop is checked by loop */
+                ctcn_reactor_serve_ready_entries (thread);
+                continue;
+            }
+
+            is_closed = CTC_FALSE;
+
+            (void)pthread_mutex_lock (&entry->serve_lock);
+
+            if (entry->is_removed == CTC_TRUE)
+            {
+                /* removed after the wait returned */
+            }
+            else if (entry->accept_func != NULL)
+            {
+                ctcn_reactor_serve_listener (entry);
+            }
+            else if (entry->frame_func == NULL)
+            {
+                /* an error is kept by link, its owner finds it */
+                (void)ctcn_link_flush (entry->link);
+            }
+            else
+            {
+                if ((events[i].events & EPOLLOUT) != 0)
+                {
+                    /* results queued by frame functions, an error is 
+                     * found by the next send or read */
+                    (void)ctcn_link_flush (entry->link);
+                }
+
+                if (entry->is_held == CTC_TRUE)
+                {
+                    /* a hang up is found once the worker is done */
+                }
+                else if ((events[i].events & ~EPOLLOUT) != 0 &&
+                         ctcn_reactor_serve_entry (entry) != CTC_SUCCESS)
+                {
+                    is_closed = ctcn_reactor_detach_entry (entry);
+                }
+            }
+
+            (void)pthread_mutex_unlock (&entry->serve_lock);
+
+            if (is_closed == CTC_TRUE && entry->close_func != NULL)
+            {
+                entry->close_func (entry->link, entry->arg);
+            }
+        }
+
+        ctcn_reactor_free_dead_entries (thread);
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Description : every frame received is handled, since frames already
+ *               in rbuf are not reported by epoll again. a hang up
+ *               comes as end of file after them.
+ *
+ */
+static int ctcn_reactor_serve_entry (CTCN_REACTOR_ENTRY *entry)
+{
+    BOOL is_received;
+    int result;
+
+    while (1)
+    {
+        result = ctcn_link_recv_frame (entry->link, &is_received);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_link_recv_label);
+
+        if (is_received != CTC_TRUE)
+        {
+            break;
+        }
+
+        result = entry->frame_func (entry->link, entry->arg);
+
+        if (result == CTCN_REACTOR_DEFER)
+        {
+            /* next frames wait in rbuf for the worker */
+            ctcn_reactor_hold_entry (entry);
+            break;
+        }
+
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_frame_func_label);
+
+        if (entry->frame_func == NULL)
+        {
+            /* made send only by the frame just handled */
+            break;
+        }
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_link_recv_label)
+    {
+        /* peer closed or broken frame */
+    }
+    CTC_EXCEPTION (err_frame_func_label)
+    {
+        /* CTCN_REACTOR_CLOSE or protocol error */
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : connections pending on a listener are accepted, a few
+ *               at a time for other links of the thread. those left are
+ *               reported again. out of descriptors or memory, they stay
+ *               pending and would be reported at once, the listener is
+ *               paused instead.
+ *
+ */
+static void ctcn_reactor_serve_listener (CTCN_REACTOR_ENTRY *entry)
+{
+    int i;
+    int addr_len;
+    int error;
+    ctc_sock_addr_t addr;
+    CTCN_LINK *link = NULL;
+
+    for (i = 0; i < CTCN_REACTOR_ACCEPT_MAX; i++)
+    {
+        if (ctcn_link_create (&link) != CTC_SUCCESS)
+        {
+            /* ERROR: memory allocation */
+            ctcn_reactor_pause_listener (entry);
+            break;
+        }
+
+        addr_len = sizeof (addr);
+
+        /* non-blocking as the listener, none left when it fails */
+        if (ctcn_sock_accept (&link->sock, 
+                              &entry->link->sock, 
+                              &addr, 
+                              &addr_len) != CTC_SUCCESS)
+        {
+            error = errno;
+
+            ctcn_link_destroy (link);
+
+            if (error == EMFILE || error == ENFILE || 
+                error == ENOBUFS || error == ENOMEM)
+            {
+                ctcn_reactor_pause_listener (entry);
+            }
+
+            break;
+        }
+
+        entry->accept_func (link, entry->arg);
+    }
+}
+
+
+/* not reported until ctcn_reactor_resume_listener, on the owner's beat */
+static void ctcn_reactor_pause_listener (CTCN_REACTOR_ENTRY *entry)
+{
+    struct epoll_event event;
+
+    memset (&event, 0, sizeof (event));
+    event.events = 0;
+    event.data.ptr = entry;
+
+    if (epoll_ctl (entry->thread->epoll_fd,
+                   EPOLL_CTL_MOD,
+                   entry->link->sock.handle,
+                   &event) == 0)
+    {
+        __atomic_store_n (&entry->is_paused, CTC_TRUE, __ATOMIC_RELEASE);
+    }
+}
+
+
+/*
+ * Description : frame at rbuf goes to a worker, link is only watched 
+ *               for frames queued meanwhile. called on the thread of
+ *               entry.
+ *
+ */
+static void ctcn_reactor_hold_entry (CTCN_REACTOR_ENTRY *entry)
+{
+    struct epoll_event event;
+    CTCN_LINK *link = entry->link;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    entry->is_held = CTC_TRUE;
+    entry->is_out_watched = CTC_FALSE;
+
+    /* reported once, re-armed by ctcn_reactor_want_write */
+    memset (&event, 0, sizeof (event));
+    event.events = link->out_head != NULL ? 
+                   EPOLLOUT | EPOLLONESHOT : EPOLLONESHOT;
+    event.data.ptr = entry;
+
+    (void)epoll_ctl (entry->thread->epoll_fd,
+                     EPOLL_CTL_MOD,
+                     link->sock.handle,
+                     &event);
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    (void)pthread_mutex_lock (&ctcn_Reactor.defer_lock);
+    CTCG_LIST_ADD_LAST (&(ctcn_Reactor.defer_list), &(entry->defer_node));
+    (void)pthread_cond_signal (&ctcn_Reactor.defer_cond);
+    (void)pthread_mutex_unlock (&ctcn_Reactor.defer_lock);
+}
+
+
+/* watched for frames again, called on the thread of entry */
+static int ctcn_reactor_unhold_entry (CTCN_REACTOR_ENTRY *entry)
+{
+    int result = CTC_SUCCESS;
+    struct epoll_event event;
+    CTCN_LINK *link = entry->link;
+
+    (void)pthread_mutex_lock (&link->out_lock);
+
+    entry->is_held = CTC_FALSE;
+    entry->is_out_watched = link->out_head != NULL ? CTC_TRUE : CTC_FALSE;
+
+    memset (&event, 0, sizeof (event));
+    event.events = entry->is_out_watched == CTC_TRUE ? 
+                   EPOLLIN | EPOLLOUT : EPOLLIN;
+    event.data.ptr = entry;
+
+    if (epoll_ctl (entry->thread->epoll_fd,
+                   EPOLL_CTL_MOD,
+                   link->sock.handle,
+                   &event) == -1)
+    {
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+    }
+
+    (void)pthread_mutex_unlock (&link->out_lock);
+
+    return result;
+}
+
+
+/*
+ * Description : links whose deferred frame is done are served again, 
+ *               frames waiting in rbuf first since epoll does not 
+ *               report them
+ *
+ */
+static void ctcn_reactor_serve_ready_entries (CTCN_REACTOR_THREAD *thread)
+{
+    BOOL is_closed;
+    UINT_64 wakeup;
+    CTCN_REACTOR_ENTRY *entry;
+
+    (void)read (thread->wakeup_fd, &wakeup, sizeof (wakeup));
+
+    (void)pthread_mutex_lock (&thread->entry_list_lock);
+
+    while (CTCG_LIST_IS_EMPTY (&(thread->ready_list)) != CTC_TRUE)
+    {
+        entry = (CTCN_REACTOR_ENTRY *)CTCG_LIST_GET_FIRST (&(thread->ready_list))->obj;
+        CTCG_LIST_REMOVE (&(entry->defer_node));
+
+        (void)pthread_mutex_unlock (&thread->entry_list_lock);
+
+        is_closed = CTC_FALSE;
+
+        (void)pthread_mutex_lock (&entry->serve_lock);
+
+        if (entry->is_removed != CTC_TRUE &&
+            (entry->defer_result != CTC_SUCCESS ||
+             ctcn_reactor_unhold_entry (entry) != CTC_SUCCESS ||
+             ctcn_reactor_serve_entry (entry) != CTC_SUCCESS))
+        {
+            is_closed = ctcn_reactor_detach_entry (entry);
+        }
+
+        (void)pthread_mutex_unlock (&entry->serve_lock);
+
+        if (is_closed == CTC_TRUE && entry->close_func != NULL)
+        {
+            entry->close_func (entry->link, entry->arg);
+        }
+
+        (void)pthread_mutex_lock (&thread->entry_list_lock);
+    }
+
+    (void)pthread_mutex_unlock (&thread->entry_list_lock);
+}
+
+
+/*
+ * Description : runs deferred frames, which may wait, then hands their
+ *               links back to their threads
+ *
+ */
+static void *ctcn_reactor_worker_func (void *args)
+{
+    UINT_64 wakeup = 1;
+    CTCN_REACTOR_ENTRY *entry;
+    CTCN_REACTOR_THREAD *thread;
+
+    while (1)
+    {
+        (void)pthread_mutex_lock (&ctcn_Reactor.defer_lock);
+
+        while (CTCG_LIST_IS_EMPTY (&(ctcn_Reactor.defer_list)) == CTC_TRUE &&
+               ctcn_Reactor.is_stop != CTC_TRUE)
+        {
+            (void)pthread_cond_wait (&ctcn_Reactor.defer_cond, 
+                                     &ctcn_Reactor.defer_lock);
+        }
+
+        if (ctcn_Reactor.is_stop == CTC_TRUE)
+        {
+            /* frames left are dropped with their links */
+            (void)pthread_mutex_unlock (&ctcn_Reactor.defer_lock);
+            break;
+        }
+
+        entry = (CTCN_REACTOR_ENTRY *)CTCG_LIST_GET_FIRST (&(ctcn_Reactor.defer_list))->obj;
+        CTCG_LIST_REMOVE (&(entry->defer_node));
+
+        (void)pthread_mutex_unlock (&ctcn_Reactor.defer_lock);
+
+        entry->defer_result = entry->defer_func (entry->link, entry->arg);
+
+        thread = entry->thread;
+
+        (void)pthread_mutex_lock (&thread->entry_list_lock);
+        CTCG_LIST_ADD_LAST (&(thread->ready_list), &(entry->defer_node));
+        (void)pthread_mutex_unlock (&thread->entry_list_lock);
+
+        (void)write (thread->wakeup_fd, &wakeup, sizeof (wakeup));
+    }
+
+    return NULL;
+}
+
+
+/*
+ * Description : stops watching the link of entry, CTC_FALSE when it was
+ *               removed already. serve_lock is held unless no reactor 
+ *               thread runs.
+ *
+ */
+static BOOL ctcn_reactor_detach_entry (CTCN_REACTOR_ENTRY *entry)
+{
+    CTCN_REACTOR_THREAD *thread = entry->thread;
+
+    if (entry->is_removed == CTC_TRUE)
+    {
+        return CTC_FALSE;
+    }
+
+    entry->is_removed = CTC_TRUE;
+
+    (void)pthread_mutex_lock (&entry->link->out_lock);
+    entry->link->reactor_entry = NULL;
+    (void)pthread_mutex_unlock (&entry->link->out_lock);
+
+    (void)epoll_ctl (thread->epoll_fd,
+                     EPOLL_CTL_DEL,
+                     entry->link->sock.handle,
+                     NULL);
+
+    if (entry->room_fd != -1)
+    {
+        (void)epoll_ctl (thread->epoll_fd, EPOLL_CTL_DEL, entry->room_fd, NULL);
+        entry->room_fd = -1;
+    }
+
+    (void)pthread_mutex_lock (&thread->entry_list_lock);
+    CTCG_LIST_REMOVE (&(entry->node));
+    CTCG_LIST_ADD_LAST (&(thread->dead_list), &(entry->node));
+    (void)pthread_mutex_unlock (&thread->entry_list_lock);
+
+    return CTC_TRUE;
+}
+
+
+static void ctcn_reactor_free_dead_entries (CTCN_REACTOR_THREAD *thread)
+{
+    CTCN_REACTOR_ENTRY *entry;
+
+    (void)pthread_mutex_lock (&thread->entry_list_lock);
+
+    while (CTCG_LIST_IS_EMPTY (&(thread->dead_list)) != CTC_TRUE)
+    {
+        entry = (CTCN_REACTOR_ENTRY *)CTCG_LIST_GET_FIRST (&(thread->dead_list))->obj;
+
+        CTCG_LIST_REMOVE (&(entry->node));
+
+        (void)pthread_mutex_destroy (&entry->serve_lock);
+        free (entry);
+    }
+
+    (void)pthread_mutex_unlock (&thread->entry_list_lock);
+}
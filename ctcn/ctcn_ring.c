@@ -0,0 +1,382 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcn_ring.c : ctc shared memory ring implementation
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
+#include "ctc_common.h"
+#include "ctcn_link.h"
+#include "ctcn_ring.h"
+#include "ctc_types.h"
+
+
+static unsigned int ctcn_ring_get_need (CTCN_RING *ring, unsigned int rec_len);
+static void ctcn_ring_post_event (int fd);
+
+
+/*
+ * Description : data_size is rounded up to a power of two, memory is
+ *               zero filled by the kernel
+ *
+ */
+extern int ctcn_ring_create (unsigned int data_size, CTCN_RING **ring)
+{
+    int result;
+    unsigned int size = CTCN_RING_DATA_SIZE_MIN;
+    void *mem = MAP_FAILED;
+    CTCN_RING *ring_ptr = NULL;
+
+    CTC_COND_EXCEPTION (data_size > CTCN_RING_DATA_SIZE_MAX,
+                        err_invalid_size_label);
+
+    while (size < data_size)
+    {
+        size <<= 1;
+    }
+
+    ring_ptr = (CTCN_RING *)malloc (sizeof (CTCN_RING));
+    CTC_COND_EXCEPTION (ring_ptr == NULL, err_alloc_failed_label);
+
+    memset (ring_ptr, 0, sizeof (CTCN_RING));
+
+    ring_ptr->data_fd = -1;
+    ring_ptr->room_fd = -1;
+    ring_ptr->data_size = size;
+    ring_ptr->mem_size = CTCN_RING_HDR_SIZE + (size_t)size;
+
+    ring_ptr->mem_fd = memfd_create ("ctc_ring", MFD_CLOEXEC);
+    CTC_COND_EXCEPTION (ring_ptr->mem_fd == -1, err_sys_resource_label);
+
+    CTC_COND_EXCEPTION (ftruncate (ring_ptr->mem_fd,
+                                   (off_t)ring_ptr->mem_size) == -1,
+                        err_sys_resource_label);
+
+    mem = mmap (NULL,
+                ring_ptr->mem_size,
+                PROT_READ | PROT_WRITE,
+                MAP_SHARED,
+                ring_ptr->mem_fd,
+                0);
+    CTC_COND_EXCEPTION (mem == MAP_FAILED, err_sys_resource_label);
+
+    ring_ptr->hdr = (CTCN_RING_HDR *)mem;
+    ring_ptr->data = (char *)mem + CTCN_RING_HDR_SIZE;
+
+    ring_ptr->data_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    CTC_COND_EXCEPTION (ring_ptr->data_fd == -1, err_sys_resource_label);
+
+    ring_ptr->room_fd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    CTC_COND_EXCEPTION (ring_ptr->room_fd == -1, err_sys_resource_label);
+
+    ring_ptr->hdr->version = CTCN_RING_VERSION;
+    ring_ptr->hdr->data_offset = CTCN_RING_HDR_SIZE;
+    ring_ptr->hdr->data_size = size;
+
+    /* a consumer checks magic last */
+    __atomic_store_n (&ring_ptr->hdr->magic, CTCN_RING_MAGIC, __ATOMIC_RELEASE);
+
+    *ring = ring_ptr;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_size_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_sys_resource_label)
+    {
+        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+
+        if (mem != MAP_FAILED)
+        {
+            (void)munmap (mem, ring_ptr->mem_size);
+        }
+
+        if (ring_ptr->room_fd != -1)
+        {
+            (void)close (ring_ptr->room_fd);
+        }
+
+        if (ring_ptr->data_fd != -1)
+        {
+            (void)close (ring_ptr->data_fd);
+        }
+
+        if (ring_ptr->mem_fd != -1)
+        {
+            (void)close (ring_ptr->mem_fd);
+        }
+
+        free (ring_ptr);
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : a consumer waiting is woken to find the ring closed,
+ *               its mapping stays valid until it unmaps
+ *
+ */
+extern void ctcn_ring_destroy (CTCN_RING *ring)
+{
+    if (ring == NULL)
+    {
+        return;
+    }
+
+    __atomic_store_n (&ring->hdr->is_closed, 1, __ATOMIC_RELEASE);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_exchange_n (&ring->hdr->is_consumer_waiting,
+                             0,
+                             __ATOMIC_SEQ_CST) != 0)
+    {
+        ctcn_ring_post_event (ring->data_fd);
+    }
+
+    (void)munmap ((void *)ring->hdr, ring->mem_size);
+
+    (void)close (ring->room_fd);
+    (void)close (ring->data_fd);
+    (void)close (ring->mem_fd);
+
+    free (ring);
+}
+
+
+extern unsigned int ctcn_ring_get_free (CTCN_RING *ring)
+{
+    UINT_64 tail;
+
+    tail = __atomic_load_n (&ring->hdr->tail, __ATOMIC_ACQUIRE);
+
+    return ring->data_size - (unsigned int)(ring->head - tail);
+}
+
+
+extern BOOL ctcn_ring_has_room (CTCN_RING *ring, unsigned int frame_len)
+{
+    unsigned int need;
+
+    need = ctcn_ring_get_need (ring, CTCN_RING_REC_LEN (frame_len));
+
+    return ctcn_ring_get_free (ring) >= need ? CTC_TRUE : CTC_FALSE;
+}
+
+
+/*
+ * Description : bytes taken from head by a record of rec_len, the end
+ *               of data is skipped when it does not fit there
+ *
+ */
+static unsigned int ctcn_ring_get_need (CTCN_RING *ring, unsigned int rec_len)
+{
+    unsigned int to_end;
+
+    to_end = ring->data_size - (unsigned int)(ring->head & (ring->data_size - 1));
+
+    return rec_len <= to_end ? rec_len : to_end + rec_len;
+}
+
+
+/*
+ * Description : frame of iov is copied to the ring as one record and
+ *               published, the consumer is woken if it sleeps
+ *
+ */
+extern int ctcn_ring_write (CTCN_RING *ring,
+                            struct iovec *iov,
+                            int iov_cnt,
+                            unsigned int frame_len)
+{
+    int i;
+    unsigned int rec_len;
+    unsigned int offset;
+    unsigned int to_end;
+    char *rec;
+    char *pos;
+
+    rec_len = CTCN_RING_REC_LEN (frame_len);
+
+    CTC_COND_EXCEPTION (rec_len > ring->data_size / 2, err_too_long_label);
+
+    if (ctcn_ring_get_free (ring) < ctcn_ring_get_need (ring, rec_len))
+    {
+        return CTCN_RESULT_EAGAIN;
+    }
+
+    offset = (unsigned int)(ring->head & (ring->data_size - 1));
+    to_end = ring->data_size - offset;
+
+    if (rec_len > to_end)
+    {
+        /* records are contiguous, so they are read in place */
+        rec = ring->data + offset;
+
+        ((UINT_32 *)rec)[0] = to_end - CTCN_RING_REC_HDR_LEN;
+        ((UINT_32 *)rec)[1] = CTCN_RING_REC_WRAP;
+
+        ring->head += to_end;
+        offset = 0;
+    }
+
+    rec = ring->data + offset;
+    pos = rec + CTCN_RING_REC_HDR_LEN;
+
+    for (i = 0; i < iov_cnt; i++)
+    {
+        memcpy (pos, iov[i].iov_base, iov[i].iov_len);
+        pos += iov[i].iov_len;
+    }
+
+    ((UINT_32 *)rec)[0] = frame_len;
+    ((UINT_32 *)rec)[1] = CTCN_RING_REC_FRAME;
+
+    ring->head += rec_len;
+
+    __atomic_store_n (&ring->hdr->head, ring->head, __ATOMIC_RELEASE);
+
+    /* against the consumer setting its flag and reading head */
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (&ring->hdr->is_consumer_waiting, __ATOMIC_RELAXED) != 0 &&
+        __atomic_exchange_n (&ring->hdr->is_consumer_waiting,
+                             0,
+                             __ATOMIC_SEQ_CST) != 0)
+    {
+        ctcn_ring_post_event (ring->data_fd);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_too_long_label)
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : room_fd is written once the consumer moves tail,
+ *               caller checks room again after this
+ *
+ */
+extern void ctcn_ring_want_room (CTCN_RING *ring)
+{
+    __atomic_store_n (&ring->hdr->is_server_waiting, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+}
+
+
+/*
+ * Description : waits until a frame of frame_len fits or timeout_msec
+ *               passes with the consumer not reading
+ *
+ */
+extern int ctcn_ring_wait_room (CTCN_RING *ring,
+                                unsigned int frame_len,
+                                int timeout_msec)
+{
+    int result;
+    int poll_result;
+    struct pollfd pfd;
+
+    ctcn_ring_want_room (ring);
+
+    if (ctcn_ring_has_room (ring, frame_len) == CTC_TRUE)
+    {
+        return CTC_SUCCESS;
+    }
+
+    pfd.fd = ring->room_fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+
+    do
+    {
+        poll_result = poll (&pfd, 1, timeout_msec);
+    } while (poll_result == -1 && errno == EINTR);
+
+    CTC_COND_EXCEPTION (poll_result == -1, err_poll_failed_label);
+    CTC_COND_EXCEPTION (poll_result == 0, err_timeout_label);
+
+    ctcn_ring_clear_room_event (ring);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_poll_failed_label)
+    {
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_timeout_label)
+    {
+        result = CTCN_RESULT_ETIMEDOUT;
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+extern void ctcn_ring_clear_room_event (CTCN_RING *ring)
+{
+    UINT_64 cnt;
+
+    /* non-blocking, nothing to read is fine */
+    (void)read (ring->room_fd, &cnt, sizeof (cnt));
+}
+
+
+/*
+ * Description : passes a room event taken by a writer on to others
+ *               watching room_fd
+ *
+ */
+extern void ctcn_ring_post_room_event (CTCN_RING *ring)
+{
+    ctcn_ring_post_event (ring->room_fd);
+}
+
+
+static void ctcn_ring_post_event (int fd)
+{
+    UINT_64 one = 1;
+
+    (void)write (fd, &one, sizeof (one));
+}
@@ -28,31 +28,185 @@
 #include <string.h>
 #include <assert.h>
 #include <unistd.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+
+#include "lzo/lzo1x.h"
 
 #include "ctcp.h"
 #include "ctcs.h"
 #include "ctcl.h"
 #include "ctcm.h"
 #include "ctcn_link.h"
+#include "ctcn_reactor.h"
+#include "ctcg_trace.h"
+#include "ctcg_conf.h"
 #include "ctc_types.h"
 
 
+#define CTCP_DICT_BUCKET_CNT                (1024)
+#define CTCP_LZO_WORK_MEM_MAX               (16)    /* kept for reuse */
+
+/* transaction id, commit lsa and item count of a plain record */
+#define CTCP_CAPTURED_REC_HDR_LEN           (4 + 8 + 4)
+
+/* zigzag of a signed delta, small either way */
+#define CTCP_ZIGZAG(v)                      ((((UINT_64)(v)) << 1) ^ \
+                                             (UINT_64)((SINT_64)(v) >> 63))
+
+
+/* a table or a column of captured items, see CTCP_RC_FLAG_DICTIONARY */
+typedef struct ctcp_dict_entry CTCP_DICT_ENTRY;
+struct ctcp_dict_entry
+{
+    int id;
+    int table_id;                   /* CTCP_DICT_ID_NULL : table entry */
+    int type;                       /* column entry only */
+    int name_len;
+    CTCP_DICT_ENTRY *hash_next;
+    char name[1];                   /* allocated with the entry */
+};
+
+/* 
+ * ids are server wide, so a compact encoded transaction is shared by 
+ * jobs like any other variant. which entries a job session got is kept
+ * in its batch.
+ */
+typedef struct ctcp_dict CTCP_DICT;
+struct ctcp_dict
+{
+    pthread_mutex_t lock;
+    int entry_cnt;
+    int entry_size;
+    CTCP_DICT_ENTRY **entry;        /* by id */
+    CTCP_DICT_ENTRY *bucket[CTCP_DICT_BUCKET_CNT];
+};
+
+/* LZO1X-1 work memory taken by a compressing thread and put back */
+typedef struct ctcp_lzo_pool CTCP_LZO_POOL;
+struct ctcp_lzo_pool
+{
+    pthread_mutex_t lock;
+    int free_cnt;
+    lzo_voidp free_mem[CTCP_LZO_WORK_MEM_MAX];
+};
+
+/* dictionary entries referred by a transaction being encoded */
+typedef struct ctcp_dict_refs CTCP_DICT_REFS;
+struct ctcp_dict_refs
+{
+    int cnt;
+    int size;
+    int *id;
+    int seen_size;
+    unsigned char *seen;            /* bitmap by id */
+};
+
+
 static int ctcp_validate_prcl_ver (int ver);
 static int ctcp_validate_job_desc (int job_desc);
 static int ctcp_validate_op_param (int opid, unsigned char op_param);
 static BOOL ctcp_is_recv_protocol (int opid);
 static int ctcp_execute_protocol (void *link, CTCP_HEADER *header);
+static int ctcp_read_start_capture_pos (CTCN_LINK *link, 
+                                       CTCP_HEADER *header,
+                                       CTCL_STREAM_POS *start_pos);
+static int ctcp_write_captured_column (CTCN_LINK *link, CTCL_COLUMN *col);
+static int ctcp_write_captured_item (CTCN_LINK *link, 
+                                     CTCL_ITEM *log_item,
+                                     int update_mode,
+                                     BOOL send_before_image);
+static int ctcp_dict_get_id (int table_id,
+                             int type,
+                             const char *name,
+                             int name_len,
+                             int *id);
+static CTCP_DICT_ENTRY *ctcp_dict_get_entry (int id);
+static int ctcp_add_dict_ref (CTCP_DICT_REFS *refs, int id);
+static int ctcp_get_varint_len (UINT_64 val);
+static int ctcp_write_varint (CTCN_LINK *link, UINT_64 val);
+static int ctcp_write_compact_column (CTCN_LINK *link, 
+                                      int table_id,
+                                      CTCL_COLUMN *col,
+                                      CTCP_DICT_REFS *refs);
+static int ctcp_write_compact_item (CTCN_LINK *link, 
+                                    CTCL_ITEM *log_item,
+                                    int update_mode,
+                                    BOOL send_before_image,
+                                    CTCP_DICT_REFS *refs);
+static int ctcp_get_encoded_trans (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                   int update_mode,
+                                   BOOL send_before_image,
+                                   BOOL is_compact,
+                                   CTCL_ENCODED_TRANS **encoded);
+static void ctcp_fill_captured_item_cnt (CTCN_LINK *link, 
+                                         int rec_pos, 
+                                         int item_cnt);
+static int ctcp_send_captured_data_frame (CTCN_LINK *link,
+                                          unsigned short job_desc,
+                                          int sgid,
+                                          int result_code,
+                                          CTCJ_CAPTURE_BATCH *batch);
+static BOOL ctcp_open_captured_data_frame (CTCN_LINK *link,
+                                           CTCJ_CAPTURE_BATCH *batch);
+static int ctcp_wait_captured_data_credit (CTCN_LINK *link,
+                                           CTCJ_CAPTURE_BATCH *batch,
+                                           int need);
+static int ctcp_write_encoded_item (CTCN_LINK *link,
+                                    CTCL_ENCODED_TRANS *encoded,
+                                    int k,
+                                    int frame_limit,
+                                    BOOL *is_held);
+static void ctcp_release_encoded_trans (void *encoded);
+static lzo_voidp ctcp_lzo_get_work_mem (void);
+static void ctcp_lzo_put_work_mem (lzo_voidp work_mem);
+static int ctcp_get_batch_rec_len (CTCJ_CAPTURE_BATCH *batch,
+                                   int tid,
+                                   UINT_64 commit_lsa,
+                                   CTCL_ENCODED_TRANS *encoded);
+static int ctcp_write_batch_records (CTCN_LINK *link, CTCJ_CAPTURE_BATCH *batch);
+static int ctcp_send_compressed_batch (CTCN_LINK *link,
+                                       unsigned short job_desc,
+                                       int sgid,
+                                       CTCJ_CAPTURE_BATCH *batch);
+static void ctcp_release_held_trans (CTCJ_CAPTURE_BATCH *batch);
+static int ctcp_append_compressed_trans (CTCN_LINK *link,
+                                         unsigned short job_desc,
+                                         int sgid,
+                                         CTCL_TRANS_LOG_LIST *trans_log_list,
+                                         CTCL_ENCODED_TRANS *encoded,
+                                         CTCJ_CAPTURE_BATCH *batch,
+                                         BOOL *is_appended,
+                                         BOOL *is_credit_out);
+static int ctcp_write_dict_entry (CTCN_LINK *link, CTCP_DICT_ENTRY *entry);
+static int ctcp_send_dict_entries (CTCN_LINK *link,
+                                   unsigned short job_desc,
+                                   int sgid,
+                                   CTCL_ENCODED_TRANS *encoded,
+                                   CTCJ_CAPTURE_BATCH *batch,
+                                   BOOL *is_credit_out);
+static int ctcp_append_compact_trans (CTCN_LINK *link,
+                                      unsigned short job_desc,
+                                      int sgid,
+                                      CTCL_TRANS_LOG_LIST *trans_log_list,
+                                      CTCL_ENCODED_TRANS *encoded,
+                                      CTCJ_CAPTURE_BATCH *batch,
+                                      BOOL *is_credit_out);
+
+
+static CTCP_LZO_POOL ctcp_Lzo_pool = { PTHREAD_MUTEX_INITIALIZER, 0, { NULL } };
+
+/* schema dictionary of compact encoding */
+static CTCP_DICT ctcp_Dict = { PTHREAD_MUTEX_INITIALIZER, 0, 0, NULL, { NULL } };
 
 
 extern void ctcp_initialize (void)
 {
-    fprintf (stdout, "\n\tCurrent CTC protocol version is %d.%d.%d.%d\n", 
-             CTCP_VER_MAJOR, 
-             CTCP_VER_MINOR, 
-             CTCP_VER_PATCH, 
-             CTCP_VER_TAG);
-
-    fflush (stdout);
+    CTCG_TRACE_INFO (CTCG_TRACE_EV_PROTOCOL_VERSION,
+                     CTCP_VER_MAJOR, 
+                     CTCP_VER_MINOR, 
+                     CTCP_VER_PATCH, 
+                     CTCP_VER_TAG);
 
     return;
 }
@@ -61,6 +215,30 @@ extern void ctcp_initialize (void)
 /* function just for pair with ctcp_initialize */
 extern void ctcp_finalize (void)
 {
+    int i;
+
+    for (i = 0; i < ctcp_Dict.entry_cnt; i++)
+    {
+        free (ctcp_Dict.entry[i]);
+    }
+
+    if (ctcp_Dict.entry != NULL)
+    {
+        free (ctcp_Dict.entry);
+    }
+
+    memset (ctcp_Dict.bucket, 0, sizeof (ctcp_Dict.bucket));
+    ctcp_Dict.entry = NULL;
+    ctcp_Dict.entry_cnt = 0;
+    ctcp_Dict.entry_size = 0;
+
+    for (i = 0; i < ctcp_Lzo_pool.free_cnt; i++)
+    {
+        free (ctcp_Lzo_pool.free_mem[i]);
+    }
+
+    ctcp_Lzo_pool.free_cnt = 0;
+
     return;
 }
 
@@ -134,8 +312,8 @@ extern int ctcp_analyze_protocol_header (void *inlink,
 {
     int result = CTC_SUCCESS;
     int read_opid = CTCP_UNKNOWN_OPERATION;
-    int read_op_param;
-    int read_job_desc;
+    int read_op_param = 0;      /* one and two bytes are read into these */
+    int read_job_desc = 0;
     int read_sgid;
     int read_ver;
     int read_data_len = 0;
@@ -290,6 +468,33 @@ static int ctcp_validate_op_param (int opid, unsigned char op_param)
 
             break;
 
+        case CTCP_GRANT_CREDIT:
+
+            if (op_prm == CTCJ_CREDIT_UNIT_FRAMES ||
+                op_prm == CTCJ_CREDIT_UNIT_BYTES)
+            {
+                result = CTC_SUCCESS;
+            }
+            else
+            {
+                result = CTC_FAILURE;
+            }
+
+            break;
+
+        case CTCP_ATTACH_SHM_RING:
+
+            if (op_prm == CTCP_PACKET_PARAM_NOT_USED)
+            {
+                result = CTC_SUCCESS;
+            }
+            else
+            {
+                result = CTC_FAILURE;
+            }
+
+            break;
+
         case CTCP_SET_JOB_ATTRIBUTE:
 
             if (op_prm > CTCJ_JOB_ATTR_ID_START &&
@@ -304,6 +509,21 @@ static int ctcp_validate_op_param (int opid, unsigned char op_param)
 
             break;
 
+        case CTCP_START_CAPTURE:
+
+            if (op_prm == CTCP_START_CAPTURE_POS_NOW ||
+                op_prm == CTCP_START_CAPTURE_POS_LSA ||
+                op_prm == CTCP_PACKET_PARAM_NOT_USED)
+            {
+                result = CTC_SUCCESS;
+            }
+            else
+            {
+                result = CTC_FAILURE;
+            }
+
+            break;
+
         case CTCP_STOP_CAPTURE:
 
             if (op_prm == CTCP_STOP_CAPTURE_COND_IMMEDIATELY ||
@@ -429,19 +649,81 @@ extern int ctcp_header_get_data_len (CTCP_HEADER *header)
 extern int ctcp_do_create_ctrl_session (void *inlink, 
                                         CTCP_HEADER *header,
                                         int *sgid,
+                                        int *max_frame_size,
+                                        int *features,
                                         int *result_code)
 {
     int id;
     int result;
+    int req_frame_size = 0;
+    int conf_frame_size;
+    int req_features = 0;
+    CTCS_SESSION_GROUP *sg = NULL;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
 
     id = ctcp_header_get_sgid (header);
 
+    *max_frame_size = 0;
+    *features = CTCP_FEATURE_NOT_REQUESTED;
+
+    /* older clients send no data and keep the default frame size */
+    if (ctcp_header_get_data_len (header) >= CTCP_MAX_FRAME_SIZE_DATA_LEN)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_read_four_byte_number (link, 
+                                                             &req_frame_size),
+                            err_read_frame_size_label);
+
+        CTC_TEST_EXCEPTION (ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_MAX_FRAME_SIZE,
+                                                      CTCG_CONF_ITEM_VAL_SET_INT,
+                                                      (void *)&conf_frame_size),
+                            err_read_frame_size_label);
+
+        if (req_frame_size > conf_frame_size)
+        {
+            req_frame_size = conf_frame_size;
+        }
+        else if (req_frame_size < CTCN_LINK_BUF_SIZE)
+        {
+            req_frame_size = CTCN_LINK_BUF_SIZE;
+        }
+
+        /* before the reactor starts serving this link */
+        CTC_TEST_EXCEPTION (ctcn_link_set_max_frame_size (link, 
+                                                          req_frame_size),
+                            err_read_frame_size_label);
+
+        *max_frame_size = req_frame_size;
+    }
+
+    if (ctcp_header_get_data_len (header) >= CTCP_MAX_FRAME_SIZE_DATA_LEN +
+                                             CTCP_FEATURES_DATA_LEN)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_read_four_byte_number (link, 
+                                                             &req_features),
+                            err_read_frame_size_label);
+
+        /* unknown ones are turned down, client goes without them */
+        *features = req_features & CTCP_FEATURE_SUPPORTED;
+    }
+
     if (id == CTCP_SGID_NULL)
     {
         result = ctcs_mgr_create_session_group (link, &id);
         CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                             err_create_session_grp_label);
+
+        sg = ctcs_find_session_group_by_id (id);
+
+        if (sg != NULL)
+        {
+            if (*features != CTCP_FEATURE_NOT_REQUESTED)
+            {
+                /* job sessions are added later and follow it */
+                sg->features = *features;
+            }
+
+            ctcs_sg_put (sg);
+        }
     }
     else
     {
@@ -453,6 +735,11 @@ extern int ctcp_do_create_ctrl_session (void *inlink,
 
     return CTC_SUCCESS;
 
+    CTC_EXCEPTION (err_read_frame_size_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+        *result_code = CTCP_RC_FAILED_CREATE_SESSION;
+    }
     CTC_EXCEPTION (err_create_session_grp_label)
     {
         *result_code = CTCP_RC_FAILED_CREATE_SESSION;
@@ -465,8 +752,11 @@ extern int ctcp_do_create_ctrl_session (void *inlink,
 
 extern int ctcp_send_create_ctrl_session_result (void *inlink, 
                                                  int result_code, 
-                                                 int sgid)
+                                                 int sgid,
+                                                 int max_frame_size,
+                                                 int features)
 {
+    int data_len = 0;
     unsigned short job_desc = CTCJ_NULL_JOB_DESCRIPTOR;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
     /* link validation */
@@ -484,15 +774,40 @@ extern int ctcp_send_create_ctrl_session_result (void *inlink,
             break;
     }
 
+    /* negotiated values are answered only if asked */
+    if (max_frame_size != 0)
+    {
+        data_len += CTCP_MAX_FRAME_SIZE_DATA_LEN;
+    }
+
+    if (features != CTCP_FEATURE_NOT_REQUESTED)
+    {
+        data_len += CTCP_FEATURES_DATA_LEN;
+    }
+
     /* make protocol header */
     CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
                                                    (char)CTCP_CREATE_JOB_SESSION_RESULT,
                                                    (char)result_code,
                                                    job_desc,
                                                    sgid,
-                                                   0),
+                                                   data_len),
                         err_make_protocol_header_label);
 
+    if (max_frame_size != 0)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                              &max_frame_size),
+                            err_write_frame_size_label);
+    }
+
+    if (features != CTCP_FEATURE_NOT_REQUESTED)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                              &features),
+                            err_write_frame_size_label);
+    }
+
     /* send result */
     CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
 
@@ -506,6 +821,10 @@ extern int ctcp_send_create_ctrl_session_result (void *inlink,
     {
         /* ERROR: */
     }
+    CTC_EXCEPTION (err_write_frame_size_label)
+    {
+        /* ERROR: */
+    }
     CTC_EXCEPTION (err_link_send_label)
     {
         /* ERROR: */
@@ -526,6 +845,7 @@ extern int ctcp_do_destroy_ctrl_session (int sgid, int *result_code)
     if (sg != NULL)
     {
         result = ctcs_sg_finalize (sg); 
+        ctcs_sg_put (sg);
         CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_sg_finalize_label);
 
         *result_code = CTCP_RC_SUCCESS;
@@ -610,6 +930,8 @@ extern int ctcp_do_create_job_session (void *inlink,
                                        int *result_code)
 {
     int result;
+    int zerocopy = 0;
+    int send_queue_size = 0;
     unsigned short job_id;
     CTCS_SESSION_GROUP *sg = NULL; 
     CTCN_LINK *link = (CTCN_LINK *)inlink;
@@ -618,12 +940,41 @@ extern int ctcp_do_create_job_session (void *inlink,
 
     if (sg != NULL)
     {
+        /* job link carries frames as large as the control session's */
+        CTC_TEST_EXCEPTION (ctcn_link_set_max_frame_size (link,
+                                                          sg->ctrl_session.link->max_frame_size),
+                            err_add_job_label);
+
+        (void)ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_SEND_ZEROCOPY,
+                                        CTCG_CONF_ITEM_VAL_SET_INT,
+                                        (void *)&zerocopy);
+
+        if (zerocopy == 1)
+        {
+            /* copied as before when not supported */
+            (void)ctcn_link_set_zerocopy (link);
+        }
+
         /* add job session */
         result = ctcs_sg_add_job (sg, link, &job_id);
         CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_add_job_label);
+
+        /* capture workers queue frames, the reactor writes them. 
+         * blocking sends as before when the link cannot be watched. */
+        if (ctcn_reactor_add_link (link, NULL, NULL, NULL) == CTC_SUCCESS)
+        {
+            (void)ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_SEND_QUEUE_SIZE,
+                                            CTCG_CONF_ITEM_VAL_SET_INT,
+                                            (void *)&send_queue_size);
+
+            (void)ctcn_link_set_send_queue (link, 
+                                            (unsigned long)send_queue_size);
+        }
     
         *job_desc = job_id;
         *result_code = CTCP_RC_SUCCESS;
+
+        ctcs_sg_put (sg);
     }
     else
     {
@@ -634,6 +985,8 @@ extern int ctcp_do_create_job_session (void *inlink,
 
     CTC_EXCEPTION (err_add_job_label)
     {
+        ctcs_sg_put (sg);
+
         switch (result)
         {
             case CTC_ERR_EXCEED_MAX_FAILED: 
@@ -724,7 +1077,8 @@ extern int ctcp_do_destroy_job_session (void *inlink,
     if (sg != NULL)
     {
         result = ctcs_sg_delete_job (sg, job_desc);
-    
+        ctcs_sg_put (sg);
+
         CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                             err_destroy_job_session_label);
 
@@ -818,6 +1172,7 @@ extern int ctcp_do_request_job_status (void *inlink,
                                        CTCP_HEADER *header,
                                        unsigned short job_desc,
                                        int *status,
+                                       CTCJ_JOB_QUEUE_STAT *queue_stat,
                                        int *result_code)
 {
     int result;
@@ -831,7 +1186,8 @@ extern int ctcp_do_request_job_status (void *inlink,
 
     if (sg != NULL)
     {
-        result = ctcs_sg_get_job_status (sg, job_desc, &job_status);
+        result = ctcs_sg_get_job_status (sg, job_desc, &job_status, queue_stat);
+        ctcs_sg_put (sg);
 
         CTC_COND_EXCEPTION (result != CTC_SUCCESS,
                             err_get_job_status_failed_label);
@@ -877,8 +1233,10 @@ extern int ctcp_send_request_job_status_result (void *inlink,
                                                 int result_code,
                                                 unsigned short job_desc,
                                                 int sgid,
-                                                int status)
+                                                int status,
+                                                CTCJ_JOB_QUEUE_STAT *queue_stat)
 {
+    int data_len = 0;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
     /* link validation */
     CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
@@ -890,6 +1248,10 @@ extern int ctcp_send_request_job_status_result (void *inlink,
 
             CTC_TEST_EXCEPTION (ctcp_validate_job_desc ((int)job_desc),
                                 err_job_desc);
+
+            /* status, queue size, queue used, queue high water mark,
+             * delivered bytes */
+            data_len = CTCP_JOB_STATUS_RESULT_DATA_LEN;
             break;
 
         case CTCP_RC_FAILED_INVALID_HANDLE:
@@ -904,13 +1266,35 @@ extern int ctcp_send_request_job_status_result (void *inlink,
 
     /* make protocol header */
     CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
-                                                   (char)CTCP_CREATE_JOB_SESSION_RESULT,
+                                                   (char)CTCP_REQUEST_JOB_STATUS_RESULT,
                                                    (char)result_code,
                                                    job_desc,
                                                    sgid,
-                                                   0),
+                                                   data_len),
                         err_make_protocol_header_label);
 
+    if (data_len > 0)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, (void *)&status),
+                            err_link_write_failed_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                            (link, (void *)&queue_stat->size),
+                            err_link_write_failed_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                            (link, (void *)&queue_stat->used),
+                            err_link_write_failed_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                            (link, (void *)&queue_stat->high_water),
+                            err_link_write_failed_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_write_eight_byte_number 
+                            (link, (void *)&queue_stat->delivered_bytes),
+                            err_link_write_failed_label);
+    }
+
     /* send */
     CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
 
@@ -925,6 +1309,9 @@ extern int ctcp_send_request_job_status_result (void *inlink,
     CTC_EXCEPTION (err_make_protocol_header_label)
     {
     }
+    CTC_EXCEPTION (err_link_write_failed_label)
+    {
+    }
     CTC_EXCEPTION (err_link_send_label)
     {
     }
@@ -953,6 +1340,8 @@ extern int ctcp_do_request_server_status (void *inlink,
 
     if (sg != NULL)
     {
+        ctcs_sg_put (sg);
+
         ctc_get_server_status (&server_status);
 
         *status = server_status;    
@@ -1071,6 +1460,8 @@ extern int ctcp_do_register_table (void *inlink,
         {
             *result_code = CTCP_RC_FAILED_TABLE_ALREADY_EXIST;
         }
+
+        ctcs_sg_put (sg);
     }
     else
     {
@@ -1085,10 +1476,13 @@ extern int ctcp_do_register_table (void *inlink,
     }
     CTC_EXCEPTION (err_check_table_failed_label)
     {
+        ctcs_sg_put (sg);
         result = CTCP_RC_FAILED_INVALID_JOB;
     }
     CTC_EXCEPTION (err_register_table_label)
     {
+        ctcs_sg_put (sg);
+
         switch (result)
         {
             /* CTCP_RC code setting by result */
@@ -1221,6 +1615,8 @@ extern int ctcp_do_unregister_table (void *inlink,
         {
             *result_code = CTCP_RC_FAILED_UNREGISTERED_TABLE;
         }
+
+        ctcs_sg_put (sg);
     }
     else
     {
@@ -1235,10 +1631,13 @@ extern int ctcp_do_unregister_table (void *inlink,
     }
     CTC_EXCEPTION (err_check_table_failed_label)
     {
+        ctcs_sg_put (sg);
         result = CTC_ERR_INVALID_TABLE_NAME_FAILED;
     }
     CTC_EXCEPTION (err_unregister_table_failed_label)
     {
+        ctcs_sg_put (sg);
+
         switch (result)
         {
             /* CTCP_RC code setting by result */
@@ -1346,6 +1745,7 @@ extern int ctcp_do_set_job_attribute (void *inlink,
     if (sg != NULL)
     {
         result = ctcs_sg_set_job_attr (sg, job_desc, (CTCJ_JOB_ATTR *)job_attr);
+        ctcs_sg_put (sg);
 
         CTC_TEST_EXCEPTION (result != CTC_SUCCESS, 
                             err_set_job_attr_label); 
@@ -1453,14 +1853,14 @@ extern int ctcp_send_set_job_attribute_result (void *inlink,
 }
 
 
-/* capture */
-extern int ctcp_do_start_capture (void *inlink,
-                                  int sgid,
-                                  CTCP_HEADER *header,
-                                  unsigned short job_desc,
-                                  int *result_code)
+/* credit */
+extern int ctcp_do_grant_credit (void *inlink,
+                                 int sgid,
+                                 CTCP_HEADER *header,
+                                 unsigned short job_desc,
+                                 SINT_64 credit,
+                                 int *result_code)
 {
-    BOOL is_exist = CTC_FALSE;
     int result;
     CTCS_SESSION_GROUP *sg = NULL;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
@@ -1471,9 +1871,12 @@ extern int ctcp_do_start_capture (void *inlink,
 
     if (sg != NULL)
     {
-        result = ctcs_sg_start_capture (sg, job_desc);
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_start_capture_failed_label);
+        result = ctcs_sg_grant_credit (sg, 
+                                       job_desc, 
+                                       (int)header->op_param, 
+                                       credit);
+        ctcs_sg_put (sg);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_grant_credit_label);
 
         *result_code = CTCP_RC_SUCCESS;
     }
@@ -1488,25 +1891,15 @@ extern int ctcp_do_start_capture (void *inlink,
     {
         result = CTC_ERR_NULL_LINK_FAILED;
     }
-    CTC_EXCEPTION (err_start_capture_failed_label)
+    CTC_EXCEPTION (err_grant_credit_label)
     {
         switch (result)
         {
-            /* CTCP_RC code setting by result */
-            case CTC_ERR_INVALID_TABLE_NAME_FAILED:
-                *result_code = CTCP_RC_FAILED_INVALID_TABLE_NAME;
-                break;
-            case CTC_ERR_ALLOC_FAILED:
-                *result_code = CTCP_RC_FAILED_INSUFFICIENT_SERVER_RESOURCE;
-                break;
             case CTC_ERR_JOB_NOT_EXIST_FAILED:
                 *result_code = CTCP_RC_FAILED_INVALID_JOB;
                 break;
-            case CTC_ERR_JOB_ALREADY_STARTED:
-                *result_code = CTCP_RC_FAILED_JOB_ALREADY_STARTED;
-                break;
-            case CTC_ERR_INVALID_JOB_STATUS_FAILED:
-                *result_code = CTCP_RC_FAILED_INVALID_JOB_STATUS;
+            case CTC_ERR_INVALID_VALUE_FAILED:
+                *result_code = CTCP_RC_FAILED_OUT_OF_RANGE;
                 break;
             default:
                 *result_code = CTCP_RC_FAILED;
@@ -1519,26 +1912,21 @@ extern int ctcp_do_start_capture (void *inlink,
 }
 
 
-extern int ctcp_send_start_capture_result (void *inlink,
-                                           int result_code,
-                                           unsigned short job_desc,
-                                           int sgid)
+extern int ctcp_send_grant_credit_result (void *inlink,
+                                          int result_code,
+                                          unsigned short job_desc,
+                                          int sgid)
 {
     CTCN_LINK *link = (CTCN_LINK *)inlink;
-    /* link validation */
+
     CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
 
-    /* process by result code */
     switch (result_code)
     {
-        case CTCP_RC_SUCCESS:
-
-            CTC_TEST_EXCEPTION (ctcp_validate_job_desc ((int)job_desc),
-                                err_job_desc);
-            break;
-
+        case CTCP_RC_FAILED_WRONG_PACKET:
         case CTCP_RC_FAILED_INVALID_HANDLE:
         case CTCP_RC_FAILED_INVALID_JOB:
+        case CTCP_RC_FAILED_OUT_OF_RANGE:
             break;
 
         default:
@@ -1546,16 +1934,14 @@ extern int ctcp_send_start_capture_result (void *inlink,
             break;
     }
 
-    /* make protocol header */
     CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
-                                                   (char)CTCP_CREATE_JOB_SESSION_RESULT,
+                                                   (char)CTCP_GRANT_CREDIT_RESULT,
                                                    (char)result_code,
                                                    job_desc,
                                                    sgid,
                                                    0),
                         err_make_protocol_header_label);
 
-    /* send */
     CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
 
     return CTC_SUCCESS;
@@ -1564,10 +1950,6 @@ extern int ctcp_send_start_capture_result (void *inlink,
     {
         /* ERROR: */
     }
-    CTC_EXCEPTION (err_job_desc)
-    {
-        /* ERROR: */
-    }
     CTC_EXCEPTION (err_make_protocol_header_label)
     {
         /* ERROR: */
@@ -1582,523 +1964,2614 @@ extern int ctcp_send_start_capture_result (void *inlink,
 }
 
 
-extern int ctcp_send_captured_data_result (void *inlink,
-                                           unsigned short job_desc,
-                                           int sgid,
-                                           int trans_cnt,
-                                           void **trans_list)
+/* shared memory ring */
+extern int ctcp_do_attach_shm_ring (void *inlink,
+                                    int sgid,
+                                    unsigned short job_desc,
+                                    unsigned int ring_size,
+                                    void **ring,
+                                    int *result_code)
 {
-    BOOL is_ovf = CTC_FALSE;
-    int i;
     int result;
-    int remained_len;
-    int write_data_len;
-    int total_data_len;
-    int tid;
-    int result_code;
-    int str_len = 0;
-    int attr_num;
-    int start_offset;
-    int set_col_cnt;
-    int remained_item_cnt;
-    int read_item_cnt;
-    int num_of_item_wbuf_pos;
-    char *payload; /* TODO:*/
-    CTCL_ITEM *log_item = NULL;
-    CTCL_ITEM *next_log_item = NULL;
-    CTCL_COLUMN *set_col = NULL;
-    CTCL_COLUMN *key_col = NULL;
+    CTCS_SESSION_GROUP *sg = NULL;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
-//    CTCL_TRANS_LOG_LIST ***trans_log_list = (CTCL_TRANS_LOG_LIST ***)trans_list;
-    CTCL_TRANS_LOG_LIST *log_item_list;
-    CTCG_LIST_NODE *itr;
 
-    /* link validation */
     CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
 
-    /* about process by result code:
-     * in this case, acceptable result codes are only two
-     * and just send the result code generated from job thread
-     *
-     *  acceptable result codes :
-     *      CTCP_RC_SUCCESS 
-     *      CTCP_RC_SUCCESS_FRAGMENTED 
-     */
-    for (i = 0; i < trans_cnt; i++)
-    {
-//        log_item_list = (CTCL_TRANS_LOG_LIST *)trans_log_list[i];
-        log_item_list = (CTCL_TRANS_LOG_LIST *)trans_list[i];
-        start_offset = CTCP_HDR_LEN;
-        remained_item_cnt = log_item_list->item_num;
-        read_item_cnt = 0;
-        tid = log_item_list->tid;
-        log_item = log_item_list->head->next; 
-
-        while (remained_item_cnt > 0)
-        {
-            for (; read_item_cnt <= log_item_list->item_num;)
-            {
-                read_item_cnt++;
-                set_col_cnt = 0;
-                write_data_len = 0;
-                next_log_item = log_item->next;
-
-                /* 1. transaction id (4 BYTE) */
-                if (ctcn_link_write_four_byte_number (link, (void *)&tid) 
-                    != CTC_SUCCESS)
-                {
-                    is_ovf = CTC_TRUE;
-                    break;
-                }
-                else
-                {
-                    write_data_len += 4;
-                }
+    sg = ctcs_find_session_group_by_id (sgid);
 
-                /* 2. the number of items (4 BYTE) write later, 
-                 *    only increase write_data_len by offset */
-                if (ctcn_link_forward_wbuf_pos (link, sizeof (int)) 
-                    != CTC_SUCCESS)
-                {
-                    is_ovf = CTC_TRUE;
-                    break;
-                }
-                else
-                {
-                    num_of_item_wbuf_pos = CTCN_HDR_LEN + write_data_len;
-                    write_data_len += sizeof (int);
-                }
+    if (sg == NULL)
+    {
+        *result_code = CTCP_RC_FAILED_INVALID_HANDLE;
+    }
+    else if (ctcn_link_is_unix (link) != CTC_TRUE)
+    {
+        ctcs_sg_put (sg);
 
-                /* 3. table_name length (4 BYTE) */
-                str_len = strlen (log_item->table_name);
+        /* fds are passed over the control session */
+        *result_code = CTCP_RC_FAILED_NOT_LOCAL_SESSION;
+    }
+    else
+    {
+        result = ctcs_sg_attach_ring (sg, 
+                                      job_desc, 
+                                      ring_size, 
+                                      (CTCN_RING **)ring);
+        ctcs_sg_put (sg);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_attach_ring_label);
 
-                if (ctcn_link_write_four_byte_number (link, (void *)&str_len) 
-                    != CTC_SUCCESS)
-                {
-                    is_ovf = CTC_TRUE;
-                    break;
-                }
-                else
-                {
-                    write_data_len += 4;
-                }
+        *result_code = CTCP_RC_SUCCESS;
+    }
 
-                /* 4. table_name value (VARIABLE_LENGTH) */
-                if (ctcn_link_write (link, log_item->table_name, str_len) 
-                    != CTC_SUCCESS)
-                {
-                    is_ovf = CTC_TRUE;
-                    break;
-                }
-                else
-                {
-                    write_data_len += str_len;
-                }
+    return CTC_SUCCESS;
 
-                /* 5. stmt type (4 BYTE) */
-                if (ctcn_link_write_four_byte_number (link, (void *)&log_item->stmt_type) 
-                    != CTC_SUCCESS)
+    CTC_EXCEPTION (err_null_link_label)
+    {
+        result = CTC_ERR_NULL_LINK_FAILED;
+    }
+    CTC_EXCEPTION (err_attach_ring_label)
+    {
+        switch (result)
+        {
+            case CTC_ERR_JOB_NOT_EXIST_FAILED:
+                *result_code = CTCP_RC_FAILED_INVALID_JOB;
+                break;
+            case CTC_ERR_JOB_ALREADY_STARTED:
+                *result_code = CTCP_RC_FAILED_JOB_ALREADY_STARTED;
+                break;
+            case CTC_ERR_INVALID_JOB_STATUS_FAILED:
+                *result_code = CTCP_RC_FAILED_INVALID_JOB_STATUS;
+                break;
+            case CTC_ERR_INVALID_VALUE_FAILED:
+                *result_code = CTCP_RC_FAILED_OUT_OF_RANGE;
+                break;
+            case CTC_ERR_ALLOC_FAILED:
+            case CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED:
+                *result_code = CTCP_RC_FAILED_INSUFFICIENT_SERVER_RESOURCE;
+                break;
+            default:
+                *result_code = CTCP_RC_FAILED;
+                break;
+        }
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+extern int ctcp_send_attach_shm_ring_result (void *inlink,
+                                             int result_code,
+                                             unsigned short job_desc,
+                                             int sgid,
+                                             void *inring)
+{
+    int fds[CTCP_SHM_RING_FD_CNT];
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+    CTCN_RING *ring = (CTCN_RING *)inring;
+
+    CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
+
+    switch (result_code)
+    {
+        case CTCP_RC_SUCCESS:
+        case CTCP_RC_FAILED_WRONG_PACKET:
+        case CTCP_RC_FAILED_OUT_OF_RANGE:
+        case CTCP_RC_FAILED_INVALID_HANDLE:
+        case CTCP_RC_FAILED_INSUFFICIENT_SERVER_RESOURCE:
+        case CTCP_RC_FAILED_INVALID_JOB:
+        case CTCP_RC_FAILED_INVALID_JOB_STATUS:
+        case CTCP_RC_FAILED_JOB_ALREADY_STARTED:
+        case CTCP_RC_FAILED_NOT_LOCAL_SESSION:
+            break;
+
+        default:
+            result_code = CTCP_RC_FAILED;
+            break;
+    }
+
+    if (result_code == CTCP_RC_SUCCESS && ring != NULL)
+    {
+        CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
+                                                       (char)CTCP_ATTACH_SHM_RING_RESULT,
+                                                       (char)result_code,
+                                                       job_desc,
+                                                       sgid,
+                                                       CTCP_ATTACH_SHM_RING_RESULT_DATA_LEN),
+                            err_make_protocol_header_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                              &ring->data_size),
+                            err_link_write_label);
+
+        fds[0] = ring->mem_fd;
+        fds[1] = ring->data_fd;
+        fds[2] = ring->room_fd;
+
+        CTC_TEST_EXCEPTION (ctcn_link_send_fds (link, 
+                                                fds, 
+                                                CTCP_SHM_RING_FD_CNT), 
+                            err_link_send_label);
+    }
+    else
+    {
+        CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
+                                                       (char)CTCP_ATTACH_SHM_RING_RESULT,
+                                                       (char)(result_code == CTCP_RC_SUCCESS ?
+                                                              CTCP_RC_FAILED : result_code),
+                                                       job_desc,
+                                                       sgid,
+                                                       0),
+                            err_make_protocol_header_label);
+
+        CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_null_link_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_make_protocol_header_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_link_write_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_link_send_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/* capture */
+extern int ctcp_do_start_capture (void *inlink,
+                                  int sgid,
+                                  CTCP_HEADER *header,
+                                  unsigned short job_desc,
+                                  CTCL_STREAM_POS *start_pos,
+                                  int *result_code)
+{
+    BOOL is_exist = CTC_FALSE;
+    int result;
+    CTCS_SESSION_GROUP *sg = NULL;
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+
+    CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
+
+    sg = ctcs_find_session_group_by_id (sgid);
+
+    if (sg != NULL)
+    {
+        result = ctcs_sg_start_capture (sg, job_desc, start_pos);
+        ctcs_sg_put (sg);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                            err_start_capture_failed_label);
+
+        *result_code = CTCP_RC_SUCCESS;
+    }
+    else
+    {
+        *result_code = CTCP_RC_FAILED_INVALID_HANDLE;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_null_link_label)
+    {
+        result = CTC_ERR_NULL_LINK_FAILED;
+    }
+    CTC_EXCEPTION (err_start_capture_failed_label)
+    {
+        switch (result)
+        {
+            /* CTCP_RC code setting by result */
+            case CTC_ERR_INVALID_TABLE_NAME_FAILED:
+                *result_code = CTCP_RC_FAILED_INVALID_TABLE_NAME;
+                break;
+            case CTC_ERR_ALLOC_FAILED:
+                *result_code = CTCP_RC_FAILED_INSUFFICIENT_SERVER_RESOURCE;
+                break;
+            case CTC_ERR_JOB_NOT_EXIST_FAILED:
+                *result_code = CTCP_RC_FAILED_INVALID_JOB;
+                break;
+            case CTC_ERR_JOB_ALREADY_STARTED:
+                *result_code = CTCP_RC_FAILED_JOB_ALREADY_STARTED;
+                break;
+            case CTC_ERR_INVALID_JOB_STATUS_FAILED:
+                *result_code = CTCP_RC_FAILED_INVALID_JOB_STATUS;
+                break;
+            case CTC_ERR_INVALID_VALUE_FAILED:
+                *result_code = CTCP_RC_FAILED_OUT_OF_RANGE;
+                break;
+            case CTC_ERR_POSITION_NOT_AVAILABLE_FAILED:
+                *result_code = CTCP_RC_FAILED_POSITION_NOT_AVAILABLE;
+                break;
+            default:
+                *result_code = CTCP_RC_FAILED;
+                break;
+        }
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : read where capture starts from, op_param tells what 
+ *               follows the header
+ *
+ */
+static int ctcp_read_start_capture_pos (CTCN_LINK *link, 
+                                       CTCP_HEADER *header,
+                                       CTCL_STREAM_POS *start_pos)
+{
+    UINT_64 commit_lsa;
+
+    start_pos->lsa.pageid = 0;
+    start_pos->lsa.offset = 0;
+
+    switch ((unsigned char)header->op_param)
+    {
+        case CTCP_START_CAPTURE_POS_NOW:
+        case CTCP_PACKET_PARAM_NOT_USED:
+
+            start_pos->type = CTCL_STREAM_POS_NOW;
+            break;
+
+        case CTCP_START_CAPTURE_POS_LSA:
+
+            start_pos->type = CTCL_STREAM_POS_LSA;
+
+            /* as carried by captured data records */
+            CTC_TEST_EXCEPTION (ctcn_link_read_eight_byte_number 
+                                (link, (void *)&commit_lsa),
+                                err_wrong_packet_label);
+
+            CTCL_LSA_UNPACK (&start_pos->lsa, commit_lsa);
+            break;
+
+        default:
+            /* e.g. a commit seq, not valid across server restarts */
+            CTC_COND_EXCEPTION (CTC_TRUE, err_wrong_packet_label);
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_wrong_packet_label)
+    {
+        /* ERR_NOT_ENOUGH_DATA_IN_RBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+extern int ctcp_send_start_capture_result (void *inlink,
+                                           int result_code,
+                                           unsigned short job_desc,
+                                           int sgid)
+{
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+    /* link validation */
+    CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
+
+    /* process by result code */
+    switch (result_code)
+    {
+        case CTCP_RC_SUCCESS:
+
+            CTC_TEST_EXCEPTION (ctcp_validate_job_desc ((int)job_desc),
+                                err_job_desc);
+            break;
+
+        case CTCP_RC_FAILED_INVALID_HANDLE:
+        case CTCP_RC_FAILED_INVALID_JOB:
+        case CTCP_RC_FAILED_WRONG_PACKET:
+        case CTCP_RC_FAILED_OUT_OF_RANGE:
+        case CTCP_RC_FAILED_POSITION_NOT_AVAILABLE:
+            break;
+
+        default:
+            result_code = CTCP_RC_FAILED;
+            break;
+    }
+
+    /* make protocol header */
+    CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
+                                                   (char)CTCP_CREATE_JOB_SESSION_RESULT,
+                                                   (char)result_code,
+                                                   job_desc,
+                                                   sgid,
+                                                   0),
+                        err_make_protocol_header_label);
+
+    /* send */
+    CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_null_link_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_job_desc)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_make_protocol_header_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_link_send_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : write column name, type and value of a captured column
+ *
+ */
+static int ctcp_write_captured_column (CTCN_LINK *link, CTCL_COLUMN *col)
+{
+    /* column name length (4 BYTE) */
+    CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                          (void *)&col->name_len),
+                        err_write_buf_overflow_label);
+
+    /* column name (VARIABLE) */
+    CTC_TEST_EXCEPTION (ctcn_link_write (link, col->name, col->name_len),
+                        err_write_buf_overflow_label);
+
+    /* column type (4 BYTE) */
+    CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                          (void *)&col->type),
+                        err_write_buf_overflow_label);
+
+    /* column value length (4 BYTE), negative if NULL or not supported */
+    CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                          (void *)&col->val_len),
+                        err_write_buf_overflow_label);
+
+    /* column value (VARIABLE) */
+    if (col->val_len > 0)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_write (link, col->val, col->val_len),
+                            err_write_buf_overflow_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : write one log item of a transaction record, fails if it 
+ *               does not fit in the rest of write buffer
+ *
+ */
+static int ctcp_write_captured_item (CTCN_LINK *link, 
+                                     CTCL_ITEM *log_item,
+                                     int update_mode,
+                                     BOOL send_before_image)
+{
+    int str_len;
+    int set_col_cnt;
+    CTCL_COLUMN *set_col = NULL;
+    CTCG_LIST_NODE *itr;
+
+    /* 1. table_name length (4 BYTE) */
+    str_len = strlen (log_item->table_name);
+
+    CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                          (void *)&str_len),
+                        err_write_buf_overflow_label);
+
+    /* 2. table_name value (VARIABLE_LENGTH) */
+    CTC_TEST_EXCEPTION (ctcn_link_write (link, log_item->table_name, str_len),
+                        err_write_buf_overflow_label);
+
+    /* 3. stmt type (4 BYTE) */
+    CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                        (link, (void *)&log_item->stmt_type),
+                        err_write_buf_overflow_label);
+
+    switch (log_item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+
+            set_col_cnt = log_item->insert_log_info.set_col_cnt;
+
+            /* 4. set column count (4 BYTE)*/
+            CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                                (link, (void *)&set_col_cnt),
+                                err_write_buf_overflow_label);
+
+            /* 5. set column info */
+            CTCG_LIST_ITERATE (&(log_item->insert_log_info.set_col_list), itr)
+            {
+                set_col = (CTCL_COLUMN *)itr->obj;
+
+                CTC_TEST_EXCEPTION (ctcp_write_captured_column (link, set_col),
+                                    err_write_buf_overflow_label);
+            }
+
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+
+            /* 4. key column info */
+            CTC_TEST_EXCEPTION (ctcp_write_captured_column 
+                                (link, &log_item->update_log_info.key_col),
+                                err_write_buf_overflow_label);
+
+            if (update_mode == CTCJ_UPDATE_MODE_CHANGED_COLUMNS)
+            {
+                set_col_cnt = log_item->update_log_info.changed_col_cnt;
+            }
+            else
+            {
+                set_col_cnt = log_item->update_log_info.set_col_cnt;
+            }
+
+            /* 5. set column count (4 BYTE)*/
+            CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                                (link, (void *)&set_col_cnt),
+                                err_write_buf_overflow_label);
+
+            /* 6. set column info */
+            CTCG_LIST_ITERATE (&(log_item->update_log_info.set_col_list), itr)
+            {
+                set_col = (CTCL_COLUMN *)itr->obj;
+
+                if (update_mode == CTCJ_UPDATE_MODE_CHANGED_COLUMNS &&
+                    set_col->is_changed != CTC_TRUE)
+                {
+                    continue;
+                }
+
+                CTC_TEST_EXCEPTION (ctcp_write_captured_column (link, set_col),
+                                    err_write_buf_overflow_label);
+
+                if (send_before_image != CTC_TRUE)
+                {
+                    continue;
+                }
+
+                /* before-image value length (4 BYTE), 
+                 * negative if NULL, not supported or not logged */
+                CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number 
+                                    (link, (void *)&set_col->old_val_len),
+                                    err_write_buf_overflow_label);
+
+                /* before-image value (VARIABLE) */
+                if (set_col->old_val_len > 0)
+                {
+                    CTC_TEST_EXCEPTION (ctcn_link_write (link, 
+                                                         set_col->old_val, 
+                                                         set_col->old_val_len),
+                                        err_write_buf_overflow_label);
+                }
+            }
+
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+
+            /* 4. key column info */
+            CTC_TEST_EXCEPTION (ctcp_write_captured_column 
+                                (link, &log_item->delete_log_info.key_col),
+                                err_write_buf_overflow_label);
+            break;
+
+        default:
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : id of a table entry (table_id CTCP_DICT_ID_NULL) or of a
+ *               column entry of table_id, added when it is new
+ *
+ */
+static int ctcp_dict_get_id (int table_id,
+                             int type,
+                             const char *name,
+                             int name_len,
+                             int *id)
+{
+    int i;
+    int new_size;
+    unsigned int hash = 2166136261U;
+    CTCP_DICT_ENTRY *entry;
+    CTCP_DICT_ENTRY **new_entry;
+
+    /* FNV-1a */
+    for (i = 0; i < name_len; i++)
+    {
+        hash = (hash ^ (unsigned char)name[i]) * 16777619U;
+    }
+
+    hash = (hash ^ (unsigned int)table_id) * 16777619U;
+    hash = (hash ^ (unsigned int)type) * 16777619U;
+    hash %= CTCP_DICT_BUCKET_CNT;
+
+    pthread_mutex_lock (&ctcp_Dict.lock);
+
+    for (entry = ctcp_Dict.bucket[hash]; 
+         entry != NULL; 
+         entry = entry->hash_next)
+    {
+        if (entry->table_id == table_id && 
+            entry->type == type &&
+            entry->name_len == name_len &&
+            memcmp (entry->name, name, name_len) == 0)
+        {
+            *id = entry->id;
+
+            pthread_mutex_unlock (&ctcp_Dict.lock);
+
+            return CTC_SUCCESS;
+        }
+    }
+
+    if (ctcp_Dict.entry_cnt == ctcp_Dict.entry_size)
+    {
+        new_size = (ctcp_Dict.entry_size == 0) ? 
+                   CTCP_DICT_BUCKET_CNT : ctcp_Dict.entry_size * 2;
+
+        new_entry = (CTCP_DICT_ENTRY **)realloc (ctcp_Dict.entry, 
+                                                 new_size * 
+                                                 sizeof (CTCP_DICT_ENTRY *));
+        CTC_COND_EXCEPTION (new_entry == NULL, err_alloc_failed_label);
+
+        ctcp_Dict.entry = new_entry;
+        ctcp_Dict.entry_size = new_size;
+    }
+
+    entry = (CTCP_DICT_ENTRY *)malloc (sizeof (CTCP_DICT_ENTRY) + name_len);
+    CTC_COND_EXCEPTION (entry == NULL, err_alloc_failed_label);
+
+    entry->id = ctcp_Dict.entry_cnt;
+    entry->table_id = table_id;
+    entry->type = type;
+    entry->name_len = name_len;
+    memcpy (entry->name, name, name_len);
+
+    entry->hash_next = ctcp_Dict.bucket[hash];
+    ctcp_Dict.bucket[hash] = entry;
+
+    ctcp_Dict.entry[ctcp_Dict.entry_cnt++] = entry;
+
+    *id = entry->id;
+
+    pthread_mutex_unlock (&ctcp_Dict.lock);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        pthread_mutex_unlock (&ctcp_Dict.lock);
+    }
+    EXCEPTION_END;
+
+    return CTC_ERR_ALLOC_FAILED;
+}
+
+
+/* entries are never freed while the server runs */
+static CTCP_DICT_ENTRY *ctcp_dict_get_entry (int id)
+{
+    CTCP_DICT_ENTRY *entry;
+
+    pthread_mutex_lock (&ctcp_Dict.lock);
+    entry = ctcp_Dict.entry[id];
+    pthread_mutex_unlock (&ctcp_Dict.lock);
+
+    return entry;
+}
+
+
+/*
+ * Description : remember id once for the transaction being encoded
+ *
+ */
+static int ctcp_add_dict_ref (CTCP_DICT_REFS *refs, int id)
+{
+    int new_size;
+    int *new_id;
+    unsigned char *new_seen;
+
+    if (id / 8 >= refs->seen_size)
+    {
+        new_size = (id / 8) * 2 + 64;
+
+        new_seen = (unsigned char *)realloc (refs->seen, new_size);
+        CTC_COND_EXCEPTION (new_seen == NULL, err_alloc_failed_label);
+
+        memset (new_seen + refs->seen_size, 0, new_size - refs->seen_size);
+
+        refs->seen = new_seen;
+        refs->seen_size = new_size;
+    }
+
+    if ((refs->seen[id / 8] & (1 << (id % 8))) != 0)
+    {
+        return CTC_SUCCESS;
+    }
+
+    if (refs->cnt == refs->size)
+    {
+        new_size = refs->size * 2 + 16;
+
+        new_id = (int *)realloc (refs->id, new_size * sizeof (int));
+        CTC_COND_EXCEPTION (new_id == NULL, err_alloc_failed_label);
+
+        refs->id = new_id;
+        refs->size = new_size;
+    }
+
+    refs->seen[id / 8] |= (unsigned char)(1 << (id % 8));
+    refs->id[refs->cnt++] = id;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    EXCEPTION_END;
+
+    return CTC_ERR_ALLOC_FAILED;
+}
+
+
+static int ctcp_get_varint_len (UINT_64 val)
+{
+    int len = 1;
+
+    while (val >= 0x80)
+    {
+        val >>= 7;
+        len++;
+    }
+
+    return len;
+}
+
+
+/*
+ * Description : write val as LEB128, see CTCP_RC_FLAG_COMPACT
+ *
+ */
+static int ctcp_write_varint (CTCN_LINK *link, UINT_64 val)
+{
+    int len = 0;
+    unsigned char buf[CTCP_VARINT_MAX_LEN];
+
+    while (val >= 0x80)
+    {
+        buf[len++] = (unsigned char)(val | 0x80);
+        val >>= 7;
+    }
+
+    buf[len++] = (unsigned char)val;
+
+    return ctcn_link_write (link, buf, len);
+}
+
+
+/*
+ * Description : write column id and value of a captured column, its name
+ *               and type are in the dictionary
+ *
+ */
+static int ctcp_write_compact_column (CTCN_LINK *link, 
+                                      int table_id,
+                                      CTCL_COLUMN *col,
+                                      CTCP_DICT_REFS *refs)
+{
+    int col_id;
+
+    CTC_TEST_EXCEPTION (ctcp_dict_get_id (table_id, 
+                                          col->type, 
+                                          col->name, 
+                                          col->name_len, 
+                                          &col_id),
+                        err_dict_failed_label);
+    CTC_TEST_EXCEPTION (ctcp_add_dict_ref (refs, col_id),
+                        err_dict_failed_label);
+
+    /* column id (VARINT) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)col_id),
+                        err_write_buf_overflow_label);
+
+    /* column value length (ZIGZAG VARINT) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, CTCP_ZIGZAG (col->val_len)),
+                        err_write_buf_overflow_label);
+
+    /* column value (VARIABLE) */
+    if (col->val_len > 0)
+    {
+        CTC_TEST_EXCEPTION (ctcn_link_write (link, col->val, col->val_len),
+                            err_write_buf_overflow_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_dict_failed_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : compact form of ctcp_write_captured_item, dictionary 
+ *               entries the item refers to are added to refs
+ *
+ */
+static int ctcp_write_compact_item (CTCN_LINK *link, 
+                                    CTCL_ITEM *log_item,
+                                    int update_mode,
+                                    BOOL send_before_image,
+                                    CTCP_DICT_REFS *refs)
+{
+    int table_id;
+    int set_col_cnt;
+    CTCL_COLUMN *set_col = NULL;
+    CTCG_LIST_NODE *itr;
+
+    CTC_TEST_EXCEPTION (ctcp_dict_get_id (CTCP_DICT_ID_NULL, 
+                                          0,
+                                          log_item->table_name, 
+                                          strlen (log_item->table_name), 
+                                          &table_id),
+                        err_dict_failed_label);
+    CTC_TEST_EXCEPTION (ctcp_add_dict_ref (refs, table_id),
+                        err_dict_failed_label);
+
+    /* 1. table id (VARINT) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)table_id),
+                        err_write_buf_overflow_label);
+
+    /* 2. stmt type (VARINT) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                           (UINT_64)(unsigned int)log_item->stmt_type),
+                        err_write_buf_overflow_label);
+
+    switch (log_item->stmt_type)
+    {
+        case CTCL_STMT_TYPE_INSERT:
+
+            set_col_cnt = log_item->insert_log_info.set_col_cnt;
+
+            /* 3. set column count (VARINT) */
+            CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)set_col_cnt),
+                                err_write_buf_overflow_label);
+
+            /* 4. set column info */
+            CTCG_LIST_ITERATE (&(log_item->insert_log_info.set_col_list), itr)
+            {
+                set_col = (CTCL_COLUMN *)itr->obj;
+
+                CTC_TEST_EXCEPTION (ctcp_write_compact_column (link, 
+                                                               table_id,
+                                                               set_col,
+                                                               refs),
+                                    err_write_buf_overflow_label);
+            }
+
+            break;
+
+        case CTCL_STMT_TYPE_UPDATE:
+
+            /* 3. key column info */
+            CTC_TEST_EXCEPTION (ctcp_write_compact_column 
+                                (link, 
+                                 table_id,
+                                 &log_item->update_log_info.key_col,
+                                 refs),
+                                err_write_buf_overflow_label);
+
+            if (update_mode == CTCJ_UPDATE_MODE_CHANGED_COLUMNS)
+            {
+                set_col_cnt = log_item->update_log_info.changed_col_cnt;
+            }
+            else
+            {
+                set_col_cnt = log_item->update_log_info.set_col_cnt;
+            }
+
+            /* 4. set column count (VARINT) */
+            CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)set_col_cnt),
+                                err_write_buf_overflow_label);
+
+            /* 5. set column info */
+            CTCG_LIST_ITERATE (&(log_item->update_log_info.set_col_list), itr)
+            {
+                set_col = (CTCL_COLUMN *)itr->obj;
+
+                if (update_mode == CTCJ_UPDATE_MODE_CHANGED_COLUMNS &&
+                    set_col->is_changed != CTC_TRUE)
                 {
-                    is_ovf = CTC_TRUE;
-                    break;
+                    continue;
                 }
-                else
+
+                CTC_TEST_EXCEPTION (ctcp_write_compact_column (link, 
+                                                               table_id,
+                                                               set_col,
+                                                               refs),
+                                    err_write_buf_overflow_label);
+
+                if (send_before_image != CTC_TRUE)
+                {
+                    continue;
+                }
+
+                /* before-image value length (ZIGZAG VARINT) */
+                CTC_TEST_EXCEPTION (ctcp_write_varint 
+                                    (link, 
+                                     CTCP_ZIGZAG (set_col->old_val_len)),
+                                    err_write_buf_overflow_label);
+
+                /* before-image value (VARIABLE) */
+                if (set_col->old_val_len > 0)
                 {
-                    write_data_len += 4;
+                    CTC_TEST_EXCEPTION (ctcn_link_write (link, 
+                                                         set_col->old_val, 
+                                                         set_col->old_val_len),
+                                        err_write_buf_overflow_label);
                 }
+            }
+
+            break;
+
+        case CTCL_STMT_TYPE_DELETE:
+
+            /* 3. key column info */
+            CTC_TEST_EXCEPTION (ctcp_write_compact_column 
+                                (link, 
+                                 table_id,
+                                 &log_item->delete_log_info.key_col,
+                                 refs),
+                                err_write_buf_overflow_label);
+            break;
+
+        default:
+            break;
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_dict_failed_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : fill the item count of a transaction record written 
+ *               at rec_pos, write position is kept
+ *
+ */
+static void ctcp_fill_captured_item_cnt (CTCN_LINK *link, 
+                                         int rec_pos, 
+                                         int item_cnt)
+{
+    int wbuf_pos = link->wbuf_pos;
+
+    ctcn_link_move_wbuf_pos (link, 
+                             rec_pos + sizeof (int) + sizeof (UINT_64));
+    (void)ctcn_link_write_four_byte_number (link, (void *)&item_cnt);
+    ctcn_link_move_wbuf_pos (link, wbuf_pos);
+}
+
+
+/*
+ * Description : put header in front of the frame payload and send it
+ *
+ */
+static int ctcp_send_captured_data_frame (CTCN_LINK *link,
+                                          unsigned short job_desc,
+                                          int sgid,
+                                          int result_code,
+                                          CTCJ_CAPTURE_BATCH *batch)
+{
+    int wbuf_pos = link->wbuf_pos;
+    int data_len = CTCN_LINK_FRAME_LEN (link) - CTCP_HDR_LEN;
+    int credit_units;
+
+    /* header is written from the start of write buffer */
+    CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
+                                                   (char)CTCP_CAPTURED_DATA_RESULT,
+                                                   (char)(result_code | 
+                                                          batch->frame_flag),
+                                                   job_desc,
+                                                   sgid,
+                                                   data_len),
+                        err_make_protocol_header_label);
+
+    ctcn_link_move_wbuf_pos (link, wbuf_pos);
+
+    CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
+
+    batch->trans_cnt = 0;
+    batch->frame_flag = 0;
+
+    /* read by job status request */
+    __atomic_add_fetch (&batch->sent_bytes, 
+                        CTCP_HDR_LEN + data_len, 
+                        __ATOMIC_RELAXED);
+
+    /* units never granted are not counted, see ctcj_grant_credit */
+    credit_units = __atomic_load_n (&batch->credit_units, __ATOMIC_ACQUIRE);
+
+    if ((credit_units & CTCJ_CREDIT_UNIT_FRAMES) != 0)
+    {
+        (void)__atomic_sub_fetch (&batch->credit_frames, 1, __ATOMIC_SEQ_CST);
+    }
+
+    if ((credit_units & CTCJ_CREDIT_UNIT_BYTES) != 0)
+    {
+        (void)__atomic_sub_fetch (&batch->credit_bytes, 
+                                  CTCP_HDR_LEN + data_len, 
+                                  __ATOMIC_SEQ_CST);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_make_protocol_header_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_link_send_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : start a new frame, CTC_FALSE when the consumer granted no
+ *               credit for it. the frame is capped at the byte credit left,
+ *               frames never go beyond what was granted.
+ *
+ */
+static BOOL ctcp_open_captured_data_frame (CTCN_LINK *link,
+                                           CTCJ_CAPTURE_BATCH *batch)
+{
+    int credit_units;
+    SINT_64 credit_bytes;
+
+    /* units never granted are not counted, see ctcj_grant_credit */
+    credit_units = __atomic_load_n (&batch->credit_units, __ATOMIC_ACQUIRE);
+
+    if ((credit_units & CTCJ_CREDIT_UNIT_FRAMES) != 0 &&
+        __atomic_load_n (&batch->credit_frames, __ATOMIC_SEQ_CST) <= 0)
+    {
+        return CTC_FALSE;
+    }
+
+    batch->frame_limit = (int)link->max_frame_size;
+
+    if ((credit_units & CTCJ_CREDIT_UNIT_BYTES) != 0)
+    {
+        credit_bytes = __atomic_load_n (&batch->credit_bytes, __ATOMIC_SEQ_CST);
+
+        if (credit_bytes <= CTCP_HDR_LEN)
+        {
+            return CTC_FALSE;
+        }
+
+        if (credit_bytes < (SINT_64)batch->frame_limit)
+        {
+            batch->frame_limit = (int)credit_bytes;
+        }
+    }
+
+    batch->credit_need = 0;
+
+    /* header is made when it is sent */
+    ctcn_link_move_wbuf_pos (link, CTCP_HDR_LEN);
+
+    return CTC_TRUE;
+}
+
+
+/*
+ * Description : a piece of need bytes does not fit in an empty frame. it 
+ *               waits for a grant when the byte credit left capped the 
+ *               frame, CTC_FAILURE when it exceeds the negotiated frame.
+ *
+ */
+static int ctcp_wait_captured_data_credit (CTCN_LINK *link,
+                                           CTCJ_CAPTURE_BATCH *batch,
+                                           int need)
+{
+    /* 1 log item must fit in the negotiated frame */
+    CTC_COND_EXCEPTION (need > (int)link->max_frame_size, 
+                        err_write_buf_overflow_label);
+
+    /* empty frame is opened again with the next grant */
+    ctcn_link_truncate_wbuf (link, 0);
+    batch->frame_flag = 0;
+    batch->credit_need = need;
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : encode every item of a committed transaction once per 
+ *               variant into a block shared with the other jobs sending
+ *               it the same way. returned one is held by caller.
+ *
+ */
+static int ctcp_get_encoded_trans (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                   int update_mode,
+                                   BOOL send_before_image,
+                                   BOOL is_compact,
+                                   CTCL_ENCODED_TRANS **encoded)
+{
+    int result;
+    int variant;
+    int item_cnt = 0;
+    int item_len;
+    int data_len = 0;
+    int data_size;
+    int hdr_size;
+    int dict_pos = 0;
+    char *block = NULL;
+    char *new_block;
+    CTCL_ITEM *log_item;
+    CTCN_LINK *scratch = NULL;
+    CTCL_ENCODED_TRANS *new_encoded;
+    CTCP_DICT_REFS refs = { 0, 0, NULL, 0, NULL };
+
+    variant = CTCP_ENCODE_VARIANT (update_mode, send_before_image);
+
+    if (is_compact == CTC_TRUE)
+    {
+        variant |= CTCP_ENCODE_COMPACT;
+    }
+
+    *encoded = ctcl_trans_get_encoded (trans_log_list, variant);
+
+    if (*encoded != NULL)
+    {
+        /* already encoded by another job */
+        return CTC_SUCCESS;
+    }
+
+    for (log_item = trans_log_list->head; 
+         log_item != NULL; 
+         log_item = log_item->next)
+    {
+        item_cnt++;
+    }
+
+    /* an item is encoded in write buffer of scratch link, then copied.
+     * it grows up to the largest frame, a job with a smaller frame 
+     * rejects the item when sending */
+    CTC_TEST_EXCEPTION (ctcn_link_create (&scratch), err_alloc_failed_label);
+    CTC_TEST_EXCEPTION (ctcn_link_set_max_frame_size (scratch, 
+                                                      CTCN_LINK_FRAME_SIZE_MAX),
+                        err_alloc_failed_label);
+
+    hdr_size = sizeof (CTCL_ENCODED_TRANS) + item_cnt * sizeof (int);
+    data_size = CTCN_LINK_BUF_SIZE;
+
+    block = (char *)malloc (hdr_size + data_size);
+    CTC_COND_EXCEPTION (block == NULL, err_alloc_failed_label);
+
+    item_cnt = 0;
+
+    for (log_item = trans_log_list->head; 
+         log_item != NULL; 
+         log_item = log_item->next)
+    {
+        ctcn_link_move_wbuf_pos (scratch, 0);
+
+        /* 1 log item size must less than CTCN_LINK_FRAME_SIZE_MAX */
+        if (is_compact == CTC_TRUE)
+        {
+            CTC_TEST_EXCEPTION (ctcp_write_compact_item (scratch, 
+                                                         log_item, 
+                                                         update_mode, 
+                                                         send_before_image,
+                                                         &refs),
+                                err_write_buf_overflow_label);
+        }
+        else
+        {
+            CTC_TEST_EXCEPTION (ctcp_write_captured_item (scratch, 
+                                                          log_item, 
+                                                          update_mode, 
+                                                          send_before_image),
+                                err_write_buf_overflow_label);
+        }
+
+        item_len = scratch->wbuf_pos;
+
+        if (data_len + item_len > data_size)
+        {
+            data_size = data_size * 2 + item_len;
+
+            new_block = (char *)realloc (block, hdr_size + data_size);
+            CTC_COND_EXCEPTION (new_block == NULL, err_alloc_failed_label);
+
+            block = new_block;
+        }
+
+        memcpy (block + hdr_size + data_len, scratch->wbuf, item_len);
+        data_len += item_len;
+
+        ((int *)(block + sizeof (CTCL_ENCODED_TRANS)))[item_cnt++] = data_len;
+    }
+
+    ctcn_link_destroy (scratch);
+    scratch = NULL;
+
+    if (refs.cnt > 0)
+    {
+        /* ids referred go after data, aligned */
+        dict_pos = hdr_size + data_len;
+        dict_pos = (dict_pos + sizeof (int) - 1) & ~((int)sizeof (int) - 1);
+
+        new_block = (char *)realloc (block, dict_pos + refs.cnt * sizeof (int));
+        CTC_COND_EXCEPTION (new_block == NULL, err_alloc_failed_label);
+
+        block = new_block;
+
+        memcpy (block + dict_pos, refs.id, refs.cnt * sizeof (int));
+    }
+
+    new_encoded = (CTCL_ENCODED_TRANS *)block;
+    new_encoded->variant = variant;
+    new_encoded->ref_cnt = 1;
+    new_encoded->item_cnt = item_cnt;
+    new_encoded->item_end = (int *)(block + sizeof (CTCL_ENCODED_TRANS));
+    new_encoded->data = block + hdr_size;
+    new_encoded->dict_id_cnt = refs.cnt;
+    new_encoded->dict_id = (refs.cnt > 0) ? (int *)(block + dict_pos) : NULL;
+    new_encoded->batch_lsa = NULL;
+    new_encoded->batch_list = NULL;
+    new_encoded->next = NULL;
+
+    if (refs.id != NULL)
+    {
+        free (refs.id);
+    }
+
+    if (refs.seen != NULL)
+    {
+        free (refs.seen);
+    }
+
+    *encoded = ctcl_trans_add_encoded (trans_log_list, new_encoded);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        result = CTC_FAILURE;
+    }
+    EXCEPTION_END;
+
+    if (scratch != NULL)
+    {
+        ctcn_link_destroy (scratch);
+    }
+
+    if (block != NULL)
+    {
+        free (block);
+    }
+
+    if (refs.id != NULL)
+    {
+        free (refs.id);
+    }
+
+    if (refs.seen != NULL)
+    {
+        free (refs.seen);
+    }
+
+    return result;
+}
+
+
+/*
+ * Description : append kth item of encoded to the frame, CTC_FAILURE when
+ *               the frame would exceed frame_limit. a large one is sent 
+ *               from the shared block, which is held by the frame once per
+ *               record (is_held).
+ *
+ */
+static int ctcp_write_encoded_item (CTCN_LINK *link,
+                                    CTCL_ENCODED_TRANS *encoded,
+                                    int k,
+                                    int frame_limit,
+                                    BOOL *is_held)
+{
+    int item_start;
+    int item_len;
+
+    item_start = (k == 0) ? 0 : encoded->item_end[k - 1];
+    item_len = encoded->item_end[k] - item_start;
+
+    if (CTCN_LINK_FRAME_LEN (link) + item_len > frame_limit)
+    {
+        /* does not fit in the rest of frame */
+        return CTC_FAILURE;
+    }
+
+    if (item_len >= CTCP_ITEM_REF_MIN_LEN)
+    {
+        if (*is_held == CTC_FALSE)
+        {
+            ctcl_encoded_trans_hold (encoded);
+
+            if (ctcn_link_hold (link, 
+                                (void *)encoded, 
+                                ctcp_release_encoded_trans) == CTC_SUCCESS)
+            {
+                *is_held = CTC_TRUE;
+            }
+            else
+            {
+                ctcl_encoded_trans_release (encoded);
+            }
+        }
+
+        if (*is_held == CTC_TRUE &&
+            ctcn_link_write_ref (link, 
+                                 encoded->data + item_start, 
+                                 item_len) == CTC_SUCCESS)
+        {
+            return CTC_SUCCESS;
+        }
+    }
+
+    return ctcn_link_write (link, encoded->data + item_start, item_len);
+}
+
+
+static void ctcp_release_encoded_trans (void *encoded)
+{
+    ctcl_encoded_trans_release ((CTCL_ENCODED_TRANS *)encoded);
+}
+
+
+/*
+ * Description : work memory is not kept by threads, a job thread gone 
+ *               would leak it. a few free ones are kept for the next.
+ *
+ */
+static lzo_voidp ctcp_lzo_get_work_mem (void)
+{
+    lzo_voidp work_mem = NULL;
+
+    (void)pthread_mutex_lock (&ctcp_Lzo_pool.lock);
+
+    if (ctcp_Lzo_pool.free_cnt > 0)
+    {
+        work_mem = ctcp_Lzo_pool.free_mem[--ctcp_Lzo_pool.free_cnt];
+    }
+
+    (void)pthread_mutex_unlock (&ctcp_Lzo_pool.lock);
+
+    if (work_mem == NULL)
+    {
+        work_mem = (lzo_voidp)malloc (LZO1X_1_MEM_COMPRESS);
+    }
+
+    return work_mem;
+}
+
+
+static void ctcp_lzo_put_work_mem (lzo_voidp work_mem)
+{
+    if (work_mem == NULL)
+    {
+        return;
+    }
+
+    (void)pthread_mutex_lock (&ctcp_Lzo_pool.lock);
+
+    if (ctcp_Lzo_pool.free_cnt < CTCP_LZO_WORK_MEM_MAX)
+    {
+        ctcp_Lzo_pool.free_mem[ctcp_Lzo_pool.free_cnt++] = work_mem;
+        work_mem = NULL;
+    }
+
+    (void)pthread_mutex_unlock (&ctcp_Lzo_pool.lock);
+
+    free (work_mem);
+}
+
+
+/*
+ * Description : length of the record trans takes in the held frame, see
+ *               CTCP_RC_FLAG_COMPRESSED
+ *
+ */
+static int ctcp_get_batch_rec_len (CTCJ_CAPTURE_BATCH *batch,
+                                   int tid,
+                                   UINT_64 commit_lsa,
+                                   CTCL_ENCODED_TRANS *encoded)
+{
+    int items_len = 0;
+    int prev_tid = 0;
+    UINT_64 prev_commit_lsa = 0;
+
+    if (encoded->item_cnt > 0)
+    {
+        items_len = encoded->item_end[encoded->item_cnt - 1];
+    }
+
+    if ((encoded->variant & CTCP_ENCODE_COMPACT) == 0)
+    {
+        return sizeof (int) + sizeof (UINT_64) + sizeof (int) + items_len;
+    }
+
+    if (batch->held_cnt > 0)
+    {
+        prev_tid = batch->held_trans[batch->held_cnt - 1].tid;
+        prev_commit_lsa = batch->held_trans[batch->held_cnt - 1].commit_lsa;
+    }
+
+    return ctcp_get_varint_len (CTCP_ZIGZAG ((SINT_64)tid - 
+                                             (SINT_64)prev_tid)) +
+           ctcp_get_varint_len (CTCP_ZIGZAG ((SINT_64)(commit_lsa - 
+                                                       prev_commit_lsa))) +
+           ctcp_get_varint_len ((UINT_64)encoded->item_cnt) + 
+           items_len;
+}
+
+
+/*
+ * Description : lay the records of held transactions out in the frame,
+ *               uncompressed
+ *
+ */
+static int ctcp_write_batch_records (CTCN_LINK *link, CTCJ_CAPTURE_BATCH *batch)
+{
+    int i;
+    int items_len;
+    int prev_tid = 0;
+    UINT_64 prev_commit_lsa = 0;
+    CTCJ_BATCH_TRANS *held;
+
+    for (i = 0; i < batch->held_cnt; i++)
+    {
+        held = &batch->held_trans[i];
+
+        if ((held->encoded->variant & CTCP_ENCODE_COMPACT) != 0)
+        {
+            CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                                   CTCP_ZIGZAG ((SINT_64)held->tid - 
+                                                                (SINT_64)prev_tid)),
+                                err_write_buf_overflow_label);
+            CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                                   CTCP_ZIGZAG ((SINT_64)(held->commit_lsa - 
+                                                                          prev_commit_lsa))),
+                                err_write_buf_overflow_label);
+            CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                                   (UINT_64)held->encoded->item_cnt),
+                                err_write_buf_overflow_label);
+
+            prev_tid = held->tid;
+            prev_commit_lsa = held->commit_lsa;
+        }
+        else
+        {
+            CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                                  (void *)&held->tid),
+                                err_write_buf_overflow_label);
+            CTC_TEST_EXCEPTION (ctcn_link_write_eight_byte_number (link, 
+                                                                   (void *)&held->commit_lsa),
+                                err_write_buf_overflow_label);
+            CTC_TEST_EXCEPTION (ctcn_link_write_four_byte_number (link, 
+                                                                  (void *)&held->encoded->item_cnt),
+                                err_write_buf_overflow_label);
+        }
+
+        if (held->encoded->item_cnt > 0)
+        {
+            items_len = held->encoded->item_end[held->encoded->item_cnt - 1];
+
+            CTC_TEST_EXCEPTION (ctcn_link_write (link, 
+                                                 held->encoded->data, 
+                                                 items_len),
+                                err_write_buf_overflow_label);
+        }
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : compress the held transactions together and send them as
+ *               the one record of a compressed frame. the compressed block
+ *               is made once and shared by the jobs sending the same 
+ *               transactions in a frame the same way, see 
+ *               ctcl_encoded_add_batch.
+ *
+ */
+static int ctcp_send_compressed_batch (CTCN_LINK *link,
+                                       unsigned short job_desc,
+                                       int sgid,
+                                       CTCJ_CAPTURE_BATCH *batch)
+{
+    int i;
+    int result;
+    int variant;
+    int raw_len;
+    int stored_len;
+    int hdr_size;
+    int trans_cnt = batch->held_cnt;
+    lzo_uint out_len = 0;
+    lzo_voidp work_mem;
+    UINT_64 *lsa_list = NULL;
+    char *block = NULL;
+    char *new_block;
+    BOOL is_held = CTC_FALSE;
+    CTCL_ENCODED_TRANS *first = batch->held_trans[0].encoded;
+    CTCL_ENCODED_TRANS *compressed = NULL;
+    CTCL_ENCODED_TRANS *new_compressed;
+
+    variant = first->variant | CTCP_ENCODE_COMPRESSED;
+
+    lsa_list = (UINT_64 *)malloc (trans_cnt * sizeof (UINT_64));
+    CTC_COND_EXCEPTION (lsa_list == NULL, err_alloc_failed_label);
+
+    for (i = 0; i < trans_cnt; i++)
+    {
+        lsa_list[i] = batch->held_trans[i].commit_lsa;
+    }
+
+    compressed = ctcl_encoded_get_batch (first, variant, trans_cnt, lsa_list);
+
+    /* frame was opened with the first one held */
+    ctcn_link_move_wbuf_pos (link, CTCP_HDR_LEN);
+
+    if (compressed == NULL)
+    {
+        /* records are laid out in the frame, then compressed from there */
+        CTC_TEST_EXCEPTION (ctcp_write_batch_records (link, batch),
+                            err_write_buf_overflow_label);
+
+        raw_len = link->wbuf_pos - CTCP_HDR_LEN;
+
+        /* lsa list, then the one item end */
+        hdr_size = sizeof (CTCL_ENCODED_TRANS) + 
+                   trans_cnt * sizeof (UINT_64) + 
+                   sizeof (int);
+
+        /* worst case of LZO1X output */
+        block = (char *)malloc (hdr_size + 
+                                sizeof (int) * 3 + 
+                                raw_len + raw_len / 16 + 64 + 3);
+        CTC_COND_EXCEPTION (block == NULL, err_alloc_failed_label);
+
+        stored_len = raw_len;
+        work_mem = ctcp_lzo_get_work_mem ();
+
+        if (work_mem != NULL &&
+            lzo1x_1_compress ((const lzo_bytep)(link->wbuf + CTCP_HDR_LEN), 
+                              raw_len,
+                              (lzo_bytep)(block + hdr_size + sizeof (int) * 3),
+                              &out_len,
+                              work_mem) == LZO_E_OK &&
+            out_len < (lzo_uint)raw_len)
+        {
+            stored_len = (int)out_len;
+        }
+
+        ctcp_lzo_put_work_mem (work_mem);
+
+        if (stored_len == raw_len)
+        {
+            /* not worth it, sent as they are */
+            memcpy (block + hdr_size + sizeof (int) * 3, 
+                    link->wbuf + CTCP_HDR_LEN, 
+                    raw_len);
+        }
+
+        ctcn_link_truncate_wbuf (link, CTCP_HDR_LEN);
+
+        /* same byte order as ctcn_link_write_four_byte_number */
+        ((int *)(block + hdr_size))[0] = (int)htonl ((uint32_t)trans_cnt);
+        ((int *)(block + hdr_size))[1] = (int)htonl ((uint32_t)raw_len);
+        ((int *)(block + hdr_size))[2] = (int)htonl ((uint32_t)stored_len);
+
+        new_block = (char *)realloc (block, 
+                                     hdr_size + sizeof (int) * 3 + stored_len);
+
+        if (new_block != NULL)
+        {
+            block = new_block;
+        }
+
+        new_compressed = (CTCL_ENCODED_TRANS *)block;
+        new_compressed->variant = variant;
+        new_compressed->ref_cnt = 1;
+        new_compressed->item_cnt = trans_cnt;
+        new_compressed->batch_lsa = (UINT_64 *)(block + sizeof (CTCL_ENCODED_TRANS));
+        new_compressed->item_end = (int *)(new_compressed->batch_lsa + trans_cnt);
+        new_compressed->item_end[0] = sizeof (int) * 3 + stored_len;
+        new_compressed->data = block + hdr_size;
+        new_compressed->dict_id_cnt = 0;
+        new_compressed->dict_id = NULL;
+        new_compressed->batch_list = NULL;
+        new_compressed->next = NULL;
+
+        memcpy (new_compressed->batch_lsa, lsa_list, trans_cnt * sizeof (UINT_64));
+        block = NULL;
+
+        compressed = ctcl_encoded_add_batch (first, new_compressed);
+    }
+
+    free (lsa_list);
+    lsa_list = NULL;
+
+    /* records never exceed the frame, see ctcp_append_compressed_trans */
+    CTC_TEST_EXCEPTION (ctcp_write_encoded_item (link, 
+                                                 compressed, 
+                                                 0, 
+                                                 batch->frame_limit, 
+                                                 &is_held),
+                        err_write_buf_overflow_label);
+
+    ctcl_encoded_trans_release (compressed);
+    compressed = NULL;
+
+    ctcp_release_held_trans (batch);
+
+    batch->frame_flag = CTCP_RC_FLAG_COMPRESSED;
+
+    if ((variant & CTCP_ENCODE_COMPACT) != 0)
+    {
+        batch->frame_flag |= CTCP_RC_FLAG_COMPACT;
+    }
+
+    CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                       job_desc,
+                                                       sgid,
+                                                       CTCP_RC_SUCCESS,
+                                                       batch),
+                        err_send_frame_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        result = CTC_ERR_ALLOC_FAILED;
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        result = CTC_FAILURE;
+    }
+    CTC_EXCEPTION (err_send_frame_label)
+    {
+        result = CTC_FAILURE;
+    }
+    EXCEPTION_END;
+
+    if (compressed != NULL)
+    {
+        ctcl_encoded_trans_release (compressed);
+    }
+
+    if (block != NULL)
+    {
+        free (block);
+    }
+
+    if (lsa_list != NULL)
+    {
+        free (lsa_list);
+    }
+
+    return result;
+}
+
+
+static void ctcp_release_held_trans (CTCJ_CAPTURE_BATCH *batch)
+{
+    int i;
+
+    for (i = 0; i < batch->held_cnt; i++)
+    {
+        ctcl_encoded_trans_release (batch->held_trans[i].encoded);
+    }
+
+    batch->held_cnt = 0;
+    batch->held_len = 0;
+}
+
+
+/*
+ * Description : hold a transaction in the open frame, its records are 
+ *               compressed together when the frame is sent. the open 
+ *               frame is sent first when it holds uncompressed records or
+ *               has no room. is_appended is false when the record does not
+ *               fit even in an empty frame, it goes uncompressed then, or
+ *               when it waits for credit (is_credit_out).
+ *
+ */
+static int ctcp_append_compressed_trans (CTCN_LINK *link,
+                                         unsigned short job_desc,
+                                         int sgid,
+                                         CTCL_TRANS_LOG_LIST *trans_log_list,
+                                         CTCL_ENCODED_TRANS *encoded,
+                                         CTCJ_CAPTURE_BATCH *batch,
+                                         BOOL *is_appended,
+                                         BOOL *is_credit_out)
+{
+    int rec_len;
+    int new_size;
+    int tid = trans_log_list->tid;
+    UINT_64 commit_lsa = CTCL_LSA_PACK (&trans_log_list->commit_lsa);
+    CTCJ_BATCH_TRANS *new_held;
+
+    *is_appended = CTC_FALSE;
+
+    if (batch->sent_items > 0)
+    {
+        /* rest of a transaction split before goes uncompressed */
+        return CTC_SUCCESS;
+    }
+
+    rec_len = ctcp_get_batch_rec_len (batch, tid, commit_lsa, encoded);
+
+    /* compressed one is never longer, stored as it is then */
+    if (batch->held_cnt > 0 &&
+        CTCP_HDR_LEN + (int)sizeof (int) * 3 + batch->held_len + rec_len > 
+        batch->frame_limit)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_compressed_batch (link,
+                                                        job_desc,
+                                                        sgid,
+                                                        batch),
+                            err_send_frame_label);
+
+        /* deltas start over */
+        rec_len = ctcp_get_batch_rec_len (batch, tid, commit_lsa, encoded);
+    }
+
+    if (CTCP_HDR_LEN + (int)sizeof (int) * 3 + rec_len > 
+        (int)link->max_frame_size)
+    {
+        return CTC_SUCCESS;
+    }
+
+    if (link->wbuf_pos > CTCP_HDR_LEN)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS,
+                                                           batch),
+                            err_send_frame_label);
+    }
+
+    if (link->wbuf_pos < CTCP_HDR_LEN &&
+        ctcp_open_captured_data_frame (link, batch) != CTC_TRUE)
+    {
+        /* waits in the job queue for the next grant */
+        *is_credit_out = CTC_TRUE;
+        return CTC_SUCCESS;
+    }
+
+    if (batch->held_cnt == 0 &&
+        CTCP_HDR_LEN + (int)sizeof (int) * 3 + rec_len > batch->frame_limit)
+    {
+        CTC_TEST_EXCEPTION (ctcp_wait_captured_data_credit (link,
+                                                            batch,
+                                                            CTCP_HDR_LEN + 
+                                                            (int)sizeof (int) * 3 + 
+                                                            rec_len),
+                            err_write_buf_overflow_label);
+
+        *is_credit_out = CTC_TRUE;
+        return CTC_SUCCESS;
+    }
+
+    if (batch->held_cnt == batch->held_size)
+    {
+        new_size = batch->held_size * 2 + 16;
+
+        new_held = (CTCJ_BATCH_TRANS *)realloc (batch->held_trans, 
+                                                new_size * sizeof (CTCJ_BATCH_TRANS));
+        CTC_COND_EXCEPTION (new_held == NULL, err_alloc_failed_label);
 
-                switch (log_item->stmt_type)
-                {
-                    case CTCL_STMT_TYPE_INSERT:
+        batch->held_trans = new_held;
+        batch->held_size = new_size;
+    }
 
-                        set_col_cnt = log_item->insert_log_info.set_col_cnt;
-                        
-                        /* 6. set column count (4 BYTE)*/
-                        if (ctcn_link_write_four_byte_number (link, (void *)&set_col_cnt)
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+    ctcl_encoded_trans_hold (encoded);
 
-                        /* 7. set column info */
-                        CTCG_LIST_ITERATE (&(log_item->insert_log_info.set_col_list), itr)
-                        {
-                            set_col = (CTCL_COLUMN *)itr->obj;
+    batch->held_trans[batch->held_cnt].tid = tid;
+    batch->held_trans[batch->held_cnt].commit_lsa = commit_lsa;
+    batch->held_trans[batch->held_cnt].encoded = encoded;
+    batch->held_cnt++;
+    batch->held_len += rec_len;
 
-                            /* set column name length (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->name_len) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
+    batch->frame_flag = CTCP_RC_FLAG_COMPRESSED;
 
-                            /* set column name (VARIABLE) */
-                            if (ctcn_link_write (link, set_col->name, set_col->name_len) 
-                                != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += set_col->name_len;
-                            }
+    if ((encoded->variant & CTCP_ENCODE_COMPACT) != 0)
+    {
+        batch->frame_flag |= CTCP_RC_FLAG_COMPACT;
+    }
 
-                            /* set column type (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->type) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
+    batch->encoded_bytes += rec_len;
+    batch->trans_cnt++;
 
-                            /* set column value length (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->val_len) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
+    if (batch->trans_cnt >= batch->max_trans ||
+        batch->held_len >= batch->max_bytes)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_compressed_batch (link,
+                                                        job_desc,
+                                                        sgid,
+                                                        batch),
+                            err_send_frame_label);
+    }
 
-                            /* set column value (VARIABLE) */
-                            if (ctcn_link_write (link, set_col->val, set_col->val_len) 
-                                != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += set_col->val_len;
-                            }
-                        }
-                        
-                        break;
+    *is_appended = CTC_TRUE;
 
-                    case CTCL_STMT_TYPE_UPDATE:
+    return CTC_SUCCESS;
 
-                        key_col = &log_item->update_log_info.key_col;
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_send_frame_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
 
-                        /* 6. key column name length (4 BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->name_len) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+    return CTC_FAILURE;
+}
 
-                        /* 7. key column name (VARIABLE) */
-                        if (ctcn_link_write (link, key_col->name, key_col->name_len) 
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += key_col->name_len;
-                        }
 
-                        /* 8. key column type (4 BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->type) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+static int ctcp_write_dict_entry (CTCN_LINK *link, CTCP_DICT_ENTRY *entry)
+{
+    /* entry id, table id + 1 (VARINT) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)entry->id),
+                        err_write_buf_overflow_label);
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                           (UINT_64)(entry->table_id + 1)),
+                        err_write_buf_overflow_label);
 
-                        /* 9. key column value length (4BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->val_len) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+    if (entry->table_id != CTCP_DICT_ID_NULL)
+    {
+        /* column type (VARINT) */
+        CTC_TEST_EXCEPTION (ctcp_write_varint (link, 
+                                               (UINT_64)(unsigned int)entry->type),
+                            err_write_buf_overflow_label);
+    }
 
-                        /* 10. key column value (VARIABLE) */
-                        if (ctcn_link_write (link, key_col->val, key_col->val_len) 
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += key_col->val_len;
-                        }
+    /* name length (VARINT), name (VARIABLE) */
+    CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)entry->name_len),
+                        err_write_buf_overflow_label);
+    CTC_TEST_EXCEPTION (ctcn_link_write (link, entry->name, entry->name_len),
+                        err_write_buf_overflow_label);
 
-                        set_col_cnt = log_item->update_log_info.set_col_cnt;
+    return CTC_SUCCESS;
 
-                        /* 11. set column count (4 BYTE)*/
-                        if (ctcn_link_write_four_byte_number (link, (void *)&set_col_cnt)
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERR_NOT_ENOUGH_SPACE_IN_WBUF */
+    }
+    EXCEPTION_END;
 
-                        /* 12. set column info */
-                        CTCG_LIST_ITERATE (&(log_item->insert_log_info.set_col_list), itr)
-                        {
-                            set_col = (CTCL_COLUMN *)itr->obj;
+    return CTC_FAILURE;
+}
 
-                            /* set column name length (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->name_len) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
 
-                            /* set column name (VARIABLE) */
-                            if (ctcn_link_write (link, set_col->name, set_col->name_len) 
-                                != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += set_col->name_len;
-                            }
+/*
+ * Description : send the dictionary entries encoded refers to and the job
+ *               session has not got yet. the open frame is sent first, its
+ *               records do not refer to them. entries left wait for credit
+ *               when is_credit_out.
+ *
+ */
+static int ctcp_send_dict_entries (CTCN_LINK *link,
+                                   unsigned short job_desc,
+                                   int sgid,
+                                   CTCL_ENCODED_TRANS *encoded,
+                                   CTCJ_CAPTURE_BATCH *batch,
+                                   BOOL *is_credit_out)
+{
+    int i;
+    int id;
+    int result;
+    int new_size;
+    int entry_pos;
+    int entry_len;
+    unsigned char *new_sent;
+    CTCP_DICT_ENTRY *entry;
 
-                            /* set column type (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->type) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
+    for (i = 0; i < encoded->dict_id_cnt; i++)
+    {
+        id = encoded->dict_id[i];
+
+        if (id / 8 < batch->dict_sent_size &&
+            (batch->dict_sent[id / 8] & (1 << (id % 8))) != 0)
+        {
+            continue;
+        }
+
+        if (id / 8 >= batch->dict_sent_size)
+        {
+            new_size = (id / 8) * 2 + 64;
+
+            new_sent = (unsigned char *)realloc (batch->dict_sent, new_size);
+            CTC_COND_EXCEPTION (new_sent == NULL, err_alloc_failed_label);
+
+            memset (new_sent + batch->dict_sent_size, 
+                    0, 
+                    new_size - batch->dict_sent_size);
+
+            batch->dict_sent = new_sent;
+            batch->dict_sent_size = new_size;
+        }
+
+        if (batch->held_cnt > 0)
+        {
+            CTC_TEST_EXCEPTION (ctcp_send_compressed_batch (link,
+                                                            job_desc,
+                                                            sgid,
+                                                            batch),
+                                err_send_frame_label);
+        }
+
+        if (link->wbuf_pos > CTCP_HDR_LEN &&
+            batch->frame_flag != CTCP_RC_FLAG_DICTIONARY)
+        {
+            CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                               job_desc,
+                                                               sgid,
+                                                               CTCP_RC_SUCCESS,
+                                                               batch),
+                                err_send_frame_label);
+        }
+
+        if (link->wbuf_pos < CTCP_HDR_LEN &&
+            ctcp_open_captured_data_frame (link, batch) != CTC_TRUE)
+        {
+            /* entries left go with the next grant */
+            *is_credit_out = CTC_TRUE;
+            return CTC_SUCCESS;
+        }
+
+        batch->frame_flag = CTCP_RC_FLAG_DICTIONARY;
+
+        entry = ctcp_dict_get_entry (id);
+        entry_pos = link->wbuf_pos;
+
+        result = ctcp_write_dict_entry (link, entry);
+
+        if (result == CTC_SUCCESS &&
+            CTCN_LINK_FRAME_LEN (link) <= batch->frame_limit)
+        {
+            batch->dict_sent[id / 8] |= (unsigned char)(1 << (id % 8));
+            continue;
+        }
+
+        entry_len = link->wbuf_pos - entry_pos;
+        ctcn_link_truncate_wbuf (link, entry_pos);
+
+        if (entry_pos == CTCP_HDR_LEN)
+        {
+            /* a failed write is longer than the negotiated frame */
+            CTC_TEST_EXCEPTION (ctcp_wait_captured_data_credit (link,
+                                                                batch,
+                                                                (result == CTC_SUCCESS) ?
+                                                                CTCP_HDR_LEN + entry_len :
+                                                                (int)link->max_frame_size + 1),
+                                err_write_buf_overflow_label);
+
+            *is_credit_out = CTC_TRUE;
+            return CTC_SUCCESS;
+        }
+
+        /* entry goes to the next dictionary frame */
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS,
+                                                           batch),
+                            err_send_frame_label);
+        i--;
+    }
+
+    if (batch->frame_flag == CTCP_RC_FLAG_DICTIONARY)
+    {
+        /* records never go in a dictionary frame */
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS,
+                                                           batch),
+                            err_send_frame_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_alloc_failed_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_send_frame_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : append a transaction as compact records, see 
+ *               CTCP_RC_FLAG_COMPACT. items fitting the rest of frame are
+ *               counted before a record is written, the others continue
+ *               in the next frame as with plain records. items from 
+ *               batch->sent_items on are appended, the rest waits for 
+ *               credit when is_credit_out.
+ *
+ */
+static int ctcp_append_compact_trans (CTCN_LINK *link,
+                                      unsigned short job_desc,
+                                      int sgid,
+                                      CTCL_TRANS_LOG_LIST *trans_log_list,
+                                      CTCL_ENCODED_TRANS *encoded,
+                                      CTCJ_CAPTURE_BATCH *batch,
+                                      BOOL *is_credit_out)
+{
+    int i;
+    int k = batch->sent_items;
+    int item_cnt;
+    int item_start;
+    int rec_hdr_len;
+    int room;
+    int rec_frame_len;
+    UINT_64 tid_delta;
+    UINT_64 lsa_delta;
+    BOOL is_held;
+
+    for (;;)
+    {
+        if (link->wbuf_pos > CTCP_HDR_LEN &&
+            batch->frame_flag != CTCP_RC_FLAG_COMPACT)
+        {
+            CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                               job_desc,
+                                                               sgid,
+                                                               CTCP_RC_SUCCESS,
+                                                               batch),
+                                err_send_frame_label);
+        }
+
+        if (link->wbuf_pos < CTCP_HDR_LEN)
+        {
+            if (ctcp_open_captured_data_frame (link, batch) != CTC_TRUE)
+            {
+                /* rest of transaction goes with the next grant */
+                batch->sent_items = k;
+                *is_credit_out = CTC_TRUE;
+
+                return CTC_SUCCESS;
+            }
+
+            /* new frame, deltas start over */
+            batch->prev_tid = 0;
+            batch->prev_commit_lsa = 0;
+        }
+
+        batch->frame_flag = CTCP_RC_FLAG_COMPACT;
+
+        tid_delta = CTCP_ZIGZAG ((SINT_64)trans_log_list->tid - 
+                                 (SINT_64)batch->prev_tid);
+        lsa_delta = CTCP_ZIGZAG ((SINT_64)(CTCL_LSA_PACK (&trans_log_list->commit_lsa) - 
+                                           batch->prev_commit_lsa));
+
+        rec_frame_len = CTCN_LINK_FRAME_LEN (link);
+        rec_hdr_len = ctcp_get_varint_len (tid_delta) +
+                      ctcp_get_varint_len (lsa_delta) +
+                      ctcp_get_varint_len ((UINT_64)(encoded->item_cnt - k));
+
+        /* item count of the rest bounds that of this record */
+        room = batch->frame_limit - rec_frame_len - rec_hdr_len;
+
+        item_start = (k == 0) ? 0 : encoded->item_end[k - 1];
+        item_cnt = 0;
+
+        while (k + item_cnt < encoded->item_cnt &&
+               encoded->item_end[k + item_cnt] - item_start <= room)
+        {
+            item_cnt++;
+        }
+
+        if (room < 0 || (item_cnt == 0 && k < encoded->item_cnt))
+        {
+            if (link->wbuf_pos == CTCP_HDR_LEN)
+            {
+                /* not even the record of 1 log item fits */
+                CTC_TEST_EXCEPTION (ctcp_wait_captured_data_credit (link,
+                                                                    batch,
+                                                                    CTCP_HDR_LEN + 
+                                                                    rec_hdr_len +
+                                                                    ((k < encoded->item_cnt) ?
+                                                                     encoded->item_end[k] - item_start :
+                                                                     0)),
+                                    err_write_buf_overflow_label);
+
+                batch->sent_items = k;
+                *is_credit_out = CTC_TRUE;
+
+                return CTC_SUCCESS;
+            }
+
+            /* record starts in the next frame */
+            CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                               job_desc,
+                                                               sgid,
+                                                               CTCP_RC_SUCCESS,
+                                                               batch),
+                                err_send_frame_label);
+            continue;
+        }
+
+        /* room is checked above */
+        CTC_TEST_EXCEPTION (ctcp_write_varint (link, tid_delta),
+                            err_write_buf_overflow_label);
+        CTC_TEST_EXCEPTION (ctcp_write_varint (link, lsa_delta),
+                            err_write_buf_overflow_label);
+        CTC_TEST_EXCEPTION (ctcp_write_varint (link, (UINT_64)item_cnt),
+                            err_write_buf_overflow_label);
+
+        is_held = CTC_FALSE;
+
+        for (i = 0; i < item_cnt; i++)
+        {
+            CTC_TEST_EXCEPTION (ctcp_write_encoded_item (link, 
+                                                         encoded, 
+                                                         k + i, 
+                                                         batch->frame_limit,
+                                                         &is_held),
+                                err_write_buf_overflow_label);
+        }
+
+        k += item_cnt;
+
+        batch->prev_tid = trans_log_list->tid;
+        batch->prev_commit_lsa = CTCL_LSA_PACK (&trans_log_list->commit_lsa);
+        batch->encoded_bytes += CTCN_LINK_FRAME_LEN (link) - rec_frame_len;
+
+        if (k == encoded->item_cnt)
+        {
+            break;
+        }
+
+        /* rest of transaction continues in the next frame */
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS_FRAGMENTED,
+                                                           batch),
+                            err_send_frame_label);
+    }
+
+    batch->sent_items = 0;
+    batch->trans_cnt++;
+
+    if (batch->trans_cnt >= batch->max_trans ||
+        CTCN_LINK_FRAME_LEN (link) - CTCP_HDR_LEN >= batch->max_bytes)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS,
+                                                           batch),
+                            err_send_frame_label);
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_send_frame_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_write_buf_overflow_label)
+    {
+        /* ERROR: */
+    }
+    EXCEPTION_END;
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : append transactions to the open frame of job's data link.
+ *               payload of CTCP_CAPTURED_DATA_RESULT is a sequence of 
+ *               transaction records, 
+ *
+ *                 transaction id (4 BYTE) | commit lsa (8 BYTE) | 
+ *                 item count (4 BYTE) | items
+ *
+ *               commit lsa lets a client resume with CTCP_START_CAPTURE
+ *               after reconnecting, also to a restarted server. items are taken from the wire form
+ *               shared by jobs with the same update_mode and 
+ *               send_before_image, see ctcp_get_encoded_trans.
+ *               a frame is sent when it holds batch->max_trans transactions
+ *               or batch->max_bytes payload, the rest stays open until the
+ *               next call or ctcp_flush_captured_data_result. a transaction
+ *               not fitting in a frame is split by items, every frame but
+ *               the last of it is sent with CTCP_RC_SUCCESS_FRAGMENTED and 
+ *               its last record continues in the next frame.
+ *               with CTCP_FEATURE_COMPACT_ENCODING records are written
+ *               compact instead, after the dictionary entries they need.
+ *               with CTCP_FEATURE_COMPRESS_LZO transactions are held 
+ *               instead and their records compressed together when the
+ *               frame is sent.
+ *
+ *               frames stay within the credit granted by the consumer.
+ *               sent_cnt is the number of transactions appended, the next
+ *               one waits for a grant and is given again then. its items 
+ *               already sent are kept in batch->sent_items.
+ *
+ */
+extern int ctcp_send_captured_data_result (void *inlink,
+                                           unsigned short job_desc,
+                                           int sgid,
+                                           int trans_cnt,
+                                           void **trans_list,
+                                           int update_mode,
+                                           BOOL send_before_image,
+                                           CTCJ_CAPTURE_BATCH *batch,
+                                           int *sent_cnt)
+{
+    int i;
+    int k;
+    int tid;
+    UINT_64 commit_lsa;
+    int item_cnt = 0;
+    int item_len;
+    int rec_pos;
+    int rec_frame_len = 0;
+    BOOL is_held = CTC_FALSE;
+    BOOL is_appended;
+    BOOL is_credit_out = CTC_FALSE;
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+    CTCL_TRANS_LOG_LIST *log_item_list;
+    CTCL_ENCODED_TRANS *encoded = NULL;
 
-                            /* set column value length (4 BYTE) */
-                            if (ctcn_link_write_four_byte_number 
-                                (link, (void *)&set_col->val_len) != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += 4;
-                            }
+    *sent_cnt = 0;
 
-                            /* set column value (VARIABLE) */
-                            if (ctcn_link_write (link, set_col->val, set_col->val_len) 
-                                != CTC_SUCCESS)
-                            {
-                                is_ovf = CTC_TRUE;
-                                break;
-                            }
-                            else
-                            {
-                                write_data_len += set_col->val_len;
-                            }
-                        }
-                        
-                        break;
+    /* link validation */
+    CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
 
-                    case CTCL_STMT_TYPE_DELETE:
+    for (i = 0; i < trans_cnt && is_credit_out == CTC_FALSE; i++)
+    {
+        log_item_list = (CTCL_TRANS_LOG_LIST *)trans_list[i];
+        tid = log_item_list->tid;
+        commit_lsa = CTCL_LSA_PACK (&log_item_list->commit_lsa);
 
-                        key_col = &log_item->delete_log_info.key_col;
+        CTC_TEST_EXCEPTION (ctcp_get_encoded_trans (log_item_list,
+                                                    update_mode,
+                                                    send_before_image,
+                                                    batch->is_compact,
+                                                    &encoded),
+                            err_encode_failed_label);
 
-                        /* 6. key column name length (4 BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->name_len) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+        if (batch->is_compact == CTC_TRUE)
+        {
+            CTC_TEST_EXCEPTION (ctcp_send_dict_entries (link,
+                                                        job_desc,
+                                                        sgid,
+                                                        encoded,
+                                                        batch,
+                                                        &is_credit_out),
+                                err_send_frame_label);
+
+            if (is_credit_out == CTC_TRUE)
+            {
+                break;
+            }
+        }
 
-                        /* 7. key column name (VARIABLE) */
-                        if (ctcn_link_write (link, key_col->name, key_col->name_len) 
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += key_col->name_len;
-                        }
+        if (batch->is_compressed == CTC_TRUE)
+        {
+            CTC_TEST_EXCEPTION (ctcp_append_compressed_trans (link,
+                                                              job_desc,
+                                                              sgid,
+                                                              log_item_list,
+                                                              encoded,
+                                                              batch,
+                                                              &is_appended,
+                                                              &is_credit_out),
+                                err_send_frame_label);
+
+            if (is_appended == CTC_TRUE)
+            {
+                ctcl_encoded_trans_release (encoded);
+                encoded = NULL;
+                (*sent_cnt)++;
+                continue;
+            }
 
-                        /* 8. key column type (4 BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->type) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+            if (is_credit_out == CTC_TRUE)
+            {
+                break;
+            }
+        }
 
-                        /* 9. key column value length (4BYTE) */
-                        if (ctcn_link_write_four_byte_number 
-                            (link, (void *)&key_col->val_len) != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += 4;
-                        }
+        if (batch->is_compact == CTC_TRUE)
+        {
+            CTC_TEST_EXCEPTION (ctcp_append_compact_trans (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           log_item_list,
+                                                           encoded,
+                                                           batch,
+                                                           &is_credit_out),
+                                err_send_frame_label);
+
+            if (is_credit_out == CTC_TRUE)
+            {
+                break;
+            }
 
-                        /* 10. key column value (VARIABLE) */
-                        if (ctcn_link_write (link, key_col->val, key_col->val_len) 
-                            != CTC_SUCCESS)
-                        {
-                            is_ovf = CTC_TRUE;
-                            break;
-                        }
-                        else
-                        {
-                            write_data_len += key_col->val_len;
-                        }
+            ctcl_encoded_trans_release (encoded);
+            encoded = NULL;
+            (*sent_cnt)++;
+            continue;
+        }
 
-                        break;
+        if (batch->frame_flag != 0 && link->wbuf_pos > CTCP_HDR_LEN)
+        {
+            /* plain records do not go in a compressed frame */
+            CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                               job_desc,
+                                                               sgid,
+                                                               CTCP_RC_SUCCESS,
+                                                               batch),
+                                err_send_frame_label);
+        }
 
-                    default:
-                        break;
-                }
+        k = batch->sent_items;
+        rec_pos = -1;
 
-                if (is_ovf == CTC_TRUE)
+        while (rec_pos < 0 || k < encoded->item_cnt)
+        {
+            if (rec_pos < 0)
+            {
+                if (link->wbuf_pos < CTCP_HDR_LEN &&
+                    ctcp_open_captured_data_frame (link, batch) != CTC_TRUE)
                 {
+                    /* rest of transaction goes with the next grant */
+                    is_credit_out = CTC_TRUE;
                     break;
                 }
-                else
+
+                rec_pos = link->wbuf_pos;
+                rec_frame_len = CTCN_LINK_FRAME_LEN (link);
+                item_cnt = 0;
+                is_held = CTC_FALSE;
+
+                /* transaction id (4 BYTE), commit lsa (8 BYTE),
+                 * the number of items (4 BYTE) is filled later */
+                if (rec_frame_len + CTCP_CAPTURED_REC_HDR_LEN <= 
+                    batch->frame_limit &&
+                    ctcn_link_write_four_byte_number (link, (void *)&tid) 
+                    == CTC_SUCCESS &&
+                    ctcn_link_write_eight_byte_number (link, 
+                                                       (void *)&commit_lsa) 
+                    == CTC_SUCCESS &&
+                    ctcn_link_forward_wbuf_pos (link, sizeof (int)) 
+                    == CTC_SUCCESS)
                 {
-                    remained_item_cnt--;
                     continue;
                 }
+
+                ctcn_link_truncate_wbuf (link, rec_pos);
+                rec_pos = -1;
+
+                if (link->wbuf_pos == CTCP_HDR_LEN)
+                {
+                    /* not even the record of 1 log item fits */
+                    item_len = (k < encoded->item_cnt) ? 
+                               encoded->item_end[k] - 
+                               ((k == 0) ? 0 : encoded->item_end[k - 1]) : 
+                               0;
+
+                    CTC_TEST_EXCEPTION (ctcp_wait_captured_data_credit (link,
+                                                                        batch,
+                                                                        CTCP_HDR_LEN + 
+                                                                        CTCP_CAPTURED_REC_HDR_LEN + 
+                                                                        item_len),
+                                        err_write_buf_overflow_label);
+
+                    is_credit_out = CTC_TRUE;
+                    break;
+                }
+
+                /* record starts in the next frame */
+                CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                                   job_desc,
+                                                                   sgid,
+                                                                   CTCP_RC_SUCCESS,
+                                                                   batch),
+                                    err_send_frame_label);
+                continue;
             }
 
-            if (is_ovf != CTC_TRUE)
+            if (ctcp_write_encoded_item (link, 
+                                         encoded, 
+                                         k, 
+                                         batch->frame_limit, 
+                                         &is_held) == CTC_SUCCESS)
             {
-                total_data_len += write_data_len;
+                item_cnt++;
+                k++;
+                continue;
             }
-            else
-            {
-                /* adjust remained log item count */
-                /* 1 log record size must less than CTCP_PACKET_DATA_MAX_LEN */
-                read_item_cnt--;
 
-                CTC_TEST_EXCEPTION (ctcn_link_backward_wbuf_pos (link, write_data_len),
-                                    err_write_buf_overflow_label);
+            /* log item does not fit in the rest of frame */
+            if (item_cnt == 0)
+            {
+                /* move whole record to the next frame */
+                ctcn_link_truncate_wbuf (link, rec_pos);
 
-                /* initialize write data length */
-                write_data_len = 0;
+                if (rec_pos == CTCP_HDR_LEN)
+                {
+                    item_len = encoded->item_end[k] - 
+                               ((k == 0) ? 0 : encoded->item_end[k - 1]);
 
-                /* fill 2. the number of item (4BYTE) */
-                ctcn_link_move_wbuf_pos (link, num_of_item_wbuf_pos);
+                    CTC_TEST_EXCEPTION (ctcp_wait_captured_data_credit (link,
+                                                                        batch,
+                                                                        CTCP_HDR_LEN + 
+                                                                        CTCP_CAPTURED_REC_HDR_LEN + 
+                                                                        item_len),
+                                        err_write_buf_overflow_label);
 
-                (void)ctcn_link_write_four_byte_number (link, (void *)&read_item_cnt);
+                    is_credit_out = CTC_TRUE;
+                    break;
+                }
 
-                /* set result code */
-                result_code = CTCP_RC_SUCCESS_FRAGMENTED;
+                CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                                   job_desc,
+                                                                   sgid,
+                                                                   CTCP_RC_SUCCESS,
+                                                                   batch),
+                                    err_send_frame_label);
+            }
+            else
+            {
+                /* rest of transaction continues in the next frame */
+                ctcp_fill_captured_item_cnt (link, rec_pos, item_cnt);
+                batch->encoded_bytes += CTCN_LINK_FRAME_LEN (link) - rec_frame_len;
+
+                CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                                   job_desc,
+                                                                   sgid,
+                                                                   CTCP_RC_SUCCESS_FRAGMENTED,
+                                                                   batch),
+                                    err_send_frame_label);
+            }
 
-                /* make ctcp header */
-                CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
-                                                               (char)CTCP_CAPTURED_DATA_RESULT,
-                                                               (char)result_code,
-                                                               job_desc,
-                                                               sgid,
-                                                               total_data_len),
-                                    err_make_protocol_header_label);
+            rec_pos = -1;
+        }
 
-                /* send packet */
-                CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
-            }
+        if (is_credit_out == CTC_TRUE)
+        {
+            /* items before k were sent in fragmented frames */
+            batch->sent_items = k;
+            break;
         }
 
-        result_code = CTCP_RC_SUCCESS;
+        ctcl_encoded_trans_release (encoded);
+        encoded = NULL;
 
-        /* make protocol header */
-        CTC_TEST_EXCEPTION (ctcp_make_protocol_header (link,
-                                                       (char)CTCP_CAPTURED_DATA_RESULT,
-                                                       (char)result_code,
-                                                       job_desc,
-                                                       sgid,
-                                                       total_data_len),
-                            err_make_protocol_header_label);
+        ctcp_fill_captured_item_cnt (link, rec_pos, item_cnt);
+        batch->encoded_bytes += CTCN_LINK_FRAME_LEN (link) - rec_frame_len;
 
-        /* send */
-        CTC_TEST_EXCEPTION (ctcn_link_send (link), err_link_send_label);
+        batch->sent_items = 0;
+        batch->trans_cnt++;
+        (*sent_cnt)++;
 
-        if (log_item_list->ref_cnt > 0)
+        if (batch->trans_cnt >= batch->max_trans ||
+            CTCN_LINK_FRAME_LEN (link) - CTCP_HDR_LEN >= batch->max_bytes)
         {
-            log_item_list->ref_cnt--;
+            CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                               job_desc,
+                                                               sgid,
+                                                               CTCP_RC_SUCCESS,
+                                                               batch),
+                                err_send_frame_label);
         }
     }
 
+    if (encoded != NULL)
+    {
+        /* transaction waits for credit */
+        ctcl_encoded_trans_release (encoded);
+    }
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_null_link_label)
     {
         /* ERROR: */
     }
-    CTC_EXCEPTION (err_make_protocol_header_label)
+    CTC_EXCEPTION (err_encode_failed_label)
     {
         /* ERROR: */
+        ctcn_link_truncate_wbuf (link, 0);
+        ctcp_release_held_trans (batch);
+        batch->trans_cnt = 0;
+        batch->frame_flag = 0;
     }
-    CTC_EXCEPTION (err_link_write_failed_label)
+    CTC_EXCEPTION (err_write_buf_overflow_label)
     {
         /* ERROR: */
+        ctcn_link_truncate_wbuf (link, 0);
+        ctcp_release_held_trans (batch);
+        batch->trans_cnt = 0;
+        batch->frame_flag = 0;
     }
-    CTC_EXCEPTION (err_write_buf_overflow_label)
+    CTC_EXCEPTION (err_send_frame_label)
     {
         /* ERROR: */
+        ctcn_link_truncate_wbuf (link, 0);
+        ctcp_release_held_trans (batch);
+        batch->trans_cnt = 0;
+        batch->frame_flag = 0;
     }
-    CTC_EXCEPTION (err_link_send_label)
+    EXCEPTION_END;
+
+    if (encoded != NULL)
+    {
+        ctcl_encoded_trans_release (encoded);
+    }
+
+    return CTC_FAILURE;
+}
+
+
+/*
+ * Description : send the open frame of job's data link, if any
+ *
+ */
+extern int ctcp_flush_captured_data_result (void *inlink,
+                                            unsigned short job_desc,
+                                            int sgid,
+                                            CTCJ_CAPTURE_BATCH *batch)
+{
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+
+    CTC_COND_EXCEPTION (link == NULL, err_null_link_label);
+
+    if (batch->held_cnt > 0)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_compressed_batch (link,
+                                                        job_desc,
+                                                        sgid,
+                                                        batch),
+                            err_send_frame_label);
+    }
+    else if (batch->trans_cnt > 0)
+    {
+        CTC_TEST_EXCEPTION (ctcp_send_captured_data_frame (link,
+                                                           job_desc,
+                                                           sgid,
+                                                           CTCP_RC_SUCCESS,
+                                                           batch),
+                            err_send_frame_label);
+    }
+    else
+    {
+        /* no open frame */
+    }
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_null_link_label)
+    {
+        /* ERROR: */
+    }
+    CTC_EXCEPTION (err_send_frame_label)
     {
         /* ERROR: */
+        ctcn_link_truncate_wbuf (link, 0);
+        ctcp_release_held_trans (batch);
+        batch->trans_cnt = 0;
+        batch->frame_flag = 0;
     }
     EXCEPTION_END;
 
@@ -2125,6 +4598,7 @@ extern int ctcp_do_stop_capture (void *inlink,
     if (sg != NULL)
     {
         result = ctcs_sg_stop_capture (sg, job_desc, close_cond);
+        ctcs_sg_put (sg);
 
         CTC_COND_EXCEPTION (result != CTC_SUCCESS,
                             err_stop_capture_failed_label);
@@ -2231,7 +4705,6 @@ extern int ctcp_process_protocol (void *inlink, int sgid)
 {
     BOOL is_timeout = CTC_FALSE;
     int result; 
-    CTCP_HEADER header;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
 
     /* recv packet */
@@ -2242,6 +4715,38 @@ extern int ctcp_process_protocol (void *inlink, int sgid)
 
     CTC_COND_EXCEPTION (is_timeout == CTC_TRUE, err_timeout_exceed_label);
 
+    result = ctcp_process_received_protocol (link);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                        err_process_prcl_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_link_recv_socket_label)
+    {
+    }
+    CTC_EXCEPTION (err_timeout_exceed_label)
+    {
+    }
+    CTC_EXCEPTION (err_process_prcl_failed_label)
+    {
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : frame is already in rbuf of link, as the reactor 
+ *               hands it over
+ *
+ */
+extern int ctcp_process_received_protocol (void *inlink)
+{
+    int result; 
+    CTCP_HEADER header;
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+
     /* analyze protocol */
     CTC_TEST_EXCEPTION (ctcp_analyze_protocol_header (link,
                                                       CTCP_UNKNOWN_OPERATION,
@@ -2255,14 +4760,9 @@ extern int ctcp_process_protocol (void *inlink, int sgid)
 
     return CTC_SUCCESS;
 
-    CTC_EXCEPTION (err_link_recv_socket_label)
-    {
-    }
-    CTC_EXCEPTION (err_timeout_exceed_label)
-    {
-    }
     CTC_EXCEPTION (err_analyze_protocol_header)
     {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
     }
     CTC_EXCEPTION (err_execute_prcl_failed_label)
     {
@@ -2273,6 +4773,40 @@ extern int ctcp_process_protocol (void *inlink, int sgid)
 }
 
 
+/*
+ * Description : CTC_TRUE if the received frame asks for what waits on
+ *               capture workers, a capture to start or stop or a session
+ *               to destroy. the frame is read again by
+ *               ctcp_process_received_protocol.
+ *
+ */
+extern BOOL ctcp_is_waiting_protocol (void *inlink)
+{
+    CTCP_HEADER header;
+    CTCN_LINK *link = (CTCN_LINK *)inlink;
+
+    if (ctcp_analyze_protocol_header (link,
+                                      CTCP_UNKNOWN_OPERATION,
+                                      &header) != CTC_SUCCESS)
+    {
+        /* told to client as before */
+        return CTC_FALSE;
+    }
+
+    switch (header.op_id)
+    {
+        case CTCP_DESTROY_CONTROL_SESSION:
+        case CTCP_DESTROY_JOB_SESSION:
+        case CTCP_START_CAPTURE:
+        case CTCP_STOP_CAPTURE:
+            return CTC_TRUE;
+
+        default:
+            return CTC_FALSE;
+    }
+}
+
+
 
 static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
 {
@@ -2284,11 +4818,16 @@ static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
     int result_code;
     int status;
     int close_cond;
+    SINT_64 credit;
+    unsigned int ring_size;
+    void *ring;
     unsigned short job_desc;
     char user_name[CTC_NAME_LEN] = {0,};
     char table_name[CTC_NAME_LEN] = {0,};
     CTCJ_JOB_TAB_INFO tab_info;
     CTCJ_JOB_ATTR job_attr;
+    CTCJ_JOB_QUEUE_STAT queue_stat = {0,};
+    CTCL_STREAM_POS start_pos;
     CTCN_LINK *link = (CTCN_LINK *)inlink;
 
     assert (header != NULL);
@@ -2365,6 +4904,7 @@ static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
                                                  header,
                                                  job_desc,
                                                  &status,
+                                                 &queue_stat,
                                                  &result_code);
 
             CTC_COND_EXCEPTION (result != CTC_SUCCESS,
@@ -2374,7 +4914,8 @@ static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
                                                           result_code,
                                                           job_desc,
                                                           sgid,
-                                                          status);
+                                                          status,
+                                                          &queue_stat);
 
             CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                                 err_send_result_failed_label);
@@ -2593,16 +5134,99 @@ static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
 
             break;
 
+        case CTCP_GRANT_CREDIT:
+
+            job_desc = header->job_desc;
+
+            if (header->data_len != CTCP_GRANT_CREDIT_DATA_LEN ||
+                ctcn_link_read_eight_byte_number (link, (void *)&credit) 
+                != CTC_SUCCESS)
+            {
+                result_code = CTCP_RC_FAILED_WRONG_PACKET;
+            }
+            else
+            {
+                result = ctcp_do_grant_credit (link,
+                                               sgid,
+                                               header,
+                                               job_desc,
+                                               credit,
+                                               &result_code);
+
+                CTC_COND_EXCEPTION (result == CTC_ERR_NULL_LINK_FAILED,
+                                    err_grant_credit_failed_label);
+            }
+
+            if (result_code != CTCP_RC_SUCCESS)
+            {
+                /* a grant succeeds silently */
+                result = ctcp_send_grant_credit_result (link,
+                                                        result_code,
+                                                        job_desc,
+                                                        sgid);
+
+                CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                                    err_send_result_failed_label);
+            }
+
+            break;
+
+        case CTCP_ATTACH_SHM_RING:
+
+            job_desc = header->job_desc;
+            ring = NULL;
+
+            if (header->data_len != CTCP_ATTACH_SHM_RING_DATA_LEN ||
+                ctcn_link_read_four_byte_number (link, (void *)&ring_size) 
+                != CTC_SUCCESS)
+            {
+                result_code = CTCP_RC_FAILED_WRONG_PACKET;
+            }
+            else
+            {
+                result = ctcp_do_attach_shm_ring (link,
+                                                  sgid,
+                                                  job_desc,
+                                                  ring_size,
+                                                  &ring,
+                                                  &result_code);
+
+                CTC_COND_EXCEPTION (result == CTC_ERR_NULL_LINK_FAILED,
+                                    err_attach_shm_ring_failed_label);
+            }
+
+            result = ctcp_send_attach_shm_ring_result (link,
+                                                       result_code,
+                                                       job_desc,
+                                                       sgid,
+                                                       ring);
+
+            CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                                err_send_result_failed_label);
+
+            break;
+
         case CTCP_START_CAPTURE:
 
-            result = ctcp_do_start_capture (link,
-                                            sgid,
-                                            header,
-                                            job_desc,
-                                            &result_code);
+            if (ctcp_read_start_capture_pos (link, header, &start_pos) 
+                != CTC_SUCCESS)
+            {
+                result_code = CTCP_RC_FAILED_WRONG_PACKET;
+            }
+            else
+            {
+                result = ctcp_do_start_capture (link,
+                                                sgid,
+                                                header,
+                                                job_desc,
+                                                &start_pos,
+                                                &result_code);
 
-            CTC_COND_EXCEPTION (result != CTC_SUCCESS,
-                                err_start_capture_failed_label);
+                /* other failures are told to client by result code,
+                 * e.g. start position is not retained any more */
+                CTC_COND_EXCEPTION (result == CTC_ERR_NULL_LINK_FAILED,
+                                    err_start_capture_failed_label);
+            }
 
             result = ctcp_send_start_capture_result (link,
                                                      result_code,
@@ -2675,6 +5299,12 @@ static int ctcp_execute_protocol (void *inlink, CTCP_HEADER *header)
     CTC_EXCEPTION (err_set_job_attribute_failed_label)
     {
     }
+    CTC_EXCEPTION (err_grant_credit_failed_label)
+    {
+    }
+    CTC_EXCEPTION (err_attach_shm_ring_failed_label)
+    {
+    }
     CTC_EXCEPTION (err_start_capture_failed_label)
     {
     }
@@ -33,6 +33,7 @@
 #include "ctc_common.h"
 #include "ctcg_conf.h"
 #include "ctcg_list.h"
+#include "ctcn_reactor.h"
 #include "ctcj.h"
 #include "ctcs_def.h"
 #include "ctcs.h"
@@ -53,10 +54,13 @@ static int ctcs_init_ctrl_session (CTCS_CTRL_SESSION *ctrl_session,
                                    CTCN_LINK *link, 
                                    int sgid);
 
-static void *ctcs_ctrl_session_thr_func (void *args);
+static int ctcs_ctrl_session_on_frame (CTCN_LINK *link, void *arg);
+static int ctcs_ctrl_session_serve_frame (CTCN_LINK *link, void *arg);
+static void ctcs_ctrl_session_on_close (CTCN_LINK *link, void *arg);
 
 static int ctcs_job_session_get_job_status (CTCS_JOB_SESSION *job_session, 
-                                            int *job_status);
+                                            int *job_status,
+                                            CTCJ_JOB_QUEUE_STAT *queue_stat);
 
 static int ctcs_job_session_register_table (CTCS_JOB_SESSION *job_session, 
                                             char *table_name, 
@@ -132,26 +136,15 @@ extern int ctcs_initialize (void)
 extern void ctcs_finalize (void)
 {
     CTCS_SESSION_GROUP *sg;
-    CTCG_LIST_NODE *itr;
 
-    if (CTCG_LIST_IS_EMPTY (&(ctcs_Mgr.sg_list)))
-    {
-        /* already clean */
-    }
-    else
+    /* sg may be freed by finalize, so the list is not iterated */
+    while (CTCG_LIST_IS_EMPTY (&(ctcs_Mgr.sg_list)) != CTC_TRUE)
     {
-        CTCG_LIST_ITERATE (&(ctcs_Mgr.sg_list), itr)
-        {
-            sg = (CTCS_SESSION_GROUP *)itr->obj;
+        sg = (CTCS_SESSION_GROUP *)CTCG_LIST_GET_FIRST (&(ctcs_Mgr.sg_list))->obj;
 
-            if (sg != NULL)
-            {
-                (void)ctcs_sg_finalize (sg);
-            }
-            else
-            {
-                /* end of list */
-            }
+        if (ctcs_sg_finalize (sg) != CTC_SUCCESS)
+        {
+            break;
         }
     }
 
@@ -204,7 +197,9 @@ extern int ctcs_mgr_create_session_group (CTCN_LINK *link, int *sgid)
     switch (stage)
     {
         case 2:
-            (void)ctcs_sg_finalize (sg);
+            /* not in sg_list yet, frees sg */
+            (void)ctcs_mgr_destroy_session_group (sg);
+            break;
         case 1:
             (void)free (sg);
             break;
@@ -222,7 +217,7 @@ extern int ctcs_mgr_destroy_session_group (CTCS_SESSION_GROUP *sg)
     for (i = 0; i < CTCS_JOB_SESSION_COUNT_MAX; i++)
     {
         result = ctcs_job_session_final (&(sg->job_session[i]));
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS ||
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS &&
                             result != CTC_ERR_JOB_NOT_EXIST_FAILED, 
                             err_job_session_final_label);
     }
@@ -245,11 +240,22 @@ extern int ctcs_sg_initialize (CTCS_SESSION_GROUP *sg,
                                CTCN_LINK *link, 
                                int sgid)
 {
+    int i;
     int result;
 
     sg->sgid = sgid;
     sg->added_job_cnt = 0;
     sg->job_sessions_status_flag = JOB_SESSION_POSITION_NULL;
+    sg->features = 0;
+    sg->ref_cnt = 1;
+    sg->is_deleted = CTC_FALSE;
+
+    /* finalized along with sg, whether added or not */
+    for (i = 0; i < CTCS_JOB_SESSION_COUNT_MAX; i++)
+    {
+        sg->job_session[i].status = CTCS_JOB_SESSION_FREE;
+        sg->job_session[i].link = NULL;
+    }
 
     result = ctcs_init_ctrl_session (&(sg->ctrl_session), link, sg->sgid);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
@@ -269,14 +275,31 @@ extern int ctcs_sg_initialize (CTCS_SESSION_GROUP *sg,
 }
 
 
+/*
+ * Description : sg is no longer found, it is freed once the control link
+ *               and those who found it are done with it
+ *
+ */
 extern int ctcs_sg_finalize (CTCS_SESSION_GROUP *sg)
 {
+    int i;
     int result;
 
     CTC_TEST_EXCEPTION (ctcs_mgr_delete_session_group (sg),
                         err_delete_session_group_label);    
 
-    ctcs_mgr_destroy_session_group (sg);
+    /* captures stop here, the last put may be on a reactor thread */
+    for (i = 0; i < CTCS_JOB_SESSION_COUNT_MAX; i++)
+    {
+        if (sg->job_session[i].status > CTCS_JOB_SESSION_FREE)
+        {
+            (void)ctcs_job_session_stop_capture (&(sg->job_session[i]),
+                                                 CTCS_CLOSE_IMMEDIATELY);
+        }
+    }
+
+    /* reference of sg_list */
+    ctcs_sg_put (sg);
 
     return CTC_SUCCESS;
 
@@ -290,18 +313,27 @@ extern int ctcs_sg_finalize (CTCS_SESSION_GROUP *sg)
 }
 
 
+/*
+ * Description : NULL when not found, control sessions of reactor
+ *               threads look up while listener adds. A found sg is
+ *               held until ctcs_sg_put
+ *
+ */
 extern CTCS_SESSION_GROUP *ctcs_find_session_group_by_id (int sgid)
 {
     CTCG_LIST *itr = NULL;
     CTCS_SESSION_GROUP *sg = NULL; 
 
+    (void)pthread_mutex_lock (&ctcs_Mgr.sg_list_lock);
+
     if (CTCG_LIST_IS_EMPTY(&ctcs_Mgr.sg_list) != CTC_TRUE)
     {
         CTCG_LIST_ITERATE (&ctcs_Mgr.sg_list, itr)
         {
-            sg = (CTCS_SESSION_GROUP *)itr->obj;
-            if (sg->sgid == sgid)
+            if (((CTCS_SESSION_GROUP *)itr->obj)->sgid == sgid)
             {
+                sg = (CTCS_SESSION_GROUP *)itr->obj;
+                sg->ref_cnt++;
                 break;
             }
         }
@@ -311,49 +343,100 @@ extern CTCS_SESSION_GROUP *ctcs_find_session_group_by_id (int sgid)
         /* empty sglist */
     }
 
+    (void)pthread_mutex_unlock (&ctcs_Mgr.sg_list_lock);
+
     return sg;
 }
 
 
+/*
+ * Description : the last reference frees sg, with its control link if
+ *               the reactor is done with it
+ *
+ */
+extern void ctcs_sg_put (CTCS_SESSION_GROUP *sg)
+{
+    int ref_cnt;
+
+    (void)pthread_mutex_lock (&ctcs_Mgr.sg_list_lock);
+    ref_cnt = --sg->ref_cnt;
+    (void)pthread_mutex_unlock (&ctcs_Mgr.sg_list_lock);
+
+    if (ref_cnt == 0)
+    {
+        /* a link still served holds a reference */
+        if (sg->ctrl_session.status == CTCS_CTRL_SESSION_DISCONNECTED)
+        {
+            ctcn_link_destroy (sg->ctrl_session.link);
+        }
+
+        (void)ctcs_mgr_destroy_session_group (sg);
+    }
+}
+
+
 static int ctcs_init_ctrl_session (CTCS_CTRL_SESSION *ctrl_session, 
                                    CTCN_LINK *link,
                                    int sgid)
 {
     int result;
-    int thr_ret = 0;
-    pthread_t ctrl_thr;
-    pthread_attr_t ctrl_thr_attr;
 
     CTC_COND_EXCEPTION (link == NULL, err_null_link);
     ctrl_session->link = link;
     ctrl_session->status = CTCS_CTRL_SESSION_INIT;
     ctrl_session->sgid = sgid;
 
-    /* ctrl session thread create */
-    CTC_TEST_EXCEPTION (pthread_create (&ctrl_thr, 
-                                        &ctrl_thr_attr, 
-                                        (void *)ctcs_ctrl_session_thr_func, 
-                                        (void *)ctrl_session),
-                        err_create_thread_failed_label); 
-
-    /* register thread id to job_session */
-    ctrl_session->thread = ctrl_thr;
-
-    pthread_join (ctrl_thr, (void **)&thr_ret);
-
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_null_link)
     {
         result = CTC_ERR_NULL_LINK_FAILED;
     }
-    CTC_EXCEPTION (err_alloc_session_group_label)
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : called once the create result is sent on link, the
+ *               next frames of the session are handled by the reactor
+ *
+ */
+extern int ctcs_sg_start_ctrl_session (CTCS_SESSION_GROUP *sg, CTCN_LINK *link)
+{
+    int result;
+    CTCS_CTRL_SESSION *ctrl_session = &(sg->ctrl_session);
+
+    /* sg taken over by a client other than the one it was created for */
+    CTC_COND_EXCEPTION (ctrl_session->link != link || 
+                        ctrl_session->status != CTCS_CTRL_SESSION_INIT,
+                        err_not_owner_link_label);
+
+    ctrl_session->status = CTCS_CTRL_SESSION_READY;
+
+    /* held by the reactor until the link is closed */
+    (void)pthread_mutex_lock (&ctcs_Mgr.sg_list_lock);
+    sg->ref_cnt++;
+    (void)pthread_mutex_unlock (&ctcs_Mgr.sg_list_lock);
+
+    result = ctcn_reactor_add_link (link, 
+                                    ctcs_ctrl_session_on_frame, 
+                                    ctcs_ctrl_session_on_close,
+                                    (void *)sg);
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_reactor_add_link_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_not_owner_link_label)
     {
-        result = CTC_ERR_ALLOC_FAILED;
+        result = CTC_ERR_INVALID_VALUE_FAILED;
     }
-    CTC_EXCEPTION (err_create_thread_failed_label)
+    CTC_EXCEPTION (err_reactor_add_link_label)
     {
-        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
+        ctrl_session->status = CTCS_CTRL_SESSION_INIT;
+        ctcs_sg_put (sg);
     }
     EXCEPTION_END;
 
@@ -361,24 +444,50 @@ static int ctcs_init_ctrl_session (CTCS_CTRL_SESSION *ctrl_session,
 }
 
 
-static void *ctcs_ctrl_session_thr_func (void *args)
+/*
+ * Description : a frame stopping a capture waits for its worker, it is
+ *               served on a reactor worker instead
+ *
+ */
+static int ctcs_ctrl_session_on_frame (CTCN_LINK *link, void *arg)
 {
-    int i;
-    int result = 0;
-    CTCS_CTRL_SESSION *ctrl_session = (CTCS_CTRL_SESSION *)args;
-    CTCG_LIST_NODE *itr = NULL;
-
-    assert (ctrl_session != NULL);
+    int result;
 
-    while (ctrl_session->status != CTCS_CTRL_SESSION_CLOSING)
+    if (ctcp_is_waiting_protocol (link) == CTC_TRUE)
     {
-        result = ctcp_process_protocol (ctrl_session->link,
-                                        ctrl_session->sgid);
+        result = ctcn_reactor_defer_frame (link, 
+                                           ctcs_ctrl_session_serve_frame);
+
+        if (result == CTCN_REACTOR_DEFER)
+        {
+            return result;
+        }
+
+        /* served here when no worker runs */
+    }
+
+    return ctcs_ctrl_session_serve_frame (link, arg);
+}
+
 
-        CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
-                            err_process_prcl_failed_label);
+static int ctcs_ctrl_session_serve_frame (CTCN_LINK *link, void *arg)
+{
+    int result;
+    CTCS_SESSION_GROUP *sg = (CTCS_SESSION_GROUP *)arg;
+
+    result = ctcp_process_received_protocol (link);
+
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                        err_process_prcl_failed_label);
+
+    if (sg->is_deleted == CTC_TRUE)
+    {
+        /* destroyed by the frame just handled */
+        return CTCN_REACTOR_CLOSE;
     }
 
+    return CTC_SUCCESS;
+
     CTC_EXCEPTION (err_process_prcl_failed_label)
     {
         /* TODO: logging protocol errors */
@@ -386,7 +495,29 @@ static void *ctcs_ctrl_session_thr_func (void *args)
     }
     EXCEPTION_END;
 
-    pthread_exit((void *)&result);
+    return result;
+}
+
+
+/*
+ * Description : session group outlives a disconnected control session,
+ *               its jobs keep running until it is finalized
+ *
+ */
+static void ctcs_ctrl_session_on_close (CTCN_LINK *link, void *arg)
+{
+    CTCS_SESSION_GROUP *sg = (CTCS_SESSION_GROUP *)arg;
+
+    (void)ctcn_sock_close (&(link->sock));
+
+    /* its connection no longer counts against CTCN_MAX_LISTEN */
+    (void)ctcs_mgr_dec_session_count ();
+
+    /* job sessions still read frame size of link, the last put frees it */
+    sg->ctrl_session.status = CTCS_CTRL_SESSION_DISCONNECTED;
+
+    /* reference of the reactor */
+    ctcs_sg_put (sg);
 }
 
 
@@ -422,16 +553,26 @@ static int ctcs_mgr_add_session_group (CTCS_SESSION_GROUP *sg)
 static int ctcs_mgr_delete_session_group (CTCS_SESSION_GROUP *sg)
 {
     int result; 
+    BOOL is_deleted;
 
     CTC_TEST_EXCEPTION (ctcs_mgr_lock_sg_list (),
                         err_mgr_lock_failed_label);
 
-    CTCG_LIST_REMOVE (&(sg->node));
-    ctcs_mgr_dec_sg_cnt ();
+    /* reference of sg_list is dropped once */
+    is_deleted = sg->is_deleted;
+
+    if (is_deleted != CTC_TRUE)
+    {
+        CTCG_LIST_REMOVE (&(sg->node));
+        ctcs_mgr_dec_sg_cnt ();
+        sg->is_deleted = CTC_TRUE;
+    }
 
     CTC_TEST_EXCEPTION (ctcs_mgr_unlock_sg_list (),
                         err_mgr_unlock_failed_label);
 
+    CTC_COND_EXCEPTION (is_deleted == CTC_TRUE, err_already_deleted_label);
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_mgr_lock_failed_label)
@@ -442,6 +583,10 @@ static int ctcs_mgr_delete_session_group (CTCS_SESSION_GROUP *sg)
     {
         result = CTC_ERR_UNLOCK_FAILED;
     }
+    CTC_EXCEPTION (err_already_deleted_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
     EXCEPTION_END;
 
     return result;
@@ -505,7 +650,7 @@ extern int ctcs_destroy_all_job_session (CTCS_SESSION_GROUP *sg,
             if (job_status == CTCJ_JOB_PROCESSING)
             {
                 /* stop_capture: IMMEDIATELY */
-                ctcj_stop_capture_immediately (1, sg->job_session[i].job);
+                ctcj_stop_capture_immediately (sg->job_session[i].job);
             }
             else
             {
@@ -560,21 +705,8 @@ extern int ctcs_destroy_job_session (CTCS_SESSION_GROUP *sg,
 
     if (job_status == CTCJ_JOB_PROCESSING)
     {
-        ctcj_stop_capture_immediately (1, job_session->job);
-
-        while (job_status == CTCJ_JOB_PROCESSING)
-        {
-            ctcj_get_job_status (job_session->job, &job_status);
-
-            if (job_status == CTCJ_JOB_PROCESSING)
-            {
-                sleep (1);
-            }
-            else
-            {
-                break;
-            }
-        }
+        /* returns after a worker closed its cursor */
+        ctcj_stop_capture_immediately (job_session->job);
     }
     else
     {
@@ -657,6 +789,16 @@ extern int ctcs_sg_add_job (CTCS_SESSION_GROUP *sg,
     CTC_TEST_EXCEPTION (ctcs_job_session_init (job_session, link, sg->sgid, job_id),
                         err_job_session_init_failed_label);
 
+    if (sg->features & CTCP_FEATURE_COMPRESS_LZO)
+    {
+        job_session->job->batch.is_compressed = CTC_TRUE;
+    }
+
+    if (sg->features & CTCP_FEATURE_COMPACT_ENCODING)
+    {
+        job_session->job->batch.is_compact = CTC_TRUE;
+    }
+
     /* add job to job reference table */
     ctcs_job_session_add_job (job_session);
 
@@ -757,19 +899,26 @@ static int ctcs_sg_get_empty_job_session_position (CTCS_SESSION_GROUP *sg)
  */
 extern int ctcs_sg_get_job_status (CTCS_SESSION_GROUP *sg,
                                    unsigned short job_desc,
-                                   int *job_status)
+                                   int *job_status,
+                                   CTCJ_JOB_QUEUE_STAT *queue_stat)
 {
     int result;
-    int status;
     CTCS_JOB_SESSION *job_session = NULL;
 
     job_session = ctcs_sg_find_job_session (sg, job_desc);
+    CTC_COND_EXCEPTION (job_session == NULL, err_job_not_exist_label);
 
-    result = ctcs_job_session_get_job_status (job_session, &status);
+    result = ctcs_job_session_get_job_status (job_session, 
+                                              job_status, 
+                                              queue_stat);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_job_status_label);
 
     return CTC_SUCCESS;
 
+    CTC_EXCEPTION (err_job_not_exist_label)
+    {
+        result = CTC_ERR_JOB_NOT_EXIST_FAILED;
+    }
     CTC_EXCEPTION (err_get_job_status_label)
     {
         /* error info set from sub-function */
@@ -781,7 +930,8 @@ extern int ctcs_sg_get_job_status (CTCS_SESSION_GROUP *sg,
 
 
 static int ctcs_job_session_get_job_status (CTCS_JOB_SESSION *job_session,
-                                            int *job_status)
+                                            int *job_status,
+                                            CTCJ_JOB_QUEUE_STAT *queue_stat)
 {
     int result;
     CTCJ_JOB_INFO *job = NULL;
@@ -797,6 +947,8 @@ static int ctcs_job_session_get_job_status (CTCS_JOB_SESSION *job_session,
 
     *job_status = job->status;
 
+    ctcj_get_job_queue_stat (job, queue_stat);
+
     return CTC_SUCCESS;
 
     CTC_EXCEPTION (err_job_not_exist_label)
@@ -867,8 +1019,6 @@ static int ctcs_job_session_init (CTCS_JOB_SESSION *job_session,
                                            (void *)&long_tran_qsize);
         job_session->long_tran_qsize = long_tran_qsize;
 
-        job_session->thread = CTCS_JOB_THREAD_NULL_ID;
-
         CTC_TEST_EXCEPTION (ctcj_make_new_job (&job_info),
                             err_make_new_job_failed_label);
 
@@ -886,8 +1036,6 @@ static int ctcs_job_session_init (CTCS_JOB_SESSION *job_session,
     else
     {
         CTC_COND_EXCEPTION (job_session->link == NULL, err_null_link_label);
-
-        job_session->thread = CTCS_JOB_THREAD_NULL_ID;
     }
 
     job_session->status = CTCS_JOB_SESSION_OPEN;
@@ -951,6 +1099,19 @@ static int ctcs_job_session_final (CTCS_JOB_SESSION *job_session)
             /* already stopped */
         }
 
+        if (job_session->link != NULL)
+        {
+            /* frames not sent yet are dropped with their holds */
+            ctcn_reactor_remove_link (job_session->link);
+            (void)ctcn_link_set_send_queue (job_session->link, 0);
+
+            /* consumer keeps its mapping, records already written stay */
+            ctcn_link_detach_ring (job_session->link);
+
+            /* counted against CTCN_MAX_LISTEN when it was created */
+            (void)ctcs_mgr_dec_session_count ();
+        }
+
         /* remove job */
         (void)ctcj_ref_table_remove_job (job_session->job);
 
@@ -1156,6 +1317,109 @@ extern int ctcs_sg_set_job_attr (CTCS_SESSION_GROUP *sg,
 }
 
 
+extern int ctcs_sg_grant_credit (CTCS_SESSION_GROUP *sg,
+                                 unsigned short job_desc,
+                                 int unit,
+                                 SINT_64 credit)
+{
+    int result;
+    CTCS_JOB_SESSION *job_session = NULL;
+
+    job_session = ctcs_sg_find_job_session (sg, job_desc);
+    CTC_COND_EXCEPTION (job_session == NULL || 
+                        job_session->status <= CTCS_JOB_SESSION_FREE, 
+                        err_invalid_job_label);
+
+    result = ctcj_grant_credit (job_session->job, unit, credit);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_grant_credit_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_job_label)
+    {
+        result = CTC_ERR_JOB_NOT_EXIST_FAILED;
+    }
+    CTC_EXCEPTION (err_grant_credit_failed_label)
+    {
+        /* error info set from sub-function */
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
+/*
+ * Description : captured data of the job goes to a shared memory ring 
+ *               from now on, attached before capture starts so no frame
+ *               is left on the socket. the ring holds at least two 
+ *               frames of the largest size, 0 gives the default size.
+ *
+ */
+extern int ctcs_sg_attach_ring (CTCS_SESSION_GROUP *sg,
+                                unsigned short job_desc,
+                                unsigned int ring_size,
+                                CTCN_RING **ring)
+{
+    int result;
+    int job_status;
+    unsigned int min_size;
+    CTCS_JOB_SESSION *job_session = NULL;
+
+    job_session = ctcs_sg_find_job_session (sg, job_desc);
+    CTC_COND_EXCEPTION (job_session == NULL || 
+                        job_session->status <= CTCS_JOB_SESSION_FREE ||
+                        job_session->link == NULL, 
+                        err_invalid_job_label);
+
+    result = ctcj_get_job_status (job_session->job, &job_status);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_get_status_label);
+    CTC_COND_EXCEPTION (job_status == CTCJ_JOB_PROCESSING, 
+                        err_job_already_started_label);
+
+    min_size = 2 * CTCN_RING_REC_LEN (job_session->link->max_frame_size);
+
+    if (ring_size == 0)
+    {
+        ring_size = min_size > CTCP_SHM_RING_SIZE_DEFAULT ? 
+                    min_size : CTCP_SHM_RING_SIZE_DEFAULT;
+    }
+
+    CTC_COND_EXCEPTION (ring_size < min_size ||
+                        ring_size > CTCN_RING_DATA_SIZE_MAX,
+                        err_invalid_size_label);
+
+    result = ctcn_link_attach_ring (job_session->link, ring_size, ring);
+    CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_attach_ring_failed_label);
+
+    return CTC_SUCCESS;
+
+    CTC_EXCEPTION (err_invalid_job_label)
+    {
+        result = CTC_ERR_JOB_NOT_EXIST_FAILED;
+    }
+    CTC_EXCEPTION (err_get_status_label)
+    {
+        /* error info set from sub-function */
+    }
+    CTC_EXCEPTION (err_job_already_started_label)
+    {
+        result = CTC_ERR_JOB_ALREADY_STARTED;
+    }
+    CTC_EXCEPTION (err_invalid_size_label)
+    {
+        result = CTC_ERR_INVALID_VALUE_FAILED;
+    }
+    CTC_EXCEPTION (err_attach_ring_failed_label)
+    {
+        /* error info set from sub-function */
+    }
+    EXCEPTION_END;
+
+    return result;
+}
+
+
 static int ctcs_job_session_set_attr (CTCS_JOB_SESSION *job_session, 
                                       CTCJ_JOB_ATTR *job_attr)
 {
@@ -1164,9 +1428,33 @@ static int ctcs_job_session_set_attr (CTCS_JOB_SESSION *job_session,
     result = ctcs_validate_job_attr (job_attr);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_invalid_job_attr);
 
+    switch (job_attr->id)
+    {
+        case CTCJ_JOB_ATTR_ID_UPDATE_MODE:
+        case CTCJ_JOB_ATTR_ID_BEFORE_IMAGE:
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_TRANS:
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_BYTES:
+        case CTCJ_JOB_ATTR_ID_BATCH_LINGER_USEC:
+        case CTCJ_JOB_ATTR_ID_WEIGHT:
+        case CTCJ_JOB_ATTR_ID_QUEUE_FULL_POLICY:
+
+            /* capture worker reads these without a lock while the job 
+             * is processing, they are set before start or after stop */
+            CTC_COND_EXCEPTION (job_session->job->status == CTCJ_JOB_PROCESSING,
+                                err_invalid_job_status_label);
+            break;
+
+        default:
+            break;
+    }
+
     switch (job_attr->id)
     {
         case CTCJ_JOB_ATTR_ID_JOB_QUEUE_SIZE:
+            result = ctcj_job_queue_resize (job_session->job, job_attr->value);
+            CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
+                                err_resize_job_queue_failed_label);
+
             job_session->job_qsize = job_attr->value;
             break;
 
@@ -1174,6 +1462,35 @@ static int ctcs_job_session_set_attr (CTCS_JOB_SESSION *job_session,
             job_session->long_tran_qsize = job_attr->value;
             break;
 
+        case CTCJ_JOB_ATTR_ID_UPDATE_MODE:
+            job_session->job->update_mode = job_attr->value;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BEFORE_IMAGE:
+            job_session->job->send_before_image = 
+                (job_attr->value != 0) ? CTC_TRUE : CTC_FALSE;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_TRANS:
+            job_session->job->batch.max_trans = job_attr->value;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_BYTES:
+            job_session->job->batch.max_bytes = job_attr->value;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_LINGER_USEC:
+            job_session->job->batch.linger_usec = job_attr->value;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_WEIGHT:
+            job_session->job->weight = job_attr->value;
+            break;
+
+        case CTCJ_JOB_ATTR_ID_QUEUE_FULL_POLICY:
+            job_session->job->queue_full_policy = job_attr->value;
+            break;
+
         default:
             break;
     }
@@ -1184,6 +1501,14 @@ static int ctcs_job_session_set_attr (CTCS_JOB_SESSION *job_session,
     {
         /* error info set from sub-function */
     }
+    CTC_EXCEPTION (err_invalid_job_status_label)
+    {
+        result = CTC_ERR_INVALID_JOB_STATUS_FAILED;
+    }
+    CTC_EXCEPTION (err_resize_job_queue_failed_label)
+    {
+        /* error info set from sub-function */
+    }
     EXCEPTION_END;
 
     return result;
@@ -1210,6 +1535,14 @@ static int ctcs_validate_job_attr (CTCJ_JOB_ATTR *job_attr)
 
             CTC_COND_EXCEPTION (job_attr->value < attr_val,
                                 err_invalid_attr_val_label);
+
+            /* queue slots are allocated by this value */
+            result = ctcg_conf_get_item_value (CTCG_CONF_ID_CTC_JOB_QUEUE_SIZE, 
+                                               CTCG_CONF_ITEM_VAL_MAX, 
+                                               (void *)&attr_val);
+
+            CTC_COND_EXCEPTION (job_attr->value > attr_val,
+                                err_invalid_attr_val_label);
             break;
 
         case CTCJ_JOB_ATTR_ID_LONG_TRAN_QUEUE_SIZE:
@@ -1223,6 +1556,57 @@ static int ctcs_validate_job_attr (CTCJ_JOB_ATTR *job_attr)
                                 err_invalid_attr_val_label);
             break;
 
+        case CTCJ_JOB_ATTR_ID_UPDATE_MODE:
+
+            CTC_COND_EXCEPTION (job_attr->value != CTCJ_UPDATE_MODE_ALL_COLUMNS &&
+                                job_attr->value != CTCJ_UPDATE_MODE_CHANGED_COLUMNS,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BEFORE_IMAGE:
+
+            CTC_COND_EXCEPTION (job_attr->value != 0 && job_attr->value != 1,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_TRANS:
+
+            CTC_COND_EXCEPTION (job_attr->value < 1 ||
+                                job_attr->value > CTCJ_BATCH_MAX_TRANS_UPPER,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_MAX_BYTES:
+
+            /* a frame never carries more than its packet data */
+            CTC_COND_EXCEPTION (job_attr->value < 1 ||
+                                job_attr->value > CTCP_PACKET_DATA_ABS_MAX_LEN,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_BATCH_LINGER_USEC:
+
+            /* latency added to a frame, it lingers on the worker's 
+             * linger list without holding the worker */
+            CTC_COND_EXCEPTION (job_attr->value < 0 ||
+                                job_attr->value > CTCJ_BATCH_LINGER_USEC_UPPER,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_WEIGHT:
+
+            CTC_COND_EXCEPTION (job_attr->value < 1 ||
+                                job_attr->value > CTCJ_WEIGHT_UPPER,
+                                err_invalid_attr_val_label);
+            break;
+
+        case CTCJ_JOB_ATTR_ID_QUEUE_FULL_POLICY:
+
+            CTC_COND_EXCEPTION (job_attr->value != CTCL_QUEUE_FULL_BLOCK &&
+                                job_attr->value != CTCL_QUEUE_FULL_SPILL,
+                                err_invalid_attr_val_label);
+            break;
+
         default:
             break;
     }
@@ -1318,7 +1702,8 @@ static int ctcs_job_session_unregister_table (CTCS_JOB_SESSION *job_session,
 
 
 extern int ctcs_sg_start_capture (CTCS_SESSION_GROUP *sg,
-                                  unsigned short job_desc)
+                                  unsigned short job_desc,
+                                  struct ctcl_stream_pos *start_pos)
 {
     int result;
     int status;
@@ -1334,7 +1719,7 @@ extern int ctcs_sg_start_capture (CTCS_SESSION_GROUP *sg,
                         err_job_session_already_stopped_label);
 
     /* start capture */
-    result = ctcs_job_session_start_capture (job_session);
+    result = ctcs_job_session_start_capture (job_session, start_pos);
     CTC_COND_EXCEPTION (result != CTC_SUCCESS, 
                         err_start_capture_failed_label);
 
@@ -1358,12 +1743,11 @@ extern int ctcs_sg_start_capture (CTCS_SESSION_GROUP *sg,
 }
 
 
-extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session)
+extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session,
+                                           struct ctcl_stream_pos *start_pos)
 {
     int result;
     int job_status;
-    int thr_ret = 0;
-    pthread_t job_thr;
     CTCJ_JOB_INFO *job = NULL;
 
     assert (job_session != NULL);
@@ -1384,15 +1768,9 @@ extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session)
         /* increase current processing job count of ctcl */
         ctcl_mgr_inc_cur_job_cnt ();
 
-        /* create thread */
-        CTC_TEST_EXCEPTION (pthread_create (&job_thr, 
-                                            NULL, 
-                                            ctcj_capture_thr_func, 
-                                            (void *)job_session),
-                            err_create_thread_failed_label); 
-
-        /* register thread id to job_session */
-        job_session->thread = job_thr;
+        /* capture pool workers send for this job from now on */
+        result = ctcj_start_capture (job, (void *)job_session, start_pos);
+        CTC_COND_EXCEPTION (result != CTC_SUCCESS, err_start_capture_failed_label);
     }
     else
     {
@@ -1411,10 +1789,10 @@ extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session)
     {
         result = CTC_ERR_JOB_ALREADY_STARTED;
     }
-    CTC_EXCEPTION (err_create_thread_failed_label)
+    CTC_EXCEPTION (err_start_capture_failed_label)
     {
+        /* error info set from sub-function */
         ctcl_mgr_dec_cur_job_cnt ();
-        result = CTC_ERR_INSUFFICIENT_SYS_RESOURCE_FAILED;
     }
     CTC_EXCEPTION (err_invalid_job_status_label)
     {
@@ -1484,11 +1862,11 @@ static int ctcs_job_session_stop_capture (CTCS_JOB_SESSION *job_session,
 
     if (stop_cond == CTCS_CLOSE_IMMEDIATELY)
     {
-        ctcj_stop_capture_immediately (job_session->thread, job_session->job);
+        ctcj_stop_capture_immediately (job_session->job);
     }
     else
     {
-        ctcj_stop_capture (job_session->thread, job_session->job);
+        ctcj_stop_capture (job_session->job);
     }
 
     ctcl_mgr_dec_cur_job_cnt ();
@@ -35,6 +35,20 @@
 #define CONF_NAME_CTC_JOB_QUEUE_SIZE            "ctc_job_queue_size"
 #define CONF_NAME_CTC_LONG_TRAN_FILE_PATH       "ctc_long_tran_file_path"
 #define CONF_NAME_CTC_LONG_TRAN_QUEUE_SIZE      "ctc_long_tran_queue_size"
+#define CONF_NAME_CTC_JOB_MAX_LATENCY           "ctc_job_max_latency"
+#define CONF_NAME_CTC_CAPTURE_WORKER_COUNT      "ctc_capture_worker_count"
+#define CONF_NAME_CTC_RETENTION_TRANS_COUNT     "ctc_retention_trans_count"
+#define CONF_NAME_CTC_RETENTION_ITEM_COUNT      "ctc_retention_item_count"
+#define CONF_NAME_CTC_ANALYZER_CPU_LIST         "ctc_analyzer_cpu_list"
+#define CONF_NAME_CTC_CAPTURE_WORKER_CPU_LIST   "ctc_capture_worker_cpu_list"
+#define CONF_NAME_CTC_LISTENER_CPU_LIST         "ctc_listener_cpu_list"
+#define CONF_NAME_CTC_MAX_FRAME_SIZE            "ctc_max_frame_size"
+#define CONF_NAME_CTC_SEND_ZEROCOPY             "ctc_send_zerocopy"
+#define CONF_NAME_CTC_REACTOR_THREAD_COUNT      "ctc_reactor_thread_count"
+#define CONF_NAME_CTC_SEND_QUEUE_SIZE           "ctc_send_queue_size"
+#define CONF_NAME_CTC_UNIX_SOCKET_PATH          "ctc_unix_socket_path"
+#define CONF_NAME_CTC_UNIX_SOCKET_MODE          "ctc_unix_socket_mode"
+#define CONF_NAME_CTC_JOB_QUEUE_MEM_QUOTA       "ctc_job_queue_mem_quota"
 
 #define CTCG_CONF_DEFAULT_CTC_PORT              (48397)
 
@@ -98,6 +112,20 @@ typedef enum ctcg_conf_id
     CTCG_CONF_ID_CTC_JOB_QUEUE_SIZE,
     CTCG_CONF_ID_CTC_LONG_TRAN_FILE_PATH,
     CTCG_CONF_ID_CTC_LONG_TRAN_QUEUE_SIZE,
+    CTCG_CONF_ID_CTC_JOB_MAX_LATENCY,
+    CTCG_CONF_ID_CTC_CAPTURE_WORKER_COUNT,
+    CTCG_CONF_ID_CTC_RETENTION_TRANS_COUNT,
+    CTCG_CONF_ID_CTC_RETENTION_ITEM_COUNT,
+    CTCG_CONF_ID_CTC_ANALYZER_CPU_LIST,
+    CTCG_CONF_ID_CTC_CAPTURE_WORKER_CPU_LIST,
+    CTCG_CONF_ID_CTC_LISTENER_CPU_LIST,
+    CTCG_CONF_ID_CTC_MAX_FRAME_SIZE,
+    CTCG_CONF_ID_CTC_SEND_ZEROCOPY,
+    CTCG_CONF_ID_CTC_REACTOR_THREAD_COUNT,
+    CTCG_CONF_ID_CTC_SEND_QUEUE_SIZE,
+    CTCG_CONF_ID_CTC_UNIX_SOCKET_PATH,
+    CTCG_CONF_ID_CTC_UNIX_SOCKET_MODE,
+    CTCG_CONF_ID_CTC_JOB_QUEUE_MEM_QUOTA,
     CTCG_CONF_ID_LAST
 } CTCG_CONF_ID;
 
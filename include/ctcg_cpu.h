@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_cpu.h : ctc general(cpu affinity) header
+ *
+ * A cpu set is read from a configured cpu list such as "0-3,8,10" and
+ * keeps the cpus in the listed order. An empty set leaves the thread
+ * floating. Memory is allocated from the node of the cpu that touches
+ * it first, so buffers a pinned thread initializes are node local.
+ *
+ */
+
+#ifndef _CTCG_CPU_H_
+#define _CTCG_CPU_H_ 1
+
+
+#include <pthread.h>
+
+#include "ctc_types.h"
+
+
+#define CTCG_CPU_MAX                        (1024)
+#define CTCG_CPU_ALL                        (-1)
+
+
+typedef struct ctcg_cpu_set CTCG_CPU_SET;
+struct ctcg_cpu_set
+{
+    int cnt;                            /* 0 : not pinned */
+    short cpu[CTCG_CPU_MAX];
+};
+
+
+extern int ctcg_cpu_set_parse (const char *cpu_list, CTCG_CPU_SET *cpu_set);
+
+/* nth : nth cpu of the set (wraps around), CTCG_CPU_ALL : whole set */
+extern int ctcg_cpu_bind_attr (pthread_attr_t *attr,
+                               CTCG_CPU_SET *cpu_set,
+                               int nth);
+extern int ctcg_cpu_bind_thread (pthread_t thr,
+                                 CTCG_CPU_SET *cpu_set,
+                                 int nth);
+extern int ctcg_cpu_get_thread (pthread_t thr, CTCG_CPU_SET *cpu_set);
+
+
+#endif /* _CTCG_CPU_H_ */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_queue.h : ctc general(bounded spsc queue) header
+ *
+ * Fixed capacity ring of pointers with exactly one producer thread and
+ * one consumer thread. Neither side takes a lock, head is written only
+ * by the producer and tail only by the consumer.
+ *
+ */
+
+#ifndef _CTCG_QUEUE_H_
+#define _CTCG_QUEUE_H_ 1
+
+
+#include "ctc_types.h"
+
+
+#define CTCG_QUEUE_CACHE_LINE_SIZE          (64)
+
+
+typedef struct ctcg_spsc_queue CTCG_SPSC_QUEUE;
+struct ctcg_spsc_queue
+{
+    /* producer side */
+    UINT_64 head;                       /* total enqueued item count */
+    int high_water;                     /* max used slot count seen */
+    char pad[CTCG_QUEUE_CACHE_LINE_SIZE - sizeof (UINT_64) - sizeof (int)];
+
+    /* consumer side */
+    UINT_64 tail;                       /* total dequeued item count */
+
+    int size;                           /* slot count */
+    void **slot;
+};
+
+
+extern int ctcg_spsc_queue_init (CTCG_SPSC_QUEUE *queue, int size);
+extern void ctcg_spsc_queue_final (CTCG_SPSC_QUEUE *queue);
+
+/* producer */
+extern BOOL ctcg_spsc_queue_enq (CTCG_SPSC_QUEUE *queue, void *item);
+
+/* consumer */
+extern void *ctcg_spsc_queue_peek (CTCG_SPSC_QUEUE *queue, int idx);
+extern void ctcg_spsc_queue_deq (CTCG_SPSC_QUEUE *queue, int cnt);
+
+/* producer, oldest item not dequeued yet */
+extern void *ctcg_spsc_queue_peek_oldest (CTCG_SPSC_QUEUE *queue);
+
+/* any thread, approximate while both sides are running */
+extern int ctcg_spsc_queue_get_used (CTCG_SPSC_QUEUE *queue);
+extern int ctcg_spsc_queue_get_high_water (CTCG_SPSC_QUEUE *queue);
+
+
+#endif /* _CTCG_QUEUE_H_ */
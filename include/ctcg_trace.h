@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcg_trace.h : ctc general(binary trace ring) header
+ *
+ * Each thread owns its own ring of fixed size binary records, so writing
+ * a trace record takes no lock and does no I/O. Rings are written to a
+ * dump file by ctcg_trace_dump () and decoded offline by
+ * ctcg_trace_decode () (see testtools/ctc_trace_decoder.c).
+ *
+ * Trace points are compiled in only when the build defines CTCG_TRACE_LEVEL
+ * (e.g. -DCTCG_TRACE_LEVEL=3), otherwise every CTCG_TRACE_* macro expands
+ * to nothing and its arguments are never evaluated.
+ *
+ */
+
+#ifndef _CTCG_TRACE_H_
+#define _CTCG_TRACE_H_ 1
+
+
+#include <stdio.h>
+
+#include "ctc_types.h"
+
+
+/* compile time trace levels */
+#define CTCG_TRACE_LEVEL_OFF                (0)
+#define CTCG_TRACE_LEVEL_ERROR              (1)
+#define CTCG_TRACE_LEVEL_INFO               (2)
+#define CTCG_TRACE_LEVEL_DEBUG              (3)
+
+#if !defined (CTCG_TRACE_LEVEL)
+#define CTCG_TRACE_LEVEL                    CTCG_TRACE_LEVEL_OFF
+#endif
+
+#define CTCG_TRACE_RING_SIZE                (4096)    /* power of 2 */
+#define CTCG_TRACE_RING_MASK                (CTCG_TRACE_RING_SIZE - 1)
+#define CTCG_TRACE_MAX_RING                 (2048)
+#define CTCG_TRACE_ARG_MAX                  (4)
+
+#define CTCG_TRACE_DUMP_MAGIC               (0x43544354)  /* "CTCT" */
+#define CTCG_TRACE_DUMP_VERSION             (1)
+#define CTCG_TRACE_DUMP_FILE_NAME           "ctc_trace.bin"
+
+
+typedef enum ctcg_trace_event
+{
+    CTCG_TRACE_EV_NONE = 0,
+
+    /* ctcm */
+    CTCG_TRACE_EV_SERVER_START,
+    CTCG_TRACE_EV_CONF_ITEM_INT,
+    CTCG_TRACE_EV_CONF_ITEM_STR,
+    CTCG_TRACE_EV_ANALYZER_THR_STARTED,
+    CTCG_TRACE_EV_MAKE_LISTEN_LINK_FAILED,
+    CTCG_TRACE_EV_LISTEN_FAILED,
+
+    /* ctcp */
+    CTCG_TRACE_EV_PROTOCOL_VERSION,
+
+    /* ctcl */
+    CTCG_TRACE_EV_LOG_HDR,
+    CTCG_TRACE_EV_DB_LOGIN_FAILED,
+    CTCG_TRACE_EV_DB_RESTART_FAILED,
+    CTCG_TRACE_EV_REQUIRED_LSA_NULL,
+    CTCG_TRACE_EV_MGR_NOT_READY,
+    CTCG_TRACE_EV_UNKNOWN_DATA_RCVINDEX,
+    CTCG_TRACE_EV_UNKNOWN_SCHEMA_RCVINDEX,
+    CTCG_TRACE_EV_ITEM_MADE,
+    CTCG_TRACE_EV_INVALID_RECTYPE,
+    CTCG_TRACE_EV_INVALID_RCVINDEX,
+    CTCG_TRACE_EV_KEY_COLUMN,
+    CTCG_TRACE_EV_SET_COLUMN,
+    CTCG_TRACE_EV_DELETE_LOG_FAILED,
+    CTCG_TRACE_EV_ANALYZER_THR_CREATE_FAILED,
+    CTCG_TRACE_EV_ANALYZER_FINAL_LSA,
+    CTCG_TRACE_EV_ANALYZER_IN_LOOP,
+    CTCG_TRACE_EV_ANALYZER_NEGATIVE_PAGE_OFFSET,
+    CTCG_TRACE_EV_ANALYZER_PAGE_READ,
+    CTCG_TRACE_EV_ANALYZER_PASS_APPEND_LSA,
+    CTCG_TRACE_EV_ANALYZER_RECORD,
+    CTCG_TRACE_EV_ANALYZER_END_OF_PAGE,
+
+    CTCG_TRACE_EV_LAST
+} CTCG_TRACE_EVENT;
+
+
+/* reason codes of CTCG_TRACE_EV_DELETE_LOG_FAILED */
+typedef enum ctcg_trace_delete_fail
+{
+    CTCG_TRACE_DELETE_FAIL_FETCH_CLASS = 1,
+    CTCG_TRACE_DELETE_FAIL_FIND_PK,
+    CTCG_TRACE_DELETE_FAIL_INVALID_TYPE,
+    CTCG_TRACE_DELETE_FAIL_INVALID_KEY_VALUE
+} CTCG_TRACE_DELETE_FAIL;
+
+
+typedef struct ctcg_trace_rec CTCG_TRACE_REC;
+struct ctcg_trace_rec
+{
+    UINT_64 ts;                         /* CLOCK_MONOTONIC nsec */
+    unsigned short event;               /* CTCG_TRACE_EVENT */
+    unsigned short level;               /* CTCG_TRACE_LEVEL_* */
+    UINT_32 reserved;
+    SINT_64 arg[CTCG_TRACE_ARG_MAX];
+};
+
+
+typedef struct ctcg_trace_ring CTCG_TRACE_RING;
+struct ctcg_trace_ring
+{
+    UINT_64 thread_id;                  /* pthread_self () of owner */
+    UINT_64 head;                       /* total written record count */
+    CTCG_TRACE_REC rec[CTCG_TRACE_RING_SIZE];
+};
+
+
+/* dump file layout: CTCG_TRACE_DUMP_HDR, then for each ring
+ * CTCG_TRACE_DUMP_RING_HDR followed by rec_cnt records (oldest first) */
+typedef struct ctcg_trace_dump_hdr CTCG_TRACE_DUMP_HDR;
+struct ctcg_trace_dump_hdr
+{
+    UINT_32 magic;
+    UINT_32 version;
+    UINT_32 ring_cnt;
+    UINT_32 rec_size;
+};
+
+typedef struct ctcg_trace_dump_ring_hdr CTCG_TRACE_DUMP_RING_HDR;
+struct ctcg_trace_dump_ring_hdr
+{
+    UINT_64 thread_id;
+    UINT_64 head;
+    UINT_32 ring_no;
+    UINT_32 rec_cnt;
+};
+
+
+#define CTCG_TRACE_WRITE(lv, ev, a0, a1, a2, a3)                   \
+    ctcg_trace_write ((lv), (ev),                                   \
+                      (SINT_64)(a0), (SINT_64)(a1),                 \
+                      (SINT_64)(a2), (SINT_64)(a3))
+
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_ERROR
+#define CTCG_TRACE_ERROR(ev, a0, a1, a2, a3)                        \
+    CTCG_TRACE_WRITE (CTCG_TRACE_LEVEL_ERROR, (ev), (a0), (a1), (a2), (a3))
+#else
+#define CTCG_TRACE_ERROR(ev, a0, a1, a2, a3)    do { } while (0)
+#endif
+
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_INFO
+#define CTCG_TRACE_INFO(ev, a0, a1, a2, a3)                         \
+    CTCG_TRACE_WRITE (CTCG_TRACE_LEVEL_INFO, (ev), (a0), (a1), (a2), (a3))
+#else
+#define CTCG_TRACE_INFO(ev, a0, a1, a2, a3)     do { } while (0)
+#endif
+
+#if CTCG_TRACE_LEVEL >= CTCG_TRACE_LEVEL_DEBUG
+#define CTCG_TRACE_DEBUG(ev, a0, a1, a2, a3)                        \
+    CTCG_TRACE_WRITE (CTCG_TRACE_LEVEL_DEBUG, (ev), (a0), (a1), (a2), (a3))
+#else
+#define CTCG_TRACE_DEBUG(ev, a0, a1, a2, a3)    do { } while (0)
+#endif
+
+
+/*
+ * functions
+ *
+ */
+extern void ctcg_trace_write (unsigned short level,
+                              unsigned short event,
+                              SINT_64 a0,
+                              SINT_64 a1,
+                              SINT_64 a2,
+                              SINT_64 a3);
+
+extern int ctcg_trace_dump (const char *path);
+extern int ctcg_trace_decode (const char *path, FILE *out);
+
+
+#endif /* _CTCG_TRACE_H_ */
@@ -64,6 +64,10 @@ extern int ctcj_init_job_info (CTCJ_JOB_INFO *job_info,
 
 extern void ctcj_destroy_job_info (CTCJ_JOB_INFO *job_info);
 
+extern int ctcj_job_queue_resize (CTCJ_JOB_INFO *job_info, int size);
+extern void ctcj_get_job_queue_stat (CTCJ_JOB_INFO *job_info, 
+                                     CTCJ_JOB_QUEUE_STAT *stat);
+
 extern CTCG_LIST *ctcj_job_get_table_list (CTCJ_JOB_INFO *job_info);
 
 
@@ -83,12 +87,13 @@ extern int ctcj_job_unregister_table (CTCJ_JOB_INFO *job,
 
 
 /* capture */
-extern void *ctcj_capture_thr_func (void *args);
-
-extern void ctcj_stop_capture_immediately (pthread_t job_thr_id, 
-                                           CTCJ_JOB_INFO *job);
+extern int ctcj_start_capture (CTCJ_JOB_INFO *job, 
+                               void *job_session,
+                               struct ctcl_stream_pos *start_pos);
+extern void ctcj_stop_capture_immediately (CTCJ_JOB_INFO *job);
+extern void ctcj_stop_capture (CTCJ_JOB_INFO *job);
 
-extern void ctcj_stop_capture (pthread_t job_thr_id, CTCJ_JOB_INFO *job);
+extern int ctcj_grant_credit (CTCJ_JOB_INFO *job, int unit, SINT_64 amount);
 
 
 #endif /* _CTCJ_H_ */
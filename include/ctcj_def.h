@@ -29,7 +29,9 @@
 #include <pthread.h>
 
 #include "ctcg_list.h"
+#include "ctcg_queue.h"
 #include "ctc_common.h"
+#include "ctc_types.h"
 
 #define CTCJ_JOB_COUNT_PER_GROUP_MAX                (10)
 #define CTCJ_NULL_JOB_DESCRIPTOR                    (-1)
@@ -39,6 +41,16 @@
                 (CTC_JOB_QUEUE_SIZE - (a)) > 0 ? (CTC_JOB_QUEUE_SIZE - (a)) : 0;
 
 
+/* where a capturing job is in the capture pool */
+typedef enum ctcj_sched_status
+{
+    CTCJ_SCHED_IDLE = 0,            /* nothing to send, waits for notify */
+    CTCJ_SCHED_QUEUED,              /* on the run queue */
+    CTCJ_SCHED_RUNNING,             /* a worker is sending its batch */
+    CTCJ_SCHED_RUNNING_NOTIFIED,    /* notified while running, run again */
+    CTCJ_SCHED_LINGERING            /* open frame waits on the linger list */
+} CTCJ_SCHED_STATUS;
+
 /* job status */
 typedef enum ctcj_job_status 
 {
@@ -55,9 +67,93 @@ typedef enum ctcj_job_attr_id
     CTCJ_JOB_ATTR_ID_START = 0,
     CTCJ_JOB_ATTR_ID_JOB_QUEUE_SIZE,
     CTCJ_JOB_ATTR_ID_LONG_TRAN_QUEUE_SIZE,
+    CTCJ_JOB_ATTR_ID_UPDATE_MODE,
+    CTCJ_JOB_ATTR_ID_BEFORE_IMAGE,
+    CTCJ_JOB_ATTR_ID_BATCH_MAX_TRANS,
+    CTCJ_JOB_ATTR_ID_BATCH_MAX_BYTES,
+    CTCJ_JOB_ATTR_ID_BATCH_LINGER_USEC,
+    CTCJ_JOB_ATTR_ID_WEIGHT,
+    CTCJ_JOB_ATTR_ID_QUEUE_FULL_POLICY,
     CTCJ_JOB_ATTR_ID_LAST
 } CTCJ_JOB_ATTR_ID;
 
+/* which set columns of an UPDATE log item are sent to client */
+typedef enum ctcj_update_mode
+{
+    CTCJ_UPDATE_MODE_ALL_COLUMNS = 0,
+    CTCJ_UPDATE_MODE_CHANGED_COLUMNS
+} CTCJ_UPDATE_MODE;
+
+/* job queue occupancy reported by job status request */
+typedef struct ctcj_job_queue_stat CTCJ_JOB_QUEUE_STAT;
+struct ctcj_job_queue_stat
+{
+    int size;                   /* slot count */
+    int used;                   /* currently queued transactions */
+    int high_water;             /* max used since job created */
+    UINT_64 delivered_bytes;    /* captured data frame bytes sent */
+};
+
+/* upper limits of captured data batching attributes */
+#define CTCJ_BATCH_MAX_TRANS_UPPER      (1024)
+#define CTCJ_BATCH_LINGER_USEC_UPPER    (100000)
+
+/* send bandwidth share, a job may send weight * quantum bytes 
+ * per turn of capture pool (deficit round robin) */
+#define CTCJ_WEIGHT_UPPER               (100)
+#define CTCJ_DRR_QUANTUM_BYTES          (4096)
+
+/* units of consumer credit, see ctcj_grant_credit */
+typedef enum ctcj_credit_unit
+{
+    CTCJ_CREDIT_UNIT_FRAMES = 0x01,
+    CTCJ_CREDIT_UNIT_BYTES = 0x02
+} CTCJ_CREDIT_UNIT;
+
+/* transaction of the open frame of a compressed session */
+typedef struct ctcj_batch_trans CTCJ_BATCH_TRANS;
+struct ctcj_batch_trans
+{
+    int tid;
+    UINT_64 commit_lsa;                 /* packed */
+    struct ctcl_encoded_trans *encoded; /* held until the frame is sent */
+};
+
+/* captured data result frame being filled by capture worker */
+typedef struct ctcj_capture_batch CTCJ_CAPTURE_BATCH;
+struct ctcj_capture_batch
+{
+    int max_trans;              /* transactions per frame, 1 is no batching */
+    int max_bytes;              /* payload size a frame is sent at */
+    int linger_usec;            /* max wait of open frame for more */
+    int trans_cnt;              /* transactions in open frame */
+    int frame_limit;            /* open frame size, header included, 
+                                 * capped by byte credit when opened */
+    int sent_items;             /* items already sent of the first 
+                                 * transaction waiting for credit */
+    UINT_64 open_usec;          /* monotonic time open frame started */
+    UINT_64 encoded_bytes;      /* transaction record bytes written */
+    UINT_64 sent_bytes;         /* frame bytes sent on data link */
+    BOOL is_compressed;         /* negotiated by the session group */
+    BOOL is_compact;            /* negotiated by the session group */
+    int frame_flag;             /* op_param flags of open frame */
+    int prev_tid;               /* last record of open compact frame */
+    UINT_64 prev_commit_lsa;
+    CTCJ_BATCH_TRANS *held_trans;   /* compressed session only, open 
+                                     * frame compressed when it is sent */
+    int held_cnt;
+    int held_size;
+    int held_len;               /* record bytes of held_trans */
+    unsigned char *dict_sent;   /* bitmap of dictionary entries sent */
+    int dict_sent_size;         /* bytes of dict_sent */
+    int credit_units;           /* CTCJ_CREDIT_UNIT granted so far */
+    SINT_64 credit_frames;      /* frames job may still send */
+    SINT_64 credit_bytes;       /* frame bytes job may still send */
+    int credit_need;            /* byte credit the frame waiting for a 
+                                 * grant needs, 0 : a header and a byte */
+    BOOL is_credit_blocked;     /* job stopped, waits for a grant */
+};
+
 /* ctc job close condition */
 typedef enum ctcj_close_cond 
 {
@@ -88,13 +184,30 @@ struct ctcj_job_info
     CTCG_LIST table_list;       /* job table info list */
     int job_qsize;
     int long_tran_qsize;
-    unsigned long *job_queue;   /* NOTE: get queue alloc size from conf */
+    CTCG_SPSC_QUEUE job_queue;  /* committed transactions to send, 
+                                   analyzer enqueues, job thread dequeues */
+    int update_mode;            /* CTCJ_UPDATE_MODE */
+    BOOL send_before_image;     /* send old value of update set columns */
+    CTCJ_CAPTURE_BATCH batch;   /* packing of small transactions */
+    int weight;                 /* share of send bandwidth */
+    int queue_full_policy;      /* CTCL_QUEUE_FULL_POLICY, taken when 
+                                   capture starts */
 
     /* dynamic */
     int status;
     int last_processed_tid;     /* last tid sent to client */
+    struct ctcl_stream_cursor *cursor;  /* read position on commit stream */
     int enqueued_item_num;
     int dequeued_item_num;
+    SINT_64 deficit;            /* bytes job may still send this turn,
+                                   only its running worker updates */
+    UINT_64 linger_due_usec;    /* monotonic time open frame is flushed,
+                                   0 unless left lingering by worker */
+
+    /* capture pool, protected by pool lock */
+    int sched_status;           /* CTCJ_SCHED_STATUS */
+    void *capture_session;      /* job session sending captured data */
+    CTCG_LIST_NODE run_node;
 
     CTCG_LIST_NODE node;
 };
@@ -128,6 +241,26 @@ struct ctc_job_ref_table
     pthread_mutex_t table_lock;
 };
 
+/* 
+ * capture pool (GLOBAL) : fixed number of worker threads shared by all 
+ * capturing jobs. a job with data to send is put on the run queue, a 
+ * worker sends one batch of it and puts it back at the tail if it has 
+ * more, so thread count does not depend on job count.
+ */
+typedef struct ctcj_capture_pool CTCJ_CAPTURE_POOL;
+struct ctcj_capture_pool
+{
+    int worker_cnt;
+    pthread_t *worker;
+    BOOL is_stopped;
+    int max_latency;            /* msec, idle worker timed wait */
+    CTCG_LIST run_queue;        /* CTCJ_SCHED_QUEUED jobs */
+    CTCG_LIST linger_list;      /* CTCJ_SCHED_LINGERING jobs */
+    pthread_mutex_t lock;
+    pthread_cond_t run_cond;    /* run queue got a job */
+    pthread_cond_t idle_cond;   /* a job went idle */
+};
+
 /* ctc job attribute */
 typedef struct ctcj_job_attr CTCJ_JOB_ATTR;
 struct ctcj_job_attr
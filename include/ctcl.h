@@ -29,6 +29,8 @@
 #include <pthread.h>
 #include "ctc_types.h"
 #include "ctcg_list.h"
+#include "ctcg_queue.h"
+#include "ctcg_cpu.h"
 #include "dbtype.h"
 
 
@@ -36,6 +38,7 @@
 #define CTCL_DEFAULT_LOG_PAGE_SIZE                (4096)
 #define CTCL_RETRY_COUNT                          (50)
 #define CTCL_TRANS_LOG_LIST_COUNT                 (100)
+#define CTCL_TRANS_LOG_CHUNK_MAX                  (1024)
 #define CTCL_NULL_VOLDES                          (-1)
 #define CTCL_NULL_OFFSET                          (-1)
 
@@ -58,6 +61,7 @@
 #define CTCL_STATUS_IDLE                          (0)
 #define CTCL_QUERY_BUF_SIZE                       (2048)
 #define CTCL_LOG_ITEM_MAX                         (1000)
+#define CTCL_STREAM_FETCH_MAX                     (64)
 #define CTCL_DELAY_CNT                            (10)
 #define CTCL_NUM_REPL_FILTER                      (50)
 #define CTCL_LOG_PATH_MAX                         (1024)
@@ -87,6 +91,14 @@
 #define CTC_PATH_SEPARATOR(path) \
         (path[strlen(path) - 1] == PATH_SEPARATOR_CHAR ? "" : PATH_SEPARATOR_STRING)
 
+/* what the analyzer does when a job queue is full, chosen per job */
+typedef enum ctcl_queue_full_policy
+{
+    CTCL_QUEUE_FULL_BLOCK = 0,      /* wait for the job to dequeue, holds
+                                       back every job */
+    CTCL_QUEUE_FULL_SPILL           /* spill to the job's segment file */
+} CTCL_QUEUE_FULL_POLICY;
+
 /* log record's statement type */
 typedef enum ctcl_stmt_type
 {
@@ -114,9 +126,18 @@ struct ctcl_conf_items
     int max_mem_size;
     char db_name[CTCL_NAME_MAX];
     char log_path[CTCL_LOG_PATH_MAX];
+    char spill_path[CTCL_LOG_PATH_MAX];
+    int retention_trans_cnt;
+    int retention_item_cnt;
+    int job_mem_quota_kb;               /* queued bytes a job may hold */
+    CTCG_CPU_SET analyzer_cpu_set;      /* empty : not pinned */
 };
 
 
+/* old_val_len of a column whose before-image is not in the log record, 
+ * NULL and unsupported values have lengths of ctcl_encoder.h */
+#define CTCL_COLUMN_NOT_LOGGED                    (-3)
+
 /* ctcl column description */
 typedef struct ctcl_column CTCL_COLUMN;
 struct ctcl_column
@@ -124,8 +145,11 @@ struct ctcl_column
     int name_len;
     char name[CTCL_NAME_MAX];
     int type;
-    int val_len;
+    int val_len;            /* negative : no value, val is NULL */
     void *val;
+    BOOL is_changed;        /* UPDATE only, value differs from before-image */
+    int old_val_len;        /* UPDATE only, before-image value */
+    void *old_val;
 
     CTCG_LIST_NODE node;
 };
@@ -137,6 +161,8 @@ struct ctcl_update_log_info
 {
     CTCL_COLUMN key_col;
     int set_col_cnt;
+    int changed_col_cnt;
+    BOOL has_before_image;
     CTCG_LIST set_col_list;
 };
 
@@ -192,6 +218,32 @@ struct ctcl_long_trans_log_list
 };
 
 
+/* 
+ * wire form of a committed transaction's items, encoded once and shared
+ * by every job sending it with the same encoding variant. allocated in 
+ * one block by malloc, immutable once added to its trans log list and
+ * freed when the last reference is released.
+ */
+typedef struct ctcl_encoded_trans CTCL_ENCODED_TRANS;
+struct ctcl_encoded_trans
+{
+    int variant;            /* encoding options, chosen by encoder */
+    int ref_cnt;            /* trans log list holds one */
+    int item_cnt;
+    int *item_end;          /* offset in data where each item ends,
+                             * compressed batch has one, data end */
+    char *data;
+    int dict_id_cnt;        /* compact variant only, 0 otherwise */
+    int *dict_id;           /* dictionary entries items refer to, 
+                             * in order of first reference */
+    UINT_64 *batch_lsa;     /* compressed batch only, packed commit lsa
+                             * of each transaction in it */
+    CTCL_ENCODED_TRANS *batch_list; /* compressed batches starting with 
+                                     * this one, lock free */
+    CTCL_ENCODED_TRANS *next;
+};
+
+
 typedef struct ctcl_trans_log_list CTCL_TRANS_LOG_LIST;
 struct ctcl_trans_log_list
 {
@@ -199,6 +251,8 @@ struct ctcl_trans_log_list
     int ref_cnt;            /* reference count of this list */
     int max_item;           /* from configuration */
     int item_num;           /* current number of log items */
+    CTCL_LOG_LSA commit_lsa;    /* set when published, clients resume 
+                                   after it */
     BOOL is_committed;      /* did get commit log */
     BOOL long_tx_flag;      /* is long term transaction */
 
@@ -209,9 +263,44 @@ struct ctcl_trans_log_list
     CTCL_ITEM *tail;
 
     CTCL_LONG_TRANS_LOG_LIST *long_trans_log_list;
+    CTCL_ENCODED_TRANS *encoded_list;   /* committed only, lock free */
 };
 
 
+/* per job read position on the commit stream, opaque to callers */
+typedef struct ctcl_stream_cursor CTCL_STREAM_CURSOR;
+
+/* tells the cursor owner that its empty job queue has a new entry */
+typedef void (*CTCL_STREAM_NOTIFY_FUNC) (void *notify_arg);
+
+/* where a cursor starts reading the commit stream */
+typedef enum ctcl_stream_pos_type
+{
+    CTCL_STREAM_POS_NOW = 0,        /* committed from now on */
+    CTCL_STREAM_POS_LSA             /* committed after the commit lsa */
+} CTCL_STREAM_POS_TYPE;
+
+typedef struct ctcl_stream_pos CTCL_STREAM_POS;
+struct ctcl_stream_pos
+{
+    int type;                       /* CTCL_STREAM_POS_TYPE */
+    CTCL_LOG_LSA lsa;
+};
+
+/* commit lsa as one number sent to clients, page id (48 BIT) | 
+ * offset (16 BIT) */
+#define CTCL_LSA_PACK(lsa_ptr)                                  \
+    ((((UINT_64)(lsa_ptr)->pageid) << 16) |                     \
+     ((UINT_64)(lsa_ptr)->offset & 0xFFFF))
+
+#define CTCL_LSA_UNPACK(lsa_ptr, packed)                        \
+    do                                                          \
+    {                                                           \
+        (lsa_ptr)->pageid = (SINT_64)(packed) >> 16;            \
+        (lsa_ptr)->offset = (SINT_64)((packed) & 0xFFFF);       \
+    } while (0)
+
+
 /* ctcl functions */
 extern int ctcl_initialize(CTCL_CONF_ITEMS *conf_items, pthread_t *la_thr_id);
 extern void ctcl_finalize(void);
@@ -224,8 +313,6 @@ extern int ctcl_mgr_get_status_nolock (void);
 extern int ctcl_mgr_set_first_tid (void);
 extern int ctcl_mgr_get_first_tid_nolock (void);
 extern int ctcl_mgr_get_last_tid_nolock (void);
-extern int ctcl_mgr_get_cur_trans_index (void);
-extern CTCL_TRANS_LOG_LIST **ctcl_mgr_get_trans_log_list (void);
 extern int ctcl_mgr_get_cur_job_cnt (void);
 extern int ctcl_mgr_inc_cur_job_cnt (void);
 extern int ctcl_mgr_dec_cur_job_cnt (void);
@@ -234,6 +321,35 @@ extern void ctcl_mgr_set_end_of_record (BOOL is_end);
 
 extern BOOL ctcl_is_started_job(void);
 
+/* functions for commit stream */
+extern int ctcl_stream_open_cursor (CTCL_STREAM_CURSOR **cursor,
+                                    CTCG_SPSC_QUEUE *queue,
+                                    CTCL_STREAM_POS *start_pos,
+                                    int queue_full_policy,
+                                    CTCL_STREAM_NOTIFY_FUNC notify_func,
+                                    void *notify_arg);
+extern void ctcl_stream_close_cursor (CTCL_STREAM_CURSOR *cursor);
+extern int ctcl_stream_fetch (CTCL_STREAM_CURSOR *cursor,
+                              CTCL_TRANS_LOG_LIST **trans_list,
+                              int max_cnt,
+                              int *fetched_cnt);
+extern void ctcl_stream_advance (CTCL_STREAM_CURSOR *cursor, int cnt);
+extern int ctcl_stream_write_spill (CTCL_STREAM_CURSOR *cursor);
+
+/* functions for encoded transaction */
+extern CTCL_ENCODED_TRANS *ctcl_trans_get_encoded (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                                   int variant);
+extern CTCL_ENCODED_TRANS *ctcl_trans_add_encoded (CTCL_TRANS_LOG_LIST *trans_log_list,
+                                                   CTCL_ENCODED_TRANS *encoded);
+extern CTCL_ENCODED_TRANS *ctcl_encoded_get_batch (CTCL_ENCODED_TRANS *first,
+                                                   int variant,
+                                                   int trans_cnt,
+                                                   UINT_64 *lsa_list);
+extern CTCL_ENCODED_TRANS *ctcl_encoded_add_batch (CTCL_ENCODED_TRANS *first,
+                                                   CTCL_ENCODED_TRANS *batch);
+extern void ctcl_encoded_trans_hold (CTCL_ENCODED_TRANS *encoded);
+extern void ctcl_encoded_trans_release (CTCL_ENCODED_TRANS *encoded);
+
 static int ctcl_get_conf (void);
 static void ctcl_info_final (void);
 
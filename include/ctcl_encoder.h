@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcl_encoder.h : ctc column value encoder header
+ *
+ * Column values are encoded once, when the log record is turned into
+ * a log item, into the fixed binary representation sent to the client.
+ * Numbers are written in network byte order (same as CTCP header).
+ *
+ *   SHORT                  : 2 byte integer
+ *   INTEGER                : 4 byte integer
+ *   BIGINT                 : 8 byte integer
+ *   FLOAT / DOUBLE         : 4 / 8 byte IEEE 754
+ *   MONETARY               : 8 byte IEEE 754 amount
+ *   NUMERIC                : precision (1), scale (1),
+ *                            DB_NUMERIC_BUF_SIZE byte two's complement
+ *   DATE                   : 4 byte julian day
+ *   TIME                   : 4 byte seconds of day
+ *   TIMESTAMP              : 4 byte UTC seconds
+ *   DATETIME               : 4 byte julian day, 4 byte milliseconds of day
+ *   CHAR / VARCHAR /
+ *   NCHAR / VARNCHAR       : raw bytes in database charset
+ *   BIT / VARBIT           : 4 byte bit length, packed bits
+ *   ENUM                   : 2 byte index, label bytes
+ *   SET / MULTISET /
+ *   SEQUENCE               : 4 byte element count, then for each element
+ *                            type (4), length (4), encoded value
+ *
+ * A NULL value or a type without an encoder has no bytes and a negative
+ * length, CTCL_ENCODER_NULL or CTCL_ENCODER_NOT_SUPPORTED.
+ *
+ */
+
+#ifndef _CTCL_ENCODER_H_
+#define _CTCL_ENCODER_H_ 1
+
+
+#include "ctc_types.h"
+#include "dbtype.h"
+
+
+/* 
+ * a value that is not encoded has one of these as its length, so that
+ * NULL and an unsupported type are told from an empty value
+ */
+#define CTCL_ENCODER_NULL                         (-1)
+#define CTCL_ENCODER_NOT_SUPPORTED                (-2)
+
+
+/* ctcl value encoder */
+typedef struct ctcl_value_encoder CTCL_VALUE_ENCODER;
+struct ctcl_value_encoder
+{
+    int (*get_size) (DB_VALUE *value);
+    int (*write) (DB_VALUE *value, char *dst);
+};
+
+
+/* 
+ * ctcl encoder functions 
+ *
+ */
+extern BOOL ctcl_encoder_is_supported (int type);
+extern int ctcl_encoder_get_size (DB_VALUE *value);
+extern int ctcl_encoder_write (DB_VALUE *value, char *dst);
+
+
+#endif /* _CTCL_ENCODER_H_ */
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcl_spill.h : ctc job spill segment header
+ *
+ * Committed transactions that do not fit in a slow job's queue are 
+ * encoded to an append-only segment file private to that job and decoded
+ * back in commit order once the job catches up. The segment file is 
+ * unlinked right after creation, so nothing is left behind on exit.
+ *
+ * Record layout (host byte order, the file never leaves this process) :
+ *
+ *   record length (4), tid (4), item count (4), then for each item
+ *   stmt type (4), table name length (4), table name, and
+ *     INSERT : set column count (4), set columns
+ *     UPDATE : key column, set column count (4), changed column count (4),
+ *              has before-image (4), set columns
+ *     DELETE : key column
+ *
+ *   column : name length (4), name, type (4), value length (4), value,
+ *            is changed (4), before-image length (4), before-image
+ *   (a negative length means NULL pointer, CTCL_SPILL_NULL_LEN or the 
+ *    length of a column value without value)
+ *
+ */
+
+#ifndef _CTCL_SPILL_H_
+#define _CTCL_SPILL_H_ 1
+
+
+#include <sys/types.h>
+
+#include "ctc_types.h"
+#include "ctcl.h"
+
+
+#define CTCL_SPILL_NULL_LEN                       (-1)
+#define CTCL_SPILL_FILE_PREFIX                    "ctc_spill"
+
+
+typedef struct ctcl_spill CTCL_SPILL;
+struct ctcl_spill
+{
+    int fd;                 /* -1 until first record is written */
+    off_t write_pos;        /* producer */
+    off_t read_pos;         /* consumer */
+    int rec_cnt;            /* records written but not read yet */
+};
+
+
+extern void ctcl_spill_init (CTCL_SPILL *spill);
+extern void ctcl_spill_final (CTCL_SPILL *spill);
+
+extern int ctcl_spill_write (CTCL_SPILL *spill, 
+                             const char *dir, 
+                             CTCL_TRANS_LOG_LIST *trans_log_list);
+
+extern int ctcl_spill_read (CTCL_SPILL *spill, 
+                            CTCL_TRANS_LOG_LIST **trans_log_list);
+
+extern void ctcl_spill_truncate (CTCL_SPILL *spill);
+
+
+#endif /* _CTCL_SPILL_H_ */
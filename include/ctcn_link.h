@@ -28,13 +28,20 @@
 
 
 #include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include "ctcn_ring.h"
 #include "ctc_types.h"
 
 #define CTCN_MAX_LISTEN                 (11 * 100)  /* session cnt per sg * 100 */
 #define CTCN_SOCK_INVALID_HANDLE        (-1)
-#define CTCN_NONBLOCK                   (1)
-#define CTCN_LINK_BUF_SIZE              (4 * 1024)
+#define CTCN_LINK_BUF_SIZE              (4 * 1024)  /* frame size unless negotiated */
+#define CTCN_LINK_FRAME_SIZE_MAX        (16 * 1024 * 1024) /* sync with CTCP_PACKET_SIZE_MAX */
 #define CTCN_HDR_LEN                    (16) /* sync with CTCP_HDR_LEN */
+#define CTCN_LINK_ZEROCOPY_MIN_LEN      (32 * 1024) /* referenced bytes of a frame */
+#define CTCN_LINK_ZEROCOPY_PENDING_MAX  (16)        /* frames waiting completion */
+#define CTCN_LINK_SEND_FD_MAX           (4)         /* passed with a frame */
 
 #define CTCN_SHUTDW_R                   (0)
 #define CTCN_SHUTDW_W                   (1)
@@ -125,6 +132,81 @@ struct ctc_sock_t
 };
 
 
+typedef void (*CTCN_LINK_RELEASE_FUNC) (void *owner);
+
+/* called when a full send queue has drained to half */
+typedef void (*CTCN_LINK_DRAIN_FUNC) (void *arg);
+
+/* bytes sent from caller's memory, after wbuf[0 .. pos) */
+typedef struct ctcn_link_ref CTCN_LINK_REF;
+struct ctcn_link_ref
+{
+    unsigned int pos;
+    unsigned int len;
+    const char *ptr;
+};
+
+/* owner of referenced memory, released once the frame is sent */
+typedef struct ctcn_link_hold CTCN_LINK_HOLD;
+struct ctcn_link_hold
+{
+    void *owner;
+    CTCN_LINK_RELEASE_FUNC release;
+};
+
+/* frame sent with MSG_ZEROCOPY, kept until the kernel is done with it */
+typedef struct ctcn_link_zc_frame CTCN_LINK_ZC_FRAME;
+struct ctcn_link_zc_frame
+{
+    unsigned int last_id;               /* of the last sendmsg of frame */
+    unsigned int wbuf_size;
+    char *wbuf;
+    int hold_cnt;
+    CTCN_LINK_HOLD *hold;
+    CTCN_LINK_ZC_FRAME *next;
+};
+
+/* frame waiting in the send queue, owns its wbuf and holds */
+typedef struct ctcn_link_out_frame CTCN_LINK_OUT_FRAME;
+struct ctcn_link_out_frame
+{
+    unsigned int len;                   /* wbuf_pos + referenced bytes */
+    unsigned int sent;                  /* taken by the kernel so far */
+    unsigned int wbuf_pos;
+    unsigned int wbuf_size;
+    char *wbuf;
+    int ref_cnt;
+    CTCN_LINK_REF *ref;                 /* follows the frame in memory */
+    int hold_cnt;
+    CTCN_LINK_HOLD *hold;
+    int zc_call_cnt;
+    CTCN_LINK_ZC_FRAME *zc_frame;       /* taken before the first zero copy */
+    int fd_cnt;                         /* go with the first byte */
+    int fd[CTCN_LINK_SEND_FD_MAX];      /* duplicated, closed once sent */
+    CTCN_LINK_OUT_FRAME *next;
+};
+
+/* 
+ * buffers start at CTCN_LINK_BUF_SIZE and grow up to max_frame_size, 
+ * a write beyond it fails. they come from and go back to a pool shared
+ * by all links.
+ *
+ * a frame is wbuf with refs spliced in at their positions, it is sent
+ * by one sendmsg without copying referenced bytes into wbuf.
+ *
+ * rbuf may hold more than the frame being read on a non-blocking link,
+ * the next frame starts at recv_frame_len.
+ *
+ * with a send queue, a frame sent is queued with its buffers and the
+ * socket is written without blocking, the rest goes out on EPOLLOUT
+ * from the reactor. out_lock guards the queue and zero copy state, the
+ * frame being written is only touched by the writer.
+ *
+ * with a ring attached, frames sent are copied to the ring instead and
+ * the socket is left alone. a writer finding it full waits for room
+ * like for a full socket, a full ring is reported by
+ * ctcn_link_is_send_queue_full and its drain told as for the queue.
+ */
 typedef struct ctcn_link CTCN_LINK;
 struct ctcn_link
 {
@@ -132,13 +214,49 @@ struct ctcn_link
     BOOL is_sock_opened;
     unsigned short session_id;
     unsigned int next_seq_no;
+    unsigned int max_frame_size;        /* header included */
     unsigned int rbuf_pos;
-    char rbuf[CTCN_LINK_BUF_SIZE];
+    unsigned int rbuf_size;
+    char *rbuf;
     unsigned int read_data_size;
+    unsigned int recv_len;              /* received bytes in rbuf */
+    unsigned int recv_frame_len;        /* of the frame being read */
     unsigned int wbuf_pos;
-    char wbuf[CTCN_LINK_BUF_SIZE];
+    unsigned int wbuf_size;
+    char *wbuf;
+    unsigned int wbuf_ref_len;          /* referenced bytes of frame */
+    int ref_cnt;
+    int ref_max;
+    CTCN_LINK_REF *ref;
+    int hold_cnt;
+    int hold_max;
+    CTCN_LINK_HOLD *hold;
+    int iov_max;
+    struct iovec *iov;
+    BOOL is_zerocopy;
+    unsigned int zc_next_id;
+    unsigned int zc_done_id;
+    int zc_pending_cnt;
+    CTCN_LINK_ZC_FRAME *zc_pending_head;
+    CTCN_LINK_ZC_FRAME *zc_pending_tail;
+    void *reactor_entry;                /* set while watched by reactor */
+    pthread_mutex_t out_lock;
+    BOOL is_send_queued;
+    BOOL is_out_blocked;                /* writer waits for drain */
+    int out_error;                      /* of the last write, sticky */
+    int out_frame_cnt;
+    unsigned long out_bytes;            /* not yet taken by the kernel */
+    unsigned long out_bytes_max;
+    CTCN_LINK_OUT_FRAME *out_head;
+    CTCN_LINK_OUT_FRAME *out_tail;
+    CTCN_LINK_DRAIN_FUNC drain_func;
+    void *drain_arg;
+    CTCN_RING *ring;                    /* shared memory, frames go here */
 };
 
+/* frame length, write position must be at the end */
+#define CTCN_LINK_FRAME_LEN(link)       ((link)->wbuf_pos + (link)->wbuf_ref_len)
+
 
 /* 
  * ctc link functions 
@@ -148,11 +266,19 @@ extern int ctcn_link_create (CTCN_LINK **link);
 extern void ctcn_link_destroy (CTCN_LINK *link);
 
 extern int ctcn_link_set_sock_opt (CTCN_LINK *link);
+extern int ctcn_link_set_max_frame_size (CTCN_LINK *link, 
+                                         unsigned int max_frame_size);
 
 extern int ctcn_link_listen (CTCN_LINK *link, 
                              unsigned short port, 
                              unsigned int timeout);
 
+/* unix domain socket at path, left by a previous run is replaced,
+ * fails while another server still listens there */
+extern int ctcn_link_listen_unix (CTCN_LINK *link, 
+                                  const char *path, 
+                                  int mode);
+
 extern int ctcn_link_connect (CTCN_LINK *link, 
                               char *addr, 
                               unsigned short port, 
@@ -164,10 +290,19 @@ extern int ctcn_link_recv (CTCN_LINK *link,
                            unsigned long timeout,
                            BOOL *is_timeout);
 
+extern int ctcn_link_recv_frame (CTCN_LINK *link, BOOL *is_received);
+
 extern int ctcn_link_poll_socket (CTCN_LINK *link, 
                                   unsigned int timeout_msec, 
                                   BOOL *is_timeout);
 
+/* ready_idx : first of link[] with POLLIN */
+extern int ctcn_link_poll_sockets (CTCN_LINK **link,
+                                   int link_cnt,
+                                   unsigned int timeout_msec, 
+                                   int *ready_idx,
+                                   BOOL *is_timeout);
+
 extern int ctcn_link_recv_socket (CTCN_LINK *link,
                                   void *buf,
                                   int buf_size,
@@ -175,18 +310,50 @@ extern int ctcn_link_recv_socket (CTCN_LINK *link,
 
 extern int ctcn_link_send (CTCN_LINK *link);
 
+/* frame is sent with fds as SCM_RIGHTS, link must be of unix domain */
+extern int ctcn_link_send_fds (CTCN_LINK *link, int *fds, int fd_cnt);
+extern BOOL ctcn_link_is_unix (CTCN_LINK *link);
+
+extern int ctcn_link_set_send_queue (CTCN_LINK *link, 
+                                     unsigned long max_bytes);
+extern void ctcn_link_set_drain_func (CTCN_LINK *link,
+                                      CTCN_LINK_DRAIN_FUNC drain_func,
+                                      void *drain_arg);
+extern BOOL ctcn_link_is_send_queue_full (CTCN_LINK *link);
+extern int ctcn_link_flush (CTCN_LINK *link);
+
+extern int ctcn_link_attach_ring (CTCN_LINK *link, 
+                                  unsigned int data_size,
+                                  CTCN_RING **ring);
+extern void ctcn_link_detach_ring (CTCN_LINK *link);
+
 extern int ctcn_link_read (CTCN_LINK *link, void *dest, unsigned int len);
 extern int ctcn_link_read_one_byte_number (CTCN_LINK *link, void *dest);
 extern int ctcn_link_read_two_byte_number (CTCN_LINK *link, void *dest);
 extern int ctcn_link_read_four_byte_number (CTCN_LINK *link, void *dest);
+extern int ctcn_link_read_eight_byte_number (CTCN_LINK *link, void *dest);
 
 extern int ctcn_link_write (CTCN_LINK *link, void *src, unsigned int len);
 extern int ctcn_link_write_one_byte_number (CTCN_LINK *link, void *src);
 extern int ctcn_link_write_two_byte_number (CTCN_LINK *link, void *src);
 extern int ctcn_link_write_four_byte_number (CTCN_LINK *link, void *src);
+extern int ctcn_link_write_eight_byte_number (CTCN_LINK *link, void *src);
 extern int ctcn_link_forward_wbuf_pos (CTCN_LINK *link, int size);
 extern int ctcn_link_backward_wbuf_pos (CTCN_LINK *link, int size);
 extern void ctcn_link_move_wbuf_pos (CTCN_LINK *link, int pos);
+extern void ctcn_link_truncate_wbuf (CTCN_LINK *link, int pos);
+
+extern int ctcn_link_write_ref (CTCN_LINK *link, 
+                                const void *src, 
+                                unsigned int len);
+extern int ctcn_link_hold (CTCN_LINK *link, 
+                           void *owner, 
+                           CTCN_LINK_RELEASE_FUNC release);
+extern int ctcn_link_set_zerocopy (CTCN_LINK *link);
+
+extern int ctcn_sock_close (CTC_SOCK *sock);
+extern int ctcn_sock_shutdown (CTC_SOCK *sock, int how);
+extern int ctcn_sock_set_block_mode (CTC_SOCK *sock, BOOL block_mode);
 
 extern int ctcn_sock_accept (CTC_SOCK *acpt_sock,
                              CTC_SOCK *lstn_sock,
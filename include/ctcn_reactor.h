@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcn_reactor.h : ctc network reactor header
+ *
+ * Links of control sessions are served by a few reactor threads, each
+ * waiting on its own epoll instance. A link is registered once and made
+ * non-blocking, frames are put together from whatever arrives and handed
+ * to the frame function on the reactor thread, one at a time per link.
+ * An idle session costs neither a thread nor a syscall.
+ *
+ * A link added without a frame function is send only, it is watched
+ * for EPOLLOUT only while its send queue is not empty, see
+ * ctcn_link_set_send_queue. Such a link is never closed by the reactor,
+ * a write error stays with the link for the next send. A link with a 
+ * frame function may have a send queue too, so that frame functions 
+ * never wait for the socket. It is watched for EPOLLOUT along with 
+ * frames the same way.
+ *
+ * The room eventfd of a shared memory ring attached to a send only link
+ * is watched along with it, see ctcn_link_attach_ring.
+ *
+ * A listening link is watched the same way, connections are accepted on
+ * its reactor thread and handed to the accept function, which owns the
+ * new link. A listener out of descriptors or memory is paused, its owner
+ * resumes it now and then, see ctcn_reactor_resume_listener.
+ *
+ * A frame function may add its own link again to hand it over in place,
+ * to other functions or to send only. Frames already received go to the
+ * new frame function. A send only link stays so.
+ *
+ * A frame function must not wait. A frame that may is deferred to one
+ * of a few reactor workers, the link is not served until it is done,
+ * see ctcn_reactor_defer_frame.
+ *
+ */
+
+#ifndef _CTCN_REACTOR_H_
+#define _CTCN_REACTOR_H_ 1
+
+
+#include "ctcn_link.h"
+#include "ctc_types.h"
+
+
+#define CTCN_REACTOR_THREAD_MAX         (16)
+#define CTCN_REACTOR_EVENT_MAX          (64)    /* events per wait */
+#define CTCN_REACTOR_ACCEPT_MAX         (64)    /* accepts per event */
+
+/* frame function result, link is closed without an error */
+#define CTCN_REACTOR_CLOSE              (1)
+
+/* frame function result, see ctcn_reactor_defer_frame */
+#define CTCN_REACTOR_DEFER              (2)
+
+
+/* anything but CTC_SUCCESS closes the link */
+typedef int (*CTCN_REACTOR_FRAME_FUNC) (CTCN_LINK *link, void *arg);
+
+/* link is no longer watched, its socket is left to the owner */
+typedef void (*CTCN_REACTOR_CLOSE_FUNC) (CTCN_LINK *link, void *arg);
+
+/* link accepted, closed and destroyed by the function unless kept */
+typedef void (*CTCN_REACTOR_ACCEPT_FUNC) (CTCN_LINK *link, void *arg);
+
+
+extern int ctcn_reactor_initialize (int thread_cnt);
+extern void ctcn_reactor_finalize (void);
+
+extern int ctcn_reactor_add_link (CTCN_LINK *link,
+                                  CTCN_REACTOR_FRAME_FUNC frame_func,
+                                  CTCN_REACTOR_CLOSE_FUNC close_func,
+                                  void *arg);
+extern void ctcn_reactor_remove_link (CTCN_LINK *link);
+extern int ctcn_reactor_defer_frame (CTCN_LINK *link,
+                                     CTCN_REACTOR_FRAME_FUNC defer_func);
+
+extern int ctcn_reactor_add_listener (CTCN_LINK *link,
+                                      CTCN_REACTOR_ACCEPT_FUNC accept_func,
+                                      void *arg);
+extern void ctcn_reactor_resume_listener (CTCN_LINK *link);
+
+/* out_lock of link is held by caller */
+extern int ctcn_reactor_want_write (CTCN_LINK *link);
+extern void ctcn_reactor_done_write (CTCN_LINK *link);
+extern int ctcn_reactor_watch_room (CTCN_LINK *link, int room_fd);
+extern int ctcn_reactor_want_room (CTCN_LINK *link);
+
+
+#endif /* _CTCN_REACTOR_H_ */
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctcn_ring.h : ctc shared memory ring header
+ *
+ * Captured data frames of a job may be handed to a consumer on the same
+ * host through a ring in shared memory instead of its job link. The ring
+ * is a memfd mapped by both sides, passed with two eventfds over a unix
+ * domain control session, see CTCP_ATTACH_SHM_RING.
+ *
+ * The memory is a header of CTCN_RING_HDR_SIZE followed by data_size
+ * bytes, a power of two. head and tail only grow, a position is at
+ * offset (position & (data_size - 1)) of data. The server writes records
+ * from head, the consumer reads them in place from tail. A record is
+ *
+ *   frame length (4 BYTE) | record type (4 BYTE) | frame | padding
+ *
+ * padded to CTCN_RING_REC_ALIGN. A frame is as it would be sent on the
+ * job link, protocol header included. A record never wraps, the end of
+ * data is filled by a CTCN_RING_REC_WRAP record instead and the next one
+ * starts at offset 0. Numbers of the header and records are in host
+ * byte order.
+ *
+ * head is stored with release ordering after its record is written, tail
+ * once the consumer is done with a record. A side about to sleep sets
+ * its waiting flag, reads the other position again and then waits on
+ * its eventfd. The other side clears the flag after moving its position
+ * and writes the eventfd when the flag was set.
+ *
+ *   data_fd : written by server, consumer waits for records on it
+ *   room_fd : written by consumer, server waits for room on it
+ *
+ * is_closed is set when the server is done with the ring, records
+ * before head are still valid.
+ *
+ */
+
+#ifndef _CTCN_RING_H_
+#define _CTCN_RING_H_ 1
+
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include "ctc_types.h"
+
+
+#define CTCN_RING_MAGIC                 (0x43544352)    /* "CTCR" */
+#define CTCN_RING_VERSION               (1)
+#define CTCN_RING_HDR_SIZE              (4096)
+#define CTCN_RING_CACHE_LINE            (64)
+
+#define CTCN_RING_REC_FRAME             (1)
+#define CTCN_RING_REC_WRAP              (2)
+#define CTCN_RING_REC_HDR_LEN           (8)
+#define CTCN_RING_REC_ALIGN             (8)
+#define CTCN_RING_REC_LEN(frame_len)    (CTCN_RING_REC_HDR_LEN + \
+                                         (((frame_len) + CTCN_RING_REC_ALIGN - 1) & \
+                                          ~(CTCN_RING_REC_ALIGN - 1)))
+
+#define CTCN_RING_DATA_SIZE_MIN         (64 * 1024)
+#define CTCN_RING_DATA_SIZE_MAX         (1024 * 1024 * 1024)
+
+
+/* shared with the consumer, positions of each side on own cache line */
+typedef struct ctcn_ring_hdr CTCN_RING_HDR;
+struct ctcn_ring_hdr
+{
+    UINT_32 magic;
+    UINT_32 version;
+    UINT_32 data_offset;                /* from the start of memory */
+    UINT_32 data_size;
+    char pad0[CTCN_RING_CACHE_LINE - 16];
+    volatile UINT_64 head;              /* written by server */
+    volatile UINT_32 is_consumer_waiting;
+    volatile UINT_32 is_closed;
+    char pad1[CTCN_RING_CACHE_LINE - 16];
+    volatile UINT_64 tail;              /* written by consumer */
+    volatile UINT_32 is_server_waiting;
+    char pad2[CTCN_RING_CACHE_LINE - 12];
+};
+
+/* server side of a ring, written by one thread at a time */
+typedef struct ctcn_ring CTCN_RING;
+struct ctcn_ring
+{
+    int mem_fd;
+    int data_fd;
+    int room_fd;
+    size_t mem_size;
+    UINT_32 data_size;
+    UINT_64 head;                       /* published to hdr->head */
+    CTCN_RING_HDR *hdr;
+    char *data;
+};
+
+
+extern int ctcn_ring_create (unsigned int data_size, CTCN_RING **ring);
+extern void ctcn_ring_destroy (CTCN_RING *ring);
+
+extern unsigned int ctcn_ring_get_free (CTCN_RING *ring);
+extern BOOL ctcn_ring_has_room (CTCN_RING *ring, unsigned int frame_len);
+
+/* CTCN_RESULT_EAGAIN when frame does not fit */
+extern int ctcn_ring_write (CTCN_RING *ring,
+                            struct iovec *iov,
+                            int iov_cnt,
+                            unsigned int frame_len);
+
+extern void ctcn_ring_want_room (CTCN_RING *ring);
+extern int ctcn_ring_wait_room (CTCN_RING *ring,
+                                unsigned int frame_len,
+                                int timeout_msec);
+extern void ctcn_ring_clear_room_event (CTCN_RING *ring);
+extern void ctcn_ring_post_room_event (CTCN_RING *ring);
+
+
+#endif /* _CTCN_RING_H_ */
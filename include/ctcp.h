@@ -29,6 +29,7 @@
 
 
 #include "ctcl.h"
+#include "ctcj_def.h"
 
 /****************************************************************************
  *  CTCP Common Header: (byte)
@@ -44,9 +45,12 @@
  *
  * --------------------------------------------------------------------*/
 
-/* CTCP protocol version settings */
+/* CTCP protocol version settings, 1.1 : column values in network byte 
+ * order, negative value length for a column without value, commit lsa
+ * instead of commit seq in transaction records, one compressed record per
+ * compressed frame */
 #define CTCP_VER_MAJOR                      (1)
-#define CTCP_VER_MINOR                      (0)
+#define CTCP_VER_MINOR                      (1)
 #define CTCP_VER_PATCH                      (0)
 #define CTCP_VER_TAG                        (0)
 
@@ -85,6 +89,82 @@
 #define CTCP_PACKET_DATA_MAX_LEN            (((1024) * CTCP_PACKET_BLK_SIZE_K)\
                                              - CTCP_HDR_LEN)
 
+/* frame size negotiated at CTCP_CREATE_CONTROL_SESSION is bounded by this,
+ * request data : max frame size (4 BYTE, optional) | 
+ *                features (4 BYTE, optional)
+ * result data  : accepted max frame size (4 BYTE, only if requested) |
+ *                accepted features (4 BYTE, only if requested) */
+#define CTCP_PACKET_SIZE_MAX                (16 * 1024 * 1024)
+#define CTCP_PACKET_DATA_ABS_MAX_LEN        (CTCP_PACKET_SIZE_MAX - CTCP_HDR_LEN)
+#define CTCP_MAX_FRAME_SIZE_DATA_LEN        (4)
+#define CTCP_FEATURES_DATA_LEN              (4)
+
+/* session features, CTCP_FEATURE_NOT_REQUESTED : client sent none */
+#define CTCP_FEATURE_NOT_REQUESTED          (-1)
+#define CTCP_FEATURE_COMPRESS_LZO           (0x01)
+#define CTCP_FEATURE_COMPACT_ENCODING       (0x02)
+#define CTCP_FEATURE_SUPPORTED              (CTCP_FEATURE_COMPRESS_LZO | \
+                                             CTCP_FEATURE_COMPACT_ENCODING)
+
+/* 
+ * a column value or before-image length is negative when it has no value
+ * bytes, -1 : NULL, -2 : type not supported, -3 : before-image not logged.
+ * a zero length is an empty value.
+ */
+
+/* 
+ * op_param of CTCP_CAPTURED_DATA_RESULT is result code | flags. a frame
+ * flagged compressed holds one record
+ *
+ *   transaction count (4 BYTE) | records length (4 BYTE) | 
+ *   stored length (4 BYTE) | stored records
+ *
+ * stored records are transaction records compressed together by LZO1X-1,
+ * or as they are when both lengths are equal. they are plain records, or
+ * compact ones when the frame is also flagged compact, and are never 
+ * fragmented. the records of a frame are compressed once for all jobs 
+ * sending the same transactions in a frame the same way.
+ */
+#define CTCP_RC_FLAG_COMPRESSED             (0x80)
+
+/* 
+ * with CTCP_FEATURE_COMPACT_ENCODING, table and column names are sent once
+ * per job session in frames flagged dictionary, a sequence of entries
+ *
+ *   entry id (VARINT) | table id + 1 (VARINT, 0 : entry is a table) |
+ *   column type (VARINT, column entry only) | name length (VARINT) | name
+ *
+ * and captured items refer to them by id. records of a frame flagged
+ * compact are
+ *
+ *   transaction id delta (ZIGZAG VARINT) | commit lsa delta (ZIGZAG VARINT) |
+ *   item count (VARINT) | items
+ *
+ * deltas are taken from the previous record of the frame, the first record
+ * of a frame carries them as they are. an item is
+ *
+ *   table id (VARINT) | stmt type (VARINT) | columns as in plain items
+ *
+ * with each column as column id (VARINT) | value length (ZIGZAG VARINT) |
+ * value, before-image lengths as ZIGZAG VARINT and set column counts as 
+ * VARINT. VARINT is LEB128, 7 bits a byte from the lowest. deltas of 
+ * compact records stored in a compressed frame start over there too.
+ * entry ids are never reused while the server runs.
+ */
+#define CTCP_RC_FLAG_COMPACT                (0x40)
+#define CTCP_RC_FLAG_DICTIONARY             (0x20)
+#define CTCP_VARINT_MAX_LEN                 (10)
+#define CTCP_DICT_ID_NULL                   (-1)
+
+/* encoded items at least this long are sent without a copy */
+#define CTCP_ITEM_REF_MIN_LEN               (512)
+
+/* captured items are encoded once per transaction and variant */
+#define CTCP_ENCODE_VARIANT(mode, bi)       (((mode) << 1) | \
+                                             ((bi) == CTC_TRUE ? 1 : 0))
+#define CTCP_ENCODE_COMPRESSED              (0x100)
+#define CTCP_ENCODE_COMPACT                 (0x200)
+
 /* define CTCP common header flags for sending protocols */
 #define CTCP_PACKET_PARAM_NOT_USED          (0xFF)
 #define CTCP_PACKET_PARAM_NOT_FRAGMENTED    (0x00)
@@ -100,6 +180,33 @@
 
 #define CTCP_PACKET_RESERVED_NOT_USED       (0x00)
 
+/* job status, queue size, queue used, queue high water mark (4 BYTE each),
+ * delivered bytes (8 BYTE) */
+#define CTCP_JOB_STATUS_RESULT_DATA_LEN     ((4 * 4) + 8)
+
+/* op_param of CTCP_GRANT_CREDIT is CTCJ_CREDIT_UNIT, data is the amount
+ * granted (8 BYTE). its result is sent only when the grant fails, so a
+ * consumer grants as it consumes without waiting. */
+#define CTCP_GRANT_CREDIT_DATA_LEN          (8)
+
+/* 
+ * CTCP_ATTACH_SHM_RING moves captured data frames of a job to a shared
+ * memory ring, see ctcn_ring.h for its layout. it is accepted on a unix
+ * domain control session before capture starts.
+ *
+ * request data : ring size (4 BYTE, 0 : CTCP_SHM_RING_SIZE_DEFAULT, or two
+ *                frames of the largest size when they take more)
+ * result data  : ring data size (4 BYTE, on success)
+ *
+ * a successful result carries ring memfd, data eventfd and room eventfd
+ * as SCM_RIGHTS, in this order. other frames of the job, and everything 
+ * on the control session, stay on sockets.
+ */
+#define CTCP_ATTACH_SHM_RING_DATA_LEN       (4)
+#define CTCP_ATTACH_SHM_RING_RESULT_DATA_LEN (4)
+#define CTCP_SHM_RING_SIZE_DEFAULT          (8 * 1024 * 1024)   /* stays in cache */
+#define CTCP_SHM_RING_FD_CNT                (3)
+
 #define CTCP_RESULT_OPID_VALIDATION_FACTOR  (2)
 
 
@@ -142,6 +249,10 @@ typedef enum ctcp_opid
     CTCP_UNREGISTER_TABLE_RESULT,               /* 0x10 */
     CTCP_SET_JOB_ATTRIBUTE,                     /* 0x11 */
     CTCP_SET_JOB_ATTRIBUTE_RESULT,              /* 0x12 */
+    CTCP_GRANT_CREDIT,                          /* 0x13 */
+    CTCP_GRANT_CREDIT_RESULT,                   /* 0x14 */
+    CTCP_ATTACH_SHM_RING,                       /* 0x15 */
+    CTCP_ATTACH_SHM_RING_RESULT,                /* 0x16 */
     CTCP_OPID_CTRL_MAX,
 
     /* operation separator */
@@ -182,6 +293,8 @@ typedef enum ctcp_result_code
     CTCP_RC_FAILED_NOT_SUPPORTED_FILTER,        /* 0x14 */
     CTCP_RC_FAILED_JOB_ALREADY_STARTED,         /* 0x15 */
     CTCP_RC_FAILED_JOB_ALREADY_STOPPED,         /* 0x16 */
+    CTCP_RC_FAILED_POSITION_NOT_AVAILABLE,      /* 0x17 */
+    CTCP_RC_FAILED_NOT_LOCAL_SESSION,           /* 0x18 */
 
     CTCP_RC_MAX                          
 } CTCP_RESULT_CODE;
@@ -193,6 +306,19 @@ typedef enum ctcp_connection_type
     CTCP_CONNECTION_TYPE_CTRL_ONLY
 } CTCP_CONNECTION_TYPE;
 
+/* op_param of CTCP_START_CAPTURE, followed by
+ *   LSA : commit lsa (8 BYTE) of a transaction record, page id (48 BIT) |
+ *         offset (16 BIT). it is a position in the database log, so a 
+ *         client resumes with it after the server restarts too, and gets
+ *         CTCP_RC_FAILED_POSITION_NOT_AVAILABLE once it is older than 
+ *         what the server retains.
+ * 1 was a commit sequence, it is rejected as it restarts with the server */
+typedef enum ctcp_start_capture_pos
+{
+    CTCP_START_CAPTURE_POS_NOW = 0,
+    CTCP_START_CAPTURE_POS_LSA = 2
+} CTCP_START_CAPTURE_POS;
+
 typedef enum ctcp_stop_capture_cond
 {
     CTCP_STOP_CAPTURE_COND_IMMEDIATELY = 0,
@@ -263,17 +389,25 @@ extern int ctcp_header_get_data_len (CTCP_HEADER *header);
  *
  */
 extern int ctcp_process_protocol (void *link, int sgid);
+extern int ctcp_process_received_protocol (void *link);
+extern BOOL ctcp_is_waiting_protocol (void *link);
 
 
 /* control session */
 extern int ctcp_do_create_ctrl_session (void *link,
                                         CTCP_HEADER *header,
                                         int *sgid,
+                                        int *max_frame_size,
+                                        int *features,
                                         int *result_code);
 
+/* max_frame_size 0 : not negotiated, 
+ * features CTCP_FEATURE_NOT_REQUESTED : not negotiated */
 extern int ctcp_send_create_ctrl_session_result (void *link,
                                                     int result_code,
-                                                    int sgid);
+                                                    int sgid,
+                                                    int max_frame_size,
+                                                    int features);
 
 extern int ctcp_do_destroy_ctrl_session (int sgid, int *result_code);
 
@@ -310,13 +444,15 @@ extern int ctcp_do_request_job_status (void *link,
                                        CTCP_HEADER *header,
                                        unsigned short job_desc,
                                        int *status,
+                                       CTCJ_JOB_QUEUE_STAT *queue_stat,
                                        int *result_code);
 
 extern int ctcp_send_request_job_status_result (void *link,
                                                 int result_code,
                                                 unsigned short job_desc,
                                                 int sgid,
-                                                int status);
+                                                int status,
+                                                CTCJ_JOB_QUEUE_STAT *queue_stat);
 
 /* server status */
 extern int ctcp_do_request_server_status (void *link,
@@ -371,11 +507,39 @@ extern int ctcp_send_set_job_attribute_result (void *link,
                                                unsigned short job_desc,
                                                int sgid);
 
+/* credit */
+extern int ctcp_do_grant_credit (void *link,
+                                 int sgid,
+                                 CTCP_HEADER *header,
+                                 unsigned short job_desc,
+                                 SINT_64 credit,
+                                 int *result_code);
+
+extern int ctcp_send_grant_credit_result (void *link,
+                                          int result_code,
+                                          unsigned short job_desc,
+                                          int sgid);
+
+/* shared memory ring */
+extern int ctcp_do_attach_shm_ring (void *link,
+                                    int sgid,
+                                    unsigned short job_desc,
+                                    unsigned int ring_size,
+                                    void **ring,
+                                    int *result_code);
+
+extern int ctcp_send_attach_shm_ring_result (void *link,
+                                             int result_code,
+                                             unsigned short job_desc,
+                                             int sgid,
+                                             void *ring);
+
 /* capture */
 extern int ctcp_do_start_capture (void *link,
                                   int sgid,
                                   CTCP_HEADER *header,
                                   unsigned short job_desc,
+                                  CTCL_STREAM_POS *start_pos,
                                   int *result_code);
 
 extern int ctcp_send_start_capture_result (void *link,
@@ -387,7 +551,16 @@ extern int ctcp_send_captured_data_result (void *link,
                                            unsigned short job_desc,
                                            int sgid,
                                            int trans_cnt,
-                                           void **trans_list);
+                                           void **trans_list,
+                                           int update_mode,
+                                           BOOL send_before_image,
+                                           CTCJ_CAPTURE_BATCH *batch,
+                                           int *sent_cnt);
+
+extern int ctcp_flush_captured_data_result (void *link,
+                                            unsigned short job_desc,
+                                            int sgid,
+                                            CTCJ_CAPTURE_BATCH *batch);
 
 extern int ctcp_do_stop_capture (void *link,
                                  int sgid,
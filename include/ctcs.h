@@ -48,6 +48,7 @@ extern int ctcs_mgr_create_session_group (CTCN_LINK *link, int *sgid);
 
 /* session group functions */
 extern CTCS_SESSION_GROUP *ctcs_find_session_group_by_id (int sgid);
+extern void ctcs_sg_put (CTCS_SESSION_GROUP *sg);
 
 extern int ctcs_sg_initialize (CTCS_SESSION_GROUP *sg, 
                                CTCN_LINK *link, 
@@ -66,6 +67,9 @@ extern CTCS_JOB_SESSION *ctcs_sg_find_job_session (CTCS_SESSION_GROUP *sg,
 
 extern CTCS_CTRL_SESSION *ctcs_sg_get_ctrl_session (CTCS_SESSION_GROUP *sg);
 
+extern int ctcs_sg_start_ctrl_session (CTCS_SESSION_GROUP *sg, 
+                                       CTCN_LINK *link);
+
 extern int ctcs_sg_is_table_registered (CTCS_SESSION_GROUP *sg,
                                         unsigned short job_desc,
                                         char *user_Name,
@@ -74,7 +78,8 @@ extern int ctcs_sg_is_table_registered (CTCS_SESSION_GROUP *sg,
 
 extern int ctcs_sg_get_job_status (CTCS_SESSION_GROUP *sg,
                                    unsigned short job_desc,
-                                   int *job_status);
+                                   int *job_status,
+                                   CTCJ_JOB_QUEUE_STAT *queue_stat);
 
 extern int ctcs_sg_register_table (CTCS_SESSION_GROUP *sg,
                                    unsigned short job_desc,
@@ -90,8 +95,19 @@ extern int ctcs_sg_set_job_attr (CTCS_SESSION_GROUP *sg,
                                  unsigned short job_desc,
                                  CTCJ_JOB_ATTR *job_attr);
 
+extern int ctcs_sg_grant_credit (CTCS_SESSION_GROUP *sg,
+                                 unsigned short job_desc,
+                                 int unit,
+                                 SINT_64 credit);
+
+extern int ctcs_sg_attach_ring (CTCS_SESSION_GROUP *sg,
+                                unsigned short job_desc,
+                                unsigned int ring_size,
+                                CTCN_RING **ring);
+
 extern int ctcs_sg_start_capture (CTCS_SESSION_GROUP *sg,
-                                  unsigned short job_desc);
+                                  unsigned short job_desc,
+                                  struct ctcl_stream_pos *start_pos);
 
 extern int ctcs_sg_stop_capture (CTCS_SESSION_GROUP *sg, 
                                  unsigned short job_desc,
@@ -101,7 +117,8 @@ extern int ctcs_sg_stop_capture (CTCS_SESSION_GROUP *sg,
 /* job session functions */
 extern CTCJ_JOB_INFO *ctcs_job_session_get_job (CTCS_JOB_SESSION *job_session);
 
-extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session);
+extern int ctcs_job_session_start_capture (CTCS_JOB_SESSION *job_session,
+                                           struct ctcl_stream_pos *start_pos);
 
 extern int ctcs_disconnect_job_session (CTCS_JOB_SESSION * job_session);
 
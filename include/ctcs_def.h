@@ -33,7 +33,6 @@
 #define CTC_JOB_SESSION_PER_GROUP                   (10)
 #define CTCS_JOB_SESSION_COUNT_MAX                  CTC_JOB_SESSION_PER_GROUP 
 #define CTCS_NULL_SESSION_ID                        (-1)
-#define CTCS_JOB_THREAD_NULL_ID                     (-1)
 
 #define JOB_SESSION_POSITION_0_MASK                 (1)
 #define JOB_SESSION_POSITION_1_MASK                 (2)
@@ -109,10 +108,9 @@ typedef enum ctcs_conn_type
 typedef struct ctcs_ctrl_session CTCS_CTRL_SESSION;
 struct ctcs_ctrl_session
 {
-    CTCN_LINK *link;
+    CTCN_LINK *link;                /* served by the reactor once READY */
     int status;
     int sgid;
-    pthread_t thread;
 };
 
 
@@ -133,7 +131,6 @@ struct ctcs_job_session
     int sgid;
     int job_qsize;
     int long_tran_qsize;
-    pthread_t thread;       /* thread matching with job(session) by 1:1 */
     CTCJ_JOB_INFO *job;     /* job info including job's status */
 
     pthread_mutex_t lock;
@@ -147,7 +144,10 @@ struct ctcs_session_group
     int added_job_cnt;                      /* the number of added job */
     unsigned short job_sessions_status_flag;/* all job sessions' avilable status */
     CTCS_CTRL_SESSION ctrl_session;          /* control session */
+    int features;                           /* CTCP_FEATURE_ accepted */
     CTCS_JOB_SESSION job_session[CTC_JOB_SESSION_PER_GROUP];   /* job session array */
+    int ref_cnt;                            /* sg_list, reactor and finders */
+    BOOL is_deleted;                        /* out of sg_list, see ctcs_sg_put */
     CTCG_LIST_NODE node;
 };
 
@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctc_accept_bench.c : control session setup rate of a running ctc server
+ *                      under concurrent consumers
+ *
+ *  build alone, cc -O2 ctc_accept_bench.c -lpthread
+ *  usage: ctc_accept_bench [<host or unix socket path> [<port>
+ *                          [<clients> [<slow clients %>
+ *                          [<slow delay usec>]]]]]
+ *
+ *  clients connect to the server all at once, each sends
+ *  CTCP_CREATE_CONTROL_SESSION asking for a frame size and features, and
+ *  reads its result. setup is connect to result, a setup counts when the
+ *  result is success with a session group id. slow clients send their
+ *  request after the delay, like a consumer across a slow network or a
+ *  stalled one. sessions are kept until every client is done, so the
+ *  server holds all of them at once, then closed.
+ *
+ *  the server counts sessions and handshakes against CTCN_MAX_LISTEN and
+ *  needs a file per session, raise its open files limit for many clients.
+ *  a host starting with '/' is ctc_unix_socket_path of the server.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+
+/* sync with ctcp.h, numbers are in network byte order */
+#define BENCH_HDR_LEN               (16)        /* CTCP_HDR_LEN */
+#define BENCH_OP_CREATE_CTRL        (0x01)      /* CTCP_CREATE_CONTROL_SESSION */
+#define BENCH_CONN_CTRL_ONLY        (1)         /* CTCP_CONNECTION_TYPE_CTRL_ONLY */
+#define BENCH_RC_SUCCESS            (0x00)      /* CTCP_RC_SUCCESS */
+#define BENCH_PROTOCOL_VERSION      ((1 << 24) | (1 << 16))     /* CTCP_VERSION */
+#define BENCH_REQ_DATA_LEN          (4 + 4)     /* max frame size | features */
+#define BENCH_RESULT_DATA_MAX       (64)
+
+#define BENCH_HOST                  "127.0.0.1"
+#define BENCH_PORT                  (48397)     /* CTCG_CONF_DEFAULT_CTC_PORT */
+#define BENCH_CLIENT_CNT            (1000)
+#define BENCH_SLOW_PERCENT          (1)
+#define BENCH_SLOW_DELAY            (50000)     /* usec */
+#define BENCH_FRAME_SIZE            (64 * 1024)
+#define BENCH_FEATURES              (0x03)      /* CTCP_FEATURE_SUPPORTED */
+
+
+typedef struct bench_client BENCH_CLIENT;
+struct bench_client
+{
+    int delay_usec;
+    int sgid;
+    double setup_usec;
+    int is_done;
+};
+
+
+static pthread_mutex_t bench_Start_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t bench_Start_cond = PTHREAD_COND_INITIALIZER;
+static int bench_Is_started;
+static int bench_Left_cnt;
+
+static struct sockaddr_storage bench_Addr;
+static socklen_t bench_Addr_len;
+
+
+static double bench_now_usec (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+
+static int bench_read_full (int fd, char *buf, int len)
+{
+    int n;
+    int got = 0;
+
+    while (got < len)
+    {
+        n = read (fd, buf + got, len - got);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        got += n;
+    }
+
+    return 0;
+}
+
+
+static int bench_write_full (int fd, const char *buf, int len)
+{
+    int n;
+    int put = 0;
+
+    while (put < len)
+    {
+        n = write (fd, buf + put, len - put);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        put += n;
+    }
+
+    return 0;
+}
+
+
+static int bench_set_addr (const char *host, int port)
+{
+    struct sockaddr_un *addr_un;
+    struct addrinfo hints;
+    struct addrinfo *info = NULL;
+
+    memset (&bench_Addr, 0, sizeof (bench_Addr));
+
+    if (host[0] == '/')
+    {
+        addr_un = (struct sockaddr_un *)&bench_Addr;
+        addr_un->sun_family = AF_UNIX;
+        strncpy (addr_un->sun_path, host, sizeof (addr_un->sun_path) - 1);
+        bench_Addr_len = sizeof (*addr_un);
+
+        return 0;
+    }
+
+    memset (&hints, 0, sizeof (hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo (host, NULL, &hints, &info) != 0 || info == NULL)
+    {
+        return -1;
+    }
+
+    memcpy (&bench_Addr, info->ai_addr, info->ai_addrlen);
+    ((struct sockaddr_in *)&bench_Addr)->sin_port = htons (port);
+    bench_Addr_len = info->ai_addrlen;
+
+    freeaddrinfo (info);
+
+    return 0;
+}
+
+
+/* request as ctcp_make_protocol_header lays out a header */
+static void bench_make_request (char *req)
+{
+    unsigned short job_desc = 0;
+    unsigned int num;
+
+    memset (req, 0, BENCH_HDR_LEN + BENCH_REQ_DATA_LEN);
+
+    req[0] = BENCH_OP_CREATE_CTRL;
+    req[1] = BENCH_CONN_CTRL_ONLY;
+    memcpy (req + 2, &job_desc, 2);
+
+    /* session group id 0, a new group */
+    num = htonl (BENCH_PROTOCOL_VERSION);
+    memcpy (req + 8, &num, 4);
+    num = htonl (BENCH_REQ_DATA_LEN);
+    memcpy (req + 12, &num, 4);
+
+    num = htonl (BENCH_FRAME_SIZE);
+    memcpy (req + BENCH_HDR_LEN, &num, 4);
+    num = htonl (BENCH_FEATURES);
+    memcpy (req + BENCH_HDR_LEN + 4, &num, 4);
+}
+
+
+/* result header and the negotiated values after it */
+static int bench_read_result (int fd, int *sgid)
+{
+    unsigned int num;
+    char hdr[BENCH_HDR_LEN];
+    char data[BENCH_RESULT_DATA_MAX];
+
+    if (bench_read_full (fd, hdr, BENCH_HDR_LEN) != 0)
+    {
+        return -1;
+    }
+
+    memcpy (&num, hdr + 12, 4);
+    num = ntohl (num);
+
+    if (num > BENCH_RESULT_DATA_MAX ||
+        bench_read_full (fd, data, (int)num) != 0)
+    {
+        return -1;
+    }
+
+    memcpy (&num, hdr + 4, 4);
+    *sgid = (int)ntohl (num);
+
+    return hdr[1] == BENCH_RC_SUCCESS && *sgid != 0 ? 0 : -1;
+}
+
+
+/* consumer, connects when all are ready and keeps its session until all
+ * are done */
+static void *bench_client_main (void *arg)
+{
+    int opt = 1;
+    int fd;
+    double start;
+    char req[BENCH_HDR_LEN + BENCH_REQ_DATA_LEN];
+    BENCH_CLIENT *client = (BENCH_CLIENT *)arg;
+
+    bench_make_request (req);
+
+    pthread_mutex_lock (&bench_Start_lock);
+
+    while (!bench_Is_started)
+    {
+        pthread_cond_wait (&bench_Start_cond, &bench_Start_lock);
+    }
+
+    pthread_mutex_unlock (&bench_Start_lock);
+
+    start = bench_now_usec ();
+
+    fd = socket (bench_Addr.ss_family, SOCK_STREAM, 0);
+
+    if (fd >= 0)
+    {
+        if (bench_Addr.ss_family == AF_INET)
+        {
+            (void)setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof (opt));
+        }
+
+        if (connect (fd, (struct sockaddr *)&bench_Addr, bench_Addr_len) == 0)
+        {
+            if (client->delay_usec > 0)
+            {
+                usleep (client->delay_usec);
+            }
+
+            if (bench_write_full (fd, req, sizeof (req)) == 0 &&
+                bench_read_result (fd, &client->sgid) == 0)
+            {
+                client->setup_usec = bench_now_usec () - start;
+                client->is_done = 1;
+            }
+        }
+    }
+
+    pthread_mutex_lock (&bench_Start_lock);
+
+    if (--bench_Left_cnt == 0)
+    {
+        pthread_cond_broadcast (&bench_Start_cond);
+    }
+
+    while (bench_Left_cnt > 0)
+    {
+        pthread_cond_wait (&bench_Start_cond, &bench_Start_lock);
+    }
+
+    pthread_mutex_unlock (&bench_Start_lock);
+
+    if (fd >= 0)
+    {
+        close (fd);
+    }
+
+    return NULL;
+}
+
+
+static int bench_compare_double (const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+static int bench_run (int client_cnt, int slow_cnt, int slow_usec)
+{
+    int i;
+    int done = 0;
+    double start;
+    double elapsed;
+    double *setup;
+    pthread_t *client_thr;
+    BENCH_CLIENT *client;
+
+    client = (BENCH_CLIENT *)calloc (client_cnt, sizeof (BENCH_CLIENT));
+    client_thr = (pthread_t *)malloc (sizeof (pthread_t) * client_cnt);
+    setup = (double *)malloc (sizeof (double) * client_cnt);
+
+    if (client == NULL || client_thr == NULL || setup == NULL)
+    {
+        fprintf (stderr, "cannot allocate clients\n");
+        return -1;
+    }
+
+    bench_Is_started = 0;
+    bench_Left_cnt = client_cnt;
+
+    for (i = 0; i < client_cnt; i++)
+    {
+        /* spread evenly */
+        client[i].delay_usec = (long)i * slow_cnt / client_cnt !=
+                               (long)(i + 1) * slow_cnt / client_cnt ?
+                               slow_usec : 0;
+
+        if (pthread_create (&client_thr[i], NULL, bench_client_main, &client[i]) != 0)
+        {
+            fprintf (stderr, "cannot start client %d\n", i);
+            exit (EXIT_FAILURE);
+        }
+    }
+
+    pthread_mutex_lock (&bench_Start_lock);
+    bench_Is_started = 1;
+    start = bench_now_usec ();
+    pthread_cond_broadcast (&bench_Start_cond);
+
+    while (bench_Left_cnt > 0)
+    {
+        pthread_cond_wait (&bench_Start_cond, &bench_Start_lock);
+    }
+
+    elapsed = bench_now_usec () - start;
+    pthread_mutex_unlock (&bench_Start_lock);
+
+    for (i = 0; i < client_cnt; i++)
+    {
+        pthread_join (client_thr[i], NULL);
+    }
+
+    for (i = 0; i < client_cnt; i++)
+    {
+        if (client[i].is_done)
+        {
+            setup[done++] = client[i].setup_usec;
+        }
+    }
+
+    qsort (setup, done, sizeof (double), bench_compare_double);
+
+    printf ("%8.1f setups/s  %4d of %d set up (%d slow) in %7.1f msec  "
+            "p50 %8.1f usec  p99 %8.1f usec  max %8.1f usec\n",
+            done / (elapsed / 1000000.0),
+            done,
+            client_cnt,
+            slow_cnt,
+            elapsed / 1000.0,
+            done > 0 ? setup[done / 2] : 0.0,
+            done > 0 ? setup[(int)(done * 0.99)] : 0.0,
+            done > 0 ? setup[done - 1] : 0.0);
+
+    free (client);
+    free (client_thr);
+    free (setup);
+
+    return done == client_cnt ? 0 : -1;
+}
+
+
+int main (int argc, char **argv)
+{
+    int port = BENCH_PORT;
+    int client_cnt = BENCH_CLIENT_CNT;
+    int slow_cnt;
+    int slow_percent = BENCH_SLOW_PERCENT;
+    int slow_usec = BENCH_SLOW_DELAY;
+    const char *host = BENCH_HOST;
+    struct rlimit rl;
+
+    if (argc > 1)
+    {
+        host = argv[1];
+    }
+
+    if (argc > 2)
+    {
+        port = atoi (argv[2]);
+    }
+
+    if (argc > 3)
+    {
+        client_cnt = atoi (argv[3]);
+    }
+
+    if (argc > 4)
+    {
+        slow_percent = atoi (argv[4]);
+    }
+
+    if (argc > 5)
+    {
+        slow_usec = atoi (argv[5]);
+    }
+
+    if ((host[0] != '/' && (port <= 0 || port > 65535)) || client_cnt <= 0 ||
+        slow_percent < 0 || slow_percent > 100 || slow_usec < 0)
+    {
+        fprintf (stderr,
+                 "usage: %s [<host or unix socket path> [<port> "
+                 "[<clients> [<slow clients %%> [<slow delay usec>]]]]]\n",
+                 argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (bench_set_addr (host, port) != 0)
+    {
+        fprintf (stderr, "cannot resolve %s\n", host);
+        return EXIT_FAILURE;
+    }
+
+    /* a socket per client */
+    if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        (void)setrlimit (RLIMIT_NOFILE, &rl);
+    }
+
+    slow_cnt = client_cnt * slow_percent / 100;
+
+    return bench_run (client_cnt, slow_cnt, slow_usec) == 0 ?
+           EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctc_trace_decoder.c : offline decoder of ctc trace dump file
+ *
+ *  build with ctcm/ctcg_trace.c,
+ *  usage: ctc_trace_decoder <dump file> [<output file>]
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ctcg_trace.h"
+#include "ctc_common.h"
+
+
+int main (int argc, char **argv)
+{
+    FILE *out = stdout;
+
+    if (argc < 2)
+    {
+        fprintf (stderr, "usage: %s <dump file> [<output file>]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (argc > 2)
+    {
+        out = fopen (argv[2], "w");
+
+        if (out == NULL)
+        {
+            fprintf (stderr, "cannot open %s\n", argv[2]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (ctcg_trace_decode (argv[1], out) != CTC_SUCCESS)
+    {
+        fprintf (stderr, "cannot decode %s\n", argv[1]);
+
+        if (out != stdout)
+        {
+            fclose (out);
+        }
+
+        return EXIT_FAILURE;
+    }
+
+    if (out != stdout)
+    {
+        fclose (out);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,595 @@
+/*
+ * Copyright (C) 2018 CUBRID Corporation. All right reserved by CUBRID.
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+
+/*
+ * ctc_transport_bench.c : loopback tcp vs unix domain socket vs shared
+ *                         memory ring, as a consumer on the ctc server
+ *                         host sees them
+ *
+ *  build, cc -O2 -I../include ctc_transport_bench.c ../ctcn/ctcn_ring.c -lpthread
+ *  usage: ctc_transport_bench [<frame size> [<total MB> [<round trips>]]]
+ *
+ *  throughput : frames of frame size are sent one after another and
+ *               read by a consumer thread, like captured data frames.
+ *  latency    : a 16 byte header is sent and echoed back, like a control
+ *               session request and its result.
+ *  shm ring   : frames are written to a ring of ctcn_ring.c as the server
+ *               writes a job link frame, ctcn_ring_write, and read in
+ *               place by the consumer thread, throughput only.
+ *
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "ctc_common.h"
+#include "ctcn_link.h"
+#include "ctcn_ring.h"
+
+
+#define BENCH_HDR_LEN               (16)    /* sync with CTCP_HDR_LEN */
+#define BENCH_FRAME_SIZE            (64 * 1024)
+#define BENCH_TOTAL_MB              (2048)
+#define BENCH_ROUND_TRIPS           (50000)
+#define BENCH_TCP_PORT              (48398)
+#define BENCH_UNIX_PATH             "/tmp/ctc_transport_bench.sock"
+#define BENCH_RING_SIZE             (8 * 1024 * 1024)   /* CTCP_SHM_RING_SIZE_DEFAULT */
+#define BENCH_RING_WAIT_MSEC        (1000)
+
+
+typedef struct bench_peer BENCH_PEER;
+struct bench_peer
+{
+    int fd;
+    int frame_size;
+    long long total_bytes;
+    int round_trips;
+    int is_echo;
+};
+
+
+typedef struct bench_ring_peer BENCH_RING_PEER;
+struct bench_ring_peer
+{
+    CTCN_RING_HDR *hdr;
+    int data_fd;
+    int room_fd;
+    long long total_bytes;
+    unsigned long checksum;
+};
+
+
+static double bench_now_usec (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+
+static int bench_read_full (int fd, char *buf, int len)
+{
+    int n;
+    int got = 0;
+
+    while (got < len)
+    {
+        n = read (fd, buf + got, len - got);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        got += n;
+    }
+
+    return 0;
+}
+
+
+static int bench_write_full (int fd, const char *buf, int len)
+{
+    int n;
+    int put = 0;
+
+    while (put < len)
+    {
+        n = write (fd, buf + put, len - put);
+
+        if (n <= 0)
+        {
+            return -1;
+        }
+
+        put += n;
+    }
+
+    return 0;
+}
+
+
+/* consumer side, drains frames or echoes headers */
+static void *bench_peer_main (void *arg)
+{
+    int i;
+    long long left;
+    char *buf;
+    BENCH_PEER *peer = (BENCH_PEER *)arg;
+
+    buf = (char *)malloc (peer->frame_size);
+
+    if (buf == NULL)
+    {
+        return NULL;
+    }
+
+    if (peer->is_echo)
+    {
+        for (i = 0; i < peer->round_trips; i++)
+        {
+            if (bench_read_full (peer->fd, buf, BENCH_HDR_LEN) != 0 ||
+                bench_write_full (peer->fd, buf, BENCH_HDR_LEN) != 0)
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        for (left = peer->total_bytes; left > 0; left -= peer->frame_size)
+        {
+            if (bench_read_full (peer->fd, buf, peer->frame_size) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    free (buf);
+
+    return NULL;
+}
+
+
+/* connected pair, fd[0] server side, fd[1] consumer side */
+static int bench_connect (int is_unix, int *fd)
+{
+    int opt = 1;
+    int lstn;
+    socklen_t addr_len;
+    struct sockaddr_in addr_in;
+    struct sockaddr_un addr_un;
+    struct sockaddr *addr;
+
+    if (is_unix)
+    {
+        memset (&addr_un, 0, sizeof (addr_un));
+        addr_un.sun_family = AF_UNIX;
+        strncpy (addr_un.sun_path, BENCH_UNIX_PATH, sizeof (addr_un.sun_path) - 1);
+        (void)unlink (BENCH_UNIX_PATH);
+
+        addr = (struct sockaddr *)&addr_un;
+        addr_len = sizeof (addr_un);
+    }
+    else
+    {
+        memset (&addr_in, 0, sizeof (addr_in));
+        addr_in.sin_family = AF_INET;
+        addr_in.sin_port = htons (BENCH_TCP_PORT);
+        addr_in.sin_addr.s_addr = htonl (INADDR_LOOPBACK);
+
+        addr = (struct sockaddr *)&addr_in;
+        addr_len = sizeof (addr_in);
+    }
+
+    lstn = socket (addr->sa_family, SOCK_STREAM, 0);
+
+    if (lstn < 0)
+    {
+        return -1;
+    }
+
+    (void)setsockopt (lstn, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof (opt));
+
+    if (bind (lstn, addr, addr_len) != 0 || listen (lstn, 1) != 0)
+    {
+        close (lstn);
+        return -1;
+    }
+
+    fd[1] = socket (addr->sa_family, SOCK_STREAM, 0);
+
+    if (fd[1] < 0 || connect (fd[1], addr, addr_len) != 0)
+    {
+        close (lstn);
+        return -1;
+    }
+
+    fd[0] = accept (lstn, NULL, NULL);
+    close (lstn);
+
+    if (is_unix)
+    {
+        (void)unlink (BENCH_UNIX_PATH);
+    }
+    else
+    {
+        /* as ctcn_link_set_sock_opt does */
+        (void)setsockopt (fd[0], IPPROTO_TCP, TCP_NODELAY, &opt, sizeof (opt));
+        (void)setsockopt (fd[1], IPPROTO_TCP, TCP_NODELAY, &opt, sizeof (opt));
+    }
+
+    return fd[0] < 0 ? -1 : 0;
+}
+
+
+/* consumer side of the waiting protocol of ctcn_ring.h */
+static void bench_wait_event (volatile UINT_32 *flag,
+                              volatile UINT_64 *pos,
+                              UINT_64 seen,
+                              int fd)
+{
+    UINT_64 cnt;
+    struct pollfd pfd;
+
+    __atomic_store_n (flag, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (pos, __ATOMIC_ACQUIRE) != seen)
+    {
+        return;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    (void)poll (&pfd, 1, 1000);
+    (void)read (fd, &cnt, sizeof (cnt));
+}
+
+
+static void bench_post_event (volatile UINT_32 *flag, int fd)
+{
+    UINT_64 one = 1;
+
+    __atomic_thread_fence (__ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n (flag, __ATOMIC_RELAXED) != 0 &&
+        __atomic_exchange_n (flag, 0, __ATOMIC_SEQ_CST) != 0)
+    {
+        (void)write (fd, &one, sizeof (one));
+    }
+}
+
+
+/* consumer side of the ring, frames are read in place */
+static void *bench_ring_peer_main (void *arg)
+{
+    UINT_32 len;
+    UINT_32 type;
+    UINT_64 head;
+    UINT_64 tail = 0;
+    long long left;
+    char *rec;
+    BENCH_RING_PEER *peer = (BENCH_RING_PEER *)arg;
+    CTCN_RING_HDR *hdr = peer->hdr;
+    char *data = (char *)hdr + hdr->data_offset;
+    UINT_64 mask = hdr->data_size - 1;
+
+    for (left = peer->total_bytes; left > 0; )
+    {
+        head = __atomic_load_n (&hdr->head, __ATOMIC_ACQUIRE);
+
+        if (head == tail)
+        {
+            bench_wait_event (&hdr->is_consumer_waiting, 
+                              &hdr->head, 
+                              tail, 
+                              peer->data_fd);
+            continue;
+        }
+
+        while (tail != head)
+        {
+            rec = data + (tail & mask);
+            len = ((UINT_32 *)rec)[0];
+            type = ((UINT_32 *)rec)[1];
+
+            if (type == CTCN_RING_REC_FRAME)
+            {
+                /* a consumer decodes the frame where it is */
+                peer->checksum += (unsigned char)rec[CTCN_RING_REC_HDR_LEN] + 
+                                  (unsigned char)rec[CTCN_RING_REC_HDR_LEN + len - 1];
+                left -= len;
+            }
+
+            tail += CTCN_RING_REC_LEN (len);
+        }
+
+        __atomic_store_n (&hdr->tail, tail, __ATOMIC_RELEASE);
+        bench_post_event (&hdr->is_server_waiting, peer->room_fd);
+    }
+
+    return NULL;
+}
+
+
+static int bench_run_ring (int frame_size, long long total_bytes)
+{
+    int result;
+    long long left;
+    double start;
+    double elapsed;
+    char *frame;
+    struct iovec iov[2];
+    pthread_t thr;
+    CTCN_RING *ring;
+    BENCH_RING_PEER peer;
+
+    if (ctcn_ring_create (BENCH_RING_SIZE, &ring) != CTC_SUCCESS)
+    {
+        fprintf (stderr, "shm : cannot create ring\n");
+        return -1;
+    }
+
+    frame = (char *)calloc (1, frame_size);
+
+    if (frame == NULL)
+    {
+        ctcn_ring_destroy (ring);
+        return -1;
+    }
+
+    /* header and data apart, as ctcn_link_build_iov gives them */
+    iov[0].iov_base = frame;
+    iov[0].iov_len = BENCH_HDR_LEN;
+    iov[1].iov_base = frame + BENCH_HDR_LEN;
+    iov[1].iov_len = frame_size - BENCH_HDR_LEN;
+
+    /* the consumer maps the same memfd, one mapping does here */
+    peer.hdr = ring->hdr;
+    peer.data_fd = ring->data_fd;
+    peer.room_fd = ring->room_fd;
+    peer.total_bytes = total_bytes;
+    peer.checksum = 0;
+
+    pthread_create (&thr, NULL, bench_ring_peer_main, &peer);
+
+    start = bench_now_usec ();
+
+    for (left = total_bytes; left > 0; left -= frame_size)
+    {
+        /* as ctcn_link_send_ring does */
+        while ((result = ctcn_ring_write (ring, 
+                                          iov, 
+                                          2, 
+                                          frame_size)) == CTCN_RESULT_EAGAIN)
+        {
+            result = ctcn_ring_wait_room (ring, 
+                                          frame_size, 
+                                          BENCH_RING_WAIT_MSEC);
+
+            if (result != CTC_SUCCESS)
+            {
+                break;
+            }
+        }
+
+        if (result != CTC_SUCCESS)
+        {
+            fprintf (stderr, "shm : cannot write frame, %d\n", result);
+            break;
+        }
+    }
+
+    if (left > 0)
+    {
+        /* consumer waits for frames not written */
+        pthread_cancel (thr);
+    }
+
+    pthread_join (thr, NULL);
+    elapsed = bench_now_usec () - start;
+
+    if (left <= 0)
+    {
+        printf ("shm   throughput %8.1f MB/s  (%d byte frames, %lld MB)\n",
+                (total_bytes / (1024.0 * 1024.0)) / (elapsed / 1000000.0),
+                frame_size,
+                total_bytes / (1024 * 1024));
+    }
+
+    ctcn_ring_destroy (ring);
+    free (frame);
+
+    return left > 0 ? -1 : 0;
+}
+
+
+static int bench_compare_double (const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+
+static int bench_run (int is_unix, int frame_size, long long total_bytes, int round_trips)
+{
+    int i;
+    int fd[2];
+    long long left;
+    double start;
+    double elapsed;
+    double *rtt;
+    char *frame;
+    char hdr[BENCH_HDR_LEN];
+    pthread_t thr;
+    BENCH_PEER peer;
+    const char *name = is_unix ? "unix" : "tcp ";
+
+    frame = (char *)calloc (1, frame_size);
+    rtt = (double *)malloc (sizeof (double) * round_trips);
+
+    if (frame == NULL || rtt == NULL)
+    {
+        return -1;
+    }
+
+    /* throughput */
+    if (bench_connect (is_unix, fd) != 0)
+    {
+        fprintf (stderr, "%s: cannot connect\n", name);
+        return -1;
+    }
+
+    peer.fd = fd[1];
+    peer.frame_size = frame_size;
+    peer.total_bytes = total_bytes;
+    peer.round_trips = 0;
+    peer.is_echo = 0;
+
+    pthread_create (&thr, NULL, bench_peer_main, &peer);
+
+    start = bench_now_usec ();
+
+    for (left = total_bytes; left > 0; left -= frame_size)
+    {
+        if (bench_write_full (fd[0], frame, frame_size) != 0)
+        {
+            break;
+        }
+    }
+
+    pthread_join (thr, NULL);
+    elapsed = bench_now_usec () - start;
+
+    close (fd[0]);
+    close (fd[1]);
+
+    printf ("%s  throughput %8.1f MB/s  (%d byte frames, %lld MB)\n",
+            name,
+            (total_bytes / (1024.0 * 1024.0)) / (elapsed / 1000000.0),
+            frame_size,
+            total_bytes / (1024 * 1024));
+
+    /* latency */
+    if (bench_connect (is_unix, fd) != 0)
+    {
+        fprintf (stderr, "%s: cannot connect\n", name);
+        return -1;
+    }
+
+    peer.fd = fd[1];
+    peer.frame_size = BENCH_HDR_LEN;
+    peer.total_bytes = 0;
+    peer.round_trips = round_trips;
+    peer.is_echo = 1;
+
+    pthread_create (&thr, NULL, bench_peer_main, &peer);
+
+    memset (hdr, 0, sizeof (hdr));
+
+    for (i = 0; i < round_trips; i++)
+    {
+        start = bench_now_usec ();
+
+        if (bench_write_full (fd[0], hdr, BENCH_HDR_LEN) != 0 ||
+            bench_read_full (fd[0], hdr, BENCH_HDR_LEN) != 0)
+        {
+            break;
+        }
+
+        rtt[i] = bench_now_usec () - start;
+    }
+
+    pthread_join (thr, NULL);
+
+    close (fd[0]);
+    close (fd[1]);
+
+    qsort (rtt, i, sizeof (double), bench_compare_double);
+
+    printf ("%s  round trip p50 %6.1f usec  p99 %6.1f usec  (%d trips)\n",
+            name,
+            rtt[i / 2],
+            rtt[(int)(i * 0.99)],
+            i);
+
+    free (frame);
+    free (rtt);
+
+    return 0;
+}
+
+
+int main (int argc, char **argv)
+{
+    int frame_size = BENCH_FRAME_SIZE;
+    int round_trips = BENCH_ROUND_TRIPS;
+    long long total_bytes = (long long)BENCH_TOTAL_MB * 1024 * 1024;
+
+    if (argc > 1)
+    {
+        frame_size = atoi (argv[1]);
+    }
+
+    if (argc > 2)
+    {
+        total_bytes = atoll (argv[2]) * 1024 * 1024;
+    }
+
+    if (argc > 3)
+    {
+        round_trips = atoi (argv[3]);
+    }
+
+    if (frame_size < BENCH_HDR_LEN || total_bytes <= 0 || round_trips <= 0)
+    {
+        fprintf (stderr,
+                 "usage: %s [<frame size> [<total MB> [<round trips>]]]\n",
+                 argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (bench_run (0, frame_size, total_bytes, round_trips) != 0 ||
+        bench_run (1, frame_size, total_bytes, round_trips) != 0 ||
+        bench_run_ring (frame_size, total_bytes) != 0)
+    {
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}